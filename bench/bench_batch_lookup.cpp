@@ -0,0 +1,197 @@
+// bench/bench_batch_lookup.cpp
+//
+// Usage:
+//   bench_batch_lookup [--keys N] [--queries Q] [--alphabet A] [--max-batch B] [--seed S]
+//
+// Example:
+//   ./bench_batch_lookup --keys 2000000 --queries 1000000
+//
+// Notes:
+// - ランダムなキー（長さ 2..12, 文字種 A）で LOUDS を作り、同じクエリ列に対して
+//   getNodeIndex / commonPrefixSearch を 1 件ずつ呼んだ場合と、
+//   getNodeIndexBatch / commonPrefixSearchBatch をバッチ幅 1, 2, 4, ..., B で呼んだ場合の ns/query を比べる。
+// - クエリは半分が登録済みキー、半分がその末尾を変えたもの。
+// - 辞書がキャッシュに収まると差が出ないので、--keys は LLC を十分超える大きさにする。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+
+#include "prefix/prefix_tree.hpp"
+#include "louds/converter.hpp"
+#include "louds/louds.hpp"
+#include "louds/louds_reader.hpp"
+
+struct Args
+{
+    uint64_t keys = 1000000;
+    uint64_t queries = 500000;
+    uint32_t alphabet = 64;
+    size_t max_batch = 256;
+    uint32_t seed = 12345;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " [--keys N] [--queries Q] [--alphabet A] [--max-batch B] [--seed S]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--keys")
+            a.keys = static_cast<uint64_t>(std::stoull(need("--keys")));
+        else if (k == "--queries")
+            a.queries = static_cast<uint64_t>(std::stoull(need("--queries")));
+        else if (k == "--alphabet")
+            a.alphabet = static_cast<uint32_t>(std::stoul(need("--alphabet")));
+        else if (k == "--max-batch")
+            a.max_batch = static_cast<size_t>(std::stoull(need("--max-batch")));
+        else if (k == "--seed")
+            a.seed = static_cast<uint32_t>(std::stoul(need("--seed")));
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.keys == 0 || a.queries == 0 || a.alphabet == 0 || a.max_batch == 0)
+    {
+        std::cerr << "--keys, --queries, --alphabet and --max-batch must be positive\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+// ひらがな始まりの連続した文字種から引く
+static std::u32string random_key(std::mt19937_64 &rng, uint32_t alphabet)
+{
+    std::uniform_int_distribution<int> len(2, 12);
+    std::uniform_int_distribution<uint32_t> ch(0, alphabet - 1);
+    std::u32string s(static_cast<size_t>(len(rng)), U'\0');
+    for (char32_t &c : s)
+        c = static_cast<char32_t>(0x3041 + ch(rng));
+    return s;
+}
+
+template <class Fn>
+static double ns_per_query(size_t queries, Fn fn, uint64_t &checksum)
+{
+    checksum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    fn(checksum);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / static_cast<double>(queries);
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Args args = parse_args(argc, argv);
+        std::mt19937_64 rng(args.seed);
+
+        std::vector<std::u32string> keys;
+        keys.reserve(static_cast<size_t>(args.keys));
+        LOUDS louds;
+        {
+            PrefixTree tree;
+            for (uint64_t i = 0; i < args.keys; ++i)
+            {
+                keys.push_back(random_key(rng, args.alphabet));
+                tree.insert(keys.back());
+            }
+            Converter conv;
+            louds = conv.convert(tree.getRoot());
+        }
+        const LOUDSReader reader(louds.LBS, louds.isLeaf, louds.labels);
+
+        std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+        std::vector<std::u32string> words(static_cast<size_t>(args.queries));
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            words[i] = keys[pick(rng)];
+            if (i % 2 == 1)
+                words[i].back() = static_cast<char32_t>(words[i].back() + 1);
+        }
+        const std::vector<std::u32string_view> queries(words.begin(), words.end());
+
+        uint64_t base = 0;
+        const double nsNode = ns_per_query(queries.size(), [&](uint64_t &sum)
+                                           {
+                                               for (const std::u32string &w : words)
+                                                   sum += static_cast<uint64_t>(reader.getNodeIndex(w) + 1); }, base);
+        uint64_t baseCps = 0;
+        const double nsCps = ns_per_query(queries.size(), [&](uint64_t &sum)
+                                          {
+                                              for (std::u32string_view q : queries)
+                                                  reader.commonPrefixSearch(q, [&](size_t length, LoudsPos)
+                                                                            { sum += length; }); }, baseCps);
+
+        std::cout << "keys=" << args.keys << " queries=" << args.queries
+                  << " lbs_bits=" << louds.LBS.size() << " labels=" << louds.labels.size() << "\n";
+        std::cout << "ns_get_node_index_single=" << nsNode << " ns_cps_single=" << nsCps << "\n";
+        std::cout << "batch ns_get_node_index ns_cps speedup_get_node_index speedup_cps\n";
+
+        std::vector<LoudsPos> out(args.max_batch);
+        for (size_t batch = 1; batch <= args.max_batch; batch *= 2)
+        {
+            uint64_t c = 0;
+            const double nsB = ns_per_query(queries.size(), [&](uint64_t &sum)
+                                            {
+                                                for (size_t i = 0; i < queries.size(); i += batch)
+                                                {
+                                                    const size_t n = std::min(batch, queries.size() - i);
+                                                    const std::span<LoudsPos> o(out.data(), n);
+                                                    reader.getNodeIndexBatch(std::span<const std::u32string_view>(queries).subspan(i, n), o);
+                                                    for (LoudsPos p : o)
+                                                        sum += static_cast<uint64_t>(p + 1);
+                                                } }, c);
+            if (c != base)
+                throw std::runtime_error("getNodeIndexBatch result differs from getNodeIndex");
+
+            const double nsC = ns_per_query(queries.size(), [&](uint64_t &sum)
+                                            {
+                                                for (size_t i = 0; i < queries.size(); i += batch)
+                                                {
+                                                    const size_t n = std::min(batch, queries.size() - i);
+                                                    reader.commonPrefixSearchBatch(std::span<const std::u32string_view>(queries).subspan(i, n),
+                                                                                   [&](size_t, size_t length, LoudsPos)
+                                                                                   { sum += length; });
+                                                } }, c);
+            if (c != baseCps)
+                throw std::runtime_error("commonPrefixSearchBatch result differs from commonPrefixSearch");
+
+            std::cout << batch << " " << nsB << " " << nsC << " " << (nsNode / nsB) << " " << (nsCps / nsC) << "\n";
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
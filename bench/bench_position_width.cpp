@@ -0,0 +1,185 @@
+// bench/bench_position_width.cpp
+//
+// Usage:
+//   bench_position_width [--bits N] [--density D] [--queries Q] [--seed S]
+//
+// Example:
+//   ./bench_position_width --bits 100000000 --density 0.5
+//
+// Notes:
+// - 同じビット列に対して BasicSuccinctBitVector<int32_t> と <int64_t> を作り、
+//   rank1 / select0 / select1 と LOUDS の firstChild 相当（select0(rank1(p)) + 1）の ns/op を比べる。
+// - 32bit 幅で表せる範囲（N < 2^31）で測る。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+
+struct Args
+{
+    uint64_t bits = 1ULL << 26;
+    double density = 0.5;
+    uint64_t queries = 2000000;
+    uint32_t seed = 12345;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " [--bits N] [--density D] [--queries Q] [--seed S]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--bits")
+            a.bits = static_cast<uint64_t>(std::stoull(need("--bits")));
+        else if (k == "--density")
+            a.density = std::stod(need("--density"));
+        else if (k == "--queries")
+            a.queries = static_cast<uint64_t>(std::stoull(need("--queries")));
+        else if (k == "--seed")
+            a.seed = static_cast<uint32_t>(std::stoul(need("--seed")));
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.bits == 0 || a.bits >= (1ULL << 31))
+    {
+        std::cerr << "--bits must be in [1, 2^31)\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+static BitVector random_bits(uint64_t nbits, double density, uint32_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::bernoulli_distribution coin(density);
+    std::vector<uint64_t> words(static_cast<size_t>((nbits + 63) / 64), 0ULL);
+    for (uint64_t i = 0; i < nbits; ++i)
+    {
+        if (coin(rng))
+            words[static_cast<size_t>(i >> 6)] |= 1ULL << (i & 63);
+    }
+    BitVector bv;
+    bv.assign_from_words(static_cast<size_t>(nbits), std::move(words));
+    return bv;
+}
+
+template <class Fn>
+static double ns_per_op(const std::vector<uint64_t> &qs, Fn fn, uint64_t &checksum)
+{
+    checksum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t q : qs)
+        checksum += static_cast<uint64_t>(fn(q));
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / static_cast<double>(qs.size());
+}
+
+struct WidthResult
+{
+    double ns_rank1 = 0.0;
+    double ns_select0 = 0.0;
+    double ns_select1 = 0.0;
+    double ns_first_child = 0.0;
+    uint64_t checksum = 0;
+};
+
+template <class Pos>
+static WidthResult run_width(const BitVector &bv,
+                             const std::vector<uint64_t> &positions,
+                             const std::vector<uint64_t> &q1,
+                             const std::vector<uint64_t> &q0)
+{
+    BasicSuccinctBitVector<Pos> sbv(bv);
+    WidthResult r;
+    uint64_t c = 0;
+
+    r.ns_rank1 = ns_per_op(positions, [&](uint64_t p)
+                           { return sbv.rank1(static_cast<Pos>(p)); }, c);
+    r.checksum += c;
+    r.ns_select1 = ns_per_op(q1, [&](uint64_t k)
+                             { return sbv.select1(static_cast<Pos>(k)); }, c);
+    r.checksum += c;
+    r.ns_select0 = ns_per_op(q0, [&](uint64_t k)
+                             { return sbv.select0(static_cast<Pos>(k)); }, c);
+    r.checksum += c;
+    r.ns_first_child = ns_per_op(positions, [&](uint64_t p)
+                                 { return sbv.select0(sbv.rank1(static_cast<Pos>(p))) + 1; }, c);
+    r.checksum += c;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Args args = parse_args(argc, argv);
+        BitVector bv = random_bits(args.bits, args.density, args.seed);
+
+        BasicSuccinctBitVector<int64_t> probe(bv);
+        const uint64_t ones = static_cast<uint64_t>(probe.totalOnes());
+        const uint64_t zeros = args.bits - ones;
+        if (ones == 0 || zeros == 0)
+            throw std::runtime_error("bit vector must contain both 0 and 1");
+
+        std::mt19937_64 rng(args.seed);
+        std::uniform_int_distribution<uint64_t> dp(0, args.bits - 1);
+        std::uniform_int_distribution<uint64_t> d1(1, ones);
+        std::uniform_int_distribution<uint64_t> d0(1, zeros);
+        std::vector<uint64_t> positions(static_cast<size_t>(args.queries));
+        std::vector<uint64_t> q1(static_cast<size_t>(args.queries));
+        std::vector<uint64_t> q0(static_cast<size_t>(args.queries));
+        for (auto &q : positions)
+            q = dp(rng);
+        for (auto &q : q1)
+            q = d1(rng);
+        for (auto &q : q0)
+            q = d0(rng);
+
+        const WidthResult r32 = run_width<int32_t>(bv, positions, q1, q0);
+        const WidthResult r64 = run_width<int64_t>(bv, positions, q1, q0);
+        if (r32.checksum != r64.checksum)
+            throw std::runtime_error("results differ between 32-bit and 64-bit positions");
+
+        std::cout << "bits=" << args.bits << " ones=" << ones << " zeros=" << zeros << "\n";
+        std::cout << "queries=" << args.queries << "\n";
+        std::cout << "ns_rank1_32=" << r32.ns_rank1 << " ns_rank1_64=" << r64.ns_rank1 << "\n";
+        std::cout << "ns_select1_32=" << r32.ns_select1 << " ns_select1_64=" << r64.ns_select1 << "\n";
+        std::cout << "ns_select0_32=" << r32.ns_select0 << " ns_select0_64=" << r64.ns_select0 << "\n";
+        std::cout << "ns_first_child_32=" << r32.ns_first_child << " ns_first_child_64=" << r64.ns_first_child << "\n";
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
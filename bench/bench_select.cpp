@@ -0,0 +1,244 @@
+// bench/bench_select.cpp
+//
+// Usage:
+//   bench_select [--dict <dict.bin>] [--bits N] [--density D] [--queries Q] [--seed S]
+//
+// Example:
+//   ./bench_select --dict ../out/jawiki_latest_utf16.louds_utf16.bin
+//
+// Notes:
+// - --dict には LOUDS / LOUDSUtf16 / LOUDSWithTermId(Utf16) のいずれの .bin も渡せる。
+//   どの形式も先頭が LBS の BitVector（nbits, words）なので、LBS だけを読む。
+// - --dict を省略した場合は密度 D の乱数ビット列（N bit）で測る。
+// - 旧実装（大ブロック二分探索）とサンプル付き select を同じクエリ列で比較し、結果の一致も確認する。
+// - 続けて bit_ops のカーネル（CPU が対応しているものすべて）ごとに、ディレクトリ構築・rank1・select1・select0 を測る。
+//   1 行 1 カーネルで "kernel seconds_build ns_rank1 ns_select1 ns_select0" を出す（* が自動選択のカーネル）。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+#include "common/bit_ops.hpp"
+#include "legacy_succinct_bit_vector.hpp"
+
+struct Args
+{
+    std::string dict;
+    uint64_t bits = 1ULL << 26;
+    double density = 0.5;
+    uint64_t queries = 2000000;
+    uint32_t seed = 12345;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " [--dict <dict.bin>] [--bits N] [--density D] [--queries Q] [--seed S]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--dict")
+            a.dict = need("--dict");
+        else if (k == "--bits")
+            a.bits = static_cast<uint64_t>(std::stoull(need("--bits")));
+        else if (k == "--density")
+            a.density = std::stod(need("--density"));
+        else if (k == "--queries")
+            a.queries = static_cast<uint64_t>(std::stoull(need("--queries")));
+        else if (k == "--seed")
+            a.seed = static_cast<uint32_t>(std::stoul(need("--seed")));
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    return a;
+}
+
+static BitVector read_lbs(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    uint64_t nbits = 0;
+    uint64_t nwords = 0;
+    ifs.read(reinterpret_cast<char *>(&nbits), sizeof(nbits));
+    ifs.read(reinterpret_cast<char *>(&nwords), sizeof(nwords));
+    std::vector<uint64_t> words(static_cast<size_t>(nwords));
+    ifs.read(reinterpret_cast<char *>(words.data()),
+             static_cast<std::streamsize>(nwords * sizeof(uint64_t)));
+    if (!ifs)
+        throw std::runtime_error("failed to read LBS from: " + path);
+
+    BitVector bv;
+    bv.assign_from_words(static_cast<size_t>(nbits), std::move(words));
+    return bv;
+}
+
+static BitVector random_bits(uint64_t nbits, double density, uint32_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::bernoulli_distribution coin(density);
+    std::vector<uint64_t> words(static_cast<size_t>((nbits + 63) / 64), 0ULL);
+    for (uint64_t i = 0; i < nbits; ++i)
+    {
+        if (coin(rng))
+            words[static_cast<size_t>(i >> 6)] |= 1ULL << (i & 63);
+    }
+    BitVector bv;
+    bv.assign_from_words(static_cast<size_t>(nbits), std::move(words));
+    return bv;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// 同じクエリ列で select を回し、ns/op と結果の checksum を返す
+template <class Fn>
+static double time_queries(const std::vector<int> &qs, Fn fn, uint64_t &checksum)
+{
+    checksum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int q : qs)
+        checksum += static_cast<uint64_t>(fn(q));
+    return seconds_since(t0) * 1e9 / static_cast<double>(qs.size());
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Args args = parse_args(argc, argv);
+
+        BitVector bv = args.dict.empty()
+                           ? random_bits(args.bits, args.density, args.seed)
+                           : read_lbs(args.dict);
+
+        auto t_legacy = std::chrono::steady_clock::now();
+        LegacySuccinctBitVector legacy(bv);
+        const double seconds_build_legacy = seconds_since(t_legacy);
+
+        auto t_sampled = std::chrono::steady_clock::now();
+        SuccinctBitVector sampled(bv);
+        const double seconds_build_sampled = seconds_since(t_sampled);
+
+        const int ones = sampled.totalOnes();
+        const int zeros = sampled.size() - ones;
+        if (ones == 0 || zeros == 0)
+            throw std::runtime_error("bit vector must contain both 0 and 1");
+
+        std::mt19937 rng(args.seed);
+        std::uniform_int_distribution<int> d1(1, ones);
+        std::uniform_int_distribution<int> d0(1, zeros);
+        std::vector<int> q1(static_cast<size_t>(args.queries));
+        std::vector<int> q0(static_cast<size_t>(args.queries));
+        for (auto &q : q1)
+            q = d1(rng);
+        for (auto &q : q0)
+            q = d0(rng);
+
+        uint64_t c_legacy = 0;
+        uint64_t c_sampled = 0;
+
+        const double ns_select1_legacy = time_queries(q1, [&](int k)
+                                                      { return legacy.select1(k); }, c_legacy);
+        const double ns_select1_sampled = time_queries(q1, [&](int k)
+                                                       { return sampled.select1(k); }, c_sampled);
+        if (c_legacy != c_sampled)
+            throw std::runtime_error("select1 results differ between implementations");
+
+        const double ns_select0_legacy = time_queries(q0, [&](int k)
+                                                      { return legacy.select0(k); }, c_legacy);
+        const double ns_select0_sampled = time_queries(q0, [&](int k)
+                                                       { return sampled.select0(k); }, c_sampled);
+        if (c_legacy != c_sampled)
+            throw std::runtime_error("select0 results differ between implementations");
+
+        std::cout << "source=" << (args.dict.empty() ? "random" : args.dict) << "\n";
+        std::cout << "bits=" << sampled.size() << " ones=" << ones << " zeros=" << zeros << "\n";
+        std::cout << "queries=" << args.queries << "\n";
+        std::cout << "seconds_build_legacy=" << seconds_build_legacy << "\n";
+        std::cout << "seconds_build_sampled=" << seconds_build_sampled << "\n";
+        std::cout << "ns_select1_legacy=" << ns_select1_legacy << "\n";
+        std::cout << "ns_select1_sampled=" << ns_select1_sampled << "\n";
+        std::cout << "ns_select0_legacy=" << ns_select0_legacy << "\n";
+        std::cout << "ns_select0_sampled=" << ns_select0_sampled << "\n";
+
+        // カーネルごと（結果は自動選択のカーネルと一致すること）
+        std::uniform_int_distribution<int> dpos(0, sampled.size() - 1);
+        std::vector<int> qr(static_cast<size_t>(args.queries));
+        for (auto &q : qr)
+            q = dpos(rng);
+
+        const bit_ops::Kernel detected = bit_ops::activeKernel();
+        uint64_t baseRank = 0, baseSelect1 = 0, baseSelect0 = 0;
+        bool first = true;
+        std::cout << "kernel seconds_build ns_rank1 ns_select1 ns_select0\n";
+        for (bit_ops::Kernel k : {bit_ops::Kernel::Portable, bit_ops::Kernel::Popcnt,
+                                  bit_ops::Kernel::Bmi2, bit_ops::Kernel::Avx512})
+        {
+            if (!bit_ops::setKernel(k))
+                continue;
+            auto t_build = std::chrono::steady_clock::now();
+            SuccinctBitVector sbv(bv);
+            const double seconds_build = seconds_since(t_build);
+
+            uint64_t cRank = 0, cSelect1 = 0, cSelect0 = 0;
+            const double ns_rank1 = time_queries(qr, [&](int i)
+                                                 { return sbv.rank1(i); }, cRank);
+            const double ns_select1 = time_queries(q1, [&](int i)
+                                                   { return sbv.select1(i); }, cSelect1);
+            const double ns_select0 = time_queries(q0, [&](int i)
+                                                   { return sbv.select0(i); }, cSelect0);
+            if (first)
+            {
+                baseRank = cRank;
+                baseSelect1 = cSelect1;
+                baseSelect0 = cSelect0;
+                first = false;
+            }
+            else if (cRank != baseRank || cSelect1 != baseSelect1 || cSelect0 != baseSelect0)
+            {
+                throw std::runtime_error(std::string("results differ for kernel ") + bit_ops::kernelName(k));
+            }
+            std::cout << bit_ops::kernelName(k) << (k == detected ? "*" : "") << " " << seconds_build << " "
+                      << ns_rank1 << " " << ns_select1 << " " << ns_select0 << "\n";
+        }
+        bit_ops::setKernel(detected);
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
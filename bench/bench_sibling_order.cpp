@@ -0,0 +1,280 @@
+// bench/bench_sibling_order.cpp
+//
+// Usage:
+//   bench_sibling_order [--keys N] [--queries Q] [--alphabet A] [--zipf S] [--rounds R] [--seed S]
+//                       [--keys-file <utf8 lines>] [--query-log <utf8 lines>]
+//
+// Example:
+//   ./bench_sibling_order --keys 1000000 --queries 2000000 --alphabet 80 --zipf 1.1
+//   ./bench_sibling_order --keys-file titles.txt --query-log queries.txt
+//
+// Notes:
+// - 同じキーから兄弟の並びだけ違う 3 つの辞書（.img）を作り、同じクエリログを getNodeIndex / commonPrefixSearch で再生する。
+//     label      : ラベル昇順（CodeUnitAscending）。兄弟が 32 以上の区間は二分探索
+//     label-scan : ラベル昇順のまま Unordered として保存（常に先頭からの線形探索。並びの効果と探索方法の効果を分ける）
+//     frequency  : クエリログのアクセス数の降順（FrequencyDescending）。先頭からの線形探索で最初の一致で止まる
+// - クエリログの前半で重みを数え、後半を再生する（学習に使ったクエリをそのまま測らない）。
+// - --query-log を省くとキーを Zipf(S) で引いたログを作る。S が大きいほど偏りが強く frequency が効く。
+// - 3 つの辞書の結果（チェックサム）が一致しなければ失敗する。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "prefix/prefix_tree.hpp"
+#include "louds/converter.hpp"
+#include "louds/louds.hpp"
+#include "louds/louds_reader.hpp"
+#include "common/frequency_order.hpp"
+#include "common/utf8.hpp"
+
+namespace fs = std::filesystem;
+
+struct Args
+{
+    uint64_t keys = 500000;
+    uint64_t queries = 1000000;
+    uint32_t alphabet = 80;
+    double zipf = 1.0;
+    uint32_t rounds = 3;
+    uint32_t seed = 12345;
+    std::string keys_file;
+    std::string query_log;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " [--keys N] [--queries Q] [--alphabet A] [--zipf S] [--rounds R] [--seed S]"
+        << " [--keys-file <file>] [--query-log <file>]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--keys")
+            a.keys = static_cast<uint64_t>(std::stoull(need("--keys")));
+        else if (k == "--queries")
+            a.queries = static_cast<uint64_t>(std::stoull(need("--queries")));
+        else if (k == "--alphabet")
+            a.alphabet = static_cast<uint32_t>(std::stoul(need("--alphabet")));
+        else if (k == "--zipf")
+            a.zipf = std::stod(need("--zipf"));
+        else if (k == "--rounds")
+            a.rounds = static_cast<uint32_t>(std::stoul(need("--rounds")));
+        else if (k == "--seed")
+            a.seed = static_cast<uint32_t>(std::stoul(need("--seed")));
+        else if (k == "--keys-file")
+            a.keys_file = need("--keys-file");
+        else if (k == "--query-log")
+            a.query_log = need("--query-log");
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.keys == 0 || a.queries < 2 || a.alphabet == 0 || a.rounds == 0 || a.zipf < 0.0)
+    {
+        std::cerr << "--keys, --alphabet and --rounds must be positive, --queries >= 2 and --zipf >= 0\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+// 1 行 1 語の UTF-8 ファイル（空行と不正な行は飛ばす）
+static std::vector<std::u32string> read_lines(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open: " + path);
+    std::vector<std::u32string> out;
+    std::string line;
+    std::u32string s;
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && utf8::toUtf32(line, s))
+            out.push_back(s);
+    }
+    return out;
+}
+
+// ひらがな始まりの連続した文字種から引く
+static std::u32string random_key(std::mt19937_64 &rng, uint32_t alphabet)
+{
+    std::uniform_int_distribution<int> len(2, 12);
+    std::uniform_int_distribution<uint32_t> ch(0, alphabet - 1);
+    std::u32string s(static_cast<size_t>(len(rng)), U'\0');
+    for (char32_t &c : s)
+        c = static_cast<char32_t>(0x3041 + ch(rng));
+    return s;
+}
+
+// keys を Zipf(s) で引いたクエリログ（順位はキーをシャッフルして決める）
+static std::vector<std::u32string> zipf_log(std::mt19937_64 &rng, const std::vector<std::u32string> &keys,
+                                            size_t queries, double s)
+{
+    std::vector<size_t> rank(keys.size());
+    for (size_t i = 0; i < rank.size(); ++i)
+        rank[i] = i;
+    std::shuffle(rank.begin(), rank.end(), rng);
+
+    std::vector<double> cdf(keys.size());
+    double sum = 0.0;
+    for (size_t i = 0; i < cdf.size(); ++i)
+    {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+        cdf[i] = sum;
+    }
+
+    std::uniform_real_distribution<double> u(0.0, sum);
+    std::vector<std::u32string> log(queries);
+    for (std::u32string &q : log)
+    {
+        const size_t r = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin());
+        q = keys[rank[std::min(r, rank.size() - 1)]];
+    }
+    return log;
+}
+
+struct Layout
+{
+    const char *name;
+    fs::path path;
+};
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Args args = parse_args(argc, argv);
+        std::mt19937_64 rng(args.seed);
+
+        std::vector<std::u32string> keys;
+        if (!args.keys_file.empty())
+        {
+            keys = read_lines(args.keys_file);
+        }
+        else
+        {
+            keys.reserve(static_cast<size_t>(args.keys));
+            for (uint64_t i = 0; i < args.keys; ++i)
+                keys.push_back(random_key(rng, args.alphabet));
+        }
+        if (keys.empty())
+            throw std::runtime_error("no keys");
+
+        const std::vector<std::u32string> log = args.query_log.empty()
+                                                    ? zipf_log(rng, keys, static_cast<size_t>(args.queries), args.zipf)
+                                                    : read_lines(args.query_log);
+        if (log.size() < 2)
+            throw std::runtime_error("query log needs at least 2 queries");
+        const size_t half = log.size() / 2;
+        const std::vector<std::u32string_view> replay(log.begin() + static_cast<std::ptrdiff_t>(half), log.end());
+
+        const fs::path dir = fs::temp_directory_path();
+        const std::string tag = std::to_string(args.seed);
+        const Layout layouts[] = {
+            {"label", dir / ("bench_sibling_order_label_" + tag + ".img")},
+            {"label-scan", dir / ("bench_sibling_order_scan_" + tag + ".img")},
+            {"frequency", dir / ("bench_sibling_order_freq_" + tag + ".img")},
+        };
+        {
+            PrefixTree tree;
+            for (const std::u32string &k : keys)
+                tree.insert(k);
+            NodeWeights<PrefixNode> weights;
+            for (size_t i = 0; i < half; ++i)
+                weights.addQuery(tree.getRoot(), log[i]);
+
+            Converter conv;
+            LOUDS byLabel = conv.convert(tree.getRoot());
+            byLabel.saveToImageFile(layouts[0].path.string());
+            byLabel.siblingOrder = louds_image::SiblingOrder::Unordered;
+            byLabel.saveToImageFile(layouts[1].path.string());
+            conv.convertByFrequency(tree.getRoot(), weights).saveToImageFile(layouts[2].path.string());
+        }
+
+        std::cout << "keys=" << keys.size() << " queries_train=" << half << " queries_replay=" << replay.size();
+        if (args.query_log.empty())
+            std::cout << " zipf=" << args.zipf << " alphabet=" << args.alphabet;
+        std::cout << "\n";
+        std::cout << "layout ns_get_node_index ns_cps\n";
+
+        uint64_t baseNode = 0;
+        uint64_t baseCps = 0;
+        for (const Layout &layout : layouts)
+        {
+            const LOUDSReader reader = LOUDSReader::mapFromImageFile(layout.path.string());
+            double bestNode = 0.0;
+            double bestCps = 0.0;
+            uint64_t sumNode = 0;
+            uint64_t sumCps = 0;
+            for (uint32_t round = 0; round < args.rounds; ++round)
+            {
+                sumNode = 0;
+                sumCps = 0;
+                auto t0 = std::chrono::steady_clock::now();
+                // ノード位置は並びで変わるので、見つかった件数を比べる
+                for (size_t i = half; i < log.size(); ++i)
+                    sumNode += (reader.getNodeIndex(log[i]) >= 0) ? 1 : 0;
+                auto t1 = std::chrono::steady_clock::now();
+                for (std::u32string_view q : replay)
+                    reader.commonPrefixSearch(q, [&](size_t length, LoudsPos)
+                                              { sumCps += length; });
+                auto t2 = std::chrono::steady_clock::now();
+                const double n = static_cast<double>(replay.size());
+                const double ns0 = std::chrono::duration<double>(t1 - t0).count() * 1e9 / n;
+                const double ns1 = std::chrono::duration<double>(t2 - t1).count() * 1e9 / n;
+                bestNode = (round == 0) ? ns0 : std::min(bestNode, ns0);
+                bestCps = (round == 0) ? ns1 : std::min(bestCps, ns1);
+            }
+            if (&layout == &layouts[0])
+            {
+                baseNode = sumNode;
+                baseCps = sumCps;
+            }
+            else if (sumNode != baseNode || sumCps != baseCps)
+            {
+                throw std::runtime_error(std::string("results differ for layout ") + layout.name);
+            }
+            std::cout << layout.name << " " << bestNode << " " << bestCps << "\n";
+        }
+
+        for (const Layout &layout : layouts)
+            fs::remove(layout.path);
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,222 @@
+// bench/bench_utf8_decode.cpp
+//
+// Usage:
+//   bench_utf8_decode [--lines N] [--min-len A] [--max-len B] [--rounds R] [--seed S]
+//
+// Example:
+//   ./bench_utf8_decode --lines 2000000 --max-len 40
+//
+// Notes:
+// - ASCII だけ / 2 byte だけ / 3 byte だけ（かな・漢字）/ jawiki 風の混在 の 4 種類の行を作り、
+//   utf8::toUtf16 / toUtf32 を 1 行ずつ呼んだときの MB/s をカーネルごとに出す。
+// - 行の長さは A..B 文字（jawiki のタイトルは 10 文字前後が多い）。短い行では SIMD の窓が埋まらないので、
+//   --min-len / --max-len を変えて効き方を見る。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "common/utf8.hpp"
+
+struct Args
+{
+    uint64_t lines = 500000;
+    uint32_t min_len = 1;
+    uint32_t max_len = 24;
+    uint32_t rounds = 3;
+    uint32_t seed = 12345;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " [--lines N] [--min-len A] [--max-len B] [--rounds R] [--seed S]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--lines")
+            a.lines = static_cast<uint64_t>(std::stoull(need("--lines")));
+        else if (k == "--min-len")
+            a.min_len = static_cast<uint32_t>(std::stoul(need("--min-len")));
+        else if (k == "--max-len")
+            a.max_len = static_cast<uint32_t>(std::stoul(need("--max-len")));
+        else if (k == "--rounds")
+            a.rounds = static_cast<uint32_t>(std::stoul(need("--rounds")));
+        else if (k == "--seed")
+            a.seed = static_cast<uint32_t>(std::stoul(need("--seed")));
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.lines == 0 || a.rounds == 0 || a.min_len == 0 || a.max_len < a.min_len)
+    {
+        std::cerr << "--lines, --rounds and --min-len must be positive and --max-len >= --min-len\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+enum class Mix
+{
+    Ascii,
+    TwoByte,
+    ThreeByte,
+    Jawiki,
+};
+
+static const char *mix_name(Mix m)
+{
+    switch (m)
+    {
+    case Mix::Ascii:
+        return "ascii";
+    case Mix::TwoByte:
+        return "2byte";
+    case Mix::ThreeByte:
+        return "3byte";
+    case Mix::Jawiki:
+        return "jawiki";
+    }
+    return "?";
+}
+
+// 1 文字の文字種（Jawiki は ASCII / 2 byte / 3 byte のどれか）
+static Mix pick_class(std::mt19937_64 &rng, Mix mix)
+{
+    if (mix != Mix::Jawiki)
+        return mix;
+    // かな・漢字が中心で、英数字と括弧・記号が混ざる
+    const int r = std::uniform_int_distribution<int>(0, 99)(rng);
+    if (r < 25)
+        return Mix::Ascii;
+    if (r < 30)
+        return Mix::TwoByte;
+    return Mix::ThreeByte;
+}
+
+static char32_t random_char(std::mt19937_64 &rng, Mix cls)
+{
+    switch (cls)
+    {
+    case Mix::Ascii:
+        return static_cast<char32_t>(std::uniform_int_distribution<int>(0x21, 0x7E)(rng));
+    case Mix::TwoByte:
+        return static_cast<char32_t>(std::uniform_int_distribution<int>(0xC0, 0x24F)(rng));
+    default:
+        return static_cast<char32_t>(std::uniform_int_distribution<int>(0x3041, 0x9FFF)(rng));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Args args = parse_args(argc, argv);
+
+        std::vector<utf8::Kernel> kernels;
+        for (utf8::Kernel k : {utf8::Kernel::Scalar, utf8::Kernel::Sse2, utf8::Kernel::Avx2})
+        {
+            if (utf8::setKernel(k))
+                kernels.push_back(k);
+        }
+
+        std::cout << "lines=" << args.lines << " len=" << args.min_len << ".." << args.max_len << "\n";
+        std::cout << "mix kernel mb_per_s_utf16 mb_per_s_utf32\n";
+
+        for (Mix mix : {Mix::Ascii, Mix::TwoByte, Mix::ThreeByte, Mix::Jawiki})
+        {
+            std::mt19937_64 rng(args.seed);
+            std::uniform_int_distribution<uint32_t> lenDist(args.min_len, args.max_len);
+            std::vector<std::string> lines(static_cast<size_t>(args.lines));
+            uint64_t bytes = 0;
+            std::uniform_int_distribution<int> runDist(1, 6);
+            for (std::string &line : lines)
+            {
+                // 同じ文字種を 1..6 文字ずつ続ける（jawiki 風では語・括弧・数字のまとまりになる）
+                std::u32string s(lenDist(rng), U'\0');
+                Mix cls = mix;
+                int run = 0;
+                for (char32_t &c : s)
+                {
+                    if (run-- == 0)
+                    {
+                        cls = pick_class(rng, mix);
+                        run = runDist(rng) - 1;
+                    }
+                    c = random_char(rng, cls);
+                }
+                line = utf8::fromUtf32(s);
+                bytes += line.size();
+            }
+
+            uint64_t base = 0;
+            for (utf8::Kernel k : kernels)
+            {
+                utf8::setKernel(k);
+                std::u16string out16;
+                std::u32string out32;
+                double best16 = 0.0;
+                double best32 = 0.0;
+                uint64_t sum = 0;
+                for (uint32_t round = 0; round < args.rounds; ++round)
+                {
+                    sum = 0;
+                    auto t0 = std::chrono::steady_clock::now();
+                    for (const std::string &line : lines)
+                    {
+                        if (!utf8::toUtf16(line, out16))
+                            throw std::runtime_error("toUtf16 rejected a valid line");
+                        sum += out16.size();
+                    }
+                    auto t1 = std::chrono::steady_clock::now();
+                    for (const std::string &line : lines)
+                    {
+                        if (!utf8::toUtf32(line, out32))
+                            throw std::runtime_error("toUtf32 rejected a valid line");
+                        sum += out32.size();
+                    }
+                    auto t2 = std::chrono::steady_clock::now();
+                    const double mb = static_cast<double>(bytes) / 1e6;
+                    best16 = std::max(best16, mb / std::chrono::duration<double>(t1 - t0).count());
+                    best32 = std::max(best32, mb / std::chrono::duration<double>(t2 - t1).count());
+                }
+                if (base == 0)
+                    base = sum;
+                else if (sum != base)
+                    throw std::runtime_error(std::string("decoded length differs for kernel ") + utf8::kernelName(k));
+                std::cout << mix_name(mix) << " " << utf8::kernelName(k) << " " << best16 << " " << best32 << "\n";
+            }
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
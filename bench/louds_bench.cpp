@@ -0,0 +1,597 @@
+// bench/louds_bench.cpp
+//
+// Usage:
+//   louds_bench [--keys N] [--queries Q] [--alphabet A] [--rounds R] [--seed S]
+//               [--keys-file <utf8 lines>] [--filter <substring>] [--json <out.json>]
+//
+// Example:
+//   ./louds_bench --json before.json
+//   ./louds_bench --keys-file titles.txt --filter reader/ --json after.json
+//
+// Notes:
+// - 検索側のマイクロベンチマーク。ケースは次のとおり（名前は JSON の "name"）:
+//     sbv/<rank1|rank0|select1|select0>/bits=<N>/density=<D>  SuccinctBitVector（2^16 / 2^20 / 2^24 bit x 密度 0.1 / 0.5 / 0.9）
+//     reader/<char32|utf16>/<traverse|commonPrefixSearch|getNodeIndex|getLetter>  LOUDSReader / LOUDSReaderUtf16
+//     reader_term_id/<char32|utf16>/getTermId                                  LOUDSWithTermIdReader / LOUDSWithTermIdUtf16Reader
+// - 各ケースは 1 回空回ししてから R 回測り、最速の回の ns/op と、その回のハードウェアカウンタ
+//   （cycles / instructions / cache-misses の 1 op あたり）を出す。カウンタが使えない環境では null。
+// - checksum は結果から作る値で、同じ引数なら実装を変えても一致するはず（ビルド間で JSON を diff するときの確認用）。
+// - 辞書はキー（--keys-file、無ければ長さ 2..12・文字種 A のランダムなひらがな列）から作る。
+//   クエリは半分が登録済みキー、半分がその末尾を変えたもの。traverse は各クエリを根からたどった 1 文字ぶんを 1 op と数える。
+// - 人が読む表を標準出力に、--json を指定すればそのファイルに JSON を書く（"-" なら標準出力に JSON だけを書く）。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <optional>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+
+#include "common/succinct_bit_vector.hpp"
+#include "common/bit_ops.hpp"
+#include "common/utf8.hpp"
+#include "prefix_with_term_id/prefix_tree_with_term_id.hpp"
+#include "prefix_with_term_id/prefix_tree_with_term_id_utf16.hpp"
+#include "louds_with_term_id/converter_with_term_id.hpp"
+#include "louds_with_term_id/converter_with_term_id_utf16.hpp"
+#include "louds_with_term_id/louds_with_term_id.hpp"
+#include "louds_with_term_id/louds_with_term_id_utf16_writer.hpp"
+#include "louds/louds_reader.hpp"
+#include "louds/louds_utf16_reader.hpp"
+#include "louds_with_term_id/louds_with_term_id_reader.hpp"
+#include "louds_with_term_id/louds_with_term_id_utf16_reader.hpp"
+#include "perf_counters.hpp"
+
+struct Args
+{
+    uint64_t keys = 300000;
+    uint64_t queries = 500000;
+    uint32_t alphabet = 80;
+    uint32_t rounds = 5;
+    uint32_t seed = 12345;
+    std::string keys_file;
+    std::string filter;
+    std::string json;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " [--keys N] [--queries Q] [--alphabet A] [--rounds R] [--seed S]"
+        << " [--keys-file <file>] [--filter <substring>] [--json <out.json>]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--keys")
+            a.keys = static_cast<uint64_t>(std::stoull(need("--keys")));
+        else if (k == "--queries")
+            a.queries = static_cast<uint64_t>(std::stoull(need("--queries")));
+        else if (k == "--alphabet")
+            a.alphabet = static_cast<uint32_t>(std::stoul(need("--alphabet")));
+        else if (k == "--rounds")
+            a.rounds = static_cast<uint32_t>(std::stoul(need("--rounds")));
+        else if (k == "--seed")
+            a.seed = static_cast<uint32_t>(std::stoul(need("--seed")));
+        else if (k == "--keys-file")
+            a.keys_file = need("--keys-file");
+        else if (k == "--filter")
+            a.filter = need("--filter");
+        else if (k == "--json")
+            a.json = need("--json");
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.keys == 0 || a.queries == 0 || a.alphabet == 0 || a.rounds == 0)
+    {
+        std::cerr << "--keys, --queries, --alphabet and --rounds must be positive\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+// -----------------------------
+// 計測
+// -----------------------------
+struct Result
+{
+    std::string name;
+    uint64_t ops = 0;
+    double nsPerOp = 0.0;
+    std::optional<double> cyclesPerOp;
+    std::optional<double> instructionsPerOp;
+    std::optional<double> cacheMissesPerOp;
+    uint64_t checksum = 0;
+};
+
+class Runner
+{
+public:
+    Runner(uint32_t rounds, std::string filter) : rounds_(rounds), filter_(std::move(filter)) {}
+
+    bool wants(const std::string &name) const
+    {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    // fn() を 1 回空回ししてから rounds 回測る。fn は ops 回ぶんの処理をして checksum を返す
+    void run(const std::string &name, uint64_t ops, const std::function<uint64_t()> &fn)
+    {
+        if (!wants(name) || ops == 0)
+            return;
+
+        Result r;
+        r.name = name;
+        r.ops = ops;
+        r.checksum = fn();
+        for (uint32_t round = 0; round < rounds_; ++round)
+        {
+            perf_.start();
+            const auto t0 = std::chrono::steady_clock::now();
+            const uint64_t checksum = fn();
+            const auto t1 = std::chrono::steady_clock::now();
+            const PerfCounters::Sample sample = perf_.stop();
+            if (checksum != r.checksum)
+                throw std::runtime_error("checksum changed between rounds: " + name);
+
+            const double n = static_cast<double>(ops);
+            const double ns = std::chrono::duration<double>(t1 - t0).count() * 1e9 / n;
+            if (round != 0 && ns >= r.nsPerOp)
+                continue;
+            r.nsPerOp = ns;
+            r.cyclesPerOp = perOp(sample.cycles, n);
+            r.instructionsPerOp = perOp(sample.instructions, n);
+            r.cacheMissesPerOp = perOp(sample.cacheMisses, n);
+        }
+
+        std::cout << std::left << std::setw(56) << r.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << r.nsPerOp << " ns/op";
+        if (r.cyclesPerOp)
+            std::cout << std::setw(10) << *r.cyclesPerOp << " cyc/op";
+        if (r.cacheMissesPerOp)
+            std::cout << std::setw(8) << std::setprecision(3) << *r.cacheMissesPerOp << " miss/op";
+        std::cout << std::defaultfloat << "\n";
+        results_.push_back(std::move(r));
+    }
+
+    bool perfAvailable() const { return perf_.available(); }
+    const std::vector<Result> &results() const { return results_; }
+
+private:
+    uint32_t rounds_;
+    std::string filter_;
+    PerfCounters perf_;
+    std::vector<Result> results_;
+
+    static std::optional<double> perOp(std::optional<uint64_t> v, double n)
+    {
+        if (!v)
+            return std::nullopt;
+        return static_cast<double>(*v) / n;
+    }
+};
+
+// -----------------------------
+// 入力
+// -----------------------------
+// 1 行 1 語の UTF-8 ファイル（空行と不正な行は飛ばす）
+static std::vector<std::string> read_lines(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open: " + path);
+    std::vector<std::string> out;
+    std::string line;
+    std::u32string tmp;
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && utf8::toUtf32(line, tmp))
+            out.push_back(line);
+    }
+    return out;
+}
+
+// ひらがな始まりの連続した文字種から引く
+static std::string random_key(std::mt19937_64 &rng, uint32_t alphabet)
+{
+    std::uniform_int_distribution<int> len(2, 12);
+    std::uniform_int_distribution<uint32_t> ch(0, alphabet - 1);
+    std::u32string s(static_cast<size_t>(len(rng)), U'\0');
+    for (char32_t &c : s)
+        c = static_cast<char32_t>(0x3041 + ch(rng));
+    return utf8::fromUtf32(s);
+}
+
+// -----------------------------
+// ケース
+// -----------------------------
+static BitVector random_bits(uint64_t nbits, double density, std::mt19937_64 &rng)
+{
+    std::bernoulli_distribution coin(density);
+    BitVectorBuilder b;
+    b.reserve(static_cast<size_t>(nbits));
+    for (uint64_t i = 0; i < nbits; ++i)
+        b.push_back(coin(rng));
+    return b.build();
+}
+
+static std::string density_name(double d)
+{
+    std::ostringstream os;
+    os << d;
+    return os.str();
+}
+
+static void bench_succinct(Runner &runner, const Args &args)
+{
+    const uint64_t sizes[] = {1ULL << 16, 1ULL << 20, 1ULL << 24};
+    const double densities[] = {0.1, 0.5, 0.9};
+    uint64_t caseNo = 0;
+    for (uint64_t nbits : sizes)
+    {
+        for (double density : densities)
+        {
+            // --filter で飛ばすケースがあっても同じビット列・クエリになるよう、ケースごとに乱数を分ける
+            std::mt19937_64 rng(args.seed + 1000003ULL * ++caseNo);
+            const std::string suffix = "/bits=" + std::to_string(nbits) + "/density=" + density_name(density);
+            bool any = false;
+            for (const char *op : {"rank1", "rank0", "select1", "select0"})
+                any = any || runner.wants(std::string("sbv/") + op + suffix);
+            if (!any)
+                continue;
+
+            const BitVector bv = random_bits(nbits, density, rng);
+            const SuccinctBitVector sbv(bv);
+            const LoudsPos ones = sbv.totalOnes();
+            const LoudsPos zeros = sbv.size() - ones;
+
+            const size_t q = static_cast<size_t>(args.queries);
+            std::vector<LoudsPos> pos(q), k1(q), k0(q);
+            std::uniform_int_distribution<LoudsPos> dpos(0, sbv.size() - 1);
+            std::uniform_int_distribution<LoudsPos> d1(1, std::max<LoudsPos>(ones, 1));
+            std::uniform_int_distribution<LoudsPos> d0(1, std::max<LoudsPos>(zeros, 1));
+            for (size_t i = 0; i < q; ++i)
+            {
+                pos[i] = dpos(rng);
+                k1[i] = d1(rng);
+                k0[i] = d0(rng);
+            }
+
+            runner.run("sbv/rank1" + suffix, q, [&]
+                       {
+                           uint64_t c = 0;
+                           for (LoudsPos p : pos)
+                               c += static_cast<uint64_t>(sbv.rank1(p));
+                           return c; });
+            runner.run("sbv/rank0" + suffix, q, [&]
+                       {
+                           uint64_t c = 0;
+                           for (LoudsPos p : pos)
+                               c += static_cast<uint64_t>(sbv.rank0(p));
+                           return c; });
+            runner.run("sbv/select1" + suffix, ones > 0 ? q : 0, [&]
+                       {
+                           uint64_t c = 0;
+                           for (LoudsPos k : k1)
+                               c += static_cast<uint64_t>(sbv.select1(k));
+                           return c; });
+            runner.run("sbv/select0" + suffix, zeros > 0 ? q : 0, [&]
+                       {
+                           uint64_t c = 0;
+                           for (LoudsPos k : k0)
+                               c += static_cast<uint64_t>(sbv.select0(k));
+                           return c; });
+        }
+    }
+}
+
+// char32 / UTF-16 で同じ形のケースを回す
+// String: std::u32string / std::u16string、Reader / TermReader はその幅の Reader
+template <class String, class Reader, class TermReader>
+static void bench_reader(Runner &runner, const std::string &width, const Reader &reader, const TermReader &termReader,
+                         const std::vector<String> &queries)
+{
+    using View = std::basic_string_view<typename String::value_type>;
+
+    // traverse: 各クエリを根からたどれるところまで（1 文字 = 1 op）
+    uint64_t steps = 0;
+    for (const String &q : queries)
+    {
+        LoudsPos n = 0;
+        for (auto c : q)
+        {
+            n = reader.traverse(n, c);
+            ++steps;
+            if (n < 0)
+                break;
+        }
+    }
+    runner.run("reader/" + width + "/traverse", steps, [&]
+               {
+                   uint64_t c = 0;
+                   for (const String &q : queries)
+                   {
+                       LoudsPos n = 0;
+                       for (auto ch : q)
+                       {
+                           n = reader.traverse(n, ch);
+                           if (n < 0)
+                               break;
+                           c += static_cast<uint64_t>(n);
+                       }
+                   }
+                   return c; });
+
+    runner.run("reader/" + width + "/commonPrefixSearch", queries.size(), [&]
+               {
+                   uint64_t c = 0;
+                   for (const String &q : queries)
+                       reader.commonPrefixSearch(View(q), [&](size_t length, LoudsPos n)
+                                                 { c += length + static_cast<uint64_t>(n); });
+                   return c; });
+
+    runner.run("reader/" + width + "/getNodeIndex", queries.size(), [&]
+               {
+                   uint64_t c = 0;
+                   for (const String &q : queries)
+                       c += static_cast<uint64_t>(reader.getNodeIndex(q));
+                   return c; });
+
+    std::vector<LoudsPos> nodes;
+    for (const String &q : queries)
+    {
+        const LoudsPos n = reader.getNodeIndex(q);
+        if (n > 0)
+            nodes.push_back(n);
+    }
+    runner.run("reader/" + width + "/getLetter", nodes.size(), [&]
+               {
+                   uint64_t c = 0;
+                   for (LoudsPos n : nodes)
+                       c += reader.getLetter(n).size();
+                   return c; });
+
+    std::vector<LoudsPos> termNodes;
+    for (const String &q : queries)
+    {
+        const LoudsPos n = termReader.getNodeIndex(q);
+        if (n > 0)
+            termNodes.push_back(n);
+    }
+    runner.run("reader_term_id/" + width + "/getTermId", termNodes.size(), [&]
+               {
+                   uint64_t c = 0;
+                   for (LoudsPos n : termNodes)
+                       c += static_cast<uint64_t>(static_cast<uint32_t>(termReader.getTermId(n)));
+                   return c; });
+}
+
+// -----------------------------
+// JSON
+// -----------------------------
+static std::string json_escape(std::string_view s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                std::ostringstream os;
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+                out += os.str();
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+static void write_optional(std::ostream &os, const std::optional<double> &v)
+{
+    if (v)
+        os << *v;
+    else
+        os << "null";
+}
+
+static void write_json(std::ostream &os, const Args &args, const Runner &runner, size_t keyCount)
+{
+    os << std::setprecision(6);
+    os << "{\n";
+    os << "  \"schema\": 1,\n";
+    os << "  \"build\": {\n";
+#if defined(__VERSION__)
+    os << "    \"compiler\": \"" << json_escape(__VERSION__) << "\",\n";
+#endif
+    os << "    \"position_bits\": " << sizeof(LoudsPos) * 8 << ",\n";
+    os << "    \"rank_select_kernel\": \"" << bit_ops::kernelName(bit_ops::activeKernel()) << "\"\n";
+    os << "  },\n";
+    os << "  \"params\": {\n";
+    os << "    \"keys\": " << keyCount << ",\n";
+    os << "    \"keys_file\": \"" << json_escape(args.keys_file) << "\",\n";
+    os << "    \"queries\": " << args.queries << ",\n";
+    os << "    \"alphabet\": " << args.alphabet << ",\n";
+    os << "    \"rounds\": " << args.rounds << ",\n";
+    os << "    \"seed\": " << args.seed << "\n";
+    os << "  },\n";
+    os << "  \"perf_counters\": " << (runner.perfAvailable() ? "true" : "false") << ",\n";
+    os << "  \"results\": [\n";
+    const std::vector<Result> &results = runner.results();
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        os << "    {\"name\": \"" << json_escape(r.name) << "\", \"ops\": " << r.ops
+           << ", \"ns_per_op\": " << r.nsPerOp << ", \"cycles_per_op\": ";
+        write_optional(os, r.cyclesPerOp);
+        os << ", \"instructions_per_op\": ";
+        write_optional(os, r.instructionsPerOp);
+        os << ", \"cache_misses_per_op\": ";
+        write_optional(os, r.cacheMissesPerOp);
+        os << ", \"checksum\": " << r.checksum << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Args args = parse_args(argc, argv);
+        std::mt19937_64 rng(args.seed);
+
+        // --json - のときは表を捨てて JSON だけを標準出力に書く
+        std::ostringstream discard;
+        std::streambuf *const coutBuf = std::cout.rdbuf();
+        if (args.json == "-")
+            std::cout.rdbuf(discard.rdbuf());
+
+        std::vector<std::string> keys;
+        if (!args.keys_file.empty())
+        {
+            keys = read_lines(args.keys_file);
+        }
+        else
+        {
+            keys.reserve(static_cast<size_t>(args.keys));
+            for (uint64_t i = 0; i < args.keys; ++i)
+                keys.push_back(random_key(rng, args.alphabet));
+        }
+        if (keys.empty())
+            throw std::runtime_error("no keys");
+
+        std::vector<std::string> queries(static_cast<size_t>(args.queries));
+        {
+            std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+            std::u32string s;
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                queries[i] = keys[pick(rng)];
+                if (i % 2 == 1 && utf8::toUtf32(queries[i], s))
+                {
+                    s.back() = static_cast<char32_t>(s.back() + 1);
+                    queries[i] = utf8::fromUtf32(s);
+                }
+            }
+        }
+
+        Runner runner(args.rounds, args.filter);
+        std::cout << "keys=" << keys.size() << " queries=" << queries.size()
+                  << " rank_select_kernel=" << bit_ops::kernelName(bit_ops::activeKernel())
+                  << " perf_counters=" << (runner.perfAvailable() ? "yes" : "no") << "\n";
+
+        bench_succinct(runner, args);
+
+        // char32
+        {
+            std::vector<std::u32string> q32;
+            std::u32string s;
+            for (const std::string &q : queries)
+            {
+                if (utf8::toUtf32(q, s))
+                    q32.push_back(s);
+            }
+
+            PrefixTreeWithTermId tree;
+            for (const std::string &k : keys)
+            {
+                if (utf8::toUtf32(k, s))
+                    tree.insert(s);
+            }
+            ConverterWithTermId conv;
+            LOUDSWithTermId louds = conv.convert(tree.getRoot());
+            const LOUDSReader reader(louds.LBS, louds.isLeaf, louds.labels);
+            const LOUDSWithTermIdReader termReader(std::move(louds.LBS), std::move(louds.isLeaf),
+                                                   std::move(louds.labels), std::move(louds.termIdsSave));
+            bench_reader(runner, "char32", reader, termReader, q32);
+        }
+
+        // UTF-16
+        {
+            std::vector<std::u16string> q16;
+            std::u16string s;
+            for (const std::string &q : queries)
+            {
+                if (utf8::toUtf16(q, s))
+                    q16.push_back(s);
+            }
+
+            PrefixTreeWithTermIdUtf16 tree;
+            for (const std::string &k : keys)
+            {
+                if (utf8::toUtf16(k, s))
+                    tree.insert(s);
+            }
+            ConverterWithTermIdUtf16 conv;
+            LOUDSWithTermIdUtf16 louds = conv.convert(tree.getRoot());
+            const LOUDSReaderUtf16 reader(louds.LBS, louds.isLeaf, louds.labels);
+            const LOUDSWithTermIdUtf16Reader termReader(std::move(louds.LBS), std::move(louds.isLeaf),
+                                                        std::move(louds.labels), std::move(louds.termIdsSave));
+            bench_reader(runner, "utf16", reader, termReader, q16);
+        }
+
+        std::cout.rdbuf(coutBuf);
+        if (args.json == "-")
+        {
+            write_json(std::cout, args, runner, keys.size());
+        }
+        else if (!args.json.empty())
+        {
+            std::ofstream ofs(args.json);
+            if (!ofs)
+                throw std::runtime_error("failed to open for write: " + args.json);
+            write_json(ofs, args, runner, keys.size());
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+// bench/perf_counters.hpp
+//
+// ベンチマーク用のハードウェアカウンタ（Linux の perf_event_open）
+//
+// - cycles / instructions / cache-misses（LLC）を自プロセスのユーザ空間だけで数える
+// - カウンタごとに開き、開けなかったもの（perf_event_paranoid・仮想マシン・Linux 以外など）は値を持たない。
+//   呼び出し側は has_value() を見て JSON に null を書く
+// - 多重化されたときは time_enabled / time_running で補正する
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+class PerfCounters
+{
+public:
+    struct Sample
+    {
+        std::optional<uint64_t> cycles;
+        std::optional<uint64_t> instructions;
+        std::optional<uint64_t> cacheMisses;
+    };
+
+    PerfCounters()
+    {
+#if defined(__linux__)
+        fds_[0] = open(PERF_COUNT_HW_CPU_CYCLES);
+        fds_[1] = open(PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[2] = open(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // 1 つでも開けたか
+    bool available() const
+    {
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    void start()
+    {
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd < 0)
+                continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    Sample stop()
+    {
+        Sample s;
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+                ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        s.cycles = read(fds_[0]);
+        s.instructions = read(fds_[1]);
+        s.cacheMisses = read(fds_[2]);
+#endif
+        return s;
+    }
+
+private:
+    int fds_[3] = {-1, -1, -1};
+
+#if defined(__linux__)
+    static int open(uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static std::optional<uint64_t> read(int fd)
+    {
+        if (fd < 0)
+            return std::nullopt;
+        uint64_t v[3] = {0, 0, 0}; // value, time_enabled, time_running
+        if (::read(fd, v, sizeof(v)) != static_cast<ssize_t>(sizeof(v)) || v[2] == 0)
+            return std::nullopt;
+        if (v[2] < v[1])
+            return static_cast<uint64_t>(static_cast<double>(v[0]) * static_cast<double>(v[1]) / static_cast<double>(v[2]));
+        return v[0];
+    }
+#endif
+};
@@ -0,0 +1,237 @@
+#include "common/bit_ops.hpp"
+
+namespace bit_ops
+{
+    namespace
+    {
+        // -----------------------------
+        // ポータブル / POPCNT: word ごとに数える（同じコードを命令セットを変えてコンパイルする）
+        // -----------------------------
+        template <class Popcount>
+        inline uint64_t popcountWordsWith(const uint64_t *words, size_t n, Popcount popcount)
+        {
+            // 依存の連鎖を切るため 4 本に分けて足す
+            uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                c0 += static_cast<uint64_t>(popcount(words[i]));
+                c1 += static_cast<uint64_t>(popcount(words[i + 1]));
+                c2 += static_cast<uint64_t>(popcount(words[i + 2]));
+                c3 += static_cast<uint64_t>(popcount(words[i + 3]));
+            }
+            for (; i < n; ++i)
+                c0 += static_cast<uint64_t>(popcount(words[i]));
+            return c0 + c1 + c2 + c3;
+        }
+
+        // ブロック内 word ごとの 1 の数 counts[0..8) から rank9 の相対値を pack する
+        inline uint64_t packSubRanks(const uint64_t *counts, uint64_t &blockOnes)
+        {
+            uint64_t sub = 0;
+            uint64_t local = 0;
+            for (size_t k = 0; k < 8; ++k)
+            {
+                if (k > 0)
+                    sub |= local << (9 * (k - 1));
+                local += counts[k];
+            }
+            blockOnes = local;
+            return sub;
+        }
+
+        template <class Popcount>
+        inline uint64_t rank9BlocksWith(const uint64_t *words, size_t nblocks, uint64_t *dir, uint64_t rank,
+                                        Popcount popcount)
+        {
+            uint64_t counts[8];
+            for (size_t b = 0; b < nblocks; ++b)
+            {
+                const uint64_t *w = words + 8 * b;
+                for (size_t k = 0; k < 8; ++k)
+                    counts[k] = static_cast<uint64_t>(popcount(w[k]));
+                uint64_t ones = 0;
+                dir[2 * b] = rank;
+                dir[2 * b + 1] = packSubRanks(counts, ones);
+                rank += ones;
+            }
+            return rank;
+        }
+
+        uint64_t popcountWordsPortable(const uint64_t *words, size_t n)
+        {
+            return popcountWordsWith(words, n, [](uint64_t x)
+                                     { return __builtin_popcountll(x); });
+        }
+
+        uint64_t rank9BlocksPortable(const uint64_t *words, size_t nblocks, uint64_t *dir, uint64_t rank)
+        {
+            return rank9BlocksWith(words, nblocks, dir, rank, [](uint64_t x)
+                                   { return __builtin_popcountll(x); });
+        }
+
+#if defined(BIT_OPS_X86)
+        // flatten で共通部分を inline し、POPCNT 付きでコンパイルさせる
+        __attribute__((target("popcnt"), flatten)) uint64_t popcountWordsPopcnt(const uint64_t *words, size_t n)
+        {
+            return popcountWordsWith(words, n, [](uint64_t x)
+                                     { return __builtin_popcountll(x); });
+        }
+
+        __attribute__((target("popcnt"), flatten)) uint64_t rank9BlocksPopcnt(const uint64_t *words, size_t nblocks, uint64_t *dir, uint64_t rank)
+        {
+            return rank9BlocksWith(words, nblocks, dir, rank, [](uint64_t x)
+                                   { return __builtin_popcountll(x); });
+        }
+
+        // -----------------------------
+        // AVX-512 VPOPCNTDQ: 8 word（= rank9 の 1 ブロック）を 1 命令で数える
+        // -----------------------------
+#define BIT_OPS_TARGET_AVX512 __attribute__((target("popcnt,avx512f,avx512vpopcntdq")))
+
+        BIT_OPS_TARGET_AVX512 uint64_t popcountWordsAvx512(const uint64_t *words, size_t n)
+        {
+            __m512i acc = _mm512_setzero_si512();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+            alignas(64) uint64_t lanes[8];
+            _mm512_store_si512(lanes, acc);
+            uint64_t c = 0;
+            for (uint64_t lane : lanes)
+                c += lane;
+            for (; i < n; ++i)
+                c += static_cast<uint64_t>(__builtin_popcountll(words[i]));
+            return c;
+        }
+
+        BIT_OPS_TARGET_AVX512 uint64_t rank9BlocksAvx512(const uint64_t *words, size_t nblocks, uint64_t *dir, uint64_t rank)
+        {
+            alignas(64) uint64_t counts[8];
+            for (size_t b = 0; b < nblocks; ++b)
+            {
+                _mm512_store_si512(counts, _mm512_popcnt_epi64(_mm512_loadu_si512(words + 8 * b)));
+                uint64_t ones = 0;
+                dir[2 * b] = rank;
+                dir[2 * b + 1] = packSubRanks(counts, ones);
+                rank += ones;
+            }
+            return rank;
+        }
+#endif
+
+        // -----------------------------
+        // 実行時の選択
+        // -----------------------------
+        bool cpuSupports(Kernel kernel)
+        {
+#if defined(BIT_OPS_X86)
+            __builtin_cpu_init();
+            const bool popcnt = __builtin_cpu_supports("popcnt");
+            const bool bmi2 = popcnt && __builtin_cpu_supports("bmi2");
+            switch (kernel)
+            {
+            case Kernel::Portable:
+                return true;
+            case Kernel::Popcnt:
+                return popcnt;
+            case Kernel::Bmi2:
+                return bmi2;
+            case Kernel::Avx512:
+                return bmi2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+            }
+            return false;
+#else
+            return kernel == Kernel::Portable;
+#endif
+        }
+
+        // PDEP / PEXT がマイクロコード実装（数十サイクル）の CPU
+        bool slowPdep()
+        {
+#if defined(BIT_OPS_X86)
+            __builtin_cpu_init();
+            return __builtin_cpu_is("znver1") || __builtin_cpu_is("znver2");
+#else
+            return false;
+#endif
+        }
+
+        Kernel detectKernel()
+        {
+            if (cpuSupports(Kernel::Avx512))
+                return Kernel::Avx512;
+            if (cpuSupports(Kernel::Bmi2) && !slowPdep())
+                return Kernel::Bmi2;
+            if (cpuSupports(Kernel::Popcnt))
+                return Kernel::Popcnt;
+            return Kernel::Portable;
+        }
+    }
+
+    namespace detail
+    {
+        std::atomic<int> g_kernel{static_cast<int>(detectKernel())};
+    }
+
+    Kernel activeKernel()
+    {
+        return static_cast<Kernel>(detail::g_kernel.load(std::memory_order_relaxed));
+    }
+
+    const char *kernelName(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Portable:
+            return "portable";
+        case Kernel::Popcnt:
+            return "popcnt";
+        case Kernel::Bmi2:
+            return "bmi2";
+        case Kernel::Avx512:
+            return "avx512";
+        }
+        return "unknown";
+    }
+
+    bool setKernel(Kernel kernel)
+    {
+        if (!cpuSupports(kernel))
+            return false;
+        detail::g_kernel.store(static_cast<int>(kernel), std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t popcountWords(const uint64_t *words, size_t n)
+    {
+        switch (activeKernel())
+        {
+#if defined(BIT_OPS_X86)
+        case Kernel::Avx512:
+            return popcountWordsAvx512(words, n);
+        case Kernel::Bmi2:
+        case Kernel::Popcnt:
+            return popcountWordsPopcnt(words, n);
+#endif
+        default:
+            return popcountWordsPortable(words, n);
+        }
+    }
+
+    uint64_t rank9Blocks(const uint64_t *words, size_t nblocks, uint64_t *dir, uint64_t rankBase)
+    {
+        switch (activeKernel())
+        {
+#if defined(BIT_OPS_X86)
+        case Kernel::Avx512:
+            return rank9BlocksAvx512(words, nblocks, dir, rankBase);
+        case Kernel::Bmi2:
+        case Kernel::Popcnt:
+            return rank9BlocksPopcnt(words, nblocks, dir, rankBase);
+#endif
+        default:
+            return rank9BlocksPortable(words, nblocks, dir, rankBase);
+        }
+    }
+}
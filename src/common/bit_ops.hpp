@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BIT_OPS_X86 1
+#endif
+
+// 64bit word 単位のビット演算ヘルパ
+//
+// - -march なしでビルドしても速い命令を使えるよう、カーネルは実行時に CPU を見て選ぶ
+//   （AVX-512 VPOPCNTDQ > BMI2 > POPCNT > ポータブル）。上位のカーネルは下位の命令をすべて使う
+// - popcount64 / select64 は検索のホットパスなのでヘッダに置き、選択済みのカーネルを 1 回の load で見て分岐する。
+//   -mpopcnt / -mbmi2（-march=native など）でビルドしたときは分岐せずに命令をそのまま使う
+// - 複数 word をまとめて数える処理（popcountWords / rank9Blocks）は bit_ops.cpp にカーネルごとの実装がある
+// - Zen / Zen 2 は PDEP がマイクロコードで遅いので、BMI2 があっても自動選択では POPCNT に留める
+namespace bit_ops
+{
+    enum class Kernel
+    {
+        Portable, // __builtin_popcountll（libgcc）+ broadword select
+        Popcnt,   // POPCNT
+        Bmi2,     // POPCNT + PDEP/TZCNT の word 内 select
+        Avx512,   // Bmi2 + VPOPCNTDQ（8 word = 1 ブロックを 1 命令で数える）
+    };
+
+    // 現在のカーネル
+    Kernel activeKernel();
+    const char *kernelName(Kernel kernel);
+
+    // テスト・ベンチマーク用にカーネルを切り替える。CPU が対応していなければ false（切り替えない）
+    bool setKernel(Kernel kernel);
+
+    // words[0..n) の 1 の数
+    uint64_t popcountWords(const uint64_t *words, size_t n);
+
+    // rank9 ディレクトリ（SuccinctBitVector の形式）を完全なブロック（8 word）nblocks 個ぶん書く。
+    // dir[2*b] = rankBase + ブロック b の先頭までの 1 の数、dir[2*b+1] = ブロック内 word 1..7 の相対値（9bit x 7）。
+    // 戻り値は rankBase + 全ブロックの 1 の数
+    uint64_t rank9Blocks(const uint64_t *words, size_t nblocks, uint64_t *dir, uint64_t rankBase);
+
+    namespace detail
+    {
+        // activeKernel を int で持つ。bit_ops.cpp の静的初期化で CPU を見て埋める
+        // （それより前はゼロ初期化の Portable なので、どの順で初期化されても正しい結果になる）
+        extern std::atomic<int> g_kernel;
+
+        inline bool atLeast(Kernel kernel)
+        {
+            return g_kernel.load(std::memory_order_relaxed) >= static_cast<int>(kernel);
+        }
+
+#if defined(BIT_OPS_X86)
+        __attribute__((target("popcnt"))) inline int popcount64Popcnt(uint64_t x)
+        {
+            return __builtin_popcountll(x);
+        }
+
+        __attribute__((target("bmi,bmi2"))) inline int select64Pdep(uint64_t x, int k)
+        {
+            return static_cast<int>(_tzcnt_u64(_pdep_u64(1ULL << (k - 1), x)));
+        }
+#endif
+
+        // selectInByte[(r << 8) | v]: byte v の中で (r+1) 番目の 1 の位置
+        constexpr std::array<uint8_t, 256 * 8> makeSelectInByteTable()
+        {
+            std::array<uint8_t, 256 * 8> t{};
+            for (int v = 0; v < 256; ++v)
+            {
+                int r = 0;
+                for (int b = 0; b < 8; ++b)
+                {
+                    if ((v >> b) & 1)
+                    {
+                        t[static_cast<size_t>((r << 8) | v)] = static_cast<uint8_t>(b);
+                        ++r;
+                    }
+                }
+            }
+            return t;
+        }
+
+        inline constexpr std::array<uint8_t, 256 * 8> selectInByte = makeSelectInByteTable();
+    }
+
+    inline int popcount64(uint64_t x)
+    {
+#if defined(__POPCNT__) || !defined(BIT_OPS_X86)
+        return __builtin_popcountll(x);
+#else
+        if (detail::atLeast(Kernel::Popcnt))
+            return detail::popcount64Popcnt(x);
+        return __builtin_popcountll(x);
+#endif
+    }
+
+    // broadword select（Vigna / sdsl 方式）
+    // - byte ごとの累積 popcount を 1 回の乗算で作り、目的の byte を比較 1 回で特定
+    // - byte 内は 2KB の表引き
+    // k は 1-indexed。x の popcount 以下であること
+    inline int select64Broadword(uint64_t x, int k)
+    {
+        constexpr uint64_t L8 = 0x0101010101010101ULL;
+        constexpr uint64_t H8 = 0x8080808080808080ULL;
+
+        uint64_t s = x - ((x >> 1) & 0x5555555555555555ULL);
+        s = (s & 0x3333333333333333ULL) + ((s >> 2) & 0x3333333333333333ULL);
+        s = ((s + (s >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * L8;
+
+        // 各 byte に (128 - k) を足し、累積が k 以上になった byte の最上位ビットが立つ
+        const uint64_t b = (s + static_cast<uint64_t>(128 - k) * L8) & H8;
+        const int byteNr = __builtin_ctzll(b) >> 3;
+        const int shift = byteNr << 3;
+
+        const int before = static_cast<int>(((s << 8) >> shift) & 0xFFULL);
+        const int r = k - before - 1;
+        const uint64_t v = (x >> shift) & 0xFFULL;
+        return shift + detail::selectInByte[static_cast<size_t>((r << 8) | static_cast<int>(v))];
+    }
+
+    // word 内で k 番目 (1-indexed) の 1 の bit 位置
+    inline int select64(uint64_t x, int k)
+    {
+#if defined(__BMI2__)
+        return static_cast<int>(_tzcnt_u64(_pdep_u64(1ULL << (k - 1), x)));
+#elif defined(BIT_OPS_X86)
+        if (detail::atLeast(Kernel::Bmi2))
+            return detail::select64Pdep(x, k);
+        return select64Broadword(x, k);
+#else
+        return select64Broadword(x, k);
+#endif
+    }
+}
@@ -2,25 +2,62 @@
 #include <cstdint>
 #include <cstddef>
 #include <vector>
+#include <algorithm>
 #include <stdexcept>
+#include <atomic>
+#include <utility>
+
+#include "common/louds_types.hpp"
+#include "common/bit_ops.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 
 class BitVector
 {
 public:
     BitVector() = default;
+    BitVector(const BitVector &other)
+        : nbits_(other.nbits_), words_(other.words_) {}
+    BitVector(BitVector &&other) noexcept
+        : nbits_(std::exchange(other.nbits_, 0)), words_(std::move(other.words_)), version_(other.version_)
+    {
+        other.words_.clear();
+        other.version_ = nextVersion();
+    }
+    BitVector &operator=(const BitVector &other)
+    {
+        nbits_ = other.nbits_;
+        words_ = other.words_;
+        version_ = nextVersion();
+        return *this;
+    }
+    BitVector &operator=(BitVector &&other) noexcept
+    {
+        nbits_ = std::exchange(other.nbits_, 0);
+        words_ = std::move(other.words_);
+        other.words_.clear();
+        version_ = std::exchange(other.version_, nextVersion());
+        return *this;
+    }
 
     size_t size() const { return nbits_; }
 
+    // 中身の版（書き換え・代入のたびにプロセス内で一意な値に変わる。move では中身ごと移る）
+    // 派生データ（LazySuccinctIndex の rank/select ディレクトリ）が古くなっていないかの判定に使う
+    uint64_t version() const { return version_; }
+
     bool get(size_t i) const
     {
         if (i >= nbits_)
             return false;
+        LOUDS_TOUCH(words_.data() + (i >> 6));
         return (words_[i >> 6] >> (i & 63)) & 1ULL;
     }
 
     void set(size_t i, bool v)
     {
         ensure_size(i + 1);
+        version_ = nextVersion();
         const size_t w = i >> 6;
         const size_t b = i & 63;
         const uint64_t mask = 1ULL << b;
@@ -32,7 +69,8 @@ public:
 
     void push_back(bool v) { set(nbits_, v); }
 
-    int rank0(int index) const
+    // rank0(index): 0..index (inclusive) の 0 の数
+    LoudsPos rank0(LoudsPos index) const
     {
         if (nbits_ == 0)
             return 0;
@@ -42,11 +80,12 @@ public:
         if (idx >= nbits_)
             idx = nbits_ - 1;
 
-        int ones = rank1_internal(idx);
-        return static_cast<int>(idx + 1) - ones;
+        LoudsPos ones = rank1_internal(idx);
+        return static_cast<LoudsPos>(idx + 1) - ones;
     }
 
-    int rank1(int index) const
+    // rank1(index): 0..index (inclusive) の 1 の数
+    LoudsPos rank1(LoudsPos index) const
     {
         if (nbits_ == 0)
             return 0;
@@ -58,8 +97,11 @@ public:
         return rank1_internal(idx);
     }
 
-    int select0(int nodeId) const { return select_internal(false, nodeId); }
-    int select1(int nodeId) const { return select_internal(true, nodeId); }
+    // select0(nodeId): nodeId番目(1-indexed)の 0 の位置
+    LoudsPos select0(LoudsPos nodeId) const { return select_internal(false, nodeId); }
+
+    // select1(nodeId): nodeId番目(1-indexed)の 1 の位置
+    LoudsPos select1(LoudsPos nodeId) const { return select_internal(true, nodeId); }
 
     const std::vector<uint64_t> &words() const { return words_; }
 
@@ -67,6 +109,7 @@ public:
     {
         nbits_ = nbits;
         words_ = std::move(w);
+        version_ = nextVersion();
         if ((nbits_ + 63) / 64 != words_.size())
         {
             throw std::runtime_error("BitVector: words size mismatch");
@@ -78,9 +121,24 @@ public:
         return nbits_ == other.nbits_ && words_ == other.words_;
     }
 
+    MemoryUsage memoryUsage() const
+    {
+        MemoryUsage u;
+        u.bits = MemoryUsage::used(words_);
+        u.overhead = sizeof(*this) + MemoryUsage::slack(words_);
+        return u;
+    }
+
 private:
     size_t nbits_{0};
     std::vector<uint64_t> words_;
+    uint64_t version_{nextVersion()};
+
+    static uint64_t nextVersion()
+    {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
 
     void ensure_size(size_t nbits)
     {
@@ -92,43 +150,197 @@ private:
             words_.resize(need, 0ULL);
     }
 
-    static int popcount64(uint64_t x)
-    {
-        return __builtin_popcountll(x);
-    }
-
-    int rank1_internal(size_t idx) const
+    LoudsPos rank1_internal(size_t idx) const
     {
         const size_t full_words = idx >> 6;
         const size_t bit_in_word = idx & 63;
 
-        int count = 0;
-        for (size_t w = 0; w < full_words; ++w)
-        {
-            count += popcount64(words_[w]);
-        }
-
         const uint64_t mask =
             (bit_in_word == 63) ? ~0ULL : ((1ULL << (bit_in_word + 1)) - 1ULL);
 
-        count += popcount64(words_[full_words] & mask);
-        return count;
+        return static_cast<LoudsPos>(bit_ops::popcountWords(words_.data(), full_words) +
+                                     static_cast<uint64_t>(bit_ops::popcount64(words_[full_words] & mask)));
     }
 
-    int select_internal(bool value, int nodeId) const
+    // 先頭から word 単位で数え、目的の word の中は select64 で求める
+    LoudsPos select_internal(bool value, LoudsPos nodeId) const
     {
         if (nodeId <= 0)
             return -1;
-        int count = 0;
-        for (size_t i = 0; i < nbits_; ++i)
+        uint64_t remaining = static_cast<uint64_t>(nodeId);
+        for (size_t w = 0; w < words_.size(); ++w)
         {
-            if (get(i) == value)
+            const uint64_t x = value ? words_[w] : ~words_[w];
+            const uint64_t c = static_cast<uint64_t>(bit_ops::popcount64(x));
+            if (remaining <= c)
             {
-                ++count;
-                if (count == nodeId)
-                    return static_cast<int>(i);
+                const size_t pos = w * 64 + static_cast<size_t>(bit_ops::select64(x, static_cast<int>(remaining)));
+                // 末尾 word の nbits より後ろは 0 として数えてしまうので弾く
+                return (pos < nbits_) ? static_cast<LoudsPos>(pos) : -1;
             }
+            remaining -= c;
         }
         return -1;
     }
 };
+
+// BitVector を語単位で組み立てる（Converter / Builder 用）
+// - BitVector::push_back と違い 1 bit ごとに ensure_size / resize を通らない
+// - nbits より後ろのビットは常に 0 に保つので、build() はそのまま word 列を BitVector に渡せる
+class BitVectorBuilder
+{
+public:
+    BitVectorBuilder() = default;
+
+    void reserve(size_t nbits) { words_.reserve((nbits + 63) / 64); }
+
+    size_t size() const { return nbits_; }
+
+    void clear()
+    {
+        words_.clear();
+        nbits_ = 0;
+    }
+
+    void push_back(bool v)
+    {
+        const size_t bit = nbits_ & 63;
+        if (bit == 0)
+            words_.push_back(v ? 1ULL : 0ULL);
+        else if (v)
+            words_.back() |= 1ULL << bit;
+        ++nbits_;
+    }
+
+    // bits の下位 count bit（count <= 64）を追記する
+    void appendWord(uint64_t bits, unsigned count)
+    {
+        if (count == 0)
+            return;
+        if (count < 64)
+            bits &= (1ULL << count) - 1ULL;
+        const unsigned bit = static_cast<unsigned>(nbits_ & 63);
+        if (bit == 0)
+        {
+            words_.push_back(bits);
+        }
+        else
+        {
+            words_.back() |= bits << bit;
+            if (bit + count > 64)
+                words_.push_back(bits >> (64 - bit));
+        }
+        nbits_ += count;
+    }
+
+    // value を count 個追記する（LOUDS では兄弟の数だけ 1 を並べるのに使う）
+    void appendRun(bool value, size_t count)
+    {
+        const uint64_t fill = value ? ~0ULL : 0ULL;
+        for (; count >= 64; count -= 64)
+            appendWord(fill, 64);
+        appendWord(fill, static_cast<unsigned>(count));
+    }
+
+    // other のビット列を後ろに連結する
+    void append(const BitVectorBuilder &other)
+    {
+        const size_t full = other.nbits_ / 64;
+        if ((nbits_ & 63) == 0)
+        {
+            words_.insert(words_.end(), other.words_.begin(), other.words_.begin() + static_cast<std::ptrdiff_t>(full));
+            nbits_ += full * 64;
+        }
+        else
+        {
+            for (size_t w = 0; w < full; ++w)
+                appendWord(other.words_[w], 64);
+        }
+        appendWord(full < other.words_.size() ? other.words_[full] : 0ULL, static_cast<unsigned>(other.nbits_ & 63));
+    }
+
+    MemoryUsage memoryUsage() const
+    {
+        MemoryUsage u;
+        u.bits = MemoryUsage::used(words_);
+        u.overhead = sizeof(*this) + MemoryUsage::slack(words_);
+        return u;
+    }
+
+    // 組み立てた word 列を BitVector に移す（builder は空に戻る）
+    BitVector build()
+    {
+        BitVector bv;
+        bv.assign_from_words(nbits_, std::move(words_));
+        clear();
+        return bv;
+    }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t nbits_{0};
+};
+
+// BitVector（または mmap 上の word 列）を所有せずに参照する軽量ビュー
+class BitVectorView
+{
+public:
+    BitVectorView() = default;
+
+    BitVectorView(const uint64_t *words, size_t nbits)
+        : words_(words), nbits_(nbits) {}
+
+    BitVectorView(const BitVector &bv)
+        : words_(bv.words().data()), nbits_(bv.size()) {}
+
+    size_t size() const { return nbits_; }
+
+    size_t numWords() const { return (nbits_ + 63) / 64; }
+
+    const uint64_t *words() const { return words_; }
+
+    bool get(size_t i) const
+    {
+        if (i >= nbits_)
+            return false;
+        LOUDS_TOUCH(words_ + (i >> 6));
+        return (words_[i >> 6] >> (i & 63)) & 1ULL;
+    }
+
+    // i から連続する 1 の個数（LOUDS では i から始まる兄弟ノードの数）
+    size_t countOnesFrom(size_t i) const
+    {
+        size_t count = 0;
+        while (i < nbits_)
+        {
+            const size_t bit = i & 63;
+            LOUDS_TOUCH(words_ + (i >> 6));
+            const uint64_t inv = ~(words_[i >> 6] >> bit);
+            const size_t run = (inv == 0) ? (64 - bit) : static_cast<size_t>(__builtin_ctzll(inv));
+            const size_t avail = std::min(64 - bit, nbits_ - i);
+            if (run < avail)
+                return count + run;
+            count += avail;
+            i += avail;
+        }
+        return count;
+    }
+
+    // i 以降で最初に 1 が立っている位置（無ければ size()）
+    size_t nextOneFrom(size_t i) const
+    {
+        while (i < nbits_)
+        {
+            LOUDS_TOUCH(words_ + (i >> 6));
+            const uint64_t w = words_[i >> 6] >> (i & 63);
+            if (w != 0)
+                return std::min(i + static_cast<size_t>(__builtin_ctzll(w)), nbits_);
+            i = (i | 63) + 1;
+        }
+        return nbits_;
+    }
+
+private:
+    const uint64_t *words_{nullptr};
+    size_t nbits_{0};
+};
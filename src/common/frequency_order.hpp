@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+
+// 兄弟ノードを「よく通る順」に並べるためのノードの重み（SiblingOrder::FrequencyDescending 用）
+//
+// - addQuery: クエリ（検索する文字列）を根からたどり、たどれたノードに重みを足す。
+//   途中で外れたクエリも外れるまでのノードは数える（Reader の traverse が訪れるノードと同じ）
+// - fromTermWeights: termWeights[termId] を語の重みとして、部分木の合計を各ノードの重みにする（Node に termId が必要）
+// - orderChildren: 子を重みの降順に並べる。同じ重み（重みの無い子を含む）はラベル昇順なので、
+//   重みが空なら Converter の通常の並びと同じになる
+template <class Node>
+class NodeWeights
+{
+public:
+    using CharT = decltype(Node::c);
+    using Child = typename Node::Child;
+
+    void addQuery(const Node *root, std::basic_string_view<CharT> query, uint64_t weight = 1)
+    {
+        const Node *node = root;
+        for (CharT c : query)
+        {
+            node = node ? node->getChild(c) : nullptr;
+            if (!node)
+                return;
+            weights_[node] += weight;
+        }
+    }
+
+    template <class String>
+    static NodeWeights fromQueries(const Node *root, std::span<const String> queries)
+    {
+        NodeWeights w;
+        for (const String &q : queries)
+            w.addQuery(root, std::basic_string_view<CharT>(q));
+        return w;
+    }
+
+    static NodeWeights fromTermWeights(const Node *root, std::span<const uint32_t> termWeights)
+    {
+        NodeWeights w;
+        if (!root)
+            return w;
+
+        // BFS 順に並べ、後ろ（深い側）から親へ足していく
+        std::vector<const Node *> order{root};
+        std::vector<size_t> parentOf{0};
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            for (const auto &[label, child] : order[i]->children())
+            {
+                order.push_back(child);
+                parentOf.push_back(i);
+            }
+        }
+        std::vector<uint64_t> sum(order.size(), 0);
+        for (size_t i = order.size(); i-- > 0;)
+        {
+            const Node *node = order[i];
+            if (node->isWord && node->termId >= 0 && static_cast<size_t>(node->termId) < termWeights.size())
+                sum[i] += termWeights[static_cast<size_t>(node->termId)];
+            if (i != 0)
+                sum[parentOf[i]] += sum[i];
+        }
+        w.weights_.reserve(order.size());
+        for (size_t i = 1; i < order.size(); ++i)
+        {
+            if (sum[i] != 0)
+                w.weights_.emplace(order[i], sum[i]);
+        }
+        return w;
+    }
+
+    uint64_t weightOf(const Node *node) const
+    {
+        const auto it = weights_.find(node);
+        return (it == weights_.end()) ? 0 : it->second;
+    }
+
+    bool empty() const { return weights_.empty(); }
+
+    // node の子を重みの降順（同じ重みはラベル昇順）で out に入れる
+    void orderChildren(const Node *node, std::vector<Child> &out) const
+    {
+        const std::span<const Child> children = node->children();
+        keyed_.clear();
+        for (const Child &child : children)
+            keyed_.push_back({weightOf(child.node), child});
+        // 子はもともとラベル昇順なので、stable_sort で同じ重みの並びが保たれる
+        std::stable_sort(keyed_.begin(), keyed_.end(), [](const Keyed &a, const Keyed &b)
+                         { return a.weight > b.weight; });
+        out.clear();
+        for (const Keyed &k : keyed_)
+            out.push_back(k.child);
+    }
+
+private:
+    struct Keyed
+    {
+        uint64_t weight;
+        Child child;
+    };
+
+    std::unordered_map<const Node *, uint64_t> weights_;
+    mutable std::vector<Keyed> keyed_; // orderChildren の作業領域（同じ NodeWeights を複数スレッドで使わない）
+};
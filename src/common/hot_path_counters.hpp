@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+// 検索の内訳カウンタ（遅いクエリで時間が rank / select・兄弟の走査・段数のどれに使われたかを見る）
+//
+// - CMake の LOUDS_HOT_PATH_COUNTERS=ON のときだけ有効。既定（OFF）では LOUDS_COUNT / LOUDS_TOUCH が
+//   空になり、引数も評価されないので計測のコードは残らない
+// - 値はスレッドごと（thread_local）。ツールは計測の前に reset し、終わったら各スレッドの snapshot を足す
+// - 数えるもの:
+//   - rank / select: SuccinctBitVector の rank1 / rank0 / select1 / select0（範囲外で即返るものは除く）
+//   - siblings: 兄弟ラベルとの比較回数（SIMD の線形比較は調べた要素数、二分探索は比較回数）
+//   - levels: 子へ下った段数（traverse / findChild の呼び出し）
+//   - parents: 親へ上った段数（getLetter のキー復元）
+//   - cacheLines: 計測点で読んだ 64 byte 行のうち、直前に読んだ行と違うもの。
+//     ハードウェアのキャッシュは見ない近似で、同じ行への連続した読み出しを 1 回に数える
+namespace hot_path_counters
+{
+    struct Counters
+    {
+        uint64_t rank = 0;
+        uint64_t select = 0;
+        uint64_t siblings = 0;
+        uint64_t levels = 0;
+        uint64_t parents = 0;
+        uint64_t cacheLines = 0;
+
+        Counters &operator+=(const Counters &other)
+        {
+            rank += other.rank;
+            select += other.select;
+            siblings += other.siblings;
+            levels += other.levels;
+            parents += other.parents;
+            cacheLines += other.cacheLines;
+            return *this;
+        }
+    };
+
+#if defined(LOUDS_HOT_PATH_COUNTERS)
+    inline constexpr bool kEnabled = true;
+
+    namespace detail
+    {
+        inline thread_local Counters counters;
+        inline thread_local uintptr_t lastLine = ~uintptr_t{0};
+    }
+
+    inline Counters &local() { return detail::counters; }
+
+    // [p, p + bytes) を先頭から読んだときの行数を足す
+    inline void touch(const void *p, size_t bytes = 1)
+    {
+        if (bytes == 0)
+            return;
+        const uintptr_t first = reinterpret_cast<uintptr_t>(p) >> 6;
+        const uintptr_t last = (reinterpret_cast<uintptr_t>(p) + bytes - 1) >> 6;
+        detail::counters.cacheLines += (last - first + 1) - (first == detail::lastLine ? 1 : 0);
+        detail::lastLine = last;
+    }
+
+    inline Counters snapshot() { return detail::counters; }
+
+    inline void reset()
+    {
+        detail::counters = Counters{};
+        detail::lastLine = ~uintptr_t{0};
+    }
+#else
+    inline constexpr bool kEnabled = false;
+
+    inline Counters snapshot() { return Counters{}; }
+
+    inline void reset() {}
+#endif
+
+    // key=value で 1 行に出す（operations 件あたりの平均。無効なビルドでは hot_path_counters=off だけ）
+    inline void print(std::ostream &os, const Counters &c, uint64_t operations)
+    {
+        if (!kEnabled)
+        {
+            os << "hot_path_counters=off\n";
+            return;
+        }
+        const double n = operations > 0 ? static_cast<double>(operations) : 1.0;
+        os << "hot_path_counters=on operations=" << operations
+           << " rank_per_op=" << static_cast<double>(c.rank) / n
+           << " select_per_op=" << static_cast<double>(c.select) / n
+           << " siblings_per_op=" << static_cast<double>(c.siblings) / n
+           << " levels_per_op=" << static_cast<double>(c.levels) / n
+           << " parents_per_op=" << static_cast<double>(c.parents) / n
+           << " cache_lines_per_op=" << static_cast<double>(c.cacheLines) / n << "\n";
+    }
+}
+
+#if defined(LOUDS_HOT_PATH_COUNTERS)
+#define LOUDS_COUNT(field, n) (::hot_path_counters::local().field += static_cast<uint64_t>(n))
+#define LOUDS_TOUCH(...) ::hot_path_counters::touch(__VA_ARGS__)
+#else
+#define LOUDS_COUNT(field, n) ((void)0)
+#define LOUDS_TOUCH(...) ((void)0)
+#endif
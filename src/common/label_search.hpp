@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "common/louds_image.hpp"
+#include "common/hot_path_counters.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 兄弟ノードのラベル列（labels 上の連続区間）から 1 文字を探すヘルパ
+// - find: 並び順に依存しない線形探索。SSE2 があれば 128bit ずつ比較（char16_t: 8 lane / char32_t: 4 lane）
+// - findSorted: 昇順に並んでいる前提。大きな区間は二分探索、小さな区間は find
+// - findSortedCodePoint: code point 昇順（UTF-16 ではサロゲートが U+E000..U+FFFF より後ろ）に並んでいる前提
+// - findBySiblingOrder: 記録された SiblingOrder に合わせて上のどれかを呼ぶ（FrequencyDescending は find。よく通る子が先頭にある）
+// 見つからなければ n を返す
+namespace label_search
+{
+    // これ未満の区間は二分探索より SIMD の線形比較のほうが速い
+    inline constexpr size_t kBinarySearchMinFanout = 32;
+
+    namespace detail
+    {
+        template <class CharT>
+        inline size_t findScalar(const CharT *p, size_t begin, size_t n, CharT c)
+        {
+            for (size_t i = begin; i < n; ++i)
+            {
+                if (p[i] == c)
+                    return i;
+            }
+            return n;
+        }
+
+        // code point 順の比較キー（char16_t のみ並べ替える）
+        template <class CharT>
+        inline uint32_t codePointKey(CharT c)
+        {
+            const uint32_t u = static_cast<uint32_t>(c);
+            if (sizeof(CharT) != 2 || u < 0xD800)
+                return u;
+            return (u >= 0xE000) ? u - 0x800 : u + 0x2000;
+        }
+
+        template <class CharT>
+        inline size_t findLinear(const CharT *p, size_t n, CharT c)
+        {
+            static_assert(sizeof(CharT) == 2 || sizeof(CharT) == 4, "label_search: char16_t / char32_t only");
+            size_t i = 0;
+#if defined(__SSE2__)
+            constexpr size_t lanes = 16 / sizeof(CharT);
+            const __m128i needle = (sizeof(CharT) == 2)
+                                       ? _mm_set1_epi16(static_cast<short>(c))
+                                       : _mm_set1_epi32(static_cast<int>(c));
+            for (; i + lanes <= n; i += lanes)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                const __m128i eq = (sizeof(CharT) == 2) ? _mm_cmpeq_epi16(v, needle) : _mm_cmpeq_epi32(v, needle);
+                const int mask = _mm_movemask_epi8(eq);
+                if (mask != 0)
+                    return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask))) / sizeof(CharT);
+            }
+#endif
+            return findScalar(p, i, n, c);
+        }
+
+        // 二分探索の比較（比較回数と読んだ行を数える）
+        template <class CharT>
+        inline bool lessCounted(const CharT &a, CharT b)
+        {
+            LOUDS_COUNT(siblings, 1);
+            LOUDS_TOUCH(&a, sizeof(CharT));
+            return a < b;
+        }
+    }
+
+    template <class CharT>
+    inline size_t find(const CharT *p, size_t n, CharT c)
+    {
+        const size_t k = detail::findLinear(p, n, c);
+        LOUDS_COUNT(siblings, k < n ? k + 1 : n);
+        LOUDS_TOUCH(p, (k < n ? k + 1 : n) * sizeof(CharT));
+        return k;
+    }
+
+    template <class CharT>
+    inline size_t findSorted(const CharT *p, size_t n, CharT c)
+    {
+        if (n < kBinarySearchMinFanout)
+            return find(p, n, c);
+        const CharT *it = std::lower_bound(p, p + n, c, [](const CharT &a, CharT b)
+                                           { return detail::lessCounted(a, b); });
+        if (it != p + n && *it == c)
+            return static_cast<size_t>(it - p);
+        return n;
+    }
+
+    template <class CharT>
+    inline size_t findSortedCodePoint(const CharT *p, size_t n, CharT c)
+    {
+        if (sizeof(CharT) != 2)
+            return findSorted(p, n, c);
+        if (n < kBinarySearchMinFanout)
+            return find(p, n, c);
+        const uint32_t key = detail::codePointKey(c);
+        const CharT *it = std::partition_point(p, p + n, [key](const CharT &a)
+                                               {
+                                                   LOUDS_COUNT(siblings, 1);
+                                                   LOUDS_TOUCH(&a, sizeof(CharT));
+                                                   return detail::codePointKey(a) < key; });
+        if (it != p + n && *it == c)
+            return static_cast<size_t>(it - p);
+        return n;
+    }
+
+    template <class CharT>
+    inline size_t findBySiblingOrder(louds_image::SiblingOrder order, const CharT *p, size_t n, CharT c)
+    {
+        switch (order)
+        {
+        case louds_image::SiblingOrder::CodeUnitAscending:
+            return findSorted(p, n, c);
+        case louds_image::SiblingOrder::CodePointAscending:
+            return findSortedCodePoint(p, n, c);
+        case louds_image::SiblingOrder::FrequencyDescending:
+            // 先頭から探して最初の一致で止まる。よく通る子ほど手前にあるので 1 回目の比較で当たりやすい
+            return find(p, n, c);
+        default:
+            return find(p, n, c);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+#include "common/memory_usage.hpp"
+
+// Writer 側の LOUDS 系（LOUDS / LOUDSUtf16 / LOUDSWithTermId / LOUDSWithTermIdUtf16）が検索に使う rank/select ディレクトリ
+//
+// - BitVector::rank1 / select は先頭から word 単位で数えるので、変換直後の辞書を検索すると
+//   1 回ごとに辞書の大きさに比例する。最初の検索でディレクトリ（SuccinctBitVector）を作り、以後はそれを引く
+// - ディレクトリは作ったときの BitVector の版（BitVector::version）と word 列の先頭アドレス・ビット数に紐づける。
+//   LBS / isLeaf を代入・set・読み込みで書き換えると版が変わり、次の検索で作り直す
+//   （同じ大きさの vector の代入で word 列の場所が変わらなくても検知できる）。move では版も移るので作り直さない
+// - Writer の convertListToBitVector と loadFromFile はビット列を作り直したときに reset でも捨てる
+// - 複数スレッドから同時に const の検索をしてよい（ディレクトリを作るのは 1 回だけ）
+// - コピーはディレクトリを持ち越さない（コピー先のビット列は別の場所にある）
+class LazySuccinctIndex
+{
+public:
+    LazySuccinctIndex() = default;
+    LazySuccinctIndex(const LazySuccinctIndex &) {}
+    LazySuccinctIndex &operator=(const LazySuccinctIndex &)
+    {
+        reset();
+        return *this;
+    }
+    LazySuccinctIndex(LazySuccinctIndex &&other) noexcept
+        : owned_(std::move(other.owned_))
+    {
+        current_.store(owned_.get(), std::memory_order_release);
+        other.current_.store(nullptr, std::memory_order_release);
+    }
+    LazySuccinctIndex &operator=(LazySuccinctIndex &&other) noexcept
+    {
+        owned_ = std::move(other.owned_);
+        current_.store(owned_.get(), std::memory_order_release);
+        other.current_.store(nullptr, std::memory_order_release);
+        return *this;
+    }
+
+    // bits のディレクトリ（無い・古いときはここで作る）
+    const SuccinctBitVector &get(const BitVector &bits) const
+    {
+        const Entry *e = current_.load(std::memory_order_acquire);
+        if (e && e->matches(bits))
+            return e->sbv;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!owned_ || !owned_->matches(bits))
+        {
+            owned_ = std::make_unique<Entry>(bits, SuccinctBitVector(bits));
+            current_.store(owned_.get(), std::memory_order_release);
+        }
+        return owned_->sbv;
+    }
+
+    // 読み込んだディレクトリ（.bin の末尾セクション）をそのまま使う。sbv は bits を参照していること
+    void adopt(const BitVector &bits, SuccinctBitVector sbv)
+    {
+        owned_ = std::make_unique<Entry>(bits, std::move(sbv));
+        current_.store(owned_.get(), std::memory_order_release);
+    }
+
+    // 作ったディレクトリの分（まだ作っていなければ本体だけ）
+    MemoryUsage memoryUsage() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MemoryUsage u;
+        if (owned_)
+        {
+            u = owned_->sbv.memoryUsage();
+            u.overhead += sizeof(Entry) - sizeof(SuccinctBitVector);
+        }
+        u.overhead += sizeof(*this);
+        return u;
+    }
+
+    void reset()
+    {
+        current_.store(nullptr, std::memory_order_release);
+        owned_.reset();
+    }
+
+private:
+    struct Entry
+    {
+        Entry(const BitVector &bits, SuccinctBitVector s)
+            : words(bits.words().data()), nbits(bits.size()), version(bits.version()), sbv(std::move(s)) {}
+
+        bool matches(const BitVector &bits) const
+        {
+            return version == bits.version() && words == bits.words().data() && nbits == bits.size();
+        }
+
+        const uint64_t *words;
+        size_t nbits;
+        uint64_t version;
+        SuccinctBitVector sbv;
+    };
+
+    mutable std::mutex mutex_;
+    mutable std::unique_ptr<Entry> owned_;
+    mutable std::atomic<const Entry *> current_{nullptr};
+};
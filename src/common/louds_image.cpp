@@ -0,0 +1,217 @@
+#include "common/louds_image.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+namespace louds_image
+{
+    namespace
+    {
+        uint64_t alignUp(uint64_t v)
+        {
+            return (v + kAlignment - 1) / kAlignment * kAlignment;
+        }
+
+        SectionId offsetId(SectionId id, uint32_t delta)
+        {
+            return static_cast<SectionId>(static_cast<uint32_t>(id) + delta);
+        }
+    }
+
+    Writer::Writer(Kind kind, uint32_t labelBytes)
+        : kind_(kind), labelBytes_(labelBytes) {}
+
+    void Writer::add(SectionId id, const void *data, size_t elemBytes, size_t count, uint64_t param)
+    {
+        for (const Pending &p : sections_)
+        {
+            if (p.id == id)
+                throw std::runtime_error("louds image: duplicated section " +
+                                         std::to_string(static_cast<uint32_t>(id)));
+        }
+        sections_.push_back(Pending{id, data, elemBytes, count, param, {}});
+    }
+
+    void Writer::addStream(SectionId id, size_t elemBytes, size_t count, uint64_t param,
+                           std::function<void(std::ostream &)> write)
+    {
+        add(id, nullptr, elemBytes, count, param);
+        sections_.back().write = std::move(write);
+    }
+
+    void Writer::addBitVector(SectionId wordsId, BitVectorView bits, const SuccinctBitVector &sbv)
+    {
+        add(wordsId, bits.words(), sizeof(uint64_t), bits.numWords(), static_cast<uint64_t>(bits.size()));
+        add(offsetId(wordsId, 1), sbv.rankDirectory());
+        add(offsetId(wordsId, 2), sbv.select1Samples());
+        add(offsetId(wordsId, 3), sbv.select0Samples());
+    }
+
+    void Writer::addSiblingOrder(SiblingOrder order)
+    {
+        if (order == SiblingOrder::Unordered)
+            return;
+        // 値ごと持つ（Writer 自身のメンバを指すと、Writer を move / コピーしたときに外れる）
+        const uint32_t v = static_cast<uint32_t>(order);
+        addStream(SectionId::SiblingOrder, sizeof(uint32_t), 1, 0, [v](std::ostream &os)
+                  { os.write(reinterpret_cast<const char *>(&v), sizeof(v)); });
+    }
+
+    void Writer::writeTo(const std::string &path) const
+    {
+        std::vector<SectionEntry> table;
+        table.reserve(sections_.size());
+
+        uint64_t offset = alignUp(sizeof(Header) + sections_.size() * sizeof(SectionEntry));
+        for (const Pending &p : sections_)
+        {
+            SectionEntry e{};
+            e.id = static_cast<uint32_t>(p.id);
+            e.elemBytes = static_cast<uint32_t>(p.elemBytes);
+            e.offset = offset;
+            e.bytes = static_cast<uint64_t>(p.elemBytes) * p.count;
+            e.param = p.param;
+            table.push_back(e);
+            offset = alignUp(offset + e.bytes);
+        }
+
+        Header h{};
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.kind = static_cast<uint32_t>(kind_);
+        h.endianCheck = kEndianCheck;
+        h.labelBytes = labelBytes_;
+        h.sectionCount = static_cast<uint32_t>(table.size());
+        h.fileSize = offset;
+
+        std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+        if (!ofs)
+            throw std::runtime_error("failed to open file for write: " + path);
+
+        static const char zeros[kAlignment] = {};
+        uint64_t written = 0;
+        auto put = [&](const void *p, uint64_t n)
+        {
+            if (n > 0)
+                ofs.write(static_cast<const char *>(p), static_cast<std::streamsize>(n));
+            written += n;
+        };
+        auto padTo = [&](uint64_t target)
+        {
+            while (written < target)
+                put(zeros, std::min<uint64_t>(target - written, kAlignment));
+        };
+
+        put(&h, sizeof(h));
+        put(table.data(), table.size() * sizeof(SectionEntry));
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            padTo(table[i].offset);
+            if (sections_[i].write)
+            {
+                const std::streamoff begin = ofs.tellp();
+                sections_[i].write(ofs);
+                if (!ofs || static_cast<uint64_t>(ofs.tellp() - begin) != table[i].bytes)
+                    throw std::runtime_error("louds image: streamed section size mismatch " +
+                                             std::to_string(table[i].id) + ": " + path);
+                written += table[i].bytes;
+            }
+            else
+            {
+                put(sections_[i].data, table[i].bytes);
+            }
+        }
+        padTo(h.fileSize);
+
+        if (!ofs)
+            throw std::runtime_error("failed to write file: " + path);
+    }
+
+    View::View(const MappedFile &file, Kind kind, uint32_t labelBytes)
+        : base_(file.data()), path_(file.path())
+    {
+        if (file.size() < sizeof(Header))
+            throw std::runtime_error("louds image: file too small: " + path_);
+
+        Header h{};
+        std::memcpy(&h, base_, sizeof(h));
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0)
+            throw std::runtime_error("louds image: bad magic: " + path_);
+        if (h.endianCheck != kEndianCheck)
+            throw std::runtime_error("louds image: endianness mismatch: " + path_);
+        if (h.version != kVersion)
+            throw std::runtime_error("louds image: unsupported version " + std::to_string(h.version) + ": " + path_);
+        if (h.kind != static_cast<uint32_t>(kind))
+            throw std::runtime_error("louds image: unexpected trie kind: " + path_);
+        if (h.labelBytes != labelBytes)
+            throw std::runtime_error("louds image: unexpected label width: " + path_);
+        if (h.fileSize != file.size())
+            throw std::runtime_error("louds image: truncated file: " + path_);
+
+        const uint64_t tableEnd = sizeof(Header) + static_cast<uint64_t>(h.sectionCount) * sizeof(SectionEntry);
+        if (tableEnd > file.size())
+            throw std::runtime_error("louds image: truncated section table: " + path_);
+
+        entries_.resize(h.sectionCount);
+        if (h.sectionCount > 0)
+            std::memcpy(entries_.data(), base_ + sizeof(Header), h.sectionCount * sizeof(SectionEntry));
+
+        for (const SectionEntry &e : entries_)
+        {
+            if (e.offset % kAlignment != 0 || e.offset < tableEnd ||
+                e.offset > file.size() || e.bytes > file.size() - e.offset)
+                throw std::runtime_error("louds image: section out of range: " + path_);
+            if (e.elemBytes == 0 || e.bytes % e.elemBytes != 0)
+                throw std::runtime_error("louds image: bad section element size: " + path_);
+        }
+    }
+
+    bool View::has(SectionId id) const
+    {
+        for (const SectionEntry &e : entries_)
+        {
+            if (e.id == static_cast<uint32_t>(id))
+                return true;
+        }
+        return false;
+    }
+
+    const SectionEntry &View::entry(SectionId id) const
+    {
+        for (const SectionEntry &e : entries_)
+        {
+            if (e.id == static_cast<uint32_t>(id))
+                return e;
+        }
+        throw std::runtime_error("louds image: missing section " +
+                                 std::to_string(static_cast<uint32_t>(id)) + ": " + path_);
+    }
+
+    BitVectorView View::bitVector(SectionId wordsId) const
+    {
+        const std::span<const uint64_t> words = section<uint64_t>(wordsId);
+        const uint64_t nbits = param(wordsId);
+        if ((nbits + 63) / 64 != words.size())
+            throw std::runtime_error("louds image: bit count does not match words: " + path_);
+        return BitVectorView(words.data(), static_cast<size_t>(nbits));
+    }
+
+    SuccinctBitVector View::succinct(SectionId wordsId) const
+    {
+        return SuccinctBitVector(bitVector(wordsId),
+                                 section<uint64_t>(offsetId(wordsId, 1)),
+                                 section<uint32_t>(offsetId(wordsId, 2)),
+                                 section<uint32_t>(offsetId(wordsId, 3)));
+    }
+
+    SiblingOrder View::siblingOrder() const
+    {
+        if (!has(SectionId::SiblingOrder))
+            return SiblingOrder::Unordered;
+        const std::span<const uint32_t> v = section<uint32_t>(SectionId::SiblingOrder);
+        if (v.size() != 1)
+            throw std::runtime_error("louds image: bad sibling order section: " + path_);
+        return static_cast<SiblingOrder>(v[0]);
+    }
+}
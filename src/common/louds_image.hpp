@@ -0,0 +1,173 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <span>
+#include <ostream>
+#include <functional>
+#include <stdexcept>
+
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+#include "common/mapped_file.hpp"
+
+// mmap してそのまま検索できる LOUDS のイメージ形式（*.img）
+//
+// レイアウト（ホストのエンディアン。異なるエンディアンのファイルは読み込み時に弾く）
+//   [Header 64B][SectionEntry 32B x sectionCount][pad][section 0][pad][section 1]...
+// - 各セクションの先頭は 64 byte 境界に揃える（mmap の先頭はページ境界なので、そのまま span で参照できる）
+// - ビット列は words / rank ディレクトリ / select1 サンプル / select0 サンプル の 4 セクションで持ち、
+//   読み込み側は SuccinctBitVector を再構築せずに参照する
+// - 旧形式（saveToFile / loadFromFile）はそのまま残す
+namespace louds_image
+{
+    inline constexpr char kMagic[8] = {'L', 'O', 'U', 'D', 'S', 'I', 'M', 'G'};
+    inline constexpr uint32_t kVersion = 1;
+    inline constexpr uint64_t kEndianCheck = 0x0102030405060708ULL;
+    inline constexpr size_t kAlignment = 64;
+
+    enum class Kind : uint32_t
+    {
+        Louds = 1,
+        LoudsWithTermId = 2,
+    };
+
+    // ビット列は words, rank, select1, select0 の順に連番で並べる（bitVector / succinct が前提にする）
+    enum class SectionId : uint32_t
+    {
+        LbsWords = 1,
+        LbsRank = 2,
+        LbsSelect1 = 3,
+        LbsSelect0 = 4,
+        LeafWords = 5,
+        LeafRank = 6,
+        LeafSelect1 = 7,
+        LeafSelect0 = 8,
+        Labels = 9,
+        TermIds = 10,
+        SiblingOrder = 11,
+        // 任意の score 列（LOUDSWithTermId のみ）。u32。TermScores は leaf 順、MaxSubtreeScores は labels と同じ添字
+        TermScores = 12,
+        MaxSubtreeScores = 13,
+    };
+
+    // 兄弟ノード（同じ親の子）のラベルの並び順。SiblingOrder セクションに u32 1 要素で記録する
+    // - セクションが無いファイルは Unordered として扱う（旧い Converter は unordered_map の順で出力していた）
+    enum class SiblingOrder : uint32_t
+    {
+        Unordered = 0,
+        CodeUnitAscending = 1,
+        // code point の昇順（UTF-8 のバイト順）。UTF-16 ではサロゲートが U+E000..U+FFFF より後ろに来る
+        // （UTF-32 では CodeUnitAscending と同じ）
+        CodePointAscending = 2,
+        // 重み（クエリログのアクセス数・語の頻度）の降順。同じ重みは code unit 昇順（NodeWeights / Converter::convertByFrequency）
+        // 二分探索はできないので、Reader は先頭から線形に探して見つかった所で止まる
+        FrequencyDescending = 3,
+    };
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t kind;
+        uint64_t endianCheck;
+        uint32_t labelBytes;
+        uint32_t sectionCount;
+        uint64_t fileSize;
+        uint64_t flags;
+        uint8_t reserved[16];
+    };
+    static_assert(sizeof(Header) == 64, "louds_image::Header must be 64 bytes");
+
+    // param: ビット列の words セクションではビット数、それ以外は 0
+    struct SectionEntry
+    {
+        uint32_t id;
+        uint32_t elemBytes;
+        uint64_t offset;
+        uint64_t bytes;
+        uint64_t param;
+    };
+    static_assert(sizeof(SectionEntry) == 32, "louds_image::SectionEntry must be 32 bytes");
+
+    // セクションを集めて 1 ファイルに書き出す。add に渡したメモリは writeTo まで生きている必要がある
+    class Writer
+    {
+    public:
+        Writer(Kind kind, uint32_t labelBytes);
+
+        void add(SectionId id, const void *data, size_t elemBytes, size_t count, uint64_t param = 0);
+
+        template <class T>
+        void add(SectionId id, std::span<const T> values, uint64_t param = 0)
+        {
+            add(id, values.data(), sizeof(T), values.size(), param);
+        }
+
+        // 中身をメモリに持たないセクション。writeTo がセクションの位置で write(os) を呼ぶ
+        // （write はちょうど elemBytes * count byte を書く。違えば writeTo が例外）
+        void addStream(SectionId id, size_t elemBytes, size_t count, uint64_t param,
+                       std::function<void(std::ostream &)> write);
+
+        // bits と、それに対して構築済みの sbv のディレクトリを 4 セクションとして追加する
+        void addBitVector(SectionId wordsId, BitVectorView bits, const SuccinctBitVector &sbv);
+
+        // Unordered（既定）のときは何も追加しない
+        void addSiblingOrder(SiblingOrder order);
+
+        void writeTo(const std::string &path) const;
+
+    private:
+        struct Pending
+        {
+            SectionId id;
+            const void *data;
+            size_t elemBytes;
+            size_t count;
+            uint64_t param;
+            std::function<void(std::ostream &)> write;
+        };
+
+        Kind kind_;
+        uint32_t labelBytes_;
+        std::vector<Pending> sections_;
+    };
+
+    // mmap 済みファイルのヘッダとセクション表を検証し、セクションを型付きで参照する
+    class View
+    {
+    public:
+        View(const MappedFile &file, Kind kind, uint32_t labelBytes);
+
+        bool has(SectionId id) const;
+
+        template <class T>
+        std::span<const T> section(SectionId id) const
+        {
+            const SectionEntry &e = entry(id);
+            if (e.elemBytes != sizeof(T))
+                throw std::runtime_error("louds image: unexpected element size in section " +
+                                         std::to_string(static_cast<uint32_t>(id)) + ": " + path_);
+            return std::span<const T>(reinterpret_cast<const T *>(base_ + e.offset),
+                                      static_cast<size_t>(e.bytes / sizeof(T)));
+        }
+
+        uint64_t param(SectionId id) const { return entry(id).param; }
+
+        BitVectorView bitVector(SectionId wordsId) const;
+
+        // 保存済みディレクトリを参照する SuccinctBitVector（再構築しない）
+        SuccinctBitVector succinct(SectionId wordsId) const;
+
+        // セクションが無ければ Unordered
+        SiblingOrder siblingOrder() const;
+
+    private:
+        const uint8_t *base_;
+        std::string path_;
+        std::vector<SectionEntry> entries_;
+
+        const SectionEntry &entry(SectionId id) const;
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#include "common/louds_types.hpp"
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+
+// 接頭辞のノード以下の部分木を幅優先で列挙するカーソル（predictiveSearch 用）
+// - LOUDS はノードを BFS 順に並べるので、部分木の同じ深さのノードは LBS 上の連続区間になる。
+//   区間 [pos, end) の 1 を word 単位で走査し、次の深さの区間は select0 2 回で求める
+// - 状態は区間の位置と深さだけで、途中の文字列やキューは持たない
+// - 生成元の Reader を参照するので、Reader を move / 破棄した後に使ってはいけない
+class LoudsPredictiveCursor
+{
+public:
+    // 空のカーソル（next は常に false）
+    LoudsPredictiveCursor() = default;
+
+    // node: 接頭辞のノード位置（空の接頭辞ならルートの 0）, depth: 接頭辞の長さ
+    LoudsPredictiveCursor(BitVectorView lbs,
+                          BitVectorView isLeaf,
+                          const SuccinctBitVector &lbsSucc,
+                          LoudsPos node,
+                          size_t depth)
+        : lbs_(lbs),
+          isLeaf_(isLeaf),
+          succ_(&lbsSucc),
+          pos_(static_cast<size_t>(node)),
+          end_(static_cast<size_t>(node) + 1),
+          onesBefore_(lbsSucc.rank1(node) - 1),
+          depth_(depth) {}
+
+    // 次のキーを match に書いて true を返す（length はキーの長さ）。尽きたら false
+    bool next(LoudsPrefixMatch &match)
+    {
+        while (succ_ != nullptr)
+        {
+            while (pos_ < end_)
+            {
+                const size_t p = lbs_.nextOneFrom(pos_);
+                if (p >= end_)
+                {
+                    pos_ = end_;
+                    break;
+                }
+                ++ones_;
+                pos_ = p + 1;
+                if (isLeaf_.get(p))
+                {
+                    match = {depth_, static_cast<LoudsPos>(p)};
+                    return true;
+                }
+            }
+            if (!descend())
+                succ_ = nullptr;
+        }
+        return false;
+    }
+
+private:
+    BitVectorView lbs_;
+    BitVectorView isLeaf_;
+    const SuccinctBitVector *succ_{nullptr};
+
+    size_t pos_{0};
+    size_t end_{0};
+    LoudsPos onesBefore_{0}; // 区間の先頭より前にある 1 の数（区間内の最初のノード番号 - 1）
+    LoudsPos ones_{0};       // 区間内で走査済みの 1 の数
+    size_t depth_{0};
+
+    // 走査し終えた区間のノード（番号 first..last）の子の区間へ進む。子が無ければ false
+    bool descend()
+    {
+        if (ones_ == 0)
+            return false;
+        const LoudsPos first = onesBefore_ + 1;
+        const LoudsPos last = onesBefore_ + ones_;
+        const LoudsPos z0 = succ_->select0(first);
+        const LoudsPos z1 = succ_->select0(last + 1);
+        if (z0 < 0 || z1 < 0)
+            return false;
+
+        pos_ = static_cast<size_t>(z0) + 1;
+        end_ = static_cast<size_t>(z1);
+        // z0 までの 0 は first 個なので、1 の数は位置から引き算で求まる
+        onesBefore_ = z0 + 1 - first;
+        ones_ = 0;
+        ++depth_;
+        return pos_ < end_;
+    }
+};
@@ -0,0 +1,188 @@
+#include "common/louds_trailer.hpp"
+
+namespace louds_trailer
+{
+    namespace
+    {
+        SectionId offsetId(SectionId id, uint32_t delta)
+        {
+            return static_cast<SectionId>(static_cast<uint32_t>(id) + delta);
+        }
+
+        template <class T>
+        void writePod(std::ostream &os, const T &v)
+        {
+            os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        template <class T>
+        void readPod(std::istream &is, T &v)
+        {
+            is.read(reinterpret_cast<char *>(&v), sizeof(v));
+            if (!is)
+                throw std::runtime_error("louds trailer: truncated section");
+        }
+    }
+
+    void Writer::addDirectory(SectionId wordsId, const SuccinctBitVector &sbv)
+    {
+        add(offsetId(wordsId, 1), sbv.rankDirectory());
+        add(offsetId(wordsId, 2), sbv.select1Samples());
+        add(offsetId(wordsId, 3), sbv.select0Samples());
+    }
+
+    void Writer::addSiblingOrder(louds_image::SiblingOrder order)
+    {
+        if (order == louds_image::SiblingOrder::Unordered)
+            return;
+        const uint32_t v = static_cast<uint32_t>(order);
+        add(SectionId::SiblingOrder, std::span<const uint32_t>(&v, 1));
+    }
+
+    void Writer::writeTo(std::ostream &os) const
+    {
+        writePod(os, kMagic);
+        writePod(os, static_cast<uint64_t>(sections_.size()));
+        for (const Section &s : sections_)
+        {
+            writePod(os, static_cast<uint32_t>(s.id));
+            writePod(os, s.elemBytes);
+            if (s.write)
+            {
+                writePod(os, s.streamBytes);
+                const std::streamoff begin = os.tellp();
+                s.write(os);
+                if (!os || static_cast<uint64_t>(os.tellp() - begin) != s.streamBytes)
+                    throw std::runtime_error("louds trailer: streamed section size mismatch " +
+                                             std::to_string(static_cast<uint32_t>(s.id)));
+                continue;
+            }
+            writePod(os, static_cast<uint64_t>(s.bytes.size()));
+            if (!s.bytes.empty())
+                os.write(reinterpret_cast<const char *>(s.bytes.data()),
+                         static_cast<std::streamsize>(s.bytes.size()));
+        }
+    }
+
+    Trailer Trailer::read(std::istream &is)
+    {
+        Trailer t;
+        if (!is || is.peek() == std::char_traits<char>::eof())
+            return t;
+
+        uint64_t magic = 0;
+        readPod(is, magic);
+        if (magic != kMagic)
+            throw std::runtime_error("louds trailer: unexpected data after payload");
+
+        uint64_t count = 0;
+        readPod(is, count);
+
+        // セクションの長さはファイルから読んだ値なので、確保する前にストリームの残りと比べる
+        // （壊れた・途中で切れた .bin で巨大な確保をしない）
+        const std::istream::pos_type here = is.tellg();
+        if (here == std::istream::pos_type(-1))
+            throw std::runtime_error("louds trailer: stream is not seekable");
+        is.seekg(0, std::ios::end);
+        const std::istream::pos_type end = is.tellg();
+        is.seekg(here);
+        if (!is || end < here)
+            throw std::runtime_error("louds trailer: stream is not seekable");
+        uint64_t remaining = static_cast<uint64_t>(end - here);
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint32_t id = 0;
+            uint32_t elemBytes = 0;
+            uint64_t bytes = 0;
+            readPod(is, id);
+            readPod(is, elemBytes);
+            readPod(is, bytes);
+            const uint64_t headerBytes = sizeof(id) + sizeof(elemBytes) + sizeof(bytes);
+            if (remaining < headerBytes || bytes > remaining - headerBytes)
+                throw std::runtime_error("louds trailer: truncated section");
+            remaining -= headerBytes + bytes;
+
+            Section s;
+            s.id = static_cast<SectionId>(id);
+            s.elemBytes = elemBytes;
+            // 取り出すときにコピーが要らないよう、要素の型の vector に直接読む（知らない形はバイト列のまま）
+            char *dst = nullptr;
+            if (elemBytes == sizeof(uint64_t) && bytes % sizeof(uint64_t) == 0)
+            {
+                s.u64.resize(static_cast<size_t>(bytes / sizeof(uint64_t)));
+                dst = reinterpret_cast<char *>(s.u64.data());
+            }
+            else if (elemBytes == sizeof(uint32_t) && bytes % sizeof(uint32_t) == 0)
+            {
+                s.u32.resize(static_cast<size_t>(bytes / sizeof(uint32_t)));
+                dst = reinterpret_cast<char *>(s.u32.data());
+            }
+            else
+            {
+                s.bytes.resize(static_cast<size_t>(bytes));
+                dst = reinterpret_cast<char *>(s.bytes.data());
+            }
+            if (bytes > 0)
+            {
+                is.read(dst, static_cast<std::streamsize>(bytes));
+                if (!is)
+                    throw std::runtime_error("louds trailer: truncated section");
+            }
+            t.sections_.push_back(std::move(s));
+        }
+        if (is.peek() != std::char_traits<char>::eof())
+            throw std::runtime_error("louds trailer: unexpected data after trailer");
+        return t;
+    }
+
+    bool Trailer::has(SectionId id) const
+    {
+        for (const Section &s : sections_)
+        {
+            if (s.id == id)
+                return true;
+        }
+        return false;
+    }
+
+    Trailer::Section &Trailer::find(SectionId id)
+    {
+        return const_cast<Section &>(static_cast<const Trailer &>(*this).find(id));
+    }
+
+    const Trailer::Section &Trailer::find(SectionId id) const
+    {
+        for (const Section &s : sections_)
+        {
+            if (s.id == id)
+                return s;
+        }
+        throw std::runtime_error("louds trailer: missing section " +
+                                 std::to_string(static_cast<uint32_t>(id)));
+    }
+
+    SuccinctBitVector Trailer::takeSuccinct(SectionId wordsId, BitVectorView bits)
+    {
+        const SectionId rankId = offsetId(wordsId, 1);
+        const SectionId sel1Id = offsetId(wordsId, 2);
+        const SectionId sel0Id = offsetId(wordsId, 3);
+        if (!has(rankId) || !has(sel1Id) || !has(sel0Id))
+            return SuccinctBitVector(bits);
+
+        return SuccinctBitVector(bits,
+                                 take<uint64_t>(rankId),
+                                 take<uint32_t>(sel1Id),
+                                 take<uint32_t>(sel0Id));
+    }
+
+    louds_image::SiblingOrder Trailer::siblingOrder() const
+    {
+        if (!has(SectionId::SiblingOrder))
+            return louds_image::SiblingOrder::Unordered;
+        const std::vector<uint32_t> v = get<uint32_t>(SectionId::SiblingOrder);
+        if (v.size() != 1)
+            throw std::runtime_error("louds trailer: bad sibling order section");
+        return static_cast<louds_image::SiblingOrder>(v[0]);
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <span>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <functional>
+#include <type_traits>
+
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+#include "common/louds_image.hpp"
+
+// 旧形式（saveToFile / loadFromFile）の末尾に付ける任意の拡張セクション
+//
+// レイアウト（ホストのエンディアン。旧形式の labels / termIds の直後）
+//   u64 kMagic, u64 sectionCount, { u32 id, u32 elemBytes, u64 bytes, payload } x sectionCount
+// - セクション ID はイメージ形式（louds_image::SectionId）と共通
+// - 旧い Reader は末尾を読まないので、付けても互換性は保たれる
+// - 新しい Reader は末尾が無ければ空として扱い、知らない ID は読み飛ばす
+namespace louds_trailer
+{
+    inline constexpr uint64_t kMagic = 0x5458455344554F4CULL; // "LOUDSEXT"
+
+    using louds_image::SectionId;
+
+    class Writer
+    {
+    public:
+        template <class T>
+        void add(SectionId id, std::span<const T> values)
+        {
+            Section s;
+            s.id = id;
+            s.elemBytes = sizeof(T);
+            s.bytes.resize(values.size_bytes());
+            if (!values.empty())
+                std::memcpy(s.bytes.data(), values.data(), values.size_bytes());
+            sections_.push_back(std::move(s));
+        }
+
+        // 中身をメモリに持たないセクション。writeTo が write(os) を呼ぶ（ちょうど bytes byte を書く。違えば例外）
+        void addStream(SectionId id, uint32_t elemBytes, uint64_t bytes, std::function<void(std::ostream &)> write)
+        {
+            Section s;
+            s.id = id;
+            s.elemBytes = elemBytes;
+            s.streamBytes = bytes;
+            s.write = std::move(write);
+            sections_.push_back(std::move(s));
+        }
+
+        // sbv の rank ディレクトリと select サンプルを、wordsId に続く 3 つの ID で追加する
+        void addDirectory(SectionId wordsId, const SuccinctBitVector &sbv);
+
+        // Unordered（既定）のときは何も追加しない
+        void addSiblingOrder(louds_image::SiblingOrder order);
+
+        bool empty() const { return sections_.empty(); }
+
+        void writeTo(std::ostream &os) const;
+
+    private:
+        struct Section
+        {
+            SectionId id;
+            uint32_t elemBytes;
+            std::vector<uint8_t> bytes;
+            uint64_t streamBytes = 0;
+            std::function<void(std::ostream &)> write;
+        };
+        std::vector<Section> sections_;
+    };
+
+    class Trailer
+    {
+    public:
+        // 現在位置から末尾を読む。ファイル終端なら空
+        // 要素が 8 / 4 byte のセクションはその型の vector に直接読むので、take でコピーせずに取り出せる
+        // 確保の前にセクションの長さをストリームの残りと比べるので、is はシークできること（ファイル）
+        static Trailer read(std::istream &is);
+
+        bool has(SectionId id) const;
+
+        // セクションの中身のコピー（sibling order など小さいもの用）
+        template <class T>
+        std::vector<T> get(SectionId id) const
+        {
+            const Section &s = find(id);
+            checkElem<T>(s);
+            if constexpr (sizeof(T) == sizeof(uint64_t) || sizeof(T) == sizeof(uint32_t))
+            {
+                const auto &v = s.template payload<T>();
+                std::vector<T> out(v.size());
+                if (!out.empty())
+                    std::memcpy(out.data(), v.data(), v.size() * sizeof(T));
+                return out;
+            }
+            else
+            {
+                std::vector<T> out(s.bytes.size() / sizeof(T));
+                if (!out.empty())
+                    std::memcpy(out.data(), s.bytes.data(), s.bytes.size());
+                return out;
+            }
+        }
+
+        // セクションの中身を取り出す（コピーしない。取り出した後のセクションは空になる）
+        template <class T>
+        std::vector<T> take(SectionId id)
+        {
+            static_assert(sizeof(T) == sizeof(uint64_t) || sizeof(T) == sizeof(uint32_t),
+                          "louds trailer: take supports 8 / 4 byte elements");
+            Section &s = find(id);
+            checkElem<T>(s);
+            auto &v = s.template payload<T>();
+            std::vector<T> out;
+            if constexpr (std::is_same_v<T, typename std::remove_reference_t<decltype(v)>::value_type>)
+                out = std::move(v);
+            else
+            {
+                out.resize(v.size());
+                if (!out.empty())
+                    std::memcpy(out.data(), v.data(), v.size() * sizeof(T));
+            }
+            v = {};
+            return out;
+        }
+
+        // 保存済みディレクトリがあればそれを取り出して使い（コピーしない）、無ければ bits から構築する
+        SuccinctBitVector takeSuccinct(SectionId wordsId, BitVectorView bits);
+
+        // セクションが無ければ Unordered
+        louds_image::SiblingOrder siblingOrder() const;
+
+    private:
+        struct Section
+        {
+            SectionId id;
+            uint32_t elemBytes;
+            // elemBytes に合わせてどれか 1 つだけを使う
+            std::vector<uint64_t> u64;
+            std::vector<uint32_t> u32;
+            std::vector<uint8_t> bytes;
+
+            template <class T>
+            auto &payload()
+            {
+                if constexpr (sizeof(T) == sizeof(uint64_t))
+                    return u64;
+                else
+                    return u32;
+            }
+
+            template <class T>
+            const auto &payload() const
+            {
+                if constexpr (sizeof(T) == sizeof(uint64_t))
+                    return u64;
+                else
+                    return u32;
+            }
+        };
+        std::vector<Section> sections_;
+
+        const Section &find(SectionId id) const;
+        Section &find(SectionId id);
+
+        template <class T>
+        static void checkElem(const Section &s)
+        {
+            const bool typed = sizeof(T) == sizeof(uint64_t) || sizeof(T) == sizeof(uint32_t);
+            if (s.elemBytes != sizeof(T) || (typed && !s.bytes.empty()) || s.bytes.size() % sizeof(T) != 0)
+                throw std::runtime_error("louds trailer: unexpected element size in section " +
+                                         std::to_string(static_cast<uint32_t>(s.id)));
+        }
+    };
+}
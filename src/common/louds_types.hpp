@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// LOUDS のビット位置 / ノード番号の型。
+// - 既定は 32bit（2^31 bit 未満の LBS 向け。ディレクトリやサンプル、API がコンパクト）
+// - CMake の LOUDS_64BIT_POSITIONS=ON で 64bit になり、2^31 bit を超える辞書を扱える
+#if defined(LOUDS_64BIT_POSITIONS)
+using LoudsPos = int64_t;
+#else
+using LoudsPos = int32_t;
+#endif
+
+// commonPrefixSearch の固定長出力用（クエリの先頭 length 文字がキー）
+struct LoudsPrefixMatch
+{
+    size_t length;
+    LoudsPos nodeIndex;
+};
+
+struct LoudsTermPrefixMatch
+{
+    size_t length;
+    LoudsPos nodeIndex;
+    int32_t termId;
+};
+
+// score 付き辞書の predictiveTopK の結果（キーは getLetter(nodeIndex) で復元する）
+struct LoudsScoredMatch
+{
+    size_t length;
+    LoudsPos nodeIndex;
+    int32_t termId;
+    uint32_t score;
+};
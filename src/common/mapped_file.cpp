@@ -0,0 +1,69 @@
+#include "common/mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path)
+    : path_(path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("failed to stat file: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    // 空ファイルは mmap できないので data_ == nullptr のまま返す（ヘッダ検証で弾かれる）
+    if (size_ > 0)
+    {
+        void *p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("failed to mmap file: " + path);
+        }
+        data_ = static_cast<const uint8_t *>(p);
+    }
+    // mapping はファイルディスクリプタを閉じても有効
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    reset();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      path_(std::move(other.path_)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        path_ = std::move(other.path_);
+    }
+    return *this;
+}
+
+void MappedFile::reset()
+{
+    if (data_ != nullptr)
+        ::munmap(const_cast<uint8_t *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 読み込み専用でファイル全体を mmap する（POSIX）
+// - MAP_SHARED なので同じファイルを開いた複数プロセスでページキャッシュを共有できる
+// - move のみ可。デストラクタで munmap する
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string &path() const { return path_; }
+
+private:
+    const uint8_t *data_{nullptr};
+    size_t size_{0};
+    std::string path_;
+
+    void reset();
+};
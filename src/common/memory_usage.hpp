@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// LOUDS 系の構造が使っているメモリの内訳（memoryUsage() の戻り値、byte 単位）
+//
+// - 各項目はその構造が参照しているデータの大きさで、ヒープ上か mmap したファイル上かを問わない。
+//   mapped はそのうち mmap したファイル上にある分（ページキャッシュに載り、同じファイルを開いたプロセス間で共有される）
+// - overhead はオブジェクト本体（sizeof）と、vector の確保済みで未使用の容量
+// - 値で持つメンバの memoryUsage を足すときは embedded を使う（メンバの sizeof は親の sizeof に含まれている）
+struct MemoryUsage
+{
+    uint64_t bits = 0;          // ビット列の word（LBS / isLeaf）
+    uint64_t rankDirectory = 0; // rank ディレクトリ（rank9 の 2 word / 512 bit）
+    uint64_t selectSamples = 0; // select のヒント（select1 / select0）
+    uint64_t labels = 0;        // 辺のラベル
+    uint64_t termIds = 0;       // leaf ごとの termId
+    uint64_t scores = 0;        // termScores / maxScores
+    uint64_t overhead = 0;
+    uint64_t mapped = 0;
+
+    uint64_t total() const { return bits + rankDirectory + selectSamples + labels + termIds + scores + overhead; }
+
+    // プロセスごとに確保する分（total から mmap の分を除く）
+    uint64_t heap() const { return total() - mapped; }
+
+    MemoryUsage &operator+=(const MemoryUsage &other)
+    {
+        bits += other.bits;
+        rankDirectory += other.rankDirectory;
+        selectSamples += other.selectSamples;
+        labels += other.labels;
+        termIds += other.termIds;
+        scores += other.scores;
+        overhead += other.overhead;
+        mapped += other.mapped;
+        return *this;
+    }
+
+    // mapped 以外を mapped に数え直す（mmap したイメージから作った Reader 用）
+    void markMapped() { mapped = bits + rankDirectory + selectSamples + labels + termIds + scores; }
+
+    // 値で持つメンバの分（sizeof を overhead から引く）
+    template <class T>
+    static MemoryUsage embedded(const T &member)
+    {
+        MemoryUsage u = member.memoryUsage();
+        u.overhead -= sizeof(T);
+        return u;
+    }
+
+    // vector の確保済みで未使用の容量
+    template <class T>
+    static uint64_t slack(const std::vector<T> &v)
+    {
+        return static_cast<uint64_t>(v.capacity() - v.size()) * sizeof(T);
+    }
+
+    template <class T>
+    static uint64_t used(const std::vector<T> &v)
+    {
+        return static_cast<uint64_t>(v.size()) * sizeof(T);
+    }
+};
@@ -0,0 +1,313 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <span>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <numeric>
+
+#include "common/bit_vector.hpp"
+
+// Converter の BFS を根の子（先頭文字）ごとの部分木に分けて、複数スレッドで回す
+//
+// - BFS で深さ d に並ぶノードは「根の子の順に、各部分木の深さ d のノード」なので、
+//   worker が担当の部分木を BFS して深さごとの断片（LBS / isLeaf のビット列・labels・termId・score）を作り、
+//   深さごとに根の子の順で連結すれば直列の Converter と同じ LBS / isLeaf / labels / termIds になる
+// - maxScores（部分木の最大 score）は部分木の中で閉じるので worker が求める。根（labels[1]）だけ連結時に埋める
+// - worker は部分木を大きそうな順（孫の数）に取っていく。最大の部分木より速くはならない
+// - 断片と連結後の結果を同時に持つので、変換中のメモリは直列の Converter のおよそ 2 倍になる
+template <class Node, class CharT>
+class ShardedLoudsConverter
+{
+public:
+    struct Options
+    {
+        // 0 なら hardware_concurrency。部分木の数より多くは使わない
+        size_t threads = 0;
+        // leaf 順の termId（termIdsSave）を作る。Node に termId が必要
+        bool withTermIds = false;
+        // termScores[termId] を score として termScores / maxScores を作る（withTermIds のときだけ）
+        bool withScores = false;
+        std::span<const uint32_t> termScores;
+    };
+
+    // LOUDS 系の各フィールドにそのまま入れる
+    struct Result
+    {
+        BitVector LBS;
+        BitVector isLeaf;
+        std::vector<CharT> labels;
+        std::vector<int32_t> termIdsSave;
+        std::vector<uint32_t> termScores;
+        std::vector<uint32_t> maxScores;
+        size_t threadsUsed{0};
+    };
+
+    explicit ShardedLoudsConverter(Options options) : options_(options)
+    {
+        if (!options_.withTermIds)
+            options_.withScores = false;
+    }
+
+    Result convert(const Node *root) const
+    {
+        std::vector<const Node *> shards;
+        if (root)
+        {
+            for (const auto &[label, child] : root->children())
+                shards.push_back(child);
+        }
+
+        std::vector<Shard> built(shards.size());
+        const size_t threads = threadCount(shards.size());
+        if (threads <= 1)
+        {
+            for (size_t s = 0; s < shards.size(); ++s)
+                built[s] = buildShard(shards[s]);
+        }
+        else
+        {
+            runWorkers(shards, built, threads);
+        }
+
+        Result r = stitch(root, built);
+        r.threadsUsed = std::max<size_t>(threads, 1);
+        return r;
+    }
+
+private:
+    // 部分木の深さ 1 つぶん（その深さのノードが出す「子のエントリ… 終端」の並び）
+    struct Level
+    {
+        BitVectorBuilder lbs;
+        BitVectorBuilder isLeaf;
+        std::vector<CharT> labels;
+        std::vector<int32_t> termIds;
+        std::vector<uint32_t> termScores;
+        std::vector<uint32_t> maxScores;  // labels と同じ添字
+        std::vector<uint32_t> childCount; // この深さのノードごとの子の数（maxScores を下から集めるのに使う）
+    };
+
+    struct Shard
+    {
+        std::vector<Level> levels; // levels[0] は根の子自身が出すブロック
+        uint32_t rootMaxScore{0};  // 根の子自身のエントリの maxScores
+    };
+
+    Options options_;
+
+    size_t threadCount(size_t shards) const
+    {
+        size_t t = options_.threads;
+        if (t == 0)
+            t = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return std::min(t, shards);
+    }
+
+    uint32_t scoreOf(int termId) const
+    {
+        if (termId < 0 || static_cast<size_t>(termId) >= options_.termScores.size())
+            return 0;
+        return options_.termScores[static_cast<size_t>(termId)];
+    }
+
+    static int termIdOf(const Node *node)
+    {
+        if constexpr (requires { node->termId; })
+            return node->termId;
+        else
+            return -1;
+    }
+
+    // 1 つの親の子をエントリとして書く（Converter の内側のループと同じ並び）
+    void emitChildren(const Node *node, Level &out, std::vector<const Node *> *next) const
+    {
+        if (node && node->hasChild())
+        {
+            out.lbs.appendRun(true, node->children().size());
+            for (const auto &[label, child] : node->children())
+            {
+                if (next)
+                    next->push_back(child);
+                out.labels.push_back(label);
+                out.isLeaf.push_back(child->isWord);
+                if (options_.withTermIds && child->isWord)
+                {
+                    out.termIds.push_back(static_cast<int32_t>(termIdOf(child)));
+                    if (options_.withScores)
+                        out.termScores.push_back(scoreOf(termIdOf(child)));
+                }
+                if (options_.withScores)
+                    out.maxScores.push_back(child->isWord ? scoreOf(termIdOf(child)) : 0);
+            }
+        }
+        out.lbs.push_back(false);
+        out.isLeaf.push_back(false);
+    }
+
+    Shard buildShard(const Node *top) const
+    {
+        Shard shard;
+        std::vector<const Node *> current{top};
+        std::vector<const Node *> next;
+        while (!current.empty())
+        {
+            Level &level = shard.levels.emplace_back();
+            next.clear();
+            for (const Node *node : current)
+            {
+                const size_t before = level.labels.size();
+                emitChildren(node, level, &next);
+                if (options_.withScores)
+                    level.childCount.push_back(static_cast<uint32_t>(level.labels.size() - before));
+            }
+            current.swap(next);
+        }
+
+        if (options_.withScores)
+        {
+            // 深いほうから親へ最大値を伝える。深さ L のエントリ e は深さ L + 1 の e 番目のノード
+            for (size_t l = shard.levels.size() - 1; l-- > 0;)
+            {
+                Level &parent = shard.levels[l];
+                const Level &child = shard.levels[l + 1];
+                size_t cursor = 0;
+                for (size_t e = 0; e < parent.maxScores.size(); ++e)
+                {
+                    const size_t n = child.childCount[e];
+                    for (size_t k = 0; k < n; ++k)
+                        parent.maxScores[e] = std::max(parent.maxScores[e], child.maxScores[cursor + k]);
+                    cursor += n;
+                }
+            }
+            shard.rootMaxScore = top->isWord ? scoreOf(termIdOf(top)) : 0;
+            for (uint32_t s : shard.levels[0].maxScores)
+                shard.rootMaxScore = std::max(shard.rootMaxScore, s);
+        }
+        return shard;
+    }
+
+    void runWorkers(const std::vector<const Node *> &shards, std::vector<Shard> &built, size_t threads) const
+    {
+        // 孫の数が多い順に配る（大きな部分木を後回しにすると最後に 1 本だけ走り続ける）
+        std::vector<size_t> order(shards.size());
+        std::vector<size_t> weight(shards.size(), 0);
+        for (size_t s = 0; s < shards.size(); ++s)
+        {
+            for (const auto &[label, child] : shards[s]->children())
+                weight[s] += 1 + child->children().size();
+        }
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                         { return weight[a] > weight[b]; });
+
+        std::atomic<size_t> nextShard{0};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        auto work = [&]
+        {
+            try
+            {
+                for (size_t i = nextShard.fetch_add(1); i < order.size(); i = nextShard.fetch_add(1))
+                    built[order[i]] = buildShard(shards[order[i]]);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+                nextShard.store(order.size());
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t)
+            workers.emplace_back(work);
+        work();
+        for (std::thread &w : workers)
+            w.join();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    Result stitch(const Node *root, std::vector<Shard> &built) const
+    {
+        Result r;
+
+        // 出力の大きさを先に数えて確保する
+        size_t depth = 0;
+        size_t labelCount = 2;
+        size_t termCount = 0;
+        for (const Shard &shard : built)
+        {
+            depth = std::max(depth, shard.levels.size());
+            labelCount += 1;
+            for (const Level &level : shard.levels)
+            {
+                labelCount += level.labels.size();
+                termCount += level.termIds.size();
+            }
+        }
+
+        BitVectorBuilder lbs;
+        BitVectorBuilder isLeaf;
+        lbs.reserve(labelCount * 2);
+        isLeaf.reserve(labelCount * 2);
+        r.labels.reserve(labelCount);
+        if (options_.withTermIds)
+            r.termIdsSave.reserve(termCount + built.size());
+
+        // LOUDS のコンストラクタと同じ初期状態 + 根のブロック
+        lbs.push_back(true);
+        lbs.push_back(false);
+        isLeaf.appendRun(false, 2);
+        r.labels = {static_cast<CharT>(' '), static_cast<CharT>(' ')};
+        Level top;
+        emitChildren(root, top, nullptr);
+        lbs.append(top.lbs);
+        isLeaf.append(top.isLeaf);
+        r.labels.insert(r.labels.end(), top.labels.begin(), top.labels.end());
+        r.termIdsSave.insert(r.termIdsSave.end(), top.termIds.begin(), top.termIds.end());
+        if (options_.withScores)
+        {
+            r.termScores.reserve(termCount + top.termScores.size());
+            r.termScores.insert(r.termScores.end(), top.termScores.begin(), top.termScores.end());
+            r.maxScores.reserve(labelCount);
+            r.maxScores = {0, 0};
+            for (const Shard &shard : built)
+            {
+                r.maxScores.push_back(shard.rootMaxScore);
+                r.maxScores[1] = std::max(r.maxScores[1], shard.rootMaxScore);
+            }
+        }
+
+        for (size_t d = 0; d < depth; ++d)
+        {
+            for (Shard &shard : built)
+            {
+                if (d >= shard.levels.size())
+                    continue;
+                Level &level = shard.levels[d];
+                lbs.append(level.lbs);
+                isLeaf.append(level.isLeaf);
+                r.labels.insert(r.labels.end(), level.labels.begin(), level.labels.end());
+                r.termIdsSave.insert(r.termIdsSave.end(), level.termIds.begin(), level.termIds.end());
+                if (options_.withScores)
+                {
+                    r.termScores.insert(r.termScores.end(), level.termScores.begin(), level.termScores.end());
+                    r.maxScores.insert(r.maxScores.end(), level.maxScores.begin(), level.maxScores.end());
+                }
+                // 連結した断片はすぐ手放す（ピークを抑える）
+                level = Level{};
+            }
+        }
+
+        r.LBS = lbs.build();
+        r.isLeaf = isLeaf.build();
+        return r;
+    }
+};
@@ -0,0 +1,542 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+#include <atomic>
+#include <limits>
+#include <ostream>
+
+#include "common/bit_vector.hpp"
+#include "common/bit_ops.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
+
+// 昇順に並んだキーから、ポインタの木を作らずに LOUDS を組み立てるビルダー
+//
+// - 昇順の入力では、同じ深さのノードは辞書順 = BFS 順に現れる。深さ d のノードごとに
+//   「子のエントリ（label, isWord, termId）… 終端」を深さ d のバッファへ追記し、最後に深さ順に連結すると
+//   Converter の BFS と同じ LBS / isLeaf / labels / termIds になる
+// - 保持するのは直前のキーと深さごとのバッファだけ。バッファが spillRecords を超えたら一時ファイルへ書き出す
+// - writeLoudsFile / writeLoudsWithTermIdFile（.bin とそのディレクトリ）と writeLoudsImageFile / writeLoudsWithTermIdImageFile（.img）は
+//   一時ファイルから直接書くので、辞書全体をメモリに載せない。rank/select ディレクトリも 1 ブロックずつ求めて書く
+//   （代わりにセクションごとに一時ファイルを読み直す）
+// - termId は PrefixTreeWithTermId と同じく add ごとに 1 から振る（重複キーや空キーも番号を消費する）
+template <class CharT>
+class SortedLoudsBuilder
+{
+public:
+    // 入力の並び順
+    // - CodeUnit: code unit の昇順（char32_t では code point 順と同じ）
+    // - CodePoint: code point の昇順（UTF-8 のバイト順）。char16_t ではサロゲートが U+E000..U+FFFF より後ろに来る
+    enum class KeyOrder
+    {
+        CodeUnit,
+        CodePoint,
+    };
+
+    struct Options
+    {
+        KeyOrder order = KeyOrder::CodeUnit;
+        // 深さごとのメモリ上のレコード数の上限（超えたら一時ファイルへ）
+        size_t spillRecords = size_t{1} << 16;
+        // 一時ファイルの置き場所（空なら std::filesystem::temp_directory_path()）
+        std::string tempDir;
+    };
+
+    // finish() の結果（LOUDS / LOUDSWithTermId の各フィールドにそのまま入れる）
+    struct Result
+    {
+        BitVector LBS;
+        BitVector isLeaf;
+        std::vector<CharT> labels;
+        std::vector<int32_t> termIdsSave;
+        louds_image::SiblingOrder siblingOrder;
+    };
+
+    SortedLoudsBuilder() : SortedLoudsBuilder(Options{}) {}
+
+    explicit SortedLoudsBuilder(Options options)
+        : options_(std::move(options)),
+          id_(nextBuilderId().fetch_add(1))
+    {
+        if (options_.spillRecords == 0)
+            options_.spillRecords = 1;
+        tempDir_ = options_.tempDir.empty() ? std::filesystem::temp_directory_path()
+                                            : std::filesystem::path(options_.tempDir);
+    }
+
+    SortedLoudsBuilder(const SortedLoudsBuilder &) = delete;
+    SortedLoudsBuilder &operator=(const SortedLoudsBuilder &) = delete;
+
+    ~SortedLoudsBuilder()
+    {
+        for (Level &level : levels_)
+            closeSpill(level, true);
+    }
+
+    // key を追加する。直前のキーより小さいと std::runtime_error。直前と同じキーは termId だけ消費する
+    void add(std::basic_string_view<CharT> key)
+    {
+        if (finished_)
+            throw std::runtime_error("SortedLoudsBuilder: add after finish");
+        const int32_t termId = nextTermId_++;
+
+        size_t lcp = 0;
+        const size_t common = std::min(prev_.size(), key.size());
+        while (lcp < common && prev_[lcp] == key[lcp])
+            ++lcp;
+        if (lcp < common ? orderKey(key[lcp]) < orderKey(prev_[lcp]) : key.size() < prev_.size())
+            throw std::runtime_error("SortedLoudsBuilder: keys must be added in sorted order");
+        if (lcp == key.size() && lcp == prev_.size())
+            return;
+
+        // 直前のキーのうち共通接頭辞より深いノードを閉じる
+        for (size_t d = prev_.size(); d > lcp; --d)
+            push(d, Record{0, CharT{}, kEnd});
+
+        // 新しいノード（深さ i + 1）を親の深さ i に追記する
+        for (size_t i = lcp; i < key.size(); ++i)
+        {
+            const bool isWord = (i + 1 == key.size());
+            push(i, Record{isWord ? termId : -1, key[i], static_cast<uint8_t>(isWord ? kWord : 0)});
+        }
+        prev_.assign(key.begin(), key.end());
+    }
+
+    // 残りのノードを閉じてメモリ上に組み立てる
+    Result finish()
+    {
+        close();
+        Result r;
+        r.siblingOrder = siblingOrder();
+        BitVectorBuilder lbs;
+        BitVectorBuilder isLeaf;
+        lbs.reserve(2 + entries_ + ends_);
+        isLeaf.reserve(2 + entries_ + ends_);
+        lbs.push_back(true);
+        lbs.push_back(false);
+        isLeaf.appendRun(false, 2);
+        r.labels = {static_cast<CharT>(' '), static_cast<CharT>(' ')};
+        r.labels.reserve(2 + entries_);
+        r.termIdsSave.reserve(words_);
+        forEachRecord([&](const Record &rec)
+                      {
+                          const bool entry = (rec.flags & kEnd) == 0;
+                          lbs.push_back(entry);
+                          isLeaf.push_back((rec.flags & kWord) != 0);
+                          if (entry)
+                              r.labels.push_back(rec.label);
+                          if (rec.flags & kWord)
+                              r.termIdsSave.push_back(rec.termId); });
+        r.LBS = lbs.build();
+        r.isLeaf = isLeaf.build();
+        return r;
+    }
+
+    // LOUDS / LOUDSUtf16::saveToFile(path, withDirectory) と同じ形式（+ SiblingOrder の末尾セクション）で書く
+    void writeLoudsFile(const std::string &path, bool withDirectory = false) { writeFile(path, false, withDirectory); }
+
+    // LOUDSWithTermId / LOUDSWithTermIdUtf16::saveToFile(path, withDirectory) と同じ形式で書く
+    void writeLoudsWithTermIdFile(const std::string &path, bool withDirectory = false) { writeFile(path, true, withDirectory); }
+
+    // LOUDS / LOUDSUtf16::saveToImageFile と同じイメージを書く
+    void writeLoudsImageFile(const std::string &path) { writeImage(path, false); }
+
+    // LOUDSWithTermId / LOUDSWithTermIdUtf16::saveToImageFile と同じイメージを書く
+    void writeLoudsWithTermIdImageFile(const std::string &path) { writeImage(path, true); }
+
+    // 残りのノードを閉じる（以後 add できない。write* / finish も呼ぶので、明示しなくてよい）
+    void close()
+    {
+        if (finished_)
+            return;
+        for (size_t d = prev_.size() + 1; d-- > 0;)
+            push(d, Record{0, CharT{}, kEnd});
+        for (Level &level : levels_)
+        {
+            if (level.spill)
+                level.spill->flush();
+        }
+        finished_ = true;
+    }
+
+    // 出力に記録する兄弟の並び順
+    louds_image::SiblingOrder siblingOrder() const
+    {
+        if (sizeof(CharT) == 2 && options_.order == KeyOrder::CodePoint)
+            return louds_image::SiblingOrder::CodePointAscending;
+        return louds_image::SiblingOrder::CodeUnitAscending;
+    }
+
+    // 追加したキーの数（重複を含む）
+    size_t keyCount() const { return static_cast<size_t>(nextTermId_ - 1); }
+
+private:
+    static constexpr uint8_t kWord = 1;
+    static constexpr uint8_t kEnd = 2;
+
+    struct Record
+    {
+        int32_t termId;
+        CharT label;
+        uint8_t flags;
+    };
+    static_assert(std::is_trivially_copyable_v<Record>);
+
+    struct Level
+    {
+        std::vector<Record> buffer;
+        std::filesystem::path spillPath;
+        std::unique_ptr<std::ofstream> spill;
+        size_t spilled{0};
+    };
+
+    Options options_;
+    uint64_t id_;
+    std::filesystem::path tempDir_;
+    std::vector<Level> levels_;
+    std::basic_string<CharT> prev_;
+    int32_t nextTermId_{1};
+    size_t entries_{0};
+    size_t ends_{0};
+    size_t words_{0};
+    bool finished_{false};
+
+    static std::atomic<uint64_t> &nextBuilderId()
+    {
+        static std::atomic<uint64_t> id{0};
+        return id;
+    }
+
+    uint32_t orderKey(CharT c) const
+    {
+        const uint32_t u = static_cast<uint32_t>(c);
+        if (sizeof(CharT) != 2 || options_.order != KeyOrder::CodePoint || u < 0xD800)
+            return u;
+        // サロゲートを U+E000..U+FFFF の後ろへ
+        return (u >= 0xE000) ? u - 0x800 : u + 0x2000;
+    }
+
+    void push(size_t depth, const Record &rec)
+    {
+        if (depth >= levels_.size())
+            levels_.resize(depth + 1);
+        Level &level = levels_[depth];
+        level.buffer.push_back(rec);
+        if (rec.flags & kEnd)
+            ++ends_;
+        else
+            ++entries_;
+        if (rec.flags & kWord)
+            ++words_;
+        if (level.buffer.size() >= options_.spillRecords)
+            spill(depth);
+    }
+
+    void spill(size_t depth)
+    {
+        Level &level = levels_[depth];
+        if (!level.spill)
+        {
+            level.spillPath = tempDir_ / ("louds_sorted_" + std::to_string(id_) + "_" + std::to_string(depth) + ".tmp");
+            level.spill = std::make_unique<std::ofstream>(level.spillPath, std::ios::binary | std::ios::trunc);
+            if (!*level.spill)
+                throw std::runtime_error("SortedLoudsBuilder: failed to open spill file: " + level.spillPath.string());
+        }
+        level.spill->write(reinterpret_cast<const char *>(level.buffer.data()),
+                           static_cast<std::streamsize>(level.buffer.size() * sizeof(Record)));
+        if (!*level.spill)
+            throw std::runtime_error("SortedLoudsBuilder: failed to write spill file: " + level.spillPath.string());
+        level.spilled += level.buffer.size();
+        level.buffer.clear();
+    }
+
+    void closeSpill(Level &level, bool remove)
+    {
+        if (level.spill)
+        {
+            level.spill->close();
+            level.spill.reset();
+        }
+        if (remove && !level.spillPath.empty())
+        {
+            std::error_code ec;
+            std::filesystem::remove(level.spillPath, ec);
+            level.spillPath.clear();
+        }
+    }
+
+    // 深さ順・追記順にレコードを渡す（一時ファイル → メモリ上の残り）
+    template <class Fn>
+    void forEachRecord(Fn &&fn) const
+    {
+        std::vector<Record> chunk;
+        for (const Level &level : levels_)
+        {
+            if (level.spilled > 0)
+            {
+                std::ifstream in(level.spillPath, std::ios::binary);
+                if (!in)
+                    throw std::runtime_error("SortedLoudsBuilder: failed to read spill file: " + level.spillPath.string());
+                chunk.resize(options_.spillRecords);
+                size_t left = level.spilled;
+                while (left > 0)
+                {
+                    const size_t n = std::min(left, chunk.size());
+                    in.read(reinterpret_cast<char *>(chunk.data()), static_cast<std::streamsize>(n * sizeof(Record)));
+                    if (!in)
+                        throw std::runtime_error("SortedLoudsBuilder: truncated spill file: " + level.spillPath.string());
+                    for (size_t i = 0; i < n; ++i)
+                        fn(chunk[i]);
+                    left -= n;
+                }
+            }
+            for (const Record &rec : level.buffer)
+                fn(rec);
+        }
+    }
+
+    // SuccinctBitVector と同じ rank9 / select サンプルの定数
+    static constexpr size_t kWordsPerBlock = 8;
+    static constexpr uint64_t kBlockBits = kWordsPerBlock * 64;
+    static constexpr uint64_t kSelectSampleRate = 512;
+
+    uint64_t bitCount() const { return 2 + static_cast<uint64_t>(entries_ + ends_); }
+
+    // LBS（lbs）/ isLeaf の 1 の数（LBS は仮想ルートの 1 を含む）
+    uint64_t onesCount(bool lbs) const { return lbs ? 1 + static_cast<uint64_t>(entries_) : static_cast<uint64_t>(words_); }
+
+    static uint64_t blocksFor(uint64_t nbits) { return ((nbits + 63) / 64 + kWordsPerBlock - 1) / kWordsPerBlock; }
+
+    static uint64_t samplesFor(uint64_t total) { return total == 0 ? 0 : (total - 1) / kSelectSampleRate + 1; }
+
+    // LBS（lbs）/ isLeaf の word を先頭から渡す（BitVector の words と同じ並び。先頭 2 bit は仮想ルート）
+    template <class Fn>
+    void forEachWord(bool lbs, Fn &&fn) const
+    {
+        uint64_t word = 0;
+        unsigned bits = 0;
+        auto push = [&](bool b)
+        {
+            if (b)
+                word |= 1ULL << bits;
+            if (++bits == 64)
+            {
+                fn(word);
+                word = 0;
+                bits = 0;
+            }
+        };
+        push(lbs);
+        push(false);
+        forEachRecord([&](const Record &rec)
+                      { push(lbs ? (rec.flags & kEnd) == 0 : (rec.flags & kWord) != 0); });
+        if (bits > 0)
+            fn(word);
+    }
+
+    // SuccinctBitVector::build と同じ rank9 ディレクトリを 1 ブロックずつ渡す: fn(block, onesBefore, sub, onesInBlock)
+    template <class Fn>
+    void forEachBlock(bool lbs, Fn &&fn) const
+    {
+        uint64_t words[kWordsPerBlock];
+        size_t k = 0;
+        size_t block = 0;
+        uint64_t before = 0;
+        auto flush = [&]
+        {
+            uint64_t sub = 0;
+            uint64_t local = 0;
+            for (size_t i = 0; i < kWordsPerBlock; ++i)
+            {
+                if (i > 0)
+                    sub |= local << (9 * (i - 1));
+                if (i < k)
+                    local += static_cast<uint64_t>(bit_ops::popcount64(words[i]));
+            }
+            fn(block, before, sub, local);
+            before += local;
+            ++block;
+            k = 0;
+        };
+        forEachWord(lbs, [&](uint64_t w)
+                    {
+                        words[k++] = w;
+                        if (k == kWordsPerBlock)
+                            flush(); });
+        if (k > 0)
+            flush();
+    }
+
+    void writeWords(std::ostream &os, bool lbs) const
+    {
+        forEachWord(lbs, [&](uint64_t w)
+                    { writePod(os, w); });
+    }
+
+    void writeRankDirectory(std::ostream &os, bool lbs) const
+    {
+        forEachBlock(lbs, [&](size_t, uint64_t before, uint64_t sub, uint64_t)
+                     {
+                         writePod(os, before);
+                         writePod(os, sub); });
+    }
+
+    // select1（ones）/ select0 のサンプル（SuccinctBitVector::buildSelectSamples と同じ値）
+    void writeSelectSamples(std::ostream &os, bool lbs, bool ones) const
+    {
+        const uint64_t nbits = bitCount();
+        const uint64_t nblocks = blocksFor(nbits);
+        const uint64_t total = ones ? onesCount(lbs) : nbits - onesCount(lbs);
+        uint64_t next = 1;
+        forEachBlock(lbs, [&](size_t b, uint64_t before, uint64_t, uint64_t local)
+                     {
+                         const uint64_t onesEnd = before + local;
+                         const uint64_t end = (b + 1 < nblocks) ? (ones ? onesEnd : (b + 1) * kBlockBits - onesEnd) : total;
+                         while (next <= total && next <= end)
+                         {
+                             writePod(os, static_cast<uint32_t>(b));
+                             next += kSelectSampleRate;
+                         } });
+    }
+
+    void writeLabels(std::ostream &os) const
+    {
+        const CharT dummy = static_cast<CharT>(' ');
+        writePod(os, dummy);
+        writePod(os, dummy);
+        forEachRecord([&](const Record &rec)
+                      {
+                          if ((rec.flags & kEnd) == 0)
+                              writePod(os, rec.label); });
+    }
+
+    void writeTermIds(std::ostream &os) const
+    {
+        forEachRecord([&](const Record &rec)
+                      {
+                          if (rec.flags & kWord)
+                              writePod(os, rec.termId); });
+    }
+
+    void checkBlocks() const
+    {
+        if (blocksFor(bitCount()) > static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()))
+            throw std::runtime_error("SortedLoudsBuilder: too many blocks for select samples");
+    }
+
+    static louds_image::SectionId offsetId(louds_image::SectionId id, uint32_t delta)
+    {
+        return static_cast<louds_image::SectionId>(static_cast<uint32_t>(id) + delta);
+    }
+
+    // saveToFile(path, true) の末尾に付くディレクトリ（rank / select1 / select0）を、書くときに求めるセクションとして足す
+    void addDirectory(louds_trailer::Writer &trailer, louds_image::SectionId wordsId, bool lbs) const
+    {
+        const uint64_t nbits = bitCount();
+        const uint64_t ones = onesCount(lbs);
+        trailer.addStream(offsetId(wordsId, 1), sizeof(uint64_t), blocksFor(nbits) * 2 * sizeof(uint64_t),
+                          [this, lbs](std::ostream &os)
+                          { writeRankDirectory(os, lbs); });
+        trailer.addStream(offsetId(wordsId, 2), sizeof(uint32_t), samplesFor(ones) * sizeof(uint32_t),
+                          [this, lbs](std::ostream &os)
+                          { writeSelectSamples(os, lbs, true); });
+        trailer.addStream(offsetId(wordsId, 3), sizeof(uint32_t), samplesFor(nbits - ones) * sizeof(uint32_t),
+                          [this, lbs](std::ostream &os)
+                          { writeSelectSamples(os, lbs, false); });
+    }
+
+    // louds_image::Writer::addBitVector と同じ 4 セクション
+    void addBitVector(louds_image::Writer &writer, louds_image::SectionId wordsId, bool lbs) const
+    {
+        const uint64_t nbits = bitCount();
+        const uint64_t ones = onesCount(lbs);
+        writer.addStream(wordsId, sizeof(uint64_t), static_cast<size_t>((nbits + 63) / 64), nbits,
+                         [this, lbs](std::ostream &os)
+                         { writeWords(os, lbs); });
+        writer.addStream(offsetId(wordsId, 1), sizeof(uint64_t), static_cast<size_t>(blocksFor(nbits) * 2), 0,
+                         [this, lbs](std::ostream &os)
+                         { writeRankDirectory(os, lbs); });
+        writer.addStream(offsetId(wordsId, 2), sizeof(uint32_t), static_cast<size_t>(samplesFor(ones)), 0,
+                         [this, lbs](std::ostream &os)
+                         { writeSelectSamples(os, lbs, true); });
+        writer.addStream(offsetId(wordsId, 3), sizeof(uint32_t), static_cast<size_t>(samplesFor(nbits - ones)), 0,
+                         [this, lbs](std::ostream &os)
+                         { writeSelectSamples(os, lbs, false); });
+    }
+
+    template <class T>
+    static void writePod(std::ostream &os, const T &v)
+    {
+        os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+
+    void writeFile(const std::string &path, bool withTermIds, bool withDirectory)
+    {
+        close();
+        if (withDirectory)
+            checkBlocks();
+        std::ofstream ofs(path, std::ios::binary);
+        if (!ofs)
+            throw std::runtime_error("failed to open file for write: " + path);
+
+        const uint64_t nbits = bitCount();
+        const uint64_t nwords = (nbits + 63) / 64;
+
+        // 1) LBS / 2) isLeaf
+        for (const bool lbs : {true, false})
+        {
+            writePod(ofs, nbits);
+            writePod(ofs, nwords);
+            writeWords(ofs, lbs);
+        }
+
+        // 3) labels
+        writePod(ofs, static_cast<uint64_t>(2 + entries_));
+        writeLabels(ofs);
+
+        // 4) termIds
+        if (withTermIds)
+        {
+            writePod(ofs, static_cast<uint64_t>(words_));
+            writeTermIds(ofs);
+        }
+
+        louds_trailer::Writer trailer;
+        if (withDirectory)
+        {
+            addDirectory(trailer, louds_image::SectionId::LbsWords, true);
+            addDirectory(trailer, louds_image::SectionId::LeafWords, false);
+        }
+        trailer.addSiblingOrder(siblingOrder());
+        trailer.writeTo(ofs);
+        if (!ofs)
+            throw std::runtime_error("failed to write LOUDS file: " + path);
+    }
+
+    void writeImage(const std::string &path, bool withTermIds)
+    {
+        close();
+        checkBlocks();
+        louds_image::Writer writer(withTermIds ? louds_image::Kind::LoudsWithTermId : louds_image::Kind::Louds, sizeof(CharT));
+        addBitVector(writer, louds_image::SectionId::LbsWords, true);
+        addBitVector(writer, louds_image::SectionId::LeafWords, false);
+        writer.addStream(louds_image::SectionId::Labels, sizeof(CharT), 2 + entries_, 0,
+                         [this](std::ostream &os)
+                         { writeLabels(os); });
+        writer.addSiblingOrder(siblingOrder());
+        if (withTermIds)
+            writer.addStream(louds_image::SectionId::TermIds, sizeof(int32_t), words_, 0,
+                             [this](std::ostream &os)
+                             { writeTermIds(os); });
+        writer.writeTo(path);
+    }
+};
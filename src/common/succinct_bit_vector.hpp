@@ -1,35 +1,154 @@
 #pragma once
 #include <cstdint>
+#include <cstddef>
 #include <vector>
+#include <span>
+#include <utility>
 #include <algorithm>
 #include <stdexcept>
+#include <limits>
 
+#include "common/louds_types.hpp"
 #include "common/bit_vector.hpp"
-
-// Kotlin の SuccinctBitVector 相当。
-// - big block: 256 bits
-// - small block: 8 bits
-// - rank1/rank0: O(1) + 最大8bitの走査
-// - select1/select0: 大ブロック二分探索 + 小ブロック線形 + 最大8bit走査
-class SuccinctBitVector
+#include "common/bit_ops.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
+
+// rank9 方式の SuccinctBitVector。
+// - 512 bit (= 64bit word x 8) を 1 ブロックとし、ブロックごとに 2 word を持つ
+//   - rankDir_[2*b]     : ブロック b の先頭までの累積 1 の数（絶対値）
+//   - rankDir_[2*b + 1] : ブロック内 word 1..7 の先頭までの相対 1 の数（9bit x 7 を pack）
+// - ディレクトリは元のビット列の 25%
+// - rank1/rank0: ディレクトリ 2 word の参照 + masked popcount 1 回（ループなし）
+// - select1/select0: selectSampleRate_ 個ごとの 1 / 0 が属するブロック番号をヒントとして持ち、
+//   ヒント間のブロックだけを探索 + 相対カウントで word 特定 + word 内 select（broadword / PDEP）
+// - popcount / word 内 select / ディレクトリ構築は bit_ops のカーネル（実行時に CPU を見て選ぶ）を使う
+// - Pos は位置の型（int32_t / int64_t）。ディレクトリは幅によらず同じで、API の型と上限だけが変わる
+// - ビット列は参照のみ（所有しない）。ディレクトリは自前で構築するか、前計算済みのもの（mmap 上 / ファイル末尾から読んだもの）を使う
+// - ディレクトリを span で参照するためコピー不可（move は可）
+template <class Pos>
+class BasicSuccinctBitVector
 {
 public:
-    explicit SuccinctBitVector(const BitVector &bv)
-        : bv_(bv),
-          n_(static_cast<int>(bv.size())),
-          bigBlockRanks_(),
-          smallBlockRanks_(),
+    explicit BasicSuccinctBitVector(BitVectorView bits)
+        : bits_(bits),
+          n_(checkedSize(bits.size())),
           totalOnes_(0)
     {
         build();
     }
 
-    int size() const { return n_; }
+    explicit BasicSuccinctBitVector(const BitVector &bv)
+        : BasicSuccinctBitVector(BitVectorView(bv)) {}
+
+    // 前計算済みのディレクトリ（rankDirectory / select1Samples / select0Samples の出力）を参照する。
+    // メモリは呼び出し側が保持する。
+    BasicSuccinctBitVector(BitVectorView bits,
+                           std::span<const uint64_t> rankDir,
+                           std::span<const uint32_t> select1Samples,
+                           std::span<const uint32_t> select0Samples)
+        : bits_(bits),
+          n_(checkedSize(bits.size())),
+          rankDir_(rankDir),
+          select1Samples_(select1Samples),
+          select0Samples_(select0Samples),
+          totalOnes_(0)
+    {
+        adoptDirectory();
+    }
+
+    // 前計算済みのディレクトリを所有して使う（旧形式ファイルの末尾セクションから読んだ場合など）
+    BasicSuccinctBitVector(BitVectorView bits,
+                           std::vector<uint64_t> rankDir,
+                           std::vector<uint32_t> select1Samples,
+                           std::vector<uint32_t> select0Samples)
+        : bits_(bits),
+          n_(checkedSize(bits.size())),
+          totalOnes_(0),
+          rankDirStorage_(std::move(rankDir)),
+          select1Storage_(std::move(select1Samples)),
+          select0Storage_(std::move(select0Samples))
+    {
+        rankDir_ = rankDirStorage_;
+        select1Samples_ = select1Storage_;
+        select0Samples_ = select0Storage_;
+        adoptDirectory();
+    }
+
+    BasicSuccinctBitVector(const BasicSuccinctBitVector &) = delete;
+    BasicSuccinctBitVector &operator=(const BasicSuccinctBitVector &) = delete;
+    BasicSuccinctBitVector(BasicSuccinctBitVector &&) noexcept = default;
+    BasicSuccinctBitVector &operator=(BasicSuccinctBitVector &&) noexcept = default;
+
+    Pos size() const { return n_; }
+
+    Pos totalOnes() const { return totalOnes_; }
+
+    bool get(Pos index) const
+    {
+        if (index < 0)
+            return false;
+        return bits_.get(static_cast<size_t>(index));
+    }
+
+    BitVectorView bits() const { return bits_; }
+
+    // 永続化用にディレクトリをそのまま公開する
+    std::span<const uint64_t> rankDirectory() const { return rankDir_; }
+    std::span<const uint32_t> select1Samples() const { return select1Samples_; }
+    std::span<const uint32_t> select0Samples() const { return select0Samples_; }
 
-    int totalOnes() const { return totalOnes_; }
+    // ディレクトリの分だけ（ビット列は参照するだけなので含めない）。外部のディレクトリを参照しているときもその大きさを数える
+    MemoryUsage memoryUsage() const
+    {
+        MemoryUsage u;
+        u.rankDirectory = rankDir_.size_bytes();
+        u.selectSamples = select1Samples_.size_bytes() + select0Samples_.size_bytes();
+        u.overhead = sizeof(*this) + MemoryUsage::slack(rankDirStorage_) +
+                     MemoryUsage::slack(select1Storage_) + MemoryUsage::slack(select0Storage_);
+        return u;
+    }
+
+    // 前計算済みディレクトリの rank ディレクトリと select サンプルを全部検査する（O(n/512)。壊れていれば例外）
+    // 開くときは大きさしか見ないので、信用できないファイルを読んだときに明示的に呼ぶ
+    // （検査しなくても select は範囲外を読まないが、結果は正しくない）
+    void validate() const
+    {
+        const size_t nblocks = numBlocks();
+        for (size_t b = 0; b < nblocks; ++b)
+        {
+            // 累積値は単調でブロックあたり 512 以下、相対値は word ごとに 64 以下ずつ増える
+            const uint64_t before = rankDir_[2 * b];
+            const uint64_t end = (b + 1 < nblocks) ? rankDir_[2 * (b + 1)] : static_cast<uint64_t>(totalOnes_);
+            if ((b == 0 && before != 0) || end < before || end - before > blockBits_)
+                throw std::runtime_error("SuccinctBitVector: corrupted rank directory");
+            uint64_t prev = 0;
+            for (size_t k = 1; k < wordsPerBlock_; ++k)
+            {
+                const uint64_t r = subRank(rankDir_[2 * b + 1], k);
+                if (r < prev || r - prev > 64 || before + r > end)
+                    throw std::runtime_error("SuccinctBitVector: corrupted rank directory");
+                prev = r;
+            }
+            if (end - before - prev > 64)
+                throw std::runtime_error("SuccinctBitVector: corrupted rank directory");
+        }
+        auto check = [nblocks](std::span<const uint32_t> samples)
+        {
+            uint32_t prev = 0;
+            for (uint32_t b : samples)
+            {
+                if (b >= nblocks || b < prev)
+                    throw std::runtime_error("SuccinctBitVector: corrupted select samples");
+                prev = b;
+            }
+        };
+        check(select1Samples_);
+        check(select0Samples_);
+    }
 
     // rank1(index): 0..index (inclusive) の 1 の数
-    int rank1(int index) const
+    Pos rank1(Pos index) const
     {
         if (index < 0)
             return 0;
@@ -38,30 +157,17 @@ public:
         if (index >= n_)
             return totalOnes_;
 
-        const int bigIndex = index / bigBlockSize_;
-        const int offsetInBig = index % bigBlockSize_;
-        const int smallIndex = offsetInBig / smallBlockSize_;
-        const int offsetInSmall = offsetInBig % smallBlockSize_;
-
-        const int globalSmallIndex = bigIndex * numSmallBlocksPerBig_ + smallIndex;
-
-        int rankBase = bigBlockRanks_[static_cast<size_t>(bigIndex)] + smallBlockRanks_[static_cast<size_t>(globalSmallIndex)];
-
-        int additional = 0;
-        const int smallStart = bigIndex * bigBlockSize_ + smallIndex * smallBlockSize_;
-        for (int i = 0; i <= offsetInSmall; ++i)
-        {
-            const int pos = smallStart + i;
-            if (pos >= n_)
-                break;
-            if (bv_.get(static_cast<size_t>(pos)))
-                additional++;
-        }
-        return rankBase + additional;
+        const size_t i = static_cast<size_t>(index);
+        const size_t w = i >> 6;
+        const uint64_t mask = ~0ULL >> (63 - (i & 63));
+        LOUDS_COUNT(rank, 1);
+        LOUDS_TOUCH(rankDir_.data() + 2 * (w / wordsPerBlock_), 2 * sizeof(uint64_t));
+        LOUDS_TOUCH(words() + w);
+        return static_cast<Pos>(rankBeforeWord(w) + static_cast<uint64_t>(popcount64(words()[w] & mask)));
     }
 
     // rank0(index): 0..index (inclusive) の 0 の数
-    int rank0(int index) const
+    Pos rank0(Pos index) const
     {
         if (index < 0)
             return 0;
@@ -73,208 +179,310 @@ public:
     }
 
     // select1(nodeId): nodeId番目(1-indexed)の 1 の位置
-    int select1(int nodeId) const
+    Pos select1(Pos nodeId) const
     {
         if (nodeId < 1 || nodeId > totalOnes_)
             return -1;
         if (n_ <= 0)
             return -1;
 
-        // bigBlockRanks[big] は big ブロック開始時点の累積 ones
-        int lo = 0;
-        int hi = static_cast<int>(bigBlockRanks_.size()) - 1;
-        int bigBlock = 0;
-        while (lo <= hi)
-        {
-            int mid = (lo + hi) / 2;
-            if (bigBlockRanks_[static_cast<size_t>(mid)] < nodeId)
-            {
-                bigBlock = mid;
-                lo = mid + 1;
-            }
-            else
-            {
-                hi = mid - 1;
-            }
-        }
+        const uint64_t target = static_cast<uint64_t>(nodeId);
+        LOUDS_COUNT(select, 1);
+
+        // 先頭までの累積 ones が target 未満である最後のブロック
+        const size_t block = findBlock(select1Samples_, target,
+                                       [this](size_t b)
+                                       {
+                                           LOUDS_TOUCH(rankDir_.data() + 2 * b);
+                                           return rankDir_[2 * b]; });
+        const uint64_t local = target - rankDir_[2 * block];
+        const uint64_t sub = rankDir_[2 * block + 1];
+        LOUDS_TOUCH(rankDir_.data() + 2 * block, 2 * sizeof(uint64_t));
+        if (local == 0 || local > blockBits_)
+            return -1; // 壊れたディレクトリ
+
+        size_t k = 0;
+        while (k < 7 && subRank(sub, k + 1) < local)
+            ++k;
+
+        return selectInWord(block * wordsPerBlock_ + k, local, subRank(sub, k), false);
+    }
 
-        const int localTarget = nodeId - bigBlockRanks_[static_cast<size_t>(bigBlock)];
+    // select0(nodeId): nodeId番目(1-indexed)の 0 の位置
+    Pos select0(Pos nodeId) const
+    {
+        if (n_ <= 0)
+            return -1;
+        const Pos totalZeros = n_ - totalOnes_;
+        if (nodeId < 1 || nodeId > totalZeros)
+            return -1;
 
-        const int baseSmallIndex = bigBlock * numSmallBlocksPerBig_;
-        const int numSmallBlocks = static_cast<int>(smallBlockRanks_.size());
-        const int smallBlocksInThisBig =
-            std::min(numSmallBlocksPerBig_, std::max(0, numSmallBlocks - baseSmallIndex));
+        const uint64_t target = static_cast<uint64_t>(nodeId);
+        LOUDS_COUNT(select, 1);
+
+        // zerosBeforeBlock = blockStartBits - onesBeforeBlock
+        const size_t block = findBlock(select0Samples_, target,
+                                       [this](size_t b)
+                                       {
+                                           LOUDS_TOUCH(rankDir_.data() + 2 * b);
+                                           return zerosBeforeBlock(b); });
+        const uint64_t local = target - zerosBeforeBlock(block);
+        const uint64_t sub = rankDir_[2 * block + 1];
+        LOUDS_TOUCH(rankDir_.data() + 2 * block, 2 * sizeof(uint64_t));
+        if (local == 0 || local > blockBits_)
+            return -1; // 壊れたディレクトリ
+
+        size_t k = 0;
+        while (k < 7 && ((k + 1) * 64 - subRank(sub, k + 1)) < local)
+            ++k;
+
+        // 末尾 word の範囲外ビットは 0 として扱われるが、totalZeros で上限を弾いているので到達しない
+        return selectInWord(block * wordsPerBlock_ + k, local, k * 64 - subRank(sub, k), true);
+    }
 
-        int smallBlock = 0;
-        while (smallBlock < smallBlocksInThisBig - 1)
-        {
-            const int nextIndex = baseSmallIndex + smallBlock + 1;
-            if (smallBlockRanks_[static_cast<size_t>(nextIndex)] < localTarget)
-            {
-                smallBlock++;
-            }
-            else
-            {
-                break;
-            }
-        }
+    // バッチ検索用: rank1(index) が触る word とディレクトリを先読みする（結果は変わらない）
+    void prefetchRank(Pos index) const
+    {
+        if (index < 0 || index >= n_)
+            return;
+        const size_t w = static_cast<size_t>(index) >> 6;
+        __builtin_prefetch(words() + w);
+        __builtin_prefetch(rankDir_.data() + 2 * (w / wordsPerBlock_));
+    }
 
-        const int globalSmallIndex = baseSmallIndex + smallBlock;
-        const int offsetInSmallBlock = localTarget - smallBlockRanks_[static_cast<size_t>(globalSmallIndex)];
+    // バッチ検索用: select0(nodeId) のサンプルが指すブロックのディレクトリと先頭 word を先読みする
+    void prefetchSelect0(Pos nodeId) const
+    {
+        if (n_ <= 0 || nodeId < 1 || nodeId > n_ - totalOnes_)
+            return;
+        const size_t block = std::min<size_t>(select0Samples_[static_cast<size_t>((static_cast<uint64_t>(nodeId) - 1) / selectSampleRate_)],
+                                              numBlocks() - 1);
+        __builtin_prefetch(rankDir_.data() + 2 * block);
+        __builtin_prefetch(words() + block * wordsPerBlock_);
+    }
 
-        const int smallStart = bigBlock * bigBlockSize_ + smallBlock * smallBlockSize_;
-        int count = 0;
-        for (int i = 0; i < smallBlockSize_; ++i)
-        {
-            const int pos = smallStart + i;
-            if (pos >= n_)
-                break;
-            if (bv_.get(static_cast<size_t>(pos)))
-            {
-                ++count;
-                if (count == offsetInSmallBlock)
-                    return pos;
-            }
-        }
-        return -1;
+private:
+    BitVectorView bits_;
+    Pos n_;
+
+    static constexpr size_t wordsPerBlock_ = 8;
+    static constexpr size_t blockBits_ = wordsPerBlock_ * 64;
+
+    // select ヒント: (i * selectSampleRate_ + 1) 番目の 1 / 0 を含むブロック番号
+    static constexpr uint64_t selectSampleRate_ = 512;
+
+    // 2 word / block（絶対値 + pack した相対値）
+    std::span<const uint64_t> rankDir_;
+    std::span<const uint32_t> select1Samples_;
+    std::span<const uint32_t> select0Samples_;
+    Pos totalOnes_;
+
+    // build() したとき / 所有するディレクトリを受け取ったときの実体（外部メモリを参照する場合は空）
+    std::vector<uint64_t> rankDirStorage_;
+    std::vector<uint32_t> select1Storage_;
+    std::vector<uint32_t> select0Storage_;
+
+    const uint64_t *words() const { return bits_.words(); }
+
+    static Pos checkedSize(size_t nbits)
+    {
+        if (nbits > static_cast<size_t>(std::numeric_limits<Pos>::max()))
+            throw std::runtime_error("SuccinctBitVector: bit vector too large for position type "
+                                     "(build with LOUDS_64BIT_POSITIONS=ON)");
+        return static_cast<Pos>(nbits);
     }
 
-    // select0(nodeId): nodeId番目(1-indexed)の 0 の位置
-    int select0(int nodeId) const
+    static size_t blocksFor(size_t nbits)
     {
-        if (n_ <= 0)
-            return -1;
-        const int totalZeros = n_ - totalOnes_;
-        if (nodeId < 1 || nodeId > totalZeros)
+        const size_t nwords = (nbits + 63) / 64;
+        return (nwords + wordsPerBlock_ - 1) / wordsPerBlock_;
+    }
+
+    static size_t samplesFor(uint64_t total)
+    {
+        return total == 0 ? 0 : static_cast<size_t>((total - 1) / selectSampleRate_ + 1);
+    }
+
+    size_t numBlocks() const { return rankDir_.size() / 2; }
+
+    static int popcount64(uint64_t x)
+    {
+        return bit_ops::popcount64(x);
+    }
+
+    // ブロック内 k 番目 (0..7) の word 先頭までの相対 1 の数
+    // k == 0 のときは t + 8 == 7 (mod 2^64) となり、常に 0 の最上位ビットを読む
+    static uint64_t subRank(uint64_t sub, size_t k)
+    {
+        const uint64_t t = static_cast<uint64_t>(k) - 1;
+        return (sub >> (((t + ((t >> 60) & 8)) * 9) & 63)) & 0x1FFULL;
+    }
+
+    uint64_t rankBeforeWord(size_t w) const
+    {
+        const size_t block = w / wordsPerBlock_;
+        return rankDir_[2 * block] + subRank(rankDir_[2 * block + 1], w % wordsPerBlock_);
+    }
+
+    // ブロック内で local 番目の 1（zeros なら 0）を、word w（その前までに before 個）の中から探す。
+    // 正しいディレクトリでは w < numWords かつ 1 <= local - before <= その word の個数になる。
+    // 大きさしか検査していないファイルのディレクトリが壊れていても範囲外を読まないよう、w を末尾の word に丸め、
+    // word 内の順位が合わなければ見つからない扱いにする（select64 は範囲外の順位を渡すと表の外を読む）
+    Pos selectInWord(size_t w, uint64_t local, uint64_t before, bool zeros) const
+    {
+        w = std::min(w, bits_.numWords() - 1);
+        LOUDS_TOUCH(words() + w);
+        const uint64_t x = zeros ? ~words()[w] : words()[w];
+        if (before >= local || local - before > static_cast<uint64_t>(popcount64(x)))
             return -1;
+        const Pos pos = static_cast<Pos>(w * 64) + bit_ops::select64(x, static_cast<int>(local - before));
+        return pos < n_ ? pos : -1;
+    }
 
-        // zerosBeforeBlock = (blockStartBits) - onesBeforeBlock
-        int lo = 0;
-        int hi = static_cast<int>(bigBlockRanks_.size()) - 1;
-        int bigBlock = 0;
+    uint64_t zerosBeforeBlock(size_t block) const
+    {
+        return static_cast<uint64_t>(block * blockBits_) - rankDir_[2 * block];
+    }
 
-        while (lo <= hi)
+    // countBefore(b) < target となる最後のブロックを、サンプルで絞った範囲から探す
+    // countBefore は単調非減少で countBefore(0) == 0
+    template <class CountBefore>
+    size_t findBlock(std::span<const uint32_t> samples, uint64_t target, CountBefore countBefore) const
+    {
+        const size_t j = static_cast<size_t>((target - 1) / selectSampleRate_);
+        LOUDS_TOUCH(samples.data() + j, 2 * sizeof(uint32_t));
+        // 壊れたサンプルでも範囲外を読まないよう末尾ブロックに丸める（正しいサンプルでは何も変わらない）
+        const size_t last = numBlocks() - 1;
+        size_t lo = std::min<size_t>(samples[j], last);
+        size_t hi = (j + 1 < samples.size()) ? std::min<size_t>(samples[j + 1], last) : last;
+        if (hi < lo)
+            hi = lo;
+
+        // ヒント間が広いときだけ二分探索し、近ければ線形に進める
+        while (hi - lo > 8)
         {
-            int mid = (lo + hi) / 2;
-            const int blockStart = mid * bigBlockSize_;
-            const int zerosBefore = blockStart - bigBlockRanks_[static_cast<size_t>(mid)];
-            if (zerosBefore < nodeId)
-            {
-                bigBlock = mid;
-                lo = mid + 1;
-            }
+            const size_t mid = (lo + hi + 1) / 2;
+            if (countBefore(mid) < target)
+                lo = mid;
             else
-            {
                 hi = mid - 1;
-            }
         }
+        while (lo < hi && countBefore(lo + 1) < target)
+            ++lo;
+        return lo;
+    }
 
-        const int zerosBeforeBlock = bigBlock * bigBlockSize_ - bigBlockRanks_[static_cast<size_t>(bigBlock)];
-        const int localTarget = nodeId - zerosBeforeBlock;
-
-        const int baseSmallIndex = bigBlock * numSmallBlocksPerBig_;
-        const int numSmallBlocks = static_cast<int>(smallBlockRanks_.size());
-        const int smallBlocksInThisBig =
-            std::min(numSmallBlocksPerBig_, std::max(0, numSmallBlocks - baseSmallIndex));
+    // 各ブロック境界を走査し、i * selectSampleRate_ + 1 番目の要素を含むブロックを記録する
+    template <class CountBefore>
+    void buildSelectSamples(std::vector<uint32_t> &samples, uint64_t total, CountBefore countBefore)
+    {
+        samples.clear();
+        if (total == 0)
+            return;
+        samples.reserve(static_cast<size_t>((total - 1) / selectSampleRate_ + 1));
 
-        int smallBlock = 0;
-        while (smallBlock < smallBlocksInThisBig - 1)
+        const size_t nblocks = numBlocks();
+        uint64_t next = 1;
+        for (size_t b = 0; b < nblocks && next <= total; ++b)
         {
-            // zeros up to next small block start within this big block:
-            // nextZeros = (bitsBeforeNextSmall) - (onesBeforeNextSmallWithinBig)
-            const int nextSmall = smallBlock + 1;
-            const int nextGlobal = baseSmallIndex + nextSmall;
-            const int onesBeforeNextSmall = smallBlockRanks_[static_cast<size_t>(nextGlobal)];
-            const int bitsBeforeNextSmall = nextSmall * smallBlockSize_;
-            const int nextZeros = bitsBeforeNextSmall - onesBeforeNextSmall;
-
-            if (nextZeros < localTarget)
-            {
-                smallBlock++;
-            }
-            else
+            const uint64_t end = (b + 1 < nblocks) ? countBefore(b + 1) : total;
+            while (next <= total && next <= end)
             {
-                break;
+                samples.push_back(static_cast<uint32_t>(b));
+                next += selectSampleRate_;
             }
         }
+    }
 
-        const int globalSmallIndex = baseSmallIndex + smallBlock;
-        const int onesBeforeSmall = smallBlockRanks_[static_cast<size_t>(globalSmallIndex)];
-        const int bitsBeforeSmall = smallBlock * smallBlockSize_;
-        const int zerosBeforeSmall = bitsBeforeSmall - onesBeforeSmall;
-        const int offsetInSmallBlock = localTarget - zerosBeforeSmall;
-
-        const int smallStart = bigBlock * bigBlockSize_ + smallBlock * smallBlockSize_;
-        int count = 0;
-        for (int i = 0; i < smallBlockSize_; ++i)
+    // 前計算済みディレクトリの大きさを検証し、totalOnes を末尾ブロックから復元する
+    // （開くときに O(1) で済むよう、サンプルの中身は見ない。範囲外のサンプルは findBlock で丸める）
+    void adoptDirectory()
+    {
+        const size_t nblocks = blocksFor(static_cast<size_t>(n_));
+        if (rankDir_.size() != nblocks * 2)
+            throw std::runtime_error("SuccinctBitVector: rank directory size mismatch");
+        if (nblocks == 0)
         {
-            const int pos = smallStart + i;
-            if (pos >= n_)
-                break;
-            if (!bv_.get(static_cast<size_t>(pos)))
-            {
-                ++count;
-                if (count == offsetInSmallBlock)
-                    return pos;
-            }
+            if (!select1Samples_.empty() || !select0Samples_.empty())
+                throw std::runtime_error("SuccinctBitVector: select samples size mismatch");
+            return;
         }
-        return -1;
-    }
 
-private:
-    const BitVector &bv_;
-    int n_;
+        const size_t nwords = bits_.numWords();
+        const size_t lastBlock = nblocks - 1;
+        uint64_t rank = rankDir_[2 * lastBlock];
+        for (size_t w = lastBlock * wordsPerBlock_; w < nwords; ++w)
+            rank += static_cast<uint64_t>(popcount64(maskedWord(w)));
 
-    static constexpr int bigBlockSize_ = 256;
-    static constexpr int smallBlockSize_ = 8;
-    static constexpr int numSmallBlocksPerBig_ = bigBlockSize_ / smallBlockSize_;
+        if (rank > static_cast<uint64_t>(n_))
+            throw std::runtime_error("SuccinctBitVector: corrupted rank directory");
+        if (select1Samples_.size() != samplesFor(rank) ||
+            select0Samples_.size() != samplesFor(static_cast<uint64_t>(n_) - rank))
+            throw std::runtime_error("SuccinctBitVector: select samples size mismatch");
 
-    std::vector<int> bigBlockRanks_;
-    std::vector<int> smallBlockRanks_;
-    int totalOnes_;
+        totalOnes_ = static_cast<Pos>(rank);
+    }
+
+    // 最終 word の範囲外ビットは 0 のはずだが、念のためマスクして数える
+    uint64_t maskedWord(size_t w) const
+    {
+        const size_t nwords = bits_.numWords();
+        const size_t tailBits = bits_.size() & 63;
+        if (w + 1 == nwords && tailBits != 0)
+            return words()[w] & ((1ULL << tailBits) - 1ULL);
+        return words()[w];
+    }
 
     void build()
     {
         if (n_ <= 0)
-        {
-            bigBlockRanks_.clear();
-            smallBlockRanks_.clear();
-            totalOnes_ = 0;
             return;
-        }
-
-        const int numBigBlocks = (n_ + bigBlockSize_ - 1) / bigBlockSize_;
-        bigBlockRanks_.assign(static_cast<size_t>(numBigBlocks), 0);
 
-        const int numSmallBlocks = (n_ + smallBlockSize_ - 1) / smallBlockSize_;
-        smallBlockRanks_.assign(static_cast<size_t>(numSmallBlocks), 0);
-
-        int rank = 0;
-        for (int big = 0; big < numBigBlocks; ++big)
+        const size_t nwords = bits_.numWords();
+        const size_t nblocks = blocksFor(static_cast<size_t>(n_));
+        if (nblocks > static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+            throw std::runtime_error("SuccinctBitVector: too many blocks for select samples");
+        rankDirStorage_.assign(nblocks * 2, 0ULL);
+
+        // 完全なブロックはまとめてカーネルに数えさせる（末尾 word にマスクが要るブロックは下のループで数える）
+        const size_t tailBits = bits_.size() & 63;
+        const size_t fullBlocks = (tailBits != 0 ? nwords - 1 : nwords) / wordsPerBlock_;
+        uint64_t rank = bit_ops::rank9Blocks(words(), fullBlocks, rankDirStorage_.data(), 0);
+        for (size_t b = fullBlocks; b < nblocks; ++b)
         {
-            const int bigStart = big * bigBlockSize_;
-            bigBlockRanks_[static_cast<size_t>(big)] = rank;
+            rankDirStorage_[2 * b] = rank;
 
-            for (int small = 0; small < numSmallBlocksPerBig_; ++small)
+            uint64_t sub = 0;
+            uint64_t local = 0;
+            for (size_t k = 0; k < wordsPerBlock_; ++k)
             {
-                const int globalSmall = big * numSmallBlocksPerBig_ + small;
-                if (globalSmall >= numSmallBlocks)
-                    break;
-
-                smallBlockRanks_[static_cast<size_t>(globalSmall)] = rank - bigBlockRanks_[static_cast<size_t>(big)];
-                const int smallStart = bigStart + small * smallBlockSize_;
-
-                for (int j = 0; j < smallBlockSize_; ++j)
-                {
-                    const int pos = smallStart + j;
-                    if (pos >= n_)
-                        break;
-                    if (bv_.get(static_cast<size_t>(pos)))
-                        rank++;
-                }
+                if (k > 0)
+                    sub |= local << (9 * (k - 1));
+
+                const size_t w = b * wordsPerBlock_ + k;
+                if (w >= nwords)
+                    continue;
+                local += static_cast<uint64_t>(popcount64(maskedWord(w)));
             }
+            rankDirStorage_[2 * b + 1] = sub;
+            rank += local;
         }
 
-        totalOnes_ = rank;
+        if (rank > static_cast<uint64_t>(n_))
+            throw std::runtime_error("SuccinctBitVector: corrupted bit vector");
+        totalOnes_ = static_cast<Pos>(rank);
+        rankDir_ = rankDirStorage_;
+
+        buildSelectSamples(select1Storage_, rank,
+                           [this](size_t b)
+                           { return rankDir_[2 * b]; });
+        buildSelectSamples(select0Storage_, static_cast<uint64_t>(n_) - rank,
+                           [this](size_t b)
+                           { return zerosBeforeBlock(b); });
+        select1Samples_ = select1Storage_;
+        select0Samples_ = select0Storage_;
     }
 };
+
+// ビルド設定（LOUDS_64BIT_POSITIONS）に合わせた既定の幅
+using SuccinctBitVector = BasicSuccinctBitVector<LoudsPos>;
@@ -0,0 +1,160 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <span>
+#include <algorithm>
+
+// PrefixTree 系で共有するアロケータ
+// - NodePool: ノードを固定長のチャンクにまとめて確保する（1 ノード 1 回の new をしない。ポインタは木の寿命の間変わらない）
+// - ChildArrayPool: 子配列（ラベル昇順の {label, node}）を 2 のべき乗のサイズクラスで確保し、
+//   伸ばすときに手放した配列はサイズクラスごとに再利用する
+// - 解放は木ごとまとめて行う（個々のノードは消さない）
+namespace trie_arena
+{
+    template <class CharT, class Node>
+    struct Child
+    {
+        CharT label;
+        Node *node;
+    };
+
+    template <class Node>
+    class NodePool
+    {
+    public:
+        NodePool() = default;
+        NodePool(const NodePool &) = delete;
+        NodePool &operator=(const NodePool &) = delete;
+        NodePool(NodePool &&) noexcept = default;
+        NodePool &operator=(NodePool &&) noexcept = default;
+
+        Node *create()
+        {
+            if (used_ == kChunkNodes)
+            {
+                chunks_.push_back(std::make_unique<Node[]>(kChunkNodes));
+                used_ = 0;
+            }
+            return &chunks_.back()[used_++];
+        }
+
+        size_t size() const { return chunks_.empty() ? 0 : (chunks_.size() - 1) * kChunkNodes + used_; }
+
+        size_t bytes() const { return chunks_.size() * kChunkNodes * sizeof(Node); }
+
+    private:
+        static constexpr size_t kChunkNodes = 8192;
+
+        std::vector<std::unique_ptr<Node[]>> chunks_;
+        size_t used_{kChunkNodes};
+    };
+
+    template <class T>
+    class ChildArrayPool
+    {
+    public:
+        ChildArrayPool() = default;
+        ChildArrayPool(const ChildArrayPool &) = delete;
+        ChildArrayPool &operator=(const ChildArrayPool &) = delete;
+        ChildArrayPool(ChildArrayPool &&) noexcept = default;
+        ChildArrayPool &operator=(ChildArrayPool &&) noexcept = default;
+
+        // 要素数 (1 << sizeClass) の配列
+        T *allocate(uint8_t sizeClass)
+        {
+            std::vector<T *> &freeList = free_[sizeClass];
+            if (!freeList.empty())
+            {
+                T *p = freeList.back();
+                freeList.pop_back();
+                return p;
+            }
+
+            const size_t n = size_t{1} << sizeClass;
+            if (n > kBlockElems)
+            {
+                // ルート付近の大きな配列は専用ブロック
+                blocks_.push_back(std::make_unique<T[]>(n));
+                return blocks_.back().get();
+            }
+            if (used_ + n > kBlockElems)
+            {
+                // 前のブロックの残り（n 未満）は使わない
+                blocks_.push_back(std::make_unique<T[]>(kBlockElems));
+                bump_ = blocks_.back().get();
+                used_ = 0;
+            }
+            T *p = bump_ + used_;
+            used_ += n;
+            return p;
+        }
+
+        void release(T *p, uint8_t sizeClass) { free_[sizeClass].push_back(p); }
+
+    private:
+        static constexpr size_t kBlockElems = size_t{1} << 16;
+
+        std::vector<std::unique_ptr<T[]>> blocks_;
+        T *bump_{nullptr};
+        size_t used_{kBlockElems};
+        std::vector<T *> free_[64];
+    };
+
+    // ラベル昇順の子配列から label の子を探す（無ければ nullptr）
+    template <class CharT, class Node>
+    inline Node *findChild(const Child<CharT, Node> *children, uint32_t count, CharT label)
+    {
+        const Child<CharT, Node> *end = children + count;
+        const Child<CharT, Node> *it = std::lower_bound(children, end, label,
+                                                        [](const Child<CharT, Node> &a, CharT c)
+                                                        { return a.label < c; });
+        return (it != end && it->label == label) ? it->node : nullptr;
+    }
+
+    // parent の子配列に label の子を探し、無ければ nodes から確保して昇順を保ったまま挿入する。
+    // Node は childArray / childCount / childClass と c を持つこと。inserted は新規に作ったとき true
+    template <class CharT, class Node>
+    inline Node *findOrInsertChild(Node &parent, CharT label,
+                                   NodePool<Node> &nodes,
+                                   ChildArrayPool<Child<CharT, Node>> &arrays,
+                                   bool &inserted)
+    {
+        using C = Child<CharT, Node>;
+        C *begin = parent.childArray;
+        C *end = begin + parent.childCount;
+        C *it = std::lower_bound(begin, end, label,
+                                 [](const C &a, CharT c)
+                                 { return a.label < c; });
+        if (it != end && it->label == label)
+        {
+            inserted = false;
+            return it->node;
+        }
+
+        const size_t at = static_cast<size_t>(it - begin);
+        if (begin == nullptr || parent.childCount == (uint32_t{1} << parent.childClass))
+        {
+            const uint8_t cls = (begin == nullptr) ? 0 : static_cast<uint8_t>(parent.childClass + 1);
+            C *grown = arrays.allocate(cls);
+            std::copy(begin, begin + at, grown);
+            std::copy(begin + at, end, grown + at + 1);
+            if (begin != nullptr)
+                arrays.release(begin, parent.childClass);
+            parent.childArray = grown;
+            parent.childClass = cls;
+        }
+        else
+        {
+            std::copy_backward(begin + at, end, end + 1);
+        }
+
+        Node *child = nodes.create();
+        child->c = label;
+        parent.childArray[at] = C{label, child};
+        ++parent.childCount;
+        inserted = true;
+        return child;
+    }
+}
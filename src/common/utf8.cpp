@@ -0,0 +1,574 @@
+#include "common/utf8.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF8_HAVE_SSE2 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define UTF8_HAVE_AVX2 1
+#define UTF8_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace utf8
+{
+    namespace
+    {
+        // -----------------------------
+        // スカラー: 1 文字ぶん検証して書く（SIMD カーネルの境界処理もこれ）
+        // -----------------------------
+        template <class Out>
+        inline bool decodeOne(const uint8_t *p, size_t n, size_t &i, Out *out, size_t &o)
+        {
+            const uint8_t c = p[i];
+            if (c < 0x80)
+            {
+                out[o++] = static_cast<Out>(c);
+                i += 1;
+                return true;
+            }
+
+            size_t len = 0;
+            char32_t cp = 0;
+            if ((c & 0xE0) == 0xC0)
+            {
+                len = 2;
+                cp = c & 0x1F;
+            }
+            else if ((c & 0xF0) == 0xE0)
+            {
+                len = 3;
+                cp = c & 0x0F;
+            }
+            else if ((c & 0xF8) == 0xF0)
+            {
+                len = 4;
+                cp = c & 0x07;
+            }
+            else
+            {
+                return false;
+            }
+
+            if (i + len > n)
+                return false;
+            for (size_t k = 1; k < len; ++k)
+            {
+                const uint8_t cc = p[i + k];
+                if ((cc & 0xC0) != 0x80)
+                    return false;
+                cp = (cp << 6) | (cc & 0x3F);
+            }
+
+            // overlong / サロゲート / 範囲外
+            if ((len == 2 && cp < 0x80) || (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000))
+                return false;
+            if (cp >= 0xD800 && cp <= 0xDFFF)
+                return false;
+            if (cp > 0x10FFFF)
+                return false;
+
+            if constexpr (sizeof(Out) == 2)
+            {
+                if (cp >= 0x10000)
+                {
+                    const char32_t v = cp - 0x10000;
+                    out[o++] = static_cast<Out>(0xD800 + (v >> 10));
+                    out[o++] = static_cast<Out>(0xDC00 + (v & 0x3FF));
+                }
+                else
+                {
+                    out[o++] = static_cast<Out>(cp);
+                }
+            }
+            else
+            {
+                out[o++] = static_cast<Out>(cp);
+            }
+            i += len;
+            return true;
+        }
+
+        template <class Out>
+        bool decodeScalar(const uint8_t *p, size_t n, Out *out, size_t &o)
+        {
+            size_t i = 0;
+            o = 0;
+            while (i < n)
+            {
+                if (!decodeOne(p, n, i, out, o))
+                    return false;
+            }
+            return true;
+        }
+
+#if defined(UTF8_HAVE_SSE2)
+        // -----------------------------
+        // SSE2: 16 byte 窓
+        // 出力は入力のバイト数ぶん確保してあり、常に o <= i なので、窓いっぱいに書いても溢れない
+        // -----------------------------
+
+        // 8 個の u16 を Out として書く
+        template <class Out>
+        inline void storeWide8(__m128i v16, Out *out)
+        {
+            if constexpr (sizeof(Out) == 2)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v16);
+            }
+            else
+            {
+                const __m128i zero = _mm_setzero_si128();
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(v16, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), _mm_unpackhi_epi16(v16, zero));
+            }
+        }
+
+        // 16 byte を 16 文字に広げて書く（ASCII の部分だけ進めるので、後ろにゴミが残ってもよい）
+        template <class Out>
+        inline void storeAscii16(__m128i v, Out *out)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            storeWide8(_mm_unpacklo_epi8(v, zero), out);
+            storeWide8(_mm_unpackhi_epi8(v, zero), out + 8);
+        }
+
+        // 先頭から続く 2 byte 列（110xxxxx 10xxxxxx）の文字数（0..8）と、その code point を返す
+        inline size_t twoByte8(__m128i v, __m128i &cp)
+        {
+            // little endian なので 16 bit lane = 先頭 byte | 継続 byte << 8
+            const __m128i shape = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xC0E0)));
+            cp = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x1F)), 6),
+                              _mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0x3F)));
+            // C0 / C1 は overlong
+            const __m128i ok = _mm_andnot_si128(_mm_cmplt_epi16(cp, _mm_set1_epi16(0x80)),
+                                                _mm_cmpeq_epi16(shape, _mm_set1_epi16(static_cast<short>(0x80C0))));
+            const unsigned bad = ~static_cast<unsigned>(_mm_movemask_epi8(ok)) & 0xFFFF;
+            return (bad == 0) ? 8 : static_cast<size_t>(__builtin_ctz(bad)) / 2;
+        }
+
+        // 16 byte 窓で進められれば true（i / o を進める）
+        template <class Out>
+        inline bool stepSse2(const uint8_t *p, size_t n, size_t &i, Out *out, size_t &o)
+        {
+            // 先頭 byte で経路を決めてから読む（混在した短い列で無駄な load をしない）
+            const uint8_t lead = p[i];
+            if (i + 16 > n || (lead >= 0x80 && (lead & 0xE0) != 0xC0))
+                return false;
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            if (lead < 0x80)
+            {
+                // 先頭から非 ASCII の手前まで
+                const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(v));
+                const size_t k = (mask == 0) ? 16 : static_cast<size_t>(__builtin_ctz(mask));
+                storeAscii16(v, out + o);
+                i += k;
+                o += k;
+                return true;
+            }
+            __m128i cp;
+            const size_t k = twoByte8(v, cp);
+            if (k == 0)
+                return false;
+            storeWide8(cp, out + o);
+            i += 2 * k;
+            o += k;
+            return true;
+        }
+
+        template <class Out>
+        bool decodeSse2(const uint8_t *p, size_t n, Out *out, size_t &o)
+        {
+            size_t i = 0;
+            o = 0;
+            while (i < n)
+            {
+                if (stepSse2(p, n, i, out, o))
+                    continue;
+                // 3 / 4 byte 列はこのカーネルでは SIMD にしないので、続く間はスカラーで回す
+                do
+                {
+                    if (!decodeOne(p, n, i, out, o))
+                        return false;
+                } while (i < n && p[i] >= 0xE0);
+            }
+            return true;
+        }
+#endif
+
+#if defined(UTF8_HAVE_AVX2)
+        // -----------------------------
+        // AVX2: 32 byte 窓（+ 3 byte 列は SSSE3 の shuffle で 12 byte / 24 byte ずつ）
+        // -----------------------------
+
+        // 各 32 bit lane に {b2, b1, b0, 0} を集める shuffle（12 byte = 4 文字ぶん）
+        UTF8_TARGET_AVX2 inline __m128i threeByteShuffle()
+        {
+            return _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        }
+
+        // 各 32 bit lane の {b2, b1, b0} から code point を組み立てる
+        UTF8_TARGET_AVX2 inline __m256i threeByteCodePoints(__m256i x)
+        {
+            return _mm256_or_si256(
+                _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(x, 4), _mm256_set1_epi32(0xF000)),
+                                _mm256_and_si256(_mm256_srli_epi32(x, 2), _mm256_set1_epi32(0x0FC0))),
+                _mm256_and_si256(x, _mm256_set1_epi32(0x3F)));
+        }
+
+        UTF8_TARGET_AVX2 inline __m128i threeByteCodePoints(__m128i x)
+        {
+            return _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(x, 4), _mm_set1_epi32(0xF000)),
+                             _mm_and_si128(_mm_srli_epi32(x, 2), _mm_set1_epi32(0x0FC0))),
+                _mm_and_si128(x, _mm_set1_epi32(0x3F)));
+        }
+
+        // 継続 byte / 先頭 byte（1110xxxx）の位置が 12 byte ぶん 3 byte 列の並びになっているか
+        constexpr unsigned kThreeByteCont = 0x0DB6; // byte 1,2,4,5,7,8,10,11
+        constexpr unsigned kThreeByteLead = 0x0249; // byte 0,3,6,9
+
+        // 24 byte（12 byte x 2 lane）がすべて 3 byte 列なら 8 文字の code point（u32 x 8）を返す
+        UTF8_TARGET_AVX2 inline bool threeByte8(const uint8_t *p, __m256i &cp)
+        {
+            const __m256i v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)), 1);
+            const unsigned cont = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8(static_cast<char>(0xC0))), _mm256_set1_epi8(static_cast<char>(0x80)))));
+            const unsigned lead = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8(static_cast<char>(0xF0))), _mm256_set1_epi8(static_cast<char>(0xE0)))));
+            if ((cont & 0x0FFF0FFFu) != (kThreeByteCont | (kThreeByteCont << 16)) ||
+                (lead & 0x0FFF0FFFu) != (kThreeByteLead | (kThreeByteLead << 16)))
+                return false;
+
+            const __m128i s = threeByteShuffle();
+            cp = threeByteCodePoints(_mm256_shuffle_epi8(v, _mm256_inserti128_si256(_mm256_castsi128_si256(s), s, 1)));
+            // overlong（< U+0800）とサロゲート
+            const __m256i bad = _mm256_or_si256(
+                _mm256_cmpgt_epi32(_mm256_set1_epi32(0x800), cp),
+                _mm256_cmpeq_epi32(_mm256_and_si256(cp, _mm256_set1_epi32(0xF800)), _mm256_set1_epi32(0xD800)));
+            return _mm256_testz_si256(bad, bad) != 0;
+        }
+
+        // 先頭から続く 3 byte 列の文字数（0..4。16 byte 読む）と、その code point（u32 x 4）を返す
+        UTF8_TARGET_AVX2 inline size_t threeByte4(const uint8_t *p, __m128i &cp)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const unsigned cont = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(static_cast<char>(0xC0))), _mm_set1_epi8(static_cast<char>(0x80)))));
+            const unsigned lead = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(static_cast<char>(0xF0))), _mm_set1_epi8(static_cast<char>(0xE0)))));
+            // 並びが崩れた最初の byte より前で終わる文字だけ使う
+            const unsigned shapeBad = ((cont ^ kThreeByteCont) | (lead ^ kThreeByteLead)) & 0x0FFFu;
+            const size_t shapeOk = (shapeBad == 0) ? 4 : static_cast<size_t>(__builtin_ctz(shapeBad)) / 3;
+            if (shapeOk == 0)
+                return 0;
+
+            cp = threeByteCodePoints(_mm_shuffle_epi8(v, threeByteShuffle()));
+            const __m128i bad = _mm_or_si128(
+                _mm_cmplt_epi32(cp, _mm_set1_epi32(0x800)),
+                _mm_cmpeq_epi32(_mm_and_si128(cp, _mm_set1_epi32(0xF800)), _mm_set1_epi32(0xD800)));
+            const unsigned badMask = static_cast<unsigned>(_mm_movemask_epi8(bad));
+            const size_t valueOk = (badMask == 0) ? 4 : static_cast<size_t>(__builtin_ctz(badMask)) / 4;
+            return std::min(shapeOk, valueOk);
+        }
+
+        template <class Out>
+        UTF8_TARGET_AVX2 inline void storeCodePoints8(__m256i cp, Out *out)
+        {
+            if constexpr (sizeof(Out) == 2)
+            {
+                // lane 内で 32 → 16 bit に詰め、各 lane の下位 64 bit を並べる
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(cp, cp), 0x08);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(packed));
+            }
+            else
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), cp);
+            }
+        }
+
+        template <class Out>
+        UTF8_TARGET_AVX2 inline void storeCodePoints4(__m128i cp, Out *out)
+        {
+            if constexpr (sizeof(Out) == 2)
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi32(cp, cp));
+            else
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), cp);
+        }
+
+        // 16 個の u16 を Out として書く
+        template <class Out>
+        UTF8_TARGET_AVX2 inline void storeWide16(__m256i v16, Out *out)
+        {
+            if constexpr (sizeof(Out) == 2)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), v16);
+            }
+            else
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v16)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v16, 1)));
+            }
+        }
+
+        // 32 byte がすべて 2 byte 列なら 16 文字の code point を返す
+        UTF8_TARGET_AVX2 inline bool twoByte16(__m256i v, __m256i &cp)
+        {
+            const __m256i shape = _mm256_and_si256(v, _mm256_set1_epi16(static_cast<short>(0xC0E0)));
+            if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(shape, _mm256_set1_epi16(static_cast<short>(0x80C0))))) != 0xFFFFFFFFu)
+                return false;
+            cp = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x1F)), 6),
+                                 _mm256_and_si256(_mm256_srli_epi16(v, 8), _mm256_set1_epi16(0x3F)));
+            return _mm256_movemask_epi8(_mm256_cmpgt_epi16(_mm256_set1_epi16(0x80), cp)) == 0;
+        }
+
+        template <class Out>
+        UTF8_TARGET_AVX2 bool decodeAvx2(const uint8_t *p, size_t n, Out *out, size_t &o)
+        {
+            size_t i = 0;
+            o = 0;
+            while (i < n)
+            {
+                const uint8_t lead = p[i];
+                if (lead < 0x80)
+                {
+                    if (i + 32 <= n)
+                    {
+                        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(v));
+                        const size_t k = (mask == 0) ? 32 : static_cast<size_t>(__builtin_ctz(mask));
+                        storeWide16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)), out + o);
+                        if (k > 16)
+                            storeWide16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)), out + o + 16);
+                        i += k;
+                        o += k;
+                        continue;
+                    }
+                }
+                else if ((lead & 0xF0) == 0xE0)
+                {
+                    __m256i cp8;
+                    if (i + 32 <= n && threeByte8(p + i, cp8))
+                    {
+                        storeCodePoints8(cp8, out + o);
+                        i += 24;
+                        o += 8;
+                        continue;
+                    }
+                    __m128i cp4;
+                    const size_t k = (i + 16 <= n) ? threeByte4(p + i, cp4) : 0;
+                    if (k != 0)
+                    {
+                        storeCodePoints4(cp4, out + o);
+                        i += 3 * k;
+                        o += k;
+                        continue;
+                    }
+                }
+                else if ((lead & 0xE0) == 0xC0 && i + 32 <= n)
+                {
+                    __m256i cp;
+                    if (twoByte16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)), cp))
+                    {
+                        storeWide16(cp, out + o);
+                        i += 32;
+                        o += 16;
+                        continue;
+                    }
+                }
+                if (stepSse2(p, n, i, out, o))
+                    continue;
+                if (!decodeOne(p, n, i, out, o))
+                    return false;
+            }
+            return true;
+        }
+#endif
+
+        // -----------------------------
+        // 実行時の選択
+        // -----------------------------
+        bool cpuSupports(Kernel kernel)
+        {
+            switch (kernel)
+            {
+            case Kernel::Scalar:
+                return true;
+            case Kernel::Sse2:
+#if defined(UTF8_HAVE_SSE2)
+                return true;
+#else
+                return false;
+#endif
+            case Kernel::Avx2:
+#if defined(UTF8_HAVE_AVX2) && defined(UTF8_HAVE_SSE2)
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+#else
+                return false;
+#endif
+            }
+            return false;
+        }
+
+        Kernel detectKernel()
+        {
+            if (cpuSupports(Kernel::Avx2))
+                return Kernel::Avx2;
+            if (cpuSupports(Kernel::Sse2))
+                return Kernel::Sse2;
+            return Kernel::Scalar;
+        }
+
+        std::atomic<int> g_kernel{-1};
+
+        template <class Out, class Str>
+        bool decodeInto(std::string_view in, Str &out)
+        {
+            // UTF-16 / UTF-32 の単位数は UTF-8 のバイト数を超えない
+            out.resize(in.size());
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(in.data());
+            size_t o = 0;
+            bool ok = false;
+            switch (activeKernel())
+            {
+#if defined(UTF8_HAVE_AVX2) && defined(UTF8_HAVE_SSE2)
+            case Kernel::Avx2:
+                ok = decodeAvx2<Out>(p, in.size(), out.data(), o);
+                break;
+#endif
+#if defined(UTF8_HAVE_SSE2)
+            case Kernel::Sse2:
+                ok = decodeSse2<Out>(p, in.size(), out.data(), o);
+                break;
+#endif
+            default:
+                ok = decodeScalar<Out>(p, in.size(), out.data(), o);
+                break;
+            }
+            out.resize(o);
+            return ok;
+        }
+
+        void encodeCodePoint(std::string &out, char32_t cp)
+        {
+            if (cp <= 0x7F)
+            {
+                out.push_back(static_cast<char>(cp));
+            }
+            else if (cp <= 0x7FF)
+            {
+                out.push_back(static_cast<char>(0xC0 | ((cp >> 6) & 0x1F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+            else if (cp <= 0xFFFF)
+            {
+                if (cp >= 0xD800 && cp <= 0xDFFF)
+                {
+                    out.push_back('?');
+                    return;
+                }
+                out.push_back(static_cast<char>(0xE0 | ((cp >> 12) & 0x0F)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+            else if (cp <= 0x10FFFF)
+            {
+                out.push_back(static_cast<char>(0xF0 | ((cp >> 18) & 0x07)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+            else
+            {
+                out.push_back('?');
+            }
+        }
+    }
+
+    bool toUtf16(std::string_view in, std::u16string &out)
+    {
+        return decodeInto<char16_t>(in, out);
+    }
+
+    bool toUtf32(std::string_view in, std::u32string &out)
+    {
+        return decodeInto<char32_t>(in, out);
+    }
+
+    std::string fromUtf16(std::u16string_view in)
+    {
+        std::string out;
+        out.reserve(in.size() * 3);
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            const char16_t cu = in[i];
+            if (cu >= 0xD800 && cu <= 0xDBFF)
+            {
+                if (i + 1 >= in.size() || in[i + 1] < 0xDC00 || in[i + 1] > 0xDFFF)
+                {
+                    out.push_back('?');
+                    continue;
+                }
+                const char32_t hi = static_cast<char32_t>(cu - 0xD800);
+                const char32_t lo = static_cast<char32_t>(in[i + 1] - 0xDC00);
+                encodeCodePoint(out, 0x10000 + ((hi << 10) | lo));
+                i += 1;
+                continue;
+            }
+            // 単独の low surrogate は encodeCodePoint が '?' にする
+            encodeCodePoint(out, static_cast<char32_t>(cu));
+        }
+        return out;
+    }
+
+    std::string fromUtf32(std::u32string_view in)
+    {
+        std::string out;
+        out.reserve(in.size() * 3);
+        for (char32_t cp : in)
+            encodeCodePoint(out, cp);
+        return out;
+    }
+
+    Kernel activeKernel()
+    {
+        int k = g_kernel.load(std::memory_order_relaxed);
+        if (k < 0)
+        {
+            k = static_cast<int>(detectKernel());
+            g_kernel.store(k, std::memory_order_relaxed);
+        }
+        return static_cast<Kernel>(k);
+    }
+
+    const char *kernelName(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::Sse2:
+            return "sse2";
+        case Kernel::Avx2:
+            return "avx2";
+        }
+        return "unknown";
+    }
+
+    bool setKernel(Kernel kernel)
+    {
+        if (!cpuSupports(kernel))
+            return false;
+        g_kernel.store(static_cast<int>(kernel), std::memory_order_relaxed);
+        return true;
+    }
+}
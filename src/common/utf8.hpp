@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// UTF-8 と UTF-16 / UTF-32 の相互変換（ツール共通）
+//
+// - toUtf16 / toUtf32: 厳密に検証する。途中で切れた列・overlong・サロゲートの符号化・U+10FFFF 超・
+//   単独の継続バイトがあれば false（out の中身は不定）
+// - fromUtf16 / fromUtf32: 対になっていないサロゲートや範囲外の値は '?' にする
+// - デコードは ASCII の連続・2 byte 列の連続・3 byte 列の連続を SIMD でまとめて処理し、
+//   それ以外（混在する境界・4 byte 列）は 1 文字ずつのスカラー処理に落ちる。
+//   カーネルは初回呼び出し時に CPU を見て選ぶ（AVX2 > SSE2 > スカラー）
+namespace utf8
+{
+    enum class Kernel
+    {
+        Scalar,
+        Sse2,  // ASCII 16 byte / 2 byte 列 8 文字
+        Avx2,  // ASCII 32 byte / 2 byte 列 16 文字 / 3 byte 列 8 文字
+    };
+
+    bool toUtf16(std::string_view in, std::u16string &out);
+    bool toUtf32(std::string_view in, std::u32string &out);
+
+    std::string fromUtf16(std::u16string_view in);
+    std::string fromUtf32(std::u32string_view in);
+
+    // 現在のカーネル
+    Kernel activeKernel();
+    const char *kernelName(Kernel kernel);
+
+    // テスト・ベンチマーク用にカーネルを切り替える。CPU が対応していなければ false（切り替えない）
+    bool setKernel(Kernel kernel);
+}
@@ -1,22 +1,38 @@
 #include "louds/converter.hpp"
+#include "common/sharded_louds_converter.hpp"
 #include <queue>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 LOUDS Converter::convert(const PrefixNode* rootNode) const {
+    return convertImpl(rootNode, nullptr);
+}
+
+LOUDS Converter::convertByFrequency(const PrefixNode* rootNode, const NodeWeights<PrefixNode>& weights) const {
+    return convertImpl(rootNode, &weights);
+}
+
+LOUDS Converter::convertImpl(const PrefixNode* rootNode, const NodeWeights<PrefixNode>* weights) const {
     LOUDS louds;
     std::queue<const PrefixNode*> q;
     q.push(rootNode);
+    std::vector<PrefixNode::Child> ordered;
 
     while (!q.empty()) {
         const PrefixNode* node = q.front();
         q.pop();
 
         if (node && node->hasChild()) {
-            for (const auto& kv : node->children) {
-                const char32_t label = kv.first;
-                const PrefixNode* child = kv.second.get();
-
+            louds.LBSTemp.appendRun(true, node->children().size());
+            // PrefixTree は子をラベル昇順で持つので、weights が無ければそのまま code unit 昇順で出力できる
+            std::span<const PrefixNode::Child> children = node->children();
+            if (weights) {
+                weights->orderChildren(node, ordered);
+                children = ordered;
+            }
+            for (const auto& [label, child] : children) {
                 q.push(child);
-                louds.LBSTemp.push_back(true);
                 louds.labels.push_back(label);
                 louds.isLeafTemp.push_back(child->isWord);
             }
@@ -27,5 +43,22 @@ LOUDS Converter::convert(const PrefixNode* rootNode) const {
     }
 
     louds.convertListToBitVector();
+    louds.siblingOrder = weights ? louds_image::SiblingOrder::FrequencyDescending
+                                 : louds_image::SiblingOrder::CodeUnitAscending;
+    return louds;
+}
+
+LOUDS Converter::convertParallel(const PrefixNode* rootNode, size_t threads) const {
+    ShardedLoudsConverter<PrefixNode, char32_t>::Options options;
+    options.threads = threads;
+    auto r = ShardedLoudsConverter<PrefixNode, char32_t>(options).convert(rootNode);
+
+    LOUDS louds;
+    louds.LBSTemp.clear();
+    louds.isLeafTemp.clear();
+    louds.LBS = std::move(r.LBS);
+    louds.isLeaf = std::move(r.isLeaf);
+    louds.labels = std::move(r.labels);
+    louds.siblingOrder = louds_image::SiblingOrder::CodeUnitAscending;
     return louds;
 }
@@ -1,8 +1,20 @@
 #pragma once
 #include "prefix/prefix_tree.hpp"
 #include "louds/louds.hpp"
+#include "common/frequency_order.hpp"
+#include <cstddef>
 
 class Converter {
 public:
     LOUDS convert(const PrefixNode* rootNode) const;
+
+    // 根の子ごとの部分木を threads 本（0 なら hardware_concurrency）で変換して連結する。結果は convert と同じ
+    LOUDS convertParallel(const PrefixNode* rootNode, size_t threads = 0) const;
+
+    // 各ノードの子を weights の降順（同じ重みはラベル昇順）に並べて出力する（SiblingOrder::FrequencyDescending）。
+    // 辞書の中身は convert と同じで、兄弟の並びだけが変わる
+    LOUDS convertByFrequency(const PrefixNode* rootNode, const NodeWeights<PrefixNode>& weights) const;
+
+private:
+    LOUDS convertImpl(const PrefixNode* rootNode, const NodeWeights<PrefixNode>* weights) const;
 };
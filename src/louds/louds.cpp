@@ -1,37 +1,39 @@
 #include "louds.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
 #include <stdexcept>
 
 LOUDS::LOUDS() {
-    LBSTemp = {true, false};
+    LBSTemp.push_back(true);
+    LBSTemp.push_back(false);
     labels  = {U' ', U' '};
-    isLeafTemp = {false, false};
+    isLeafTemp.appendRun(false, 2);
 }
 
 void LOUDS::convertListToBitVector() {
-    BitVector lbs;
-    for (bool b : LBSTemp) lbs.push_back(b);
-    LBS = std::move(lbs);
-    LBSTemp.clear();
-
-    BitVector leaf;
-    for (bool b : isLeafTemp) leaf.push_back(b);
-    isLeaf = std::move(leaf);
-    isLeafTemp.clear();
+    LBS = LBSTemp.build();
+    isLeaf = isLeafTemp.build();
+    // 作り直したビット列に古いディレクトリを使わない（アドレスの一致だけに頼らず明示的に捨てる）
+    lbsIndex_.reset();
+    isLeafIndex_.reset();
 }
 
-int LOUDS::firstChild(int pos) const {
-    const int y = LBS.select0(LBS.rank1(pos)) + 1;
+LoudsPos LOUDS::firstChild(LoudsPos pos) const {
+    const LoudsPos y = lbs().select0(lbs().rank1(pos)) + 1;
     if (y < 0) return -1;
     return (LBS.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDS::traverse(int pos, char32_t c) const {
-    int childPos = firstChild(pos);
+LoudsPos LOUDS::traverse(LoudsPos pos, char32_t c) const {
+    LoudsPos childPos = firstChild(pos);
     if (childPos == -1) return -1;
+    LOUDS_COUNT(levels, 1);
 
     while (LBS.get(static_cast<size_t>(childPos))) {
-        const int labelIndex = LBS.rank1(childPos);
+        const LoudsPos labelIndex = lbs().rank1(childPos);
         if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels.size()) {
+            LOUDS_COUNT(siblings, 1);
+            LOUDS_TOUCH(labels.data() + labelIndex);
             if (labels[static_cast<size_t>(labelIndex)] == c) return childPos;
         }
         childPos += 1;
@@ -43,12 +45,12 @@ std::vector<std::u32string> LOUDS::commonPrefixSearch(const std::u32string& str)
     std::vector<char32_t> resultTemp;
     std::vector<std::u32string> result;
 
-    int n = 0;
+    LoudsPos n = 0;
     for (char32_t c : str) {
         n = traverse(n, c);
         if (n == -1) break;
 
-        const int index = LBS.rank1(n);
+        const LoudsPos index = lbs().rank1(n);
         if (index < 0 || static_cast<size_t>(index) >= labels.size()) return result;
 
         resultTemp.push_back(labels[static_cast<size_t>(index)]);
@@ -72,6 +74,19 @@ bool LOUDS::equals(const LOUDS& other) const {
         && labels == other.labels;
 }
 
+MemoryUsage LOUDS::memoryUsage() const {
+    MemoryUsage u;
+    u += MemoryUsage::embedded(LBSTemp);
+    u += MemoryUsage::embedded(isLeafTemp);
+    u += MemoryUsage::embedded(LBS);
+    u += MemoryUsage::embedded(isLeaf);
+    u += MemoryUsage::embedded(lbsIndex_);
+    u += MemoryUsage::embedded(isLeafIndex_);
+    u.labels = MemoryUsage::used(labels);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(labels);
+    return u;
+}
+
 void LOUDS::write_u64(std::ostream& os, uint64_t v) {
     os.write(reinterpret_cast<const char*>(&v), sizeof(v));
 }
@@ -118,7 +133,7 @@ BitVector LOUDS::readBitVector(std::istream& is) {
     return bv;
 }
 
-void LOUDS::saveToFile(const std::string& path) const {
+void LOUDS::saveToFile(const std::string& path, bool withDirectory) const {
     std::ofstream ofs(path, std::ios::binary);
     if (!ofs) throw std::runtime_error("failed to open file for write: " + path);
 
@@ -129,6 +144,26 @@ void LOUDS::saveToFile(const std::string& path) const {
     for (char32_t ch : labels) {
         write_u32(ofs, static_cast<uint32_t>(ch));
     }
+
+    louds_trailer::Writer trailer;
+    if (withDirectory) {
+        trailer.addDirectory(louds_image::SectionId::LbsWords, lbs());
+        trailer.addDirectory(louds_image::SectionId::LeafWords, leaf());
+    }
+    trailer.addSiblingOrder(siblingOrder);
+    if (!trailer.empty()) trailer.writeTo(ofs);
+}
+
+void LOUDS::saveToImageFile(const std::string& path) const {
+    const SuccinctBitVector &lbsSucc = lbs();
+    const SuccinctBitVector &leafSucc = leaf();
+
+    louds_image::Writer writer(louds_image::Kind::Louds, sizeof(char32_t));
+    writer.addBitVector(louds_image::SectionId::LbsWords, LBS, lbsSucc);
+    writer.addBitVector(louds_image::SectionId::LeafWords, isLeaf, leafSucc);
+    writer.add(louds_image::SectionId::Labels, std::span<const char32_t>(labels));
+    writer.addSiblingOrder(siblingOrder);
+    writer.writeTo(path);
 }
 
 LOUDS LOUDS::loadFromFile(const std::string& path) {
@@ -138,6 +173,9 @@ LOUDS LOUDS::loadFromFile(const std::string& path) {
     LOUDS l;
     l.LBS = readBitVector(ifs);
     l.isLeaf = readBitVector(ifs);
+    // 読み込んだビット列のディレクトリは末尾セクションから採るか、最初の検索で作る
+    l.lbsIndex_.reset();
+    l.isLeafIndex_.reset();
 
     uint64_t labelN = 0;
     read_u64(ifs, labelN);
@@ -147,5 +185,13 @@ LOUDS LOUDS::loadFromFile(const std::string& path) {
         read_u32(ifs, v);
         l.labels[i] = static_cast<char32_t>(v);
     }
+
+    // 任意の末尾セクション（ディレクトリがあれば検索用にそのまま使う）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+    l.siblingOrder = trailer.siblingOrder();
+    if (trailer.has(louds_image::SectionId::LbsRank))
+        l.lbsIndex_.adopt(l.LBS, trailer.takeSuccinct(louds_image::SectionId::LbsWords, l.LBS));
+    if (trailer.has(louds_image::SectionId::LeafRank))
+        l.isLeafIndex_.adopt(l.isLeaf, trailer.takeSuccinct(louds_image::SectionId::LeafWords, l.isLeaf));
     return l;
 }
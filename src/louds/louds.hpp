@@ -5,31 +5,53 @@
 #include <fstream>
 #include <ostream>
 #include <istream>
+#include "common/louds_types.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 #include "common/bit_vector.hpp"
+#include "common/louds_image.hpp"
+#include "common/lazy_succinct_index.hpp"
 
 class LOUDS {
 public:
-    std::vector<bool> LBSTemp;
-    std::vector<bool> isLeafTemp;
+    // Converter 用（BFS で語単位に追記して最後に BitVector 化）
+    BitVectorBuilder LBSTemp;
+    BitVectorBuilder isLeafTemp;
 
     BitVector LBS;
     BitVector isLeaf;
     std::vector<char32_t> labels;
 
+    // 兄弟ラベルの並び順（Converter は CodeUnitAscending で出力する）。保存時に記録され、Reader の探索方法が変わる
+    louds_image::SiblingOrder siblingOrder{louds_image::SiblingOrder::Unordered};
+
     LOUDS();
 
     void convertListToBitVector();
 
     std::vector<std::u32string> commonPrefixSearch(const std::u32string& str) const;
 
-    void saveToFile(const std::string& path) const;
+    // withDirectory: LBS / isLeaf の rank/select ディレクトリを末尾セクションとして追記する（Reader の構築を省ける）
+    void saveToFile(const std::string& path, bool withDirectory = false) const;
+    // mmap 用のイメージ形式（common/louds_image.hpp）で保存する。rank/select ディレクトリも含む
+    void saveToImageFile(const std::string& path) const;
     static LOUDS loadFromFile(const std::string& path);
 
     bool equals(const LOUDS& other) const;
 
+    // 使っているメモリの内訳（変換中の *Temp と、検索で作った rank/select ディレクトリを含む）
+    MemoryUsage memoryUsage() const;
+
 private:
-    int firstChild(int pos) const;
-    int traverse(int pos, char32_t c) const;
+    // 検索用の rank/select ディレクトリ（最初の検索で作る。LBS / isLeaf を置き換えると作り直す）
+    LazySuccinctIndex lbsIndex_;
+    LazySuccinctIndex isLeafIndex_;
+
+    const SuccinctBitVector &lbs() const { return lbsIndex_.get(LBS); }
+    const SuccinctBitVector &leaf() const { return isLeafIndex_.get(isLeaf); }
+
+    LoudsPos firstChild(LoudsPos pos) const;
+    LoudsPos traverse(LoudsPos pos, char32_t c) const;
 
     static void write_u64(std::ostream& os, uint64_t v);
     static void write_u32(std::ostream& os, uint32_t v);
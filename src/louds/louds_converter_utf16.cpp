@@ -1,11 +1,28 @@
 #include "louds/louds_converter_utf16.hpp"
+#include "common/sharded_louds_converter.hpp"
 #include <queue>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 LOUDSUtf16 ConverterUtf16::convert(const PrefixNodeUtf16 *rootNode) const
+{
+    return convertImpl(rootNode, nullptr);
+}
+
+LOUDSUtf16 ConverterUtf16::convertByFrequency(const PrefixNodeUtf16 *rootNode,
+                                              const NodeWeights<PrefixNodeUtf16> &weights) const
+{
+    return convertImpl(rootNode, &weights);
+}
+
+LOUDSUtf16 ConverterUtf16::convertImpl(const PrefixNodeUtf16 *rootNode,
+                                       const NodeWeights<PrefixNodeUtf16> *weights) const
 {
     LOUDSUtf16 louds;
     std::queue<const PrefixNodeUtf16 *> q;
     q.push(rootNode);
+    std::vector<PrefixNodeUtf16::Child> ordered;
 
     while (!q.empty())
     {
@@ -14,13 +31,17 @@ LOUDSUtf16 ConverterUtf16::convert(const PrefixNodeUtf16 *rootNode) const
 
         if (node && node->hasChild())
         {
-            for (const auto &kv : node->children)
+            louds.LBSTemp.appendRun(true, node->children().size());
+            // PrefixTree は子をラベル昇順で持つので、weights が無ければそのまま code unit 昇順で出力できる
+            std::span<const PrefixNodeUtf16::Child> children = node->children();
+            if (weights)
+            {
+                weights->orderChildren(node, ordered);
+                children = ordered;
+            }
+            for (const auto &[label, child] : children)
             {
-                const char16_t label = kv.first;
-                const PrefixNodeUtf16 *child = kv.second.get();
-
                 q.push(child);
-                louds.LBSTemp.push_back(true);
                 louds.labels.push_back(label);
                 louds.isLeafTemp.push_back(child->isWord);
             }
@@ -31,5 +52,23 @@ LOUDSUtf16 ConverterUtf16::convert(const PrefixNodeUtf16 *rootNode) const
     }
 
     louds.convertListToBitVector();
+    louds.siblingOrder = weights ? louds_image::SiblingOrder::FrequencyDescending
+                                 : louds_image::SiblingOrder::CodeUnitAscending;
+    return louds;
+}
+
+LOUDSUtf16 ConverterUtf16::convertParallel(const PrefixNodeUtf16 *rootNode, size_t threads) const
+{
+    ShardedLoudsConverter<PrefixNodeUtf16, char16_t>::Options options;
+    options.threads = threads;
+    auto r = ShardedLoudsConverter<PrefixNodeUtf16, char16_t>(options).convert(rootNode);
+
+    LOUDSUtf16 louds;
+    louds.LBSTemp.clear();
+    louds.isLeafTemp.clear();
+    louds.LBS = std::move(r.LBS);
+    louds.isLeaf = std::move(r.isLeaf);
+    louds.labels = std::move(r.labels);
+    louds.siblingOrder = louds_image::SiblingOrder::CodeUnitAscending;
     return louds;
 }
@@ -1,10 +1,21 @@
 #pragma once
 #include "prefix/prefix_tree_utf16.hpp"
 #include "louds/louds_utf16_writer.hpp"
+#include "common/frequency_order.hpp"
+#include <cstddef>
 
 // UTF-16 版 Converter は char32_t 版 Converter と衝突するため別名。
 class ConverterUtf16
 {
 public:
     LOUDSUtf16 convert(const PrefixNodeUtf16 *rootNode) const;
+
+    // 根の子ごとの部分木を threads 本（0 なら hardware_concurrency）で変換して連結する。結果は convert と同じ
+    LOUDSUtf16 convertParallel(const PrefixNodeUtf16 *rootNode, size_t threads = 0) const;
+
+    // 各ノードの子を weights の降順（同じ重みはラベル昇順）に並べて出力する（SiblingOrder::FrequencyDescending）
+    LOUDSUtf16 convertByFrequency(const PrefixNodeUtf16 *rootNode, const NodeWeights<PrefixNodeUtf16> &weights) const;
+
+private:
+    LOUDSUtf16 convertImpl(const PrefixNodeUtf16 *rootNode, const NodeWeights<PrefixNodeUtf16> *weights) const;
 };
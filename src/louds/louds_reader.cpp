@@ -1,16 +1,35 @@
 #include "louds/louds_reader.hpp"
 
-LOUDSReader::LOUDSReader(const BitVector &lbs,
-                         const BitVector &isLeaf,
+LOUDSReader::LOUDSReader(BitVector lbs,
+                         BitVector isLeaf,
                          std::vector<char32_t> labels)
-    : LBS_(lbs),
-      isLeaf_(isLeaf),
-      labels_(std::move(labels)),
-      lbsSucc_(LBS_) {}
-
-int LOUDSReader::firstChild(int pos) const
+    : LOUDSReader(std::move(lbs), std::move(isLeaf), std::move(labels), louds_trailer::Trailer{}) {}
+
+LOUDSReader::LOUDSReader(BitVector lbs,
+                         BitVector isLeaf,
+                         std::vector<char32_t> labels,
+                         louds_trailer::Trailer &&trailer)
+    : lbsStorage_(std::move(lbs)),
+      isLeafStorage_(std::move(isLeaf)),
+      labelsStorage_(std::move(labels)),
+      LBS_(lbsStorage_),
+      isLeaf_(isLeafStorage_),
+      labels_(labelsStorage_),
+      siblingOrder_(trailer.siblingOrder()),
+      lbsSucc_(trailer.takeSuccinct(louds_image::SectionId::LbsWords, LBS_)) {}
+
+LOUDSReader::LOUDSReader(std::shared_ptr<const MappedFile> image,
+                          const louds_image::View &view)
+    : image_(std::move(image)),
+      LBS_(view.bitVector(louds_image::SectionId::LbsWords)),
+      isLeaf_(view.bitVector(louds_image::SectionId::LeafWords)),
+      labels_(view.section<char32_t>(louds_image::SectionId::Labels)),
+      siblingOrder_(view.siblingOrder()),
+      lbsSucc_(view.succinct(louds_image::SectionId::LbsWords)) {}
+
+LoudsPos LOUDSReader::firstChild(LoudsPos pos) const
 {
-    const int y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
+    const LoudsPos y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
     if (y < 0)
         return -1;
     if (static_cast<size_t>(y) >= LBS_.size())
@@ -18,62 +37,128 @@ int LOUDSReader::firstChild(int pos) const
     return (LBS_.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDSReader::traverse(int pos, char32_t c) const
+LoudsPos LOUDSReader::findChild(LoudsPos firstPos, char32_t c) const
 {
-    int childPos = firstChild(pos);
-    if (childPos == -1)
+    if (firstPos < 0)
+        return -1;
+    LOUDS_COUNT(levels, 1);
+    const size_t count = LBS_.countOnesFrom(static_cast<size_t>(firstPos));
+    if (count == 0)
+        return -1;
+
+    // 兄弟のラベルは labels_ 上で連続するので、先頭の添字だけ rank で求める
+    const LoudsPos first = lbsSucc_.rank1(firstPos);
+    if (first < 0 || static_cast<size_t>(first) + count > labels_.size())
         return -1;
 
-    while (static_cast<size_t>(childPos) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(childPos)))
+    const char32_t *siblings = labels_.data() + first;
+    const size_t k = label_search::findBySiblingOrder(siblingOrder_, siblings, count, c);
+    return (k == count) ? -1 : firstPos + static_cast<LoudsPos>(k);
+}
+
+LoudsPos LOUDSReader::traverse(LoudsPos pos, char32_t c) const
+{
+    return findChild(firstChild(pos), c);
+}
+
+MemoryUsage LOUDSReader::memoryUsage() const
+{
+    MemoryUsage u;
+    u.bits = static_cast<uint64_t>(LBS_.numWords() + isLeaf_.numWords()) * sizeof(uint64_t);
+    u.labels = labels_.size_bytes();
+    u += MemoryUsage::embedded(lbsSucc_);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(lbsStorage_.words()) + MemoryUsage::slack(isLeafStorage_.words()) +
+                  MemoryUsage::slack(labelsStorage_);
+    if (image_)
     {
-        const int labelIndex = lbsSucc_.rank1(childPos);
-        if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels_.size())
-        {
-            if (labels_[static_cast<size_t>(labelIndex)] == c)
-                return childPos;
-        }
-        childPos += 1;
+        u.overhead += sizeof(MappedFile);
+        u.markMapped();
     }
-    return -1;
+    return u;
 }
 
 std::vector<std::u32string> LOUDSReader::commonPrefixSearch(const std::u32string &str) const
 {
-    std::vector<char32_t> resultTemp;
     std::vector<std::u32string> result;
+    commonPrefixSearch(std::u32string_view(str), [&](size_t length, LoudsPos)
+                       { result.emplace_back(str, 0, length); });
+    return result;
+}
+
+size_t LOUDSReader::commonPrefixSearch(std::u32string_view str, std::span<LoudsPrefixMatch> out) const
+{
+    size_t count = 0;
+    if (out.empty())
+        return 0;
+    commonPrefixSearch(str, [&](size_t length, LoudsPos nodeIndex)
+                       {
+                           out[count++] = {length, nodeIndex};
+                           return count < out.size(); });
+    return count;
+}
 
-    int n = 0;
-    for (char32_t c : str)
+LoudsPos LOUDSReader::prefixNode(std::u32string_view prefix) const
+{
+    LoudsPos n = 0;
+    for (const char32_t c : prefix)
     {
         n = traverse(n, c);
-        if (n == -1)
-            break;
+        if (n < 0)
+            return -1;
+    }
+    return n;
+}
 
-        const int index = lbsSucc_.rank1(n);
-        if (index < 0 || static_cast<size_t>(index) >= labels_.size())
-            break;
+LOUDSReader::PredictiveCursor LOUDSReader::predictiveCursor(std::u32string_view prefix) const
+{
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return PredictiveCursor();
+    return PredictiveCursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size());
+}
 
-        resultTemp.push_back(labels_[static_cast<size_t>(index)]);
+std::vector<std::u32string> LOUDSReader::predictiveSearch(const std::u32string &prefix, size_t limit) const
+{
+    std::vector<std::u32string> result;
+    if (limit == 0)
+        return result;
 
-        if (static_cast<size_t>(n) < isLeaf_.size() && isLeaf_.get(static_cast<size_t>(n)))
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return result;
+    LoudsPredictiveCursor cursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size());
+
+    LoudsPrefixMatch m;
+    while (result.size() < limit && cursor.next(m))
+    {
+        // 接頭辞より下のラベルだけを親へ辿りながら後ろから埋める
+        std::u32string key(m.length, char32_t{});
+        std::copy(prefix.begin(), prefix.end(), key.begin());
+        LoudsPos current = m.nodeIndex;
+        for (size_t i = m.length; i > prefix.size(); --i)
         {
-            std::u32string tempStr(resultTemp.begin(), resultTemp.end());
-            if (!result.empty())
-            {
-                result.push_back(result[0] + tempStr);
-            }
-            else
-            {
-                result.push_back(tempStr);
-                resultTemp.clear();
-            }
+            LOUDS_COUNT(parents, 1);
+            key[i - 1] = labels_[static_cast<size_t>(lbsSucc_.rank1(current))];
+            current = lbsSucc_.select1(lbsSucc_.rank0(current));
         }
+        result.push_back(std::move(key));
     }
     return result;
 }
 
-std::u32string LOUDSReader::getLetter(int nodeIndex) const
+void LOUDSReader::getNodeIndexBatch(std::span<const std::u32string_view> queries, std::span<LoudsPos> out) const
+{
+    if (out.size() != queries.size())
+        throw std::runtime_error("getNodeIndexBatch: queries and out must have the same size");
+    std::fill(out.begin(), out.end(), LoudsPos{-1});
+    lockstep(queries, [&](size_t query, size_t length, LoudsPos n)
+             {
+                 if (length == queries[query].size())
+                     out[query] = n;
+                 return true; });
+}
+
+std::u32string LOUDSReader::getLetter(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return U"";
@@ -81,14 +166,15 @@ std::u32string LOUDSReader::getLetter(int nodeIndex) const
         return U"";
 
     std::u32string out;
-    int current = nodeIndex;
+    LoudsPos current = nodeIndex;
 
     while (true)
     {
-        const int nodeId = lbsSucc_.rank1(current);
+        const LoudsPos nodeId = lbsSucc_.rank1(current);
         if (nodeId < 0 || static_cast<size_t>(nodeId) >= labels_.size())
             break;
 
+        LOUDS_TOUCH(labels_.data() + nodeId);
         const char32_t ch = labels_[static_cast<size_t>(nodeId)];
         if (ch != U' ')
             out.push_back(ch);
@@ -96,7 +182,8 @@ std::u32string LOUDSReader::getLetter(int nodeIndex) const
         if (nodeId == 0)
             break;
 
-        const int r0 = lbsSucc_.rank0(current);
+        LOUDS_COUNT(parents, 1);
+        const LoudsPos r0 = lbsSucc_.rank0(current);
         current = lbsSucc_.select1(r0);
         if (current < 0)
             break;
@@ -106,60 +193,45 @@ std::u32string LOUDSReader::getLetter(int nodeIndex) const
     return out;
 }
 
-int LOUDSReader::getNodeIndex(const std::u32string &s) const
+LoudsPos LOUDSReader::getNodeIndex(const std::u32string &s) const
 {
     return search(2, s, 0);
 }
 
-int LOUDSReader::getNodeId(const std::u32string &s) const
+LoudsPos LOUDSReader::getNodeId(const std::u32string &s) const
 {
-    const int idx = getNodeIndex(s);
+    const LoudsPos idx = getNodeIndex(s);
     if (idx < 0)
         return -1;
     return lbsSucc_.rank0(idx);
 }
 
-int LOUDSReader::search(int index, const std::u32string &chars, size_t wordOffset) const
+LoudsPos LOUDSReader::search(LoudsPos index, const std::u32string &chars, size_t wordOffset) const
 {
-    int currentIndex = index;
     if (chars.empty())
         return -1;
-    if (currentIndex < 0)
+    if (index < 0)
         return -1;
+    if (wordOffset >= chars.size())
+        return LBS_.get(static_cast<size_t>(index)) ? index : -1;
 
-    while (static_cast<size_t>(currentIndex) < LBS_.size() && LBS_.get(static_cast<size_t>(currentIndex)))
+    LoudsPos currentIndex = index;
+    for (size_t i = wordOffset; i < chars.size(); ++i)
     {
-        if (wordOffset >= chars.size())
-            return currentIndex;
-
-        int charIndex = lbsSucc_.rank1(currentIndex);
-        if (charIndex < 0 || static_cast<size_t>(charIndex) >= labels_.size())
+        currentIndex = findChild(currentIndex, chars[i]);
+        if (currentIndex < 0)
             return -1;
-
-        const char32_t currentLabel = labels_[static_cast<size_t>(charIndex)];
-        const char32_t currentChar = chars[wordOffset];
-
-        if (currentChar == currentLabel)
-        {
-            if (wordOffset + 1 == chars.size())
-            {
-                return currentIndex;
-            }
-            const int nextIndex = lbsSucc_.select0(charIndex) + 1;
-            if (nextIndex < 0)
-                return -1;
-            return search(nextIndex, chars, wordOffset + 1);
-        }
-
-        currentIndex++;
+        if (i + 1 == chars.size())
+            return currentIndex;
+        currentIndex = lbsSucc_.select0(lbsSucc_.rank1(currentIndex)) + 1;
     }
     return -1;
 }
 
-int LOUDSReader::indexOfLabel(int label) const
+LoudsPos LOUDSReader::indexOfLabel(LoudsPos label) const
 {
     // 互換用: O(n) 版（今回は search が succinct を使うので通常は不要）
-    int count = 0;
+    LoudsPos count = 0;
     for (size_t i = 0; i < LBS_.size(); ++i)
     {
         if (!LBS_.get(i))
@@ -169,7 +241,7 @@ int LOUDSReader::indexOfLabel(int label) const
             {
                 if (i + 1 >= LBS_.size())
                     return -1;
-                return static_cast<int>(i + 1);
+                return static_cast<LoudsPos>(i + 1);
             }
         }
     }
@@ -241,12 +313,22 @@ LOUDSReader LOUDSReader::loadFromFile(const std::string &path)
     std::vector<char32_t> labels;
     labels.resize(static_cast<size_t>(labelN));
 
-    for (size_t i = 0; i < static_cast<size_t>(labelN); ++i)
-    {
-        uint32_t v = 0;
-        read_u32(ifs, v);
-        labels[i] = static_cast<char32_t>(v);
-    }
+    if (labelN > 0)
+        ifs.read(reinterpret_cast<char *>(labels.data()),
+                 static_cast<std::streamsize>(labelN * sizeof(char32_t)));
 
-    return LOUDSReader(lbs, isLeaf, std::move(labels));
+    if (!ifs)
+        throw std::runtime_error("failed to read LOUDS payload from: " + path);
+
+    // 任意の末尾セクション（rank/select ディレクトリ）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+
+    return LOUDSReader(std::move(lbs), std::move(isLeaf), std::move(labels), std::move(trailer));
+}
+
+LOUDSReader LOUDSReader::mapFromImageFile(const std::string &path)
+{
+    auto image = std::make_shared<const MappedFile>(path);
+    const louds_image::View view(*image, louds_image::Kind::Louds, sizeof(char32_t));
+    return LOUDSReader(image, view);
 }
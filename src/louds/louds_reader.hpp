@@ -1,50 +1,225 @@
 #pragma once
 #include <vector>
+#include <span>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <concepts>
+#include <type_traits>
 #include <cstdint>
 #include <fstream>
 #include <stdexcept>
 #include <ostream>
 #include <istream>
 
+#include "common/louds_types.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 #include "common/bit_vector.hpp"
 #include "common/succinct_bit_vector.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
+#include "common/label_search.hpp"
+#include "common/louds_predictive.hpp"
 
 // 読み込み専用 LOUDS
 // - loadFromFile でロード
-// - 内部で SuccinctBitVector を構築し rank/select を高速化
+// - rank/select は SuccinctBitVector。ファイル末尾にディレクトリがあればそれを使い、無ければ構築する
 class LOUDSReader
 {
 public:
-    LOUDSReader(const BitVector &lbs,
-                const BitVector &isLeaf,
+    LOUDSReader(BitVector lbs,
+                BitVector isLeaf,
                 std::vector<char32_t> labels);
 
     std::vector<std::u32string> commonPrefixSearch(const std::u32string &str) const;
 
+    // ヒープ確保しない版: str の接頭辞がキーになるたびに visit(prefixLength, nodeIndex) を呼ぶ。
+    // visit が bool を返す場合は false で打ち切る
+    template <class Visitor>
+        requires std::invocable<Visitor &, size_t, LoudsPos>
+    void commonPrefixSearch(std::u32string_view str, Visitor &&visit) const
+    {
+        LoudsPos n = 0;
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            n = traverse(n, str[i]);
+            if (n < 0)
+                return;
+            if (!isLeaf_.get(static_cast<size_t>(n)))
+                continue;
+            if constexpr (std::is_convertible_v<std::invoke_result_t<Visitor &, size_t, LoudsPos>, bool>)
+            {
+                if (!visit(i + 1, n))
+                    return;
+            }
+            else
+            {
+                visit(i + 1, n);
+            }
+        }
+    }
+
+    // 固定長の出力先に書く版。書いた件数を返す（out が埋まったら打ち切る）
+    size_t commonPrefixSearch(std::u32string_view str, std::span<LoudsPrefixMatch> out) const;
+
+    // predictiveSearch を 1 件ずつ取り出すカーソル（next で長さと nodeIndex を返す）
+    using PredictiveCursor = LoudsPredictiveCursor;
+
+    // prefix で始まるキーを短い順（同じ長さは LOUDS のノード順）に最大 limit 件返す
+    std::vector<std::u32string> predictiveSearch(const std::u32string &prefix, size_t limit) const;
+
+    // prefix に一致するノードが無ければ空のカーソル。カーソルはこの Reader を参照する
+    PredictiveCursor predictiveCursor(std::u32string_view prefix) const;
+
+    // 複数クエリを 1 文字ずつ揃えて進める版（lockstep）。
+    // 各クエリの次の rank ブロック / select0 の対象 / ラベル区間を先読みしてから進めるので、
+    // 大きな辞書でキャッシュミスの待ちをクエリ間で重ねられる。out[i] = getNodeIndex(queries[i])
+    void getNodeIndexBatch(std::span<const std::u32string_view> queries, std::span<LoudsPos> out) const;
+
+    // commonPrefixSearch のバッチ版: queries[i] の接頭辞がキーになるたびに visit(i, prefixLength, nodeIndex) を呼ぶ。
+    // 同じクエリの中では短い順だが、クエリ間の順序は決まっていない。visit が bool を返す場合は false でそのクエリを打ち切る
+    template <class Visitor>
+        requires std::invocable<Visitor &, size_t, size_t, LoudsPos>
+    void commonPrefixSearchBatch(std::span<const std::u32string_view> queries, Visitor &&visit) const
+    {
+        lockstep(queries, [&](size_t query, size_t length, LoudsPos n)
+                 {
+                     if (!isLeaf_.get(static_cast<size_t>(n)))
+                         return true;
+                     if constexpr (std::is_convertible_v<std::invoke_result_t<Visitor &, size_t, size_t, LoudsPos>, bool>)
+                         return static_cast<bool>(visit(query, length, n));
+                     else
+                     {
+                         visit(query, length, n);
+                         return true;
+                     } });
+    }
+
     // Kotlin の getLetter(nodeIndex, succinctBitVector) 相当
-    std::u32string getLetter(int nodeIndex) const;
+    std::u32string getLetter(LoudsPos nodeIndex) const;
 
     // Kotlin の getNodeIndex 相当（SuccinctBitVector版）
-    int getNodeIndex(const std::u32string &s) const;
-    int getNodeId(const std::u32string &s) const;
+    LoudsPos getNodeIndex(const std::u32string &s) const;
+    LoudsPos getNodeId(const std::u32string &s) const;
+
+    // pos のノード（有効な位置であること。根は 0）からラベル c の子へ 1 文字進む（無ければ -1）
+    LoudsPos traverse(LoudsPos pos, char32_t c) const;
+
+    // ファイルに記録された兄弟ラベルの並び順（子の探索方法がこれで決まる）
+    louds_image::SiblingOrder siblingOrder() const { return siblingOrder_; }
+
+    // 使っているメモリの内訳（mapFromImageFile で開いたときは、ビット列・ディレクトリ・ラベル等が mapped に入る）
+    MemoryUsage memoryUsage() const;
 
-    const std::vector<char32_t> &getAllLabels() const { return labels_; }
+    std::span<const char32_t> getAllLabels() const { return labels_; }
 
     static LOUDSReader loadFromFile(const std::string &path);
 
+    // saveToImageFile で書いたイメージを mmap し、コピーもディレクトリ再構築もせずに参照する
+    static LOUDSReader mapFromImageFile(const std::string &path);
+
 private:
-    BitVector LBS_;
-    BitVector isLeaf_;
-    std::vector<char32_t> labels_;
+    // mmap 時はファイルを、それ以外は *Storage_ を参照する
+    std::shared_ptr<const MappedFile> image_;
+    BitVector lbsStorage_;
+    BitVector isLeafStorage_;
+    std::vector<char32_t> labelsStorage_;
+
+    BitVectorView LBS_;
+    BitVectorView isLeaf_;
+    std::span<const char32_t> labels_;
+
+    louds_image::SiblingOrder siblingOrder_{louds_image::SiblingOrder::Unordered};
 
     SuccinctBitVector lbsSucc_;
 
-    int firstChild(int pos) const;
-    int traverse(int pos, char32_t c) const;
+    LOUDSReader(std::shared_ptr<const MappedFile> image, const louds_image::View &view);
+    LOUDSReader(BitVector lbs, BitVector isLeaf, std::vector<char32_t> labels,
+                louds_trailer::Trailer &&trailer);
+
+    LoudsPos firstChild(LoudsPos pos) const;
+    // firstPos から始まる兄弟の中で c のラベルを持つ子の位置（無ければ -1）
+    LoudsPos findChild(LoudsPos firstPos, char32_t c) const;
+    // prefix のノード位置（空ならルートの 0、無ければ -1）
+    LoudsPos prefixNode(std::u32string_view prefix) const;
+
+    LoudsPos search(LoudsPos index, const std::u32string &chars, size_t wordOffset) const;
+
+    // バッチ検索の本体。クエリごとに 1 文字進むたびに step(query, length, nodeIndex) を呼び、
+    // false が返ったクエリはそこで止める。1 段を 3 回の走査に分け、各走査で次の走査が触るメモリを先読みする
+    template <class Step>
+    void lockstep(std::span<const std::u32string_view> queries, Step &&step) const
+    {
+        struct Lane
+        {
+            size_t query;
+            size_t depth;
+            LoudsPos firstPos; // 次の文字を探す兄弟区間の先頭
+            LoudsPos rank;     // 進んだ子の rank1（次の firstPos を select0 で求める）
+            size_t first;      // 兄弟区間の先頭ラベルの添字
+            size_t count;      // 兄弟の数
+        };
+
+        const LoudsPos rootFirst = firstChild(0);
+        if (rootFirst < 0)
+            return;
+        std::vector<Lane> lanes;
+        lanes.reserve(queries.size());
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            if (!queries[i].empty())
+                lanes.push_back({i, 0, rootFirst, 0, 0, 0});
+        }
+        lbsSucc_.prefetchRank(rootFirst);
+
+        while (!lanes.empty())
+        {
+            // 1) 兄弟区間の大きさと先頭ラベルの添字を求め、ラベル区間と isLeaf を先読み
+            size_t live = 0;
+            for (Lane &lane : lanes)
+            {
+                lane.count = LBS_.countOnesFrom(static_cast<size_t>(lane.firstPos));
+                const LoudsPos first = lbsSucc_.rank1(lane.firstPos);
+                lane.first = static_cast<size_t>(first);
+                if (lane.count == 0 || first < 0 || lane.first + lane.count > labels_.size())
+                    continue;
+                __builtin_prefetch(labels_.data() + lane.first);
+                __builtin_prefetch(isLeaf_.words() + (static_cast<size_t>(lane.firstPos) >> 6));
+                lanes[live++] = lane;
+            }
+            lanes.resize(live);
+
+            // 2) ラベルを探して子へ進み、次の select0 の対象を先読み
+            live = 0;
+            for (Lane &lane : lanes)
+            {
+                const std::u32string_view q = queries[lane.query];
+                const char32_t *siblings = labels_.data() + lane.first;
+                const char32_t c = q[lane.depth];
+                LOUDS_COUNT(levels, 1);
+                const size_t k = label_search::findBySiblingOrder(siblingOrder_, siblings, lane.count, c);
+                if (k == lane.count)
+                    continue;
+                const LoudsPos child = lane.firstPos + static_cast<LoudsPos>(k);
+                ++lane.depth;
+                if (!step(lane.query, lane.depth, child) || lane.depth == q.size())
+                    continue;
+                lane.rank = static_cast<LoudsPos>(lane.first + k);
+                lbsSucc_.prefetchSelect0(lane.rank);
+                lanes[live++] = lane;
+            }
+            lanes.resize(live);
 
-    int search(int index, const std::u32string &chars, size_t wordOffset) const;
-    int indexOfLabel(int label) const;
+            // 3) 子の兄弟区間の先頭へ移り、次の rank ブロックを先読み
+            for (Lane &lane : lanes)
+            {
+                lane.firstPos = lbsSucc_.select0(lane.rank) + 1;
+                lbsSucc_.prefetchRank(lane.firstPos);
+            }
+        }
+    }
+    LoudsPos indexOfLabel(LoudsPos label) const;
 
     static void write_u64(std::ostream &os, uint64_t v);
     static void write_u32(std::ostream &os, uint32_t v);
@@ -1,18 +1,35 @@
 #include "louds/louds_utf16_reader.hpp"
 
-LOUDSReaderUtf16::LOUDSReaderUtf16(const BitVector &lbs,
-                                   const BitVector &isLeaf,
+LOUDSReaderUtf16::LOUDSReaderUtf16(BitVector lbs,
+                                   BitVector isLeaf,
                                    std::vector<char16_t> labels)
-    : LBS_(lbs),
-      isLeaf_(isLeaf),
-      labels_(std::move(labels)),
-      lbsSucc_(LBS_)
+    : LOUDSReaderUtf16(std::move(lbs), std::move(isLeaf), std::move(labels), louds_trailer::Trailer{}) {}
+
+LOUDSReaderUtf16::LOUDSReaderUtf16(BitVector lbs,
+                                   BitVector isLeaf,
+                                   std::vector<char16_t> labels,
+                                   louds_trailer::Trailer &&trailer)
+    : lbsStorage_(std::move(lbs)),
+      isLeafStorage_(std::move(isLeaf)),
+      labelsStorage_(std::move(labels)),
+      LBS_(lbsStorage_),
+      isLeaf_(isLeafStorage_),
+      labels_(labelsStorage_),
+      siblingOrder_(trailer.siblingOrder()),
+      lbsSucc_(trailer.takeSuccinct(louds_image::SectionId::LbsWords, LBS_)) {}
+
+LOUDSReaderUtf16::LOUDSReaderUtf16(std::shared_ptr<const MappedFile> image,
+                                    const louds_image::View &view)
+    : image_(std::move(image)),
+      LBS_(view.bitVector(louds_image::SectionId::LbsWords)),
+      isLeaf_(view.bitVector(louds_image::SectionId::LeafWords)),
+      labels_(view.section<char16_t>(louds_image::SectionId::Labels)),
+      siblingOrder_(view.siblingOrder()),
+      lbsSucc_(view.succinct(louds_image::SectionId::LbsWords)) {}
+
+LoudsPos LOUDSReaderUtf16::firstChild(LoudsPos pos) const
 {
-}
-
-int LOUDSReaderUtf16::firstChild(int pos) const
-{
-    const int y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
+    const LoudsPos y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
     if (y < 0)
         return -1;
     if (static_cast<size_t>(y) >= LBS_.size())
@@ -20,62 +37,116 @@ int LOUDSReaderUtf16::firstChild(int pos) const
     return (LBS_.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDSReaderUtf16::traverse(int pos, char16_t c) const
+LoudsPos LOUDSReaderUtf16::findChild(LoudsPos firstPos, char16_t c) const
 {
-    int childPos = firstChild(pos);
-    if (childPos == -1)
+    if (firstPos < 0)
+        return -1;
+    LOUDS_COUNT(levels, 1);
+    const size_t count = LBS_.countOnesFrom(static_cast<size_t>(firstPos));
+    if (count == 0)
         return -1;
 
-    while (static_cast<size_t>(childPos) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(childPos)))
+    // 兄弟のラベルは labels_ 上で連続するので、先頭の添字だけ rank で求める
+    const LoudsPos first = lbsSucc_.rank1(firstPos);
+    if (first < 0 || static_cast<size_t>(first) + count > labels_.size())
+        return -1;
+
+    const char16_t *siblings = labels_.data() + first;
+    const size_t k = label_search::findBySiblingOrder(siblingOrder_, siblings, count, c);
+    return (k == count) ? -1 : firstPos + static_cast<LoudsPos>(k);
+}
+
+LoudsPos LOUDSReaderUtf16::traverse(LoudsPos pos, char16_t c) const
+{
+    return findChild(firstChild(pos), c);
+}
+
+MemoryUsage LOUDSReaderUtf16::memoryUsage() const
+{
+    MemoryUsage u;
+    u.bits = static_cast<uint64_t>(LBS_.numWords() + isLeaf_.numWords()) * sizeof(uint64_t);
+    u.labels = labels_.size_bytes();
+    u += MemoryUsage::embedded(lbsSucc_);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(lbsStorage_.words()) + MemoryUsage::slack(isLeafStorage_.words()) +
+                  MemoryUsage::slack(labelsStorage_);
+    if (image_)
     {
-        const int labelIndex = lbsSucc_.rank1(childPos);
-        if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels_.size())
-        {
-            if (labels_[static_cast<size_t>(labelIndex)] == c)
-                return childPos;
-        }
-        childPos += 1;
+        u.overhead += sizeof(MappedFile);
+        u.markMapped();
     }
-    return -1;
+    return u;
 }
 
 std::vector<std::u16string> LOUDSReaderUtf16::commonPrefixSearch(const std::u16string &str) const
 {
-    std::vector<char16_t> resultTemp;
     std::vector<std::u16string> result;
+    commonPrefixSearch(std::u16string_view(str), [&](size_t length, LoudsPos)
+                       { result.emplace_back(str, 0, length); });
+    return result;
+}
+
+size_t LOUDSReaderUtf16::commonPrefixSearch(std::u16string_view str, std::span<LoudsPrefixMatch> out) const
+{
+    size_t count = 0;
+    if (out.empty())
+        return 0;
+    commonPrefixSearch(str, [&](size_t length, LoudsPos nodeIndex)
+                       {
+                           out[count++] = {length, nodeIndex};
+                           return count < out.size(); });
+    return count;
+}
 
-    int n = 0;
-    for (char16_t c : str)
+LoudsPos LOUDSReaderUtf16::prefixNode(std::u16string_view prefix) const
+{
+    LoudsPos n = 0;
+    for (const char16_t c : prefix)
     {
         n = traverse(n, c);
-        if (n == -1)
-            break;
+        if (n < 0)
+            return -1;
+    }
+    return n;
+}
 
-        const int index = lbsSucc_.rank1(n);
-        if (index < 0 || static_cast<size_t>(index) >= labels_.size())
-            break;
+LOUDSReaderUtf16::PredictiveCursor LOUDSReaderUtf16::predictiveCursor(std::u16string_view prefix) const
+{
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return PredictiveCursor();
+    return PredictiveCursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size());
+}
+
+std::vector<std::u16string> LOUDSReaderUtf16::predictiveSearch(const std::u16string &prefix, size_t limit) const
+{
+    std::vector<std::u16string> result;
+    if (limit == 0)
+        return result;
 
-        resultTemp.push_back(labels_[static_cast<size_t>(index)]);
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return result;
+    LoudsPredictiveCursor cursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size());
 
-        if (static_cast<size_t>(n) < isLeaf_.size() && isLeaf_.get(static_cast<size_t>(n)))
+    LoudsPrefixMatch m;
+    while (result.size() < limit && cursor.next(m))
+    {
+        // 接頭辞より下のラベルだけを親へ辿りながら後ろから埋める
+        std::u16string key(m.length, char16_t{});
+        std::copy(prefix.begin(), prefix.end(), key.begin());
+        LoudsPos current = m.nodeIndex;
+        for (size_t i = m.length; i > prefix.size(); --i)
         {
-            std::u16string tempStr(resultTemp.begin(), resultTemp.end());
-            if (!result.empty())
-            {
-                result.push_back(result[0] + tempStr);
-            }
-            else
-            {
-                result.push_back(tempStr);
-                resultTemp.clear();
-            }
+            LOUDS_COUNT(parents, 1);
+            key[i - 1] = labels_[static_cast<size_t>(lbsSucc_.rank1(current))];
+            current = lbsSucc_.select1(lbsSucc_.rank0(current));
         }
+        result.push_back(std::move(key));
     }
     return result;
 }
 
-std::u16string LOUDSReaderUtf16::getLetter(int nodeIndex) const
+std::u16string LOUDSReaderUtf16::getLetter(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return u"";
@@ -83,14 +154,15 @@ std::u16string LOUDSReaderUtf16::getLetter(int nodeIndex) const
         return u"";
 
     std::u16string out;
-    int current = nodeIndex;
+    LoudsPos current = nodeIndex;
 
     while (true)
     {
-        const int nodeId = lbsSucc_.rank1(current);
+        const LoudsPos nodeId = lbsSucc_.rank1(current);
         if (nodeId < 0 || static_cast<size_t>(nodeId) >= labels_.size())
             break;
 
+        LOUDS_TOUCH(labels_.data() + nodeId);
         const char16_t ch = labels_[static_cast<size_t>(nodeId)];
         if (ch != u' ')
             out.push_back(ch);
@@ -98,7 +170,8 @@ std::u16string LOUDSReaderUtf16::getLetter(int nodeIndex) const
         if (nodeId == 0)
             break;
 
-        const int r0 = lbsSucc_.rank0(current);
+        LOUDS_COUNT(parents, 1);
+        const LoudsPos r0 = lbsSucc_.rank0(current);
         current = lbsSucc_.select1(r0);
         if (current < 0)
             break;
@@ -108,52 +181,37 @@ std::u16string LOUDSReaderUtf16::getLetter(int nodeIndex) const
     return out;
 }
 
-int LOUDSReaderUtf16::getNodeIndex(const std::u16string &s) const
+LoudsPos LOUDSReaderUtf16::getNodeIndex(const std::u16string &s) const
 {
     return search(2, s, 0);
 }
 
-int LOUDSReaderUtf16::getNodeId(const std::u16string &s) const
+LoudsPos LOUDSReaderUtf16::getNodeId(const std::u16string &s) const
 {
-    const int idx = getNodeIndex(s);
+    const LoudsPos idx = getNodeIndex(s);
     if (idx < 0)
         return -1;
     return lbsSucc_.rank0(idx);
 }
 
-int LOUDSReaderUtf16::search(int index, const std::u16string &chars, size_t wordOffset) const
+LoudsPos LOUDSReaderUtf16::search(LoudsPos index, const std::u16string &chars, size_t wordOffset) const
 {
-    int currentIndex = index;
     if (chars.empty())
         return -1;
-    if (currentIndex < 0)
+    if (index < 0)
         return -1;
+    if (wordOffset >= chars.size())
+        return LBS_.get(static_cast<size_t>(index)) ? index : -1;
 
-    while (static_cast<size_t>(currentIndex) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(currentIndex)))
+    LoudsPos currentIndex = index;
+    for (size_t i = wordOffset; i < chars.size(); ++i)
     {
-        if (wordOffset >= chars.size())
-            return currentIndex;
-
-        int charIndex = lbsSucc_.rank1(currentIndex);
-        if (charIndex < 0 || static_cast<size_t>(charIndex) >= labels_.size())
+        currentIndex = findChild(currentIndex, chars[i]);
+        if (currentIndex < 0)
             return -1;
-
-        const char16_t currentLabel = labels_[static_cast<size_t>(charIndex)];
-        const char16_t currentChar = chars[wordOffset];
-
-        if (currentChar == currentLabel)
-        {
-            if (wordOffset + 1 == chars.size())
-                return currentIndex;
-
-            const int nextIndex = lbsSucc_.select0(charIndex) + 1;
-            if (nextIndex < 0)
-                return -1;
-            return search(nextIndex, chars, wordOffset + 1);
-        }
-
-        currentIndex++;
+        if (i + 1 == chars.size())
+            return currentIndex;
+        currentIndex = lbsSucc_.select0(lbsSucc_.rank1(currentIndex)) + 1;
     }
     return -1;
 }
@@ -206,12 +264,22 @@ LOUDSReaderUtf16 LOUDSReaderUtf16::loadFromFile(const std::string &path)
     std::vector<char16_t> labels;
     labels.resize(static_cast<size_t>(labelN));
 
-    for (size_t i = 0; i < static_cast<size_t>(labelN); ++i)
-    {
-        uint16_t v = 0;
-        read_u16(ifs, v);
-        labels[i] = static_cast<char16_t>(v);
-    }
+    if (labelN > 0)
+        ifs.read(reinterpret_cast<char *>(labels.data()),
+                 static_cast<std::streamsize>(labelN * sizeof(char16_t)));
 
-    return LOUDSReaderUtf16(lbs, isLeaf, std::move(labels));
+    if (!ifs)
+        throw std::runtime_error("failed to read LOUDS payload from: " + path);
+
+    // 任意の末尾セクション（rank/select ディレクトリ）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+
+    return LOUDSReaderUtf16(std::move(lbs), std::move(isLeaf), std::move(labels), std::move(trailer));
+}
+
+LOUDSReaderUtf16 LOUDSReaderUtf16::mapFromImageFile(const std::string &path)
+{
+    auto image = std::make_shared<const MappedFile>(path);
+    const louds_image::View view(*image, louds_image::Kind::Louds, sizeof(char16_t));
+    return LOUDSReaderUtf16(image, view);
 }
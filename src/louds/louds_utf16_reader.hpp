@@ -2,47 +2,124 @@
 #include <cstdint>
 #include <cstddef>
 #include <vector>
+#include <span>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <concepts>
+#include <type_traits>
 #include <fstream>
 #include <stdexcept>
 #include <algorithm>
 
+#include "common/louds_types.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 #include "common/bit_vector_utf16.hpp"
 #include "common/succinct_bit_vector_utf16.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
+#include "common/label_search.hpp"
+#include "common/louds_predictive.hpp"
 
 // 読み込み専用 LOUDSReader
 // - loadFromFile でロード
-// - 内部で SuccinctBitVector を構築し rank/select を高速化
+// - rank/select は SuccinctBitVector。ファイル末尾にディレクトリがあればそれを使い、無ければ構築する
 class LOUDSReaderUtf16
 {
 public:
-    LOUDSReaderUtf16(const BitVector &lbs,
-                const BitVector &isLeaf,
+    LOUDSReaderUtf16(BitVector lbs,
+                BitVector isLeaf,
                 std::vector<char16_t> labels);
 
     std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
 
+    // ヒープ確保しない版: str の接頭辞がキーになるたびに visit(prefixLength, nodeIndex) を呼ぶ。
+    // visit が bool を返す場合は false で打ち切る
+    template <class Visitor>
+        requires std::invocable<Visitor &, size_t, LoudsPos>
+    void commonPrefixSearch(std::u16string_view str, Visitor &&visit) const
+    {
+        LoudsPos n = 0;
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            n = traverse(n, str[i]);
+            if (n < 0)
+                return;
+            if (!isLeaf_.get(static_cast<size_t>(n)))
+                continue;
+            if constexpr (std::is_convertible_v<std::invoke_result_t<Visitor &, size_t, LoudsPos>, bool>)
+            {
+                if (!visit(i + 1, n))
+                    return;
+            }
+            else
+            {
+                visit(i + 1, n);
+            }
+        }
+    }
+
+    // 固定長の出力先に書く版。書いた件数を返す（out が埋まったら打ち切る）
+    size_t commonPrefixSearch(std::u16string_view str, std::span<LoudsPrefixMatch> out) const;
+
+    // predictiveSearch を 1 件ずつ取り出すカーソル（next で長さと nodeIndex を返す）
+    using PredictiveCursor = LoudsPredictiveCursor;
+
+    // prefix で始まるキーを短い順（同じ長さは LOUDS のノード順）に最大 limit 件返す
+    std::vector<std::u16string> predictiveSearch(const std::u16string &prefix, size_t limit) const;
+
+    // prefix に一致するノードが無ければ空のカーソル。カーソルはこの Reader を参照する
+    PredictiveCursor predictiveCursor(std::u16string_view prefix) const;
+
     // ルートから nodeIndex までのラベルを復元
-    std::u16string getLetter(int nodeIndex) const;
+    std::u16string getLetter(LoudsPos nodeIndex) const;
+
+    LoudsPos getNodeIndex(const std::u16string &s) const;
+    LoudsPos getNodeId(const std::u16string &s) const;
 
-    int getNodeIndex(const std::u16string &s) const;
-    int getNodeId(const std::u16string &s) const;
+    // pos のノード（有効な位置であること。根は 0）からラベル c の子へ 1 文字進む（無ければ -1）
+    LoudsPos traverse(LoudsPos pos, char16_t c) const;
 
-    const std::vector<char16_t> &getAllLabels() const { return labels_; }
+    // ファイルに記録された兄弟ラベルの並び順（子の探索方法がこれで決まる）
+    louds_image::SiblingOrder siblingOrder() const { return siblingOrder_; }
+
+    // 使っているメモリの内訳（mapFromImageFile で開いたときは、ビット列・ディレクトリ・ラベル等が mapped に入る）
+    MemoryUsage memoryUsage() const;
+
+    std::span<const char16_t> getAllLabels() const { return labels_; }
 
     static LOUDSReaderUtf16 loadFromFile(const std::string &path);
 
+    // saveToImageFile で書いたイメージを mmap し、コピーもディレクトリ再構築もせずに参照する
+    static LOUDSReaderUtf16 mapFromImageFile(const std::string &path);
+
 private:
-    BitVector LBS_;
-    BitVector isLeaf_;
-    std::vector<char16_t> labels_;
+    // mmap 時はファイルを、それ以外は *Storage_ を参照する
+    std::shared_ptr<const MappedFile> image_;
+    BitVector lbsStorage_;
+    BitVector isLeafStorage_;
+    std::vector<char16_t> labelsStorage_;
+
+    BitVectorView LBS_;
+    BitVectorView isLeaf_;
+    std::span<const char16_t> labels_;
+
+    louds_image::SiblingOrder siblingOrder_{louds_image::SiblingOrder::Unordered};
 
     SuccinctBitVector lbsSucc_;
 
-    int firstChild(int pos) const;
-    int traverse(int pos, char16_t c) const;
+    LOUDSReaderUtf16(std::shared_ptr<const MappedFile> image, const louds_image::View &view);
+    LOUDSReaderUtf16(BitVector lbs, BitVector isLeaf, std::vector<char16_t> labels,
+                     louds_trailer::Trailer &&trailer);
+
+    LoudsPos firstChild(LoudsPos pos) const;
+    // firstPos から始まる兄弟の中で c のラベルを持つ子の位置（無ければ -1）
+    LoudsPos findChild(LoudsPos firstPos, char16_t c) const;
+    // prefix のノード位置（空ならルートの 0、無ければ -1）
+    LoudsPos prefixNode(std::u16string_view prefix) const;
 
-    int search(int index, const std::u16string &chars, size_t wordOffset) const;
+    LoudsPos search(LoudsPos index, const std::u16string &chars, size_t wordOffset) const;
 
     static void read_u64(std::istream &is, uint64_t &v);
     static void read_u16(std::istream &is, uint16_t &v);
@@ -1,32 +1,29 @@
 #include "louds/louds_utf16_writer.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
 #include <stdexcept>
 
 LOUDSUtf16::LOUDSUtf16()
 {
     // 既存実装互換のためのダミー要素
-    LBSTemp = {true, false};
+    LBSTemp.push_back(true);
+    LBSTemp.push_back(false);
     labels = {u' ', u' '};
-    isLeafTemp = {false, false};
+    isLeafTemp.appendRun(false, 2);
 }
 
 void LOUDSUtf16::convertListToBitVector()
 {
-    BitVector lbs;
-    for (bool b : LBSTemp)
-        lbs.push_back(b);
-    LBS = std::move(lbs);
-    LBSTemp.clear();
-
-    BitVector leaf;
-    for (bool b : isLeafTemp)
-        leaf.push_back(b);
-    isLeaf = std::move(leaf);
-    isLeafTemp.clear();
+    LBS = LBSTemp.build();
+    isLeaf = isLeafTemp.build();
+    // 作り直したビット列に古いディレクトリを使わない（アドレスの一致だけに頼らず明示的に捨てる）
+    lbsIndex_.reset();
+    isLeafIndex_.reset();
 }
 
-int LOUDSUtf16::firstChild(int pos) const
+LoudsPos LOUDSUtf16::firstChild(LoudsPos pos) const
 {
-    const int y = LBS.select0(LBS.rank1(pos)) + 1;
+    const LoudsPos y = lbs().select0(lbs().rank1(pos)) + 1;
     if (y < 0)
         return -1;
     if (static_cast<size_t>(y) >= LBS.size())
@@ -34,18 +31,21 @@ int LOUDSUtf16::firstChild(int pos) const
     return (LBS.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDSUtf16::traverse(int pos, char16_t c) const
+LoudsPos LOUDSUtf16::traverse(LoudsPos pos, char16_t c) const
 {
-    int childPos = firstChild(pos);
+    LoudsPos childPos = firstChild(pos);
     if (childPos == -1)
         return -1;
+    LOUDS_COUNT(levels, 1);
 
     while (static_cast<size_t>(childPos) < LBS.size() &&
            LBS.get(static_cast<size_t>(childPos)))
     {
-        const int labelIndex = LBS.rank1(childPos);
+        const LoudsPos labelIndex = lbs().rank1(childPos);
         if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels.size())
         {
+            LOUDS_COUNT(siblings, 1);
+            LOUDS_TOUCH(labels.data() + labelIndex);
             if (labels[static_cast<size_t>(labelIndex)] == c)
                 return childPos;
         }
@@ -59,14 +59,14 @@ std::vector<std::u16string> LOUDSUtf16::commonPrefixSearch(const std::u16string
     std::vector<char16_t> resultTemp;
     std::vector<std::u16string> result;
 
-    int n = 0;
+    LoudsPos n = 0;
     for (char16_t c : str)
     {
         n = traverse(n, c);
         if (n == -1)
             break;
 
-        const int index = LBS.rank1(n);
+        const LoudsPos index = lbs().rank1(n);
         if (index < 0 || static_cast<size_t>(index) >= labels.size())
             return result;
 
@@ -96,6 +96,20 @@ bool LOUDSUtf16::equals(const LOUDSUtf16 &other) const
            labels == other.labels;
 }
 
+MemoryUsage LOUDSUtf16::memoryUsage() const
+{
+    MemoryUsage u;
+    u += MemoryUsage::embedded(LBSTemp);
+    u += MemoryUsage::embedded(isLeafTemp);
+    u += MemoryUsage::embedded(LBS);
+    u += MemoryUsage::embedded(isLeaf);
+    u += MemoryUsage::embedded(lbsIndex_);
+    u += MemoryUsage::embedded(isLeafIndex_);
+    u.labels = MemoryUsage::used(labels);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(labels);
+    return u;
+}
+
 void LOUDSUtf16::write_u64(std::ostream &os, uint64_t v)
 {
     os.write(reinterpret_cast<const char *>(&v), sizeof(v));
@@ -155,7 +169,7 @@ BitVector LOUDSUtf16::readBitVector(std::istream &is)
     return bv;
 }
 
-void LOUDSUtf16::saveToFile(const std::string &path) const
+void LOUDSUtf16::saveToFile(const std::string &path, bool withDirectory) const
 {
     std::ofstream ofs(path, std::ios::binary);
     if (!ofs)
@@ -169,6 +183,29 @@ void LOUDSUtf16::saveToFile(const std::string &path) const
     {
         write_u16(ofs, static_cast<uint16_t>(ch));
     }
+
+    louds_trailer::Writer trailer;
+    if (withDirectory)
+    {
+        trailer.addDirectory(louds_image::SectionId::LbsWords, lbs());
+        trailer.addDirectory(louds_image::SectionId::LeafWords, leaf());
+    }
+    trailer.addSiblingOrder(siblingOrder);
+    if (!trailer.empty())
+        trailer.writeTo(ofs);
+}
+
+void LOUDSUtf16::saveToImageFile(const std::string &path) const
+{
+    const SuccinctBitVector &lbsSucc = lbs();
+    const SuccinctBitVector &leafSucc = leaf();
+
+    louds_image::Writer writer(louds_image::Kind::Louds, sizeof(char16_t));
+    writer.addBitVector(louds_image::SectionId::LbsWords, LBS, lbsSucc);
+    writer.addBitVector(louds_image::SectionId::LeafWords, isLeaf, leafSucc);
+    writer.add(louds_image::SectionId::Labels, std::span<const char16_t>(labels));
+    writer.addSiblingOrder(siblingOrder);
+    writer.writeTo(path);
 }
 
 LOUDSUtf16 LOUDSUtf16::loadFromFile(const std::string &path)
@@ -180,6 +217,9 @@ LOUDSUtf16 LOUDSUtf16::loadFromFile(const std::string &path)
     LOUDSUtf16 l;
     l.LBS = readBitVector(ifs);
     l.isLeaf = readBitVector(ifs);
+    // 読み込んだビット列のディレクトリは末尾セクションから採るか、最初の検索で作る
+    l.lbsIndex_.reset();
+    l.isLeafIndex_.reset();
 
     uint64_t labelN = 0;
     read_u64(ifs, labelN);
@@ -191,5 +231,13 @@ LOUDSUtf16 LOUDSUtf16::loadFromFile(const std::string &path)
         read_u16(ifs, v);
         l.labels[i] = static_cast<char16_t>(v);
     }
+
+    // 任意の末尾セクション（ディレクトリがあれば検索用にそのまま使う）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+    l.siblingOrder = trailer.siblingOrder();
+    if (trailer.has(louds_image::SectionId::LbsRank))
+        l.lbsIndex_.adopt(l.LBS, trailer.takeSuccinct(louds_image::SectionId::LbsWords, l.LBS));
+    if (trailer.has(louds_image::SectionId::LeafRank))
+        l.isLeafIndex_.adopt(l.isLeaf, trailer.takeSuccinct(louds_image::SectionId::LeafWords, l.isLeaf));
     return l;
 }
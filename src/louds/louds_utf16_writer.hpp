@@ -6,35 +6,57 @@
 #include <ostream>
 #include <istream>
 
+#include "common/louds_types.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 #include "common/bit_vector_utf16.hpp"
+#include "common/louds_image.hpp"
+#include "common/lazy_succinct_index.hpp"
 
 // UTF-16 writer は char32_t 版の LOUDS と同名にすると
 // リンカで ODR/ABI 衝突するため、別名にしています。
 class LOUDSUtf16
 {
 public:
-    std::vector<bool> LBSTemp;
-    std::vector<bool> isLeafTemp;
+    // Converter 用（BFS で語単位に追記して最後に BitVector 化）
+    BitVectorBuilder LBSTemp;
+    BitVectorBuilder isLeafTemp;
 
     BitVector LBS;
     BitVector isLeaf;
 
     std::vector<char16_t> labels;
 
+    // 兄弟ラベルの並び順（Converter は CodeUnitAscending で出力する）。保存時に記録され、Reader の探索方法が変わる
+    louds_image::SiblingOrder siblingOrder{louds_image::SiblingOrder::Unordered};
+
     LOUDSUtf16();
 
     void convertListToBitVector();
 
     std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
 
-    void saveToFile(const std::string &path) const;
+    // withDirectory: LBS / isLeaf の rank/select ディレクトリを末尾セクションとして追記する（Reader の構築を省ける）
+    void saveToFile(const std::string &path, bool withDirectory = false) const;
+    // mmap 用のイメージ形式（common/louds_image.hpp）で保存する。rank/select ディレクトリも含む
+    void saveToImageFile(const std::string &path) const;
     static LOUDSUtf16 loadFromFile(const std::string &path);
 
     bool equals(const LOUDSUtf16 &other) const;
 
+    // 使っているメモリの内訳（変換中の *Temp と、検索で作った rank/select ディレクトリを含む）
+    MemoryUsage memoryUsage() const;
+
 private:
-    int firstChild(int pos) const;
-    int traverse(int pos, char16_t c) const;
+    // 検索用の rank/select ディレクトリ（最初の検索で作る。LBS / isLeaf を置き換えると作り直す）
+    LazySuccinctIndex lbsIndex_;
+    LazySuccinctIndex isLeafIndex_;
+
+    const SuccinctBitVector &lbs() const { return lbsIndex_.get(LBS); }
+    const SuccinctBitVector &leaf() const { return isLeafIndex_.get(isLeaf); }
+
+    LoudsPos firstChild(LoudsPos pos) const;
+    LoudsPos traverse(LoudsPos pos, char16_t c) const;
 
     static void write_u64(std::ostream &os, uint64_t v);
     static void write_u16(std::ostream &os, uint16_t v);
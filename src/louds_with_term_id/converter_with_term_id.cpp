@@ -1,28 +1,81 @@
 #include "louds_with_term_id/converter_with_term_id.hpp"
+#include "common/sharded_louds_converter.hpp"
 #include <queue>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 LOUDSWithTermId ConverterWithTermId::convert(const PrefixNodeWithTermId *rootNode) const
+{
+    return convertImpl(rootNode, {}, false, nullptr);
+}
+
+LOUDSWithTermId ConverterWithTermId::convert(const PrefixNodeWithTermId *rootNode,
+                                             std::span<const uint32_t> termScores) const
+{
+    return convertImpl(rootNode, termScores, true, nullptr);
+}
+
+LOUDSWithTermId ConverterWithTermId::convertByFrequency(const PrefixNodeWithTermId *rootNode,
+                                                        const NodeWeights<PrefixNodeWithTermId> &weights) const
+{
+    return convertImpl(rootNode, {}, false, &weights);
+}
+
+LOUDSWithTermId ConverterWithTermId::convertByFrequency(const PrefixNodeWithTermId *rootNode,
+                                                        const NodeWeights<PrefixNodeWithTermId> &weights,
+                                                        std::span<const uint32_t> termScores) const
+{
+    return convertImpl(rootNode, termScores, true, &weights);
+}
+
+LOUDSWithTermId ConverterWithTermId::convertImpl(const PrefixNodeWithTermId *rootNode,
+                                                 std::span<const uint32_t> termScores,
+                                                 bool withScores,
+                                                 const NodeWeights<PrefixNodeWithTermId> *weights) const
 {
     LOUDSWithTermId louds;
 
+    auto scoreOf = [&](int termId) -> uint32_t
+    {
+        if (termId < 0 || static_cast<size_t>(termId) >= termScores.size())
+            return 0;
+        return termScores[static_cast<size_t>(termId)];
+    };
+
+    // score 列用: labels の添字ごとの親の添字（BFS 順に取り出したノードの添字は 1, 2, ... と進む）
+    std::vector<size_t> parentOf;
+    if (withScores)
+    {
+        parentOf.assign(louds.labels.size(), 0);
+        louds.maxScores.assign(louds.labels.size(), 0);
+    }
+    size_t current = 0;
+
     std::queue<const PrefixNodeWithTermId *> q;
     q.push(rootNode);
+    std::vector<PrefixNodeWithTermId::Child> ordered;
 
     while (!q.empty())
     {
         const PrefixNodeWithTermId *node = q.front();
         q.pop();
+        ++current;
 
         if (node && node->hasChild())
         {
-            for (const auto &kv : node->children)
+            louds.LBSTemp.appendRun(true, node->children().size());
+            // PrefixTree は子をラベル昇順で持つので、weights が無ければそのまま code unit 昇順で出力できる
+            std::span<const PrefixNodeWithTermId::Child> children = node->children();
+            if (weights)
+            {
+                weights->orderChildren(node, ordered);
+                children = ordered;
+            }
+            for (const auto &[label, child] : children)
             {
-                const char32_t label = kv.first;
-                const PrefixNodeWithTermId *child = kv.second.get();
-
                 q.push(child);
 
-                louds.LBSTemp.push_back(true);
                 louds.labels.push_back(label);
                 louds.isLeafTemp.push_back(child->isWord);
 
@@ -30,6 +83,13 @@ LOUDSWithTermId ConverterWithTermId::convert(const PrefixNodeWithTermId *rootNod
                 if (child->isWord)
                 {
                     louds.termIdsSave.push_back(static_cast<int32_t>(child->termId));
+                    if (withScores)
+                        louds.termScores.push_back(scoreOf(child->termId));
+                }
+                if (withScores)
+                {
+                    parentOf.push_back(current);
+                    louds.maxScores.push_back(child->isWord ? scoreOf(child->termId) : 0);
                 }
             }
         }
@@ -38,6 +98,49 @@ LOUDSWithTermId ConverterWithTermId::convert(const PrefixNodeWithTermId *rootNod
         louds.isLeafTemp.push_back(false);
     }
 
+    // 葉から親へ最大値を伝える（子の添字は常に親より大きい）
+    for (size_t i = louds.maxScores.size(); i-- > 2;)
+        louds.maxScores[parentOf[i]] = std::max(louds.maxScores[parentOf[i]], louds.maxScores[i]);
+
     louds.convertListToBitVector();
+    louds.siblingOrder = weights ? louds_image::SiblingOrder::FrequencyDescending
+                                 : louds_image::SiblingOrder::CodeUnitAscending;
+    return louds;
+}
+
+LOUDSWithTermId ConverterWithTermId::convertParallel(const PrefixNodeWithTermId *rootNode, size_t threads) const
+{
+    return convertParallelImpl(rootNode, {}, false, threads);
+}
+
+LOUDSWithTermId ConverterWithTermId::convertParallel(const PrefixNodeWithTermId *rootNode,
+                                                     std::span<const uint32_t> termScores,
+                                                     size_t threads) const
+{
+    return convertParallelImpl(rootNode, termScores, true, threads);
+}
+
+LOUDSWithTermId ConverterWithTermId::convertParallelImpl(const PrefixNodeWithTermId *rootNode,
+                                                         std::span<const uint32_t> termScores,
+                                                         bool withScores,
+                                                         size_t threads) const
+{
+    ShardedLoudsConverter<PrefixNodeWithTermId, char32_t>::Options options;
+    options.threads = threads;
+    options.withTermIds = true;
+    options.withScores = withScores;
+    options.termScores = termScores;
+    auto r = ShardedLoudsConverter<PrefixNodeWithTermId, char32_t>(options).convert(rootNode);
+
+    LOUDSWithTermId louds;
+    louds.LBSTemp.clear();
+    louds.isLeafTemp.clear();
+    louds.LBS = std::move(r.LBS);
+    louds.isLeaf = std::move(r.isLeaf);
+    louds.labels = std::move(r.labels);
+    louds.termIdsSave = std::move(r.termIdsSave);
+    louds.termScores = std::move(r.termScores);
+    louds.maxScores = std::move(r.maxScores);
+    louds.siblingOrder = louds_image::SiblingOrder::CodeUnitAscending;
     return louds;
 }
@@ -1,9 +1,41 @@
 #pragma once
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
 #include "prefix_with_term_id/prefix_tree_with_term_id.hpp"
 #include "louds_with_term_id/louds_with_term_id.hpp"
+#include "common/frequency_order.hpp"
 
 class ConverterWithTermId
 {
 public:
     LOUDSWithTermId convert(const PrefixNodeWithTermId *rootNode) const;
+
+    // termScores[termId] を各語の score として、score 列（termScores / maxScores）も作る。
+    // 範囲外の termId の score は 0
+    LOUDSWithTermId convert(const PrefixNodeWithTermId *rootNode, std::span<const uint32_t> termScores) const;
+
+    // 根の子ごとの部分木を threads 本（0 なら hardware_concurrency）で変換して連結する。結果は convert と同じ
+    LOUDSWithTermId convertParallel(const PrefixNodeWithTermId *rootNode, size_t threads = 0) const;
+    LOUDSWithTermId convertParallel(const PrefixNodeWithTermId *rootNode, std::span<const uint32_t> termScores,
+                                    size_t threads = 0) const;
+
+    // 各ノードの子を weights の降順（同じ重みはラベル昇順）に並べて出力する（SiblingOrder::FrequencyDescending）。
+    // termId・score は語に付いたままなので、どの語の termId / score も convert と同じ
+    LOUDSWithTermId convertByFrequency(const PrefixNodeWithTermId *rootNode,
+                                       const NodeWeights<PrefixNodeWithTermId> &weights) const;
+    LOUDSWithTermId convertByFrequency(const PrefixNodeWithTermId *rootNode,
+                                       const NodeWeights<PrefixNodeWithTermId> &weights,
+                                       std::span<const uint32_t> termScores) const;
+
+private:
+    LOUDSWithTermId convertImpl(const PrefixNodeWithTermId *rootNode,
+                                std::span<const uint32_t> termScores,
+                                bool withScores,
+                                const NodeWeights<PrefixNodeWithTermId> *weights) const;
+    LOUDSWithTermId convertParallelImpl(const PrefixNodeWithTermId *rootNode,
+                                        std::span<const uint32_t> termScores,
+                                        bool withScores,
+                                        size_t threads) const;
 };
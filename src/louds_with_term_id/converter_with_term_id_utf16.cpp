@@ -1,12 +1,29 @@
 #include "louds_with_term_id/converter_with_term_id_utf16.hpp"
+#include "common/sharded_louds_converter.hpp"
 #include <queue>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 LOUDSWithTermIdUtf16 ConverterWithTermIdUtf16::convert(const PrefixNodeWithTermIdUtf16 *rootNode) const
+{
+    return convertImpl(rootNode, nullptr);
+}
+
+LOUDSWithTermIdUtf16 ConverterWithTermIdUtf16::convertByFrequency(const PrefixNodeWithTermIdUtf16 *rootNode,
+                                                                  const NodeWeights<PrefixNodeWithTermIdUtf16> &weights) const
+{
+    return convertImpl(rootNode, &weights);
+}
+
+LOUDSWithTermIdUtf16 ConverterWithTermIdUtf16::convertImpl(const PrefixNodeWithTermIdUtf16 *rootNode,
+                                                           const NodeWeights<PrefixNodeWithTermIdUtf16> *weights) const
 {
     LOUDSWithTermIdUtf16 louds;
 
     std::queue<const PrefixNodeWithTermIdUtf16 *> q;
     q.push(rootNode);
+    std::vector<PrefixNodeWithTermIdUtf16::Child> ordered;
 
     while (!q.empty())
     {
@@ -15,14 +32,18 @@ LOUDSWithTermIdUtf16 ConverterWithTermIdUtf16::convert(const PrefixNodeWithTermI
 
         if (node && node->hasChild())
         {
-            for (const auto &kv : node->children)
+            louds.LBSTemp.appendRun(true, node->children().size());
+            // PrefixTree は子をラベル昇順で持つので、weights が無ければそのまま code unit 昇順で出力できる
+            std::span<const PrefixNodeWithTermIdUtf16::Child> children = node->children();
+            if (weights)
+            {
+                weights->orderChildren(node, ordered);
+                children = ordered;
+            }
+            for (const auto &[label, child] : children)
             {
-                const char16_t label = kv.first;
-                const PrefixNodeWithTermIdUtf16 *child = kv.second.get();
-
                 q.push(child);
 
-                louds.LBSTemp.push_back(true);
                 louds.labels.push_back(label);
                 louds.isLeafTemp.push_back(child->isWord);
 
@@ -39,5 +60,25 @@ LOUDSWithTermIdUtf16 ConverterWithTermIdUtf16::convert(const PrefixNodeWithTermI
     }
 
     louds.convertListToBitVector();
+    louds.siblingOrder = weights ? louds_image::SiblingOrder::FrequencyDescending
+                                 : louds_image::SiblingOrder::CodeUnitAscending;
+    return louds;
+}
+
+LOUDSWithTermIdUtf16 ConverterWithTermIdUtf16::convertParallel(const PrefixNodeWithTermIdUtf16 *rootNode, size_t threads) const
+{
+    ShardedLoudsConverter<PrefixNodeWithTermIdUtf16, char16_t>::Options options;
+    options.threads = threads;
+    options.withTermIds = true;
+    auto r = ShardedLoudsConverter<PrefixNodeWithTermIdUtf16, char16_t>(options).convert(rootNode);
+
+    LOUDSWithTermIdUtf16 louds;
+    louds.LBSTemp.clear();
+    louds.isLeafTemp.clear();
+    louds.LBS = std::move(r.LBS);
+    louds.isLeaf = std::move(r.isLeaf);
+    louds.labels = std::move(r.labels);
+    louds.termIdsSave = std::move(r.termIdsSave);
+    louds.siblingOrder = louds_image::SiblingOrder::CodeUnitAscending;
     return louds;
 }
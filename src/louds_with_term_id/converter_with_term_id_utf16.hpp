@@ -1,9 +1,23 @@
 #pragma once
 #include "prefix_with_term_id/prefix_tree_with_term_id_utf16.hpp"
 #include "louds_with_term_id/louds_with_term_id_utf16_writer.hpp"
+#include "common/frequency_order.hpp"
+#include <cstddef>
 
 class ConverterWithTermIdUtf16
 {
 public:
     LOUDSWithTermIdUtf16 convert(const PrefixNodeWithTermIdUtf16 *rootNode) const;
+
+    // 根の子ごとの部分木を threads 本（0 なら hardware_concurrency）で変換して連結する。結果は convert と同じ
+    LOUDSWithTermIdUtf16 convertParallel(const PrefixNodeWithTermIdUtf16 *rootNode, size_t threads = 0) const;
+
+    // 各ノードの子を weights の降順（同じ重みはラベル昇順）に並べて出力する（SiblingOrder::FrequencyDescending）。
+    // termId は語に付いたままなので、どの語の termId も convert と同じ
+    LOUDSWithTermIdUtf16 convertByFrequency(const PrefixNodeWithTermIdUtf16 *rootNode,
+                                            const NodeWeights<PrefixNodeWithTermIdUtf16> &weights) const;
+
+private:
+    LOUDSWithTermIdUtf16 convertImpl(const PrefixNodeWithTermIdUtf16 *rootNode,
+                                     const NodeWeights<PrefixNodeWithTermIdUtf16> *weights) const;
 };
@@ -1,20 +1,59 @@
 #include "louds_with_term_id/louds_with_term_id_reader.hpp"
 #include <algorithm>
+#include <queue>
+#include <functional>
 
-LOUDSWithTermIdReader::LOUDSWithTermIdReader(const BitVector &lbs,
-                                             const BitVector &isLeaf,
+LOUDSWithTermIdReader::LOUDSWithTermIdReader(BitVector lbs,
+                                             BitVector isLeaf,
                                              std::vector<char32_t> labels,
                                              std::vector<int32_t> termIdsSave)
-    : LBS_(lbs),
-      isLeaf_(isLeaf),
-      labels_(std::move(labels)),
-      termIdsSave_(std::move(termIdsSave)),
-      lbsSucc_(LBS_),
-      leafSucc_(isLeaf_) {}
-
-int LOUDSWithTermIdReader::firstChild(int pos) const
+    : LOUDSWithTermIdReader(std::move(lbs), std::move(isLeaf), std::move(labels), std::move(termIdsSave), louds_trailer::Trailer{}) {}
+
+LOUDSWithTermIdReader::LOUDSWithTermIdReader(BitVector lbs,
+                                             BitVector isLeaf,
+                                             std::vector<char32_t> labels,
+                                             std::vector<int32_t> termIdsSave,
+                                             louds_trailer::Trailer &&trailer)
+    : lbsStorage_(std::move(lbs)),
+      isLeafStorage_(std::move(isLeaf)),
+      labelsStorage_(std::move(labels)),
+      termIdsStorage_(std::move(termIdsSave)),
+      termScoresStorage_(trailer.has(louds_image::SectionId::MaxSubtreeScores)
+                             ? trailer.take<uint32_t>(louds_image::SectionId::TermScores)
+                             : std::vector<uint32_t>{}),
+      maxScoresStorage_(trailer.has(louds_image::SectionId::MaxSubtreeScores)
+                            ? trailer.take<uint32_t>(louds_image::SectionId::MaxSubtreeScores)
+                            : std::vector<uint32_t>{}),
+      LBS_(lbsStorage_),
+      isLeaf_(isLeafStorage_),
+      labels_(labelsStorage_),
+      termIdsSave_(termIdsStorage_),
+      termScores_(termScoresStorage_),
+      maxScores_(maxScoresStorage_),
+      siblingOrder_(trailer.siblingOrder()),
+      lbsSucc_(trailer.takeSuccinct(louds_image::SectionId::LbsWords, LBS_)),
+      leafSucc_(trailer.takeSuccinct(louds_image::SectionId::LeafWords, isLeaf_)) {}
+
+LOUDSWithTermIdReader::LOUDSWithTermIdReader(std::shared_ptr<const MappedFile> image,
+                                              const louds_image::View &view)
+    : image_(std::move(image)),
+      LBS_(view.bitVector(louds_image::SectionId::LbsWords)),
+      isLeaf_(view.bitVector(louds_image::SectionId::LeafWords)),
+      labels_(view.section<char32_t>(louds_image::SectionId::Labels)),
+      termIdsSave_(view.section<int32_t>(louds_image::SectionId::TermIds)),
+      termScores_(view.has(louds_image::SectionId::MaxSubtreeScores)
+                      ? view.section<uint32_t>(louds_image::SectionId::TermScores)
+                      : std::span<const uint32_t>{}),
+      maxScores_(view.has(louds_image::SectionId::MaxSubtreeScores)
+                     ? view.section<uint32_t>(louds_image::SectionId::MaxSubtreeScores)
+                     : std::span<const uint32_t>{}),
+      siblingOrder_(view.siblingOrder()),
+      lbsSucc_(view.succinct(louds_image::SectionId::LbsWords)),
+      leafSucc_(view.succinct(louds_image::SectionId::LeafWords)) {}
+
+LoudsPos LOUDSWithTermIdReader::firstChild(LoudsPos pos) const
 {
-    const int y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
+    const LoudsPos y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
     if (y < 0)
         return -1;
     if (static_cast<size_t>(y) >= LBS_.size())
@@ -22,62 +61,120 @@ int LOUDSWithTermIdReader::firstChild(int pos) const
     return (LBS_.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDSWithTermIdReader::traverse(int pos, char32_t c) const
+LoudsPos LOUDSWithTermIdReader::findChild(LoudsPos firstPos, char32_t c) const
 {
-    int childPos = firstChild(pos);
-    if (childPos == -1)
+    if (firstPos < 0)
+        return -1;
+    LOUDS_COUNT(levels, 1);
+    const size_t count = LBS_.countOnesFrom(static_cast<size_t>(firstPos));
+    if (count == 0)
+        return -1;
+
+    // 兄弟のラベルは labels_ 上で連続するので、先頭の添字だけ rank で求める
+    const LoudsPos first = lbsSucc_.rank1(firstPos);
+    if (first < 0 || static_cast<size_t>(first) + count > labels_.size())
         return -1;
 
-    while (static_cast<size_t>(childPos) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(childPos)))
+    const char32_t *siblings = labels_.data() + first;
+    const size_t k = label_search::findBySiblingOrder(siblingOrder_, siblings, count, c);
+    return (k == count) ? -1 : firstPos + static_cast<LoudsPos>(k);
+}
+
+LoudsPos LOUDSWithTermIdReader::traverse(LoudsPos pos, char32_t c) const
+{
+    return findChild(firstChild(pos), c);
+}
+
+MemoryUsage LOUDSWithTermIdReader::memoryUsage() const
+{
+    MemoryUsage u;
+    u.bits = static_cast<uint64_t>(LBS_.numWords() + isLeaf_.numWords()) * sizeof(uint64_t);
+    u.labels = labels_.size_bytes();
+    u.termIds = termIdsSave_.size_bytes();
+    u.scores = termScores_.size_bytes() + maxScores_.size_bytes();
+    u += MemoryUsage::embedded(lbsSucc_);
+    u += MemoryUsage::embedded(leafSucc_);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(lbsStorage_.words()) + MemoryUsage::slack(isLeafStorage_.words()) +
+                  MemoryUsage::slack(labelsStorage_) + MemoryUsage::slack(termIdsStorage_) +
+                  MemoryUsage::slack(termScoresStorage_) + MemoryUsage::slack(maxScoresStorage_);
+    if (image_)
     {
-        const int labelIndex = lbsSucc_.rank1(childPos);
-        if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels_.size())
-        {
-            if (labels_[static_cast<size_t>(labelIndex)] == c)
-                return childPos;
-        }
-        childPos += 1;
+        u.overhead += sizeof(MappedFile);
+        u.markMapped();
     }
-    return -1;
+    return u;
 }
 
 std::vector<std::u32string> LOUDSWithTermIdReader::commonPrefixSearch(const std::u32string &str) const
 {
-    std::vector<char32_t> resultTemp;
     std::vector<std::u32string> result;
+    commonPrefixSearch(std::u32string_view(str), [&](size_t length, LoudsPos, int32_t)
+                       { result.emplace_back(str, 0, length); });
+    return result;
+}
 
-    int n = 0;
-    for (char32_t c : str)
+size_t LOUDSWithTermIdReader::commonPrefixSearch(std::u32string_view str, std::span<LoudsTermPrefixMatch> out) const
+{
+    size_t count = 0;
+    if (out.empty())
+        return 0;
+    commonPrefixSearch(str, [&](size_t length, LoudsPos nodeIndex, int32_t termId)
+                       {
+                           out[count++] = {length, nodeIndex, termId};
+                           return count < out.size(); });
+    return count;
+}
+
+LoudsPos LOUDSWithTermIdReader::prefixNode(std::u32string_view prefix) const
+{
+    LoudsPos n = 0;
+    for (const char32_t c : prefix)
     {
         n = traverse(n, c);
-        if (n == -1)
-            break;
+        if (n < 0)
+            return -1;
+    }
+    return n;
+}
 
-        const int index = lbsSucc_.rank1(n);
-        if (index < 0 || static_cast<size_t>(index) >= labels_.size())
-            break;
+LOUDSWithTermIdReader::PredictiveCursor LOUDSWithTermIdReader::predictiveCursor(std::u32string_view prefix) const
+{
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return PredictiveCursor();
+    return PredictiveCursor(this, LoudsPredictiveCursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size()));
+}
+
+std::vector<std::u32string> LOUDSWithTermIdReader::predictiveSearch(const std::u32string &prefix, size_t limit) const
+{
+    std::vector<std::u32string> result;
+    if (limit == 0)
+        return result;
 
-        resultTemp.push_back(labels_[static_cast<size_t>(index)]);
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return result;
+    LoudsPredictiveCursor cursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size());
 
-        if (static_cast<size_t>(n) < isLeaf_.size() && isLeaf_.get(static_cast<size_t>(n)))
+    LoudsPrefixMatch m;
+    while (result.size() < limit && cursor.next(m))
+    {
+        // 接頭辞より下のラベルだけを親へ辿りながら後ろから埋める
+        std::u32string key(m.length, char32_t{});
+        std::copy(prefix.begin(), prefix.end(), key.begin());
+        LoudsPos current = m.nodeIndex;
+        for (size_t i = m.length; i > prefix.size(); --i)
         {
-            std::u32string tempStr(resultTemp.begin(), resultTemp.end());
-            if (!result.empty())
-            {
-                result.push_back(result[0] + tempStr);
-            }
-            else
-            {
-                result.push_back(tempStr);
-                resultTemp.clear();
-            }
+            LOUDS_COUNT(parents, 1);
+            key[i - 1] = labels_[static_cast<size_t>(lbsSucc_.rank1(current))];
+            current = lbsSucc_.select1(lbsSucc_.rank0(current));
         }
+        result.push_back(std::move(key));
     }
     return result;
 }
 
-std::u32string LOUDSWithTermIdReader::getLetter(int nodeIndex) const
+std::u32string LOUDSWithTermIdReader::getLetter(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return U"";
@@ -85,14 +182,15 @@ std::u32string LOUDSWithTermIdReader::getLetter(int nodeIndex) const
         return U"";
 
     std::u32string out;
-    int current = nodeIndex;
+    LoudsPos current = nodeIndex;
 
     while (true)
     {
-        const int nodeId = lbsSucc_.rank1(current);
+        const LoudsPos nodeId = lbsSucc_.rank1(current);
         if (nodeId < 0 || static_cast<size_t>(nodeId) >= labels_.size())
             break;
 
+        LOUDS_TOUCH(labels_.data() + nodeId);
         const char32_t ch = labels_[static_cast<size_t>(nodeId)];
         if (ch != U' ')
             out.push_back(ch);
@@ -100,7 +198,8 @@ std::u32string LOUDSWithTermIdReader::getLetter(int nodeIndex) const
         if (nodeId == 0)
             break;
 
-        const int r0 = lbsSucc_.rank0(current);
+        LOUDS_COUNT(parents, 1);
+        const LoudsPos r0 = lbsSucc_.rank0(current);
         current = lbsSucc_.select1(r0);
         if (current < 0)
             break;
@@ -110,20 +209,20 @@ std::u32string LOUDSWithTermIdReader::getLetter(int nodeIndex) const
     return out;
 }
 
-int LOUDSWithTermIdReader::getNodeIndex(const std::u32string &s) const
+LoudsPos LOUDSWithTermIdReader::getNodeIndex(const std::u32string &s) const
 {
     return search(2, s, 0);
 }
 
-int LOUDSWithTermIdReader::getNodeId(const std::u32string &s) const
+LoudsPos LOUDSWithTermIdReader::getNodeId(const std::u32string &s) const
 {
-    const int idx = getNodeIndex(s);
+    const LoudsPos idx = getNodeIndex(s);
     if (idx < 0)
         return -1;
     return lbsSucc_.rank0(idx);
 }
 
-int32_t LOUDSWithTermIdReader::getTermId(int nodeIndex) const
+int32_t LOUDSWithTermIdReader::getTermId(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return -1;
@@ -135,48 +234,121 @@ int32_t LOUDSWithTermIdReader::getTermId(int nodeIndex) const
         return -1;
 
     // Kotlin: rank1(nodeIndex) - 1
-    const int leafRank = leafSucc_.rank1(nodeIndex);
-    const int leafIndex = leafRank - 1;
+    const LoudsPos leafRank = leafSucc_.rank1(nodeIndex);
+    const LoudsPos leafIndex = leafRank - 1;
     if (leafIndex < 0)
         return -1;
     if (static_cast<size_t>(leafIndex) >= termIdsSave_.size())
         return -1;
+    LOUDS_TOUCH(termIdsSave_.data() + leafIndex);
     return termIdsSave_[static_cast<size_t>(leafIndex)];
 }
 
-int LOUDSWithTermIdReader::search(int index, const std::u32string &chars, size_t wordOffset) const
+std::vector<LoudsScoredMatch> LOUDSWithTermIdReader::predictiveTopK(std::u32string_view prefix, size_t k) const
 {
-    int currentIndex = index;
-    if (chars.empty())
-        return -1;
-    if (currentIndex < 0)
-        return -1;
+    if (!hasScores())
+        throw std::runtime_error("LOUDSWithTermIdReader: dictionary has no score columns");
+    if (maxScores_.size() != labels_.size() || termScores_.size() != termIdsSave_.size())
+        throw std::runtime_error("LOUDSWithTermIdReader: score columns do not match the trie");
+
+    std::vector<LoudsScoredMatch> result;
+    const LoudsPos node = prefixNode(prefix);
+    if (k == 0 || node < 0)
+        return result;
+
+    // 候補: 部分木（score は部分木内の最大）か、確定した語（score はその語の score）
+    struct Candidate
+    {
+        uint32_t score;
+        bool term;
+        LoudsPos pos;
+        size_t length;
+    };
+    // score の降順、同点なら短い順、同じ長さなら位置（BFS 順）。同じノードなら部分木を先に。
+    // 部分木の長さ・位置は中の語以下なので、同点の短い語を含む部分木が長い語より先に展開され、結果もこの順になる
+    auto lower = [](const Candidate &a, const Candidate &b)
+    {
+        if (a.score != b.score)
+            return a.score < b.score;
+        if (a.length != b.length)
+            return a.length > b.length;
+        if (a.pos != b.pos)
+            return a.pos > b.pos;
+        return a.term && !b.term;
+    };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(lower)> heap(lower);
+
+    // これまでに候補に入れた語の score 上位 k 件（最小ヒープ）。
+    // 語は互いに異なるので、k 件揃えば先頭未満の部分木は結果に入り得ない
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> seen;
+    auto addTerm = [&](uint32_t score, LoudsPos pos, size_t length)
+    {
+        heap.push({score, true, pos, length});
+        if (seen.size() < k)
+            seen.push(score);
+        else if (score > seen.top())
+        {
+            seen.pop();
+            seen.push(score);
+        }
+    };
+    auto threshold = [&]() -> uint32_t
+    { return seen.size() < k ? 0 : seen.top(); };
 
-    while (static_cast<size_t>(currentIndex) < LBS_.size() && LBS_.get(static_cast<size_t>(currentIndex)))
+    heap.push({maxScores_[static_cast<size_t>(lbsSucc_.rank1(node))], false, node, prefix.size()});
+    while (!heap.empty() && result.size() < k)
     {
-        if (wordOffset >= chars.size())
-            return currentIndex;
+        const Candidate c = heap.top();
+        heap.pop();
 
-        int charIndex = lbsSucc_.rank1(currentIndex);
-        if (charIndex < 0 || static_cast<size_t>(charIndex) >= labels_.size())
-            return -1;
+        if (c.term)
+        {
+            result.push_back({c.length, c.pos, getTermId(c.pos), c.score});
+            continue;
+        }
+        if (c.score < threshold())
+            continue;
 
-        const char32_t currentLabel = labels_[static_cast<size_t>(charIndex)];
-        const char32_t currentChar = chars[wordOffset];
+        if (isLeaf_.get(static_cast<size_t>(c.pos)))
+        {
+            const LoudsPos leafIndex = leafSucc_.rank1(c.pos) - 1;
+            addTerm(termScores_[static_cast<size_t>(leafIndex)], c.pos, c.length);
+        }
 
-        if (currentChar == currentLabel)
+        const LoudsPos first = firstChild(c.pos);
+        if (first < 0)
+            continue;
+        const size_t count = LBS_.countOnesFrom(static_cast<size_t>(first));
+        const size_t firstLabel = static_cast<size_t>(lbsSucc_.rank1(first));
+        for (size_t i = 0; i < count; ++i)
         {
-            if (wordOffset + 1 == chars.size())
-            {
-                return currentIndex;
-            }
-            const int nextIndex = lbsSucc_.select0(charIndex) + 1;
-            if (nextIndex < 0)
-                return -1;
-            return search(nextIndex, chars, wordOffset + 1);
+            const uint32_t best = maxScores_[firstLabel + i];
+            if (best < threshold())
+                continue;
+            heap.push({best, false, first + static_cast<LoudsPos>(i), c.length + 1});
         }
+    }
+    return result;
+}
 
-        currentIndex++;
+LoudsPos LOUDSWithTermIdReader::search(LoudsPos index, const std::u32string &chars, size_t wordOffset) const
+{
+    if (chars.empty())
+        return -1;
+    if (index < 0)
+        return -1;
+    if (wordOffset >= chars.size())
+        return LBS_.get(static_cast<size_t>(index)) ? index : -1;
+
+    LoudsPos currentIndex = index;
+    for (size_t i = wordOffset; i < chars.size(); ++i)
+    {
+        currentIndex = findChild(currentIndex, chars[i]);
+        if (currentIndex < 0)
+            return -1;
+        if (i + 1 == chars.size())
+            return currentIndex;
+        currentIndex = lbsSucc_.select0(lbsSucc_.rank1(currentIndex)) + 1;
     }
     return -1;
 }
@@ -254,12 +426,9 @@ LOUDSWithTermIdReader LOUDSWithTermIdReader::loadFromFile(const std::string &pat
 
     std::vector<char32_t> labels;
     labels.resize(static_cast<size_t>(labelN));
-    for (size_t i = 0; i < static_cast<size_t>(labelN); ++i)
-    {
-        uint32_t v = 0;
-        read_u32(ifs, v);
-        labels[i] = static_cast<char32_t>(v);
-    }
+    if (labelN > 0)
+        ifs.read(reinterpret_cast<char *>(labels.data()),
+                 static_cast<std::streamsize>(labelN * sizeof(char32_t)));
 
     // termIdsSave
     uint64_t termN = 0;
@@ -267,12 +436,22 @@ LOUDSWithTermIdReader LOUDSWithTermIdReader::loadFromFile(const std::string &pat
 
     std::vector<int32_t> termIds;
     termIds.resize(static_cast<size_t>(termN));
-    for (size_t i = 0; i < static_cast<size_t>(termN); ++i)
-    {
-        int32_t v = 0;
-        read_i32(ifs, v);
-        termIds[i] = v;
-    }
+    if (termN > 0)
+        ifs.read(reinterpret_cast<char *>(termIds.data()),
+                 static_cast<std::streamsize>(termN * sizeof(int32_t)));
+
+    if (!ifs)
+        throw std::runtime_error("failed to read LOUDS payload from: " + path);
 
-    return LOUDSWithTermIdReader(lbs, isLeaf, std::move(labels), std::move(termIds));
+    // 任意の末尾セクション（rank/select ディレクトリ）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+
+    return LOUDSWithTermIdReader(std::move(lbs), std::move(isLeaf), std::move(labels), std::move(termIds), std::move(trailer));
+}
+
+LOUDSWithTermIdReader LOUDSWithTermIdReader::mapFromImageFile(const std::string &path)
+{
+    auto image = std::make_shared<const MappedFile>(path);
+    const louds_image::View view(*image, louds_image::Kind::LoudsWithTermId, sizeof(char32_t));
+    return LOUDSWithTermIdReader(image, view);
 }
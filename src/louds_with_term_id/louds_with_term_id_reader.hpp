@@ -1,51 +1,162 @@
 #pragma once
 #include <vector>
+#include <span>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <concepts>
+#include <type_traits>
 #include <cstdint>
 #include <fstream>
 #include <stdexcept>
 #include <ostream>
 #include <istream>
 
+#include "common/louds_types.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 #include "common/bit_vector.hpp"
 #include "common/succinct_bit_vector.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
+#include "common/label_search.hpp"
+#include "common/louds_predictive.hpp"
 
 // 読み込み専用 LOUDSWithTermId
-// - commonPrefixSearch は文字列のみ返す（ユーザー要件どおり）
+// - commonPrefixSearch(str) は文字列のみ返す（ユーザー要件どおり）。termId も要る場合は visitor / 固定長出力の版を使う
 // - termId は getTermId(nodeIndex) で別途取得
 class LOUDSWithTermIdReader
 {
 public:
-    LOUDSWithTermIdReader(const BitVector &lbs,
-                          const BitVector &isLeaf,
+    LOUDSWithTermIdReader(BitVector lbs,
+                          BitVector isLeaf,
                           std::vector<char32_t> labels,
                           std::vector<int32_t> termIdsSave);
 
     std::vector<std::u32string> commonPrefixSearch(const std::u32string &str) const;
 
-    std::u32string getLetter(int nodeIndex) const;
+    // ヒープ確保しない版: str の接頭辞がキーになるたびに visit(prefixLength, nodeIndex, termId) を呼ぶ。
+    // visit が bool を返す場合は false で打ち切る
+    template <class Visitor>
+        requires std::invocable<Visitor &, size_t, LoudsPos, int32_t>
+    void commonPrefixSearch(std::u32string_view str, Visitor &&visit) const
+    {
+        LoudsPos n = 0;
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            n = traverse(n, str[i]);
+            if (n < 0)
+                return;
+            if (!isLeaf_.get(static_cast<size_t>(n)))
+                continue;
+            if constexpr (std::is_convertible_v<std::invoke_result_t<Visitor &, size_t, LoudsPos, int32_t>, bool>)
+            {
+                if (!visit(i + 1, n, getTermId(n)))
+                    return;
+            }
+            else
+            {
+                visit(i + 1, n, getTermId(n));
+            }
+        }
+    }
 
-    int getNodeIndex(const std::u32string &s) const;
-    int getNodeId(const std::u32string &s) const;
+    // 固定長の出力先に書く版。書いた件数を返す（out が埋まったら打ち切る）
+    size_t commonPrefixSearch(std::u32string_view str, std::span<LoudsTermPrefixMatch> out) const;
+
+    // predictiveSearch を 1 件ずつ取り出すカーソル（next で長さ・nodeIndex・termId を返す）
+    class PredictiveCursor
+    {
+    public:
+        PredictiveCursor() = default;
+
+        bool next(LoudsTermPrefixMatch &match)
+        {
+            LoudsPrefixMatch m;
+            if (!cursor_.next(m))
+                return false;
+            match = {m.length, m.nodeIndex, reader_->getTermId(m.nodeIndex)};
+            return true;
+        }
+
+    private:
+        friend class LOUDSWithTermIdReader;
+        PredictiveCursor(const LOUDSWithTermIdReader *reader, LoudsPredictiveCursor cursor)
+            : reader_(reader), cursor_(cursor) {}
+
+        const LOUDSWithTermIdReader *reader_{nullptr};
+        LoudsPredictiveCursor cursor_;
+    };
+
+    // prefix で始まるキーを短い順（同じ長さは LOUDS のノード順）に最大 limit 件返す
+    std::vector<std::u32string> predictiveSearch(const std::u32string &prefix, size_t limit) const;
+
+    // prefix に一致するノードが無ければ空のカーソル。カーソルはこの Reader を参照する
+    PredictiveCursor predictiveCursor(std::u32string_view prefix) const;
+
+    std::u32string getLetter(LoudsPos nodeIndex) const;
+
+    LoudsPos getNodeIndex(const std::u32string &s) const;
+    LoudsPos getNodeId(const std::u32string &s) const;
+
+    // pos のノード（有効な位置であること。根は 0）からラベル c の子へ 1 文字進む（無ければ -1）
+    LoudsPos traverse(LoudsPos pos, char32_t c) const;
+
+    // ファイルに記録された兄弟ラベルの並び順（子の探索方法がこれで決まる）
+    louds_image::SiblingOrder siblingOrder() const { return siblingOrder_; }
+
+    // 使っているメモリの内訳（mapFromImageFile で開いたときは、ビット列・ディレクトリ・ラベル等が mapped に入る）
+    MemoryUsage memoryUsage() const;
 
     // leaf の nodeIndex を渡す想定
-    int32_t getTermId(int nodeIndex) const;
+    int32_t getTermId(LoudsPos nodeIndex) const;
+
+    // score 列を持つか（ConverterWithTermId::convert に score を渡して作った辞書のみ）
+    bool hasScores() const { return !maxScores_.empty(); }
+
+    // prefix で始まるキーのうち score 上位 k 件を score の降順（同点は短い順、同じ長さは BFS 順）で返す。
+    // 部分木の最大 score を上界にした best-first 探索で、k 番目の score に届かない部分木は展開しない。
+    // score 列が無い辞書では std::runtime_error
+    std::vector<LoudsScoredMatch> predictiveTopK(std::u32string_view prefix, size_t k) const;
 
     static LOUDSWithTermIdReader loadFromFile(const std::string &path);
 
+    // saveToImageFile で書いたイメージを mmap し、コピーもディレクトリ再構築もせずに参照する
+    static LOUDSWithTermIdReader mapFromImageFile(const std::string &path);
+
 private:
-    BitVector LBS_;
-    BitVector isLeaf_;
-    std::vector<char32_t> labels_;
-    std::vector<int32_t> termIdsSave_;
+    // mmap 時はファイルを、それ以外は *Storage_ を参照する
+    std::shared_ptr<const MappedFile> image_;
+    BitVector lbsStorage_;
+    BitVector isLeafStorage_;
+    std::vector<char32_t> labelsStorage_;
+    std::vector<int32_t> termIdsStorage_;
+    std::vector<uint32_t> termScoresStorage_;
+    std::vector<uint32_t> maxScoresStorage_;
+
+    BitVectorView LBS_;
+    BitVectorView isLeaf_;
+    std::span<const char32_t> labels_;
+    std::span<const int32_t> termIdsSave_;
+    std::span<const uint32_t> termScores_;
+    std::span<const uint32_t> maxScores_;
+
+    louds_image::SiblingOrder siblingOrder_{louds_image::SiblingOrder::Unordered};
 
     SuccinctBitVector lbsSucc_;
     SuccinctBitVector leafSucc_;
 
-    int firstChild(int pos) const;
-    int traverse(int pos, char32_t c) const;
+    LOUDSWithTermIdReader(std::shared_ptr<const MappedFile> image, const louds_image::View &view);
+    LOUDSWithTermIdReader(BitVector lbs, BitVector isLeaf, std::vector<char32_t> labels, std::vector<int32_t> termIdsSave,
+                          louds_trailer::Trailer &&trailer);
+
+    LoudsPos firstChild(LoudsPos pos) const;
+    // firstPos から始まる兄弟の中で c のラベルを持つ子の位置（無ければ -1）
+    LoudsPos findChild(LoudsPos firstPos, char32_t c) const;
+    // prefix のノード位置（空ならルートの 0、無ければ -1）
+    LoudsPos prefixNode(std::u32string_view prefix) const;
 
-    int search(int index, const std::u32string &chars, size_t wordOffset) const;
+    LoudsPos search(LoudsPos index, const std::u32string &chars, size_t wordOffset) const;
 
     static void write_u64(std::ostream &os, uint64_t v);
     static void write_u32(std::ostream &os, uint32_t v);
@@ -1,21 +1,42 @@
 #include "louds_with_term_id/louds_with_term_id_utf16_reader.hpp"
 
-LOUDSWithTermIdUtf16Reader::LOUDSWithTermIdUtf16Reader(const BitVector &lbs,
-                                                       const BitVector &isLeaf,
+LOUDSWithTermIdUtf16Reader::LOUDSWithTermIdUtf16Reader(BitVector lbs,
+                                                       BitVector isLeaf,
                                                        std::vector<char16_t> labels,
                                                        std::vector<int32_t> termIdsSave)
-    : LBS_(lbs),
-      isLeaf_(isLeaf),
-      labels_(std::move(labels)),
-      termIdsSave_(std::move(termIdsSave)),
-      lbsSucc_(LBS_),
-      leafSucc_(isLeaf_)
-{
-}
+    : LOUDSWithTermIdUtf16Reader(std::move(lbs), std::move(isLeaf), std::move(labels), std::move(termIdsSave), louds_trailer::Trailer{}) {}
 
-int LOUDSWithTermIdUtf16Reader::firstChild(int pos) const
+LOUDSWithTermIdUtf16Reader::LOUDSWithTermIdUtf16Reader(BitVector lbs,
+                                                       BitVector isLeaf,
+                                                       std::vector<char16_t> labels,
+                                                       std::vector<int32_t> termIdsSave,
+                                                       louds_trailer::Trailer &&trailer)
+    : lbsStorage_(std::move(lbs)),
+      isLeafStorage_(std::move(isLeaf)),
+      labelsStorage_(std::move(labels)),
+      termIdsStorage_(std::move(termIdsSave)),
+      LBS_(lbsStorage_),
+      isLeaf_(isLeafStorage_),
+      labels_(labelsStorage_),
+      termIdsSave_(termIdsStorage_),
+      siblingOrder_(trailer.siblingOrder()),
+      lbsSucc_(trailer.takeSuccinct(louds_image::SectionId::LbsWords, LBS_)),
+      leafSucc_(trailer.takeSuccinct(louds_image::SectionId::LeafWords, isLeaf_)) {}
+
+LOUDSWithTermIdUtf16Reader::LOUDSWithTermIdUtf16Reader(std::shared_ptr<const MappedFile> image,
+                                                        const louds_image::View &view)
+    : image_(std::move(image)),
+      LBS_(view.bitVector(louds_image::SectionId::LbsWords)),
+      isLeaf_(view.bitVector(louds_image::SectionId::LeafWords)),
+      labels_(view.section<char16_t>(louds_image::SectionId::Labels)),
+      termIdsSave_(view.section<int32_t>(louds_image::SectionId::TermIds)),
+      siblingOrder_(view.siblingOrder()),
+      lbsSucc_(view.succinct(louds_image::SectionId::LbsWords)),
+      leafSucc_(view.succinct(louds_image::SectionId::LeafWords)) {}
+
+LoudsPos LOUDSWithTermIdUtf16Reader::firstChild(LoudsPos pos) const
 {
-    const int y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
+    const LoudsPos y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
     if (y < 0)
         return -1;
     if (static_cast<size_t>(y) >= LBS_.size())
@@ -23,62 +44,118 @@ int LOUDSWithTermIdUtf16Reader::firstChild(int pos) const
     return (LBS_.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDSWithTermIdUtf16Reader::traverse(int pos, char16_t c) const
+LoudsPos LOUDSWithTermIdUtf16Reader::findChild(LoudsPos firstPos, char16_t c) const
 {
-    int childPos = firstChild(pos);
-    if (childPos == -1)
+    if (firstPos < 0)
+        return -1;
+    LOUDS_COUNT(levels, 1);
+    const size_t count = LBS_.countOnesFrom(static_cast<size_t>(firstPos));
+    if (count == 0)
         return -1;
 
-    while (static_cast<size_t>(childPos) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(childPos)))
+    // 兄弟のラベルは labels_ 上で連続するので、先頭の添字だけ rank で求める
+    const LoudsPos first = lbsSucc_.rank1(firstPos);
+    if (first < 0 || static_cast<size_t>(first) + count > labels_.size())
+        return -1;
+
+    const char16_t *siblings = labels_.data() + first;
+    const size_t k = label_search::findBySiblingOrder(siblingOrder_, siblings, count, c);
+    return (k == count) ? -1 : firstPos + static_cast<LoudsPos>(k);
+}
+
+LoudsPos LOUDSWithTermIdUtf16Reader::traverse(LoudsPos pos, char16_t c) const
+{
+    return findChild(firstChild(pos), c);
+}
+
+MemoryUsage LOUDSWithTermIdUtf16Reader::memoryUsage() const
+{
+    MemoryUsage u;
+    u.bits = static_cast<uint64_t>(LBS_.numWords() + isLeaf_.numWords()) * sizeof(uint64_t);
+    u.labels = labels_.size_bytes();
+    u.termIds = termIdsSave_.size_bytes();
+    u += MemoryUsage::embedded(lbsSucc_);
+    u += MemoryUsage::embedded(leafSucc_);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(lbsStorage_.words()) + MemoryUsage::slack(isLeafStorage_.words()) +
+                  MemoryUsage::slack(labelsStorage_) + MemoryUsage::slack(termIdsStorage_);
+    if (image_)
     {
-        const int labelIndex = lbsSucc_.rank1(childPos);
-        if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels_.size())
-        {
-            if (labels_[static_cast<size_t>(labelIndex)] == c)
-                return childPos;
-        }
-        childPos += 1;
+        u.overhead += sizeof(MappedFile);
+        u.markMapped();
     }
-    return -1;
+    return u;
 }
 
 std::vector<std::u16string> LOUDSWithTermIdUtf16Reader::commonPrefixSearch(const std::u16string &str) const
 {
-    std::vector<char16_t> resultTemp;
     std::vector<std::u16string> result;
+    commonPrefixSearch(std::u16string_view(str), [&](size_t length, LoudsPos, int32_t)
+                       { result.emplace_back(str, 0, length); });
+    return result;
+}
+
+size_t LOUDSWithTermIdUtf16Reader::commonPrefixSearch(std::u16string_view str, std::span<LoudsTermPrefixMatch> out) const
+{
+    size_t count = 0;
+    if (out.empty())
+        return 0;
+    commonPrefixSearch(str, [&](size_t length, LoudsPos nodeIndex, int32_t termId)
+                       {
+                           out[count++] = {length, nodeIndex, termId};
+                           return count < out.size(); });
+    return count;
+}
 
-    int n = 0;
-    for (char16_t c : str)
+LoudsPos LOUDSWithTermIdUtf16Reader::prefixNode(std::u16string_view prefix) const
+{
+    LoudsPos n = 0;
+    for (const char16_t c : prefix)
     {
         n = traverse(n, c);
-        if (n == -1)
-            break;
+        if (n < 0)
+            return -1;
+    }
+    return n;
+}
 
-        const int index = lbsSucc_.rank1(n);
-        if (index < 0 || static_cast<size_t>(index) >= labels_.size())
-            break;
+LOUDSWithTermIdUtf16Reader::PredictiveCursor LOUDSWithTermIdUtf16Reader::predictiveCursor(std::u16string_view prefix) const
+{
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return PredictiveCursor();
+    return PredictiveCursor(this, LoudsPredictiveCursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size()));
+}
 
-        resultTemp.push_back(labels_[static_cast<size_t>(index)]);
+std::vector<std::u16string> LOUDSWithTermIdUtf16Reader::predictiveSearch(const std::u16string &prefix, size_t limit) const
+{
+    std::vector<std::u16string> result;
+    if (limit == 0)
+        return result;
+
+    const LoudsPos node = prefixNode(prefix);
+    if (node < 0)
+        return result;
+    LoudsPredictiveCursor cursor(LBS_, isLeaf_, lbsSucc_, node, prefix.size());
 
-        if (static_cast<size_t>(n) < isLeaf_.size() && isLeaf_.get(static_cast<size_t>(n)))
+    LoudsPrefixMatch m;
+    while (result.size() < limit && cursor.next(m))
+    {
+        // 接頭辞より下のラベルだけを親へ辿りながら後ろから埋める
+        std::u16string key(m.length, char16_t{});
+        std::copy(prefix.begin(), prefix.end(), key.begin());
+        LoudsPos current = m.nodeIndex;
+        for (size_t i = m.length; i > prefix.size(); --i)
         {
-            std::u16string tempStr(resultTemp.begin(), resultTemp.end());
-            if (!result.empty())
-            {
-                result.push_back(result[0] + tempStr);
-            }
-            else
-            {
-                result.push_back(tempStr);
-                resultTemp.clear();
-            }
+            LOUDS_COUNT(parents, 1);
+            key[i - 1] = labels_[static_cast<size_t>(lbsSucc_.rank1(current))];
+            current = lbsSucc_.select1(lbsSucc_.rank0(current));
         }
+        result.push_back(std::move(key));
     }
     return result;
 }
 
-std::u16string LOUDSWithTermIdUtf16Reader::getLetter(int nodeIndex) const
+std::u16string LOUDSWithTermIdUtf16Reader::getLetter(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return u"";
@@ -86,14 +163,15 @@ std::u16string LOUDSWithTermIdUtf16Reader::getLetter(int nodeIndex) const
         return u"";
 
     std::u16string out;
-    int current = nodeIndex;
+    LoudsPos current = nodeIndex;
 
     while (true)
     {
-        const int nodeId = lbsSucc_.rank1(current);
+        const LoudsPos nodeId = lbsSucc_.rank1(current);
         if (nodeId < 0 || static_cast<size_t>(nodeId) >= labels_.size())
             break;
 
+        LOUDS_TOUCH(labels_.data() + nodeId);
         const char16_t ch = labels_[static_cast<size_t>(nodeId)];
         if (ch != u' ')
             out.push_back(ch);
@@ -101,7 +179,8 @@ std::u16string LOUDSWithTermIdUtf16Reader::getLetter(int nodeIndex) const
         if (nodeId == 0)
             break;
 
-        const int r0 = lbsSucc_.rank0(current);
+        LOUDS_COUNT(parents, 1);
+        const LoudsPos r0 = lbsSucc_.rank0(current);
         current = lbsSucc_.select1(r0);
         if (current < 0)
             break;
@@ -111,20 +190,20 @@ std::u16string LOUDSWithTermIdUtf16Reader::getLetter(int nodeIndex) const
     return out;
 }
 
-int LOUDSWithTermIdUtf16Reader::getNodeIndex(const std::u16string &s) const
+LoudsPos LOUDSWithTermIdUtf16Reader::getNodeIndex(const std::u16string &s) const
 {
     return search(2, s, 0);
 }
 
-int LOUDSWithTermIdUtf16Reader::getNodeId(const std::u16string &s) const
+LoudsPos LOUDSWithTermIdUtf16Reader::getNodeId(const std::u16string &s) const
 {
-    const int idx = getNodeIndex(s);
+    const LoudsPos idx = getNodeIndex(s);
     if (idx < 0)
         return -1;
     return lbsSucc_.rank0(idx);
 }
 
-int32_t LOUDSWithTermIdUtf16Reader::getTermId(int nodeIndex) const
+int32_t LOUDSWithTermIdUtf16Reader::getTermId(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return -1;
@@ -135,49 +214,35 @@ int32_t LOUDSWithTermIdUtf16Reader::getTermId(int nodeIndex) const
         return -1;
 
     // leaf の rank1(nodeIndex) - 1 を termIdsSave_ の index にする
-    const int leafRank = leafSucc_.rank1(nodeIndex);
-    const int leafIndex = leafRank - 1;
+    const LoudsPos leafRank = leafSucc_.rank1(nodeIndex);
+    const LoudsPos leafIndex = leafRank - 1;
     if (leafIndex < 0)
         return -1;
     if (static_cast<size_t>(leafIndex) >= termIdsSave_.size())
         return -1;
 
+    LOUDS_TOUCH(termIdsSave_.data() + leafIndex);
     return termIdsSave_[static_cast<size_t>(leafIndex)];
 }
 
-int LOUDSWithTermIdUtf16Reader::search(int index, const std::u16string &chars, size_t wordOffset) const
+LoudsPos LOUDSWithTermIdUtf16Reader::search(LoudsPos index, const std::u16string &chars, size_t wordOffset) const
 {
-    int currentIndex = index;
     if (chars.empty())
         return -1;
-    if (currentIndex < 0)
+    if (index < 0)
         return -1;
+    if (wordOffset >= chars.size())
+        return LBS_.get(static_cast<size_t>(index)) ? index : -1;
 
-    while (static_cast<size_t>(currentIndex) < LBS_.size() && LBS_.get(static_cast<size_t>(currentIndex)))
+    LoudsPos currentIndex = index;
+    for (size_t i = wordOffset; i < chars.size(); ++i)
     {
-        if (wordOffset >= chars.size())
-            return currentIndex;
-
-        int charIndex = lbsSucc_.rank1(currentIndex);
-        if (charIndex < 0 || static_cast<size_t>(charIndex) >= labels_.size())
+        currentIndex = findChild(currentIndex, chars[i]);
+        if (currentIndex < 0)
             return -1;
-
-        const char16_t currentLabel = labels_[static_cast<size_t>(charIndex)];
-        const char16_t currentChar = chars[wordOffset];
-
-        if (currentChar == currentLabel)
-        {
-            if (wordOffset + 1 == chars.size())
-            {
-                return currentIndex;
-            }
-            const int nextIndex = lbsSucc_.select0(charIndex) + 1;
-            if (nextIndex < 0)
-                return -1;
-            return search(nextIndex, chars, wordOffset + 1);
-        }
-
-        currentIndex++;
+        if (i + 1 == chars.size())
+            return currentIndex;
+        currentIndex = lbsSucc_.select0(lbsSucc_.rank1(currentIndex)) + 1;
     }
     return -1;
 }
@@ -233,12 +298,9 @@ LOUDSWithTermIdUtf16Reader LOUDSWithTermIdUtf16Reader::loadFromFile(const std::s
 
     std::vector<char16_t> labels;
     labels.resize(static_cast<size_t>(labelN));
-    for (size_t i = 0; i < static_cast<size_t>(labelN); ++i)
-    {
-        uint16_t v = 0;
-        read_u16(ifs, v);
-        labels[i] = static_cast<char16_t>(v);
-    }
+    if (labelN > 0)
+        ifs.read(reinterpret_cast<char *>(labels.data()),
+                 static_cast<std::streamsize>(labelN * sizeof(char16_t)));
 
     // termIdsSave
     uint64_t termN = 0;
@@ -246,12 +308,22 @@ LOUDSWithTermIdUtf16Reader LOUDSWithTermIdUtf16Reader::loadFromFile(const std::s
 
     std::vector<int32_t> termIds;
     termIds.resize(static_cast<size_t>(termN));
-    for (size_t i = 0; i < static_cast<size_t>(termN); ++i)
-    {
-        int32_t v = 0;
-        read_i32(ifs, v);
-        termIds[i] = v;
-    }
+    if (termN > 0)
+        ifs.read(reinterpret_cast<char *>(termIds.data()),
+                 static_cast<std::streamsize>(termN * sizeof(int32_t)));
 
-    return LOUDSWithTermIdUtf16Reader(lbs, isLeaf, std::move(labels), std::move(termIds));
+    if (!ifs)
+        throw std::runtime_error("failed to read LOUDS payload from: " + path);
+
+    // 任意の末尾セクション（rank/select ディレクトリ）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+
+    return LOUDSWithTermIdUtf16Reader(std::move(lbs), std::move(isLeaf), std::move(labels), std::move(termIds), std::move(trailer));
+}
+
+LOUDSWithTermIdUtf16Reader LOUDSWithTermIdUtf16Reader::mapFromImageFile(const std::string &path)
+{
+    auto image = std::make_shared<const MappedFile>(path);
+    const louds_image::View view(*image, louds_image::Kind::LoudsWithTermId, sizeof(char16_t));
+    return LOUDSWithTermIdUtf16Reader(image, view);
 }
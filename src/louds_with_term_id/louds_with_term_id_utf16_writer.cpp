@@ -1,32 +1,29 @@
 #include "louds_with_term_id/louds_with_term_id_utf16_writer.hpp"
+#include "common/louds_image.hpp"
+#include "common/louds_trailer.hpp"
 
 LOUDSWithTermIdUtf16::LOUDSWithTermIdUtf16()
 {
     // Kotlin の init と同じ初期状態（ダミー2要素）
-    LBSTemp = {true, false};
+    LBSTemp.push_back(true);
+    LBSTemp.push_back(false);
     labels = {u' ', u' '};
-    isLeafTemp = {false, false};
+    isLeafTemp.appendRun(false, 2);
     termIdsSave.clear();
 }
 
 void LOUDSWithTermIdUtf16::convertListToBitVector()
 {
-    BitVector lbs;
-    for (bool b : LBSTemp)
-        lbs.push_back(b);
-    LBS = std::move(lbs);
-    LBSTemp.clear();
-
-    BitVector leaf;
-    for (bool b : isLeafTemp)
-        leaf.push_back(b);
-    isLeaf = std::move(leaf);
-    isLeafTemp.clear();
+    LBS = LBSTemp.build();
+    isLeaf = isLeafTemp.build();
+    // 作り直したビット列に古いディレクトリを使わない（アドレスの一致だけに頼らず明示的に捨てる）
+    lbsIndex_.reset();
+    isLeafIndex_.reset();
 }
 
-int LOUDSWithTermIdUtf16::firstChild(int pos) const
+LoudsPos LOUDSWithTermIdUtf16::firstChild(LoudsPos pos) const
 {
-    const int y = LBS.select0(LBS.rank1(pos)) + 1;
+    const LoudsPos y = lbs().select0(lbs().rank1(pos)) + 1;
     if (y < 0)
         return -1;
     if (static_cast<size_t>(y) >= LBS.size())
@@ -34,18 +31,21 @@ int LOUDSWithTermIdUtf16::firstChild(int pos) const
     return (LBS.get(static_cast<size_t>(y)) ? y : -1);
 }
 
-int LOUDSWithTermIdUtf16::traverse(int pos, char16_t c) const
+LoudsPos LOUDSWithTermIdUtf16::traverse(LoudsPos pos, char16_t c) const
 {
-    int childPos = firstChild(pos);
+    LoudsPos childPos = firstChild(pos);
     if (childPos == -1)
         return -1;
+    LOUDS_COUNT(levels, 1);
 
     while (static_cast<size_t>(childPos) < LBS.size() &&
            LBS.get(static_cast<size_t>(childPos)))
     {
-        const int labelIndex = LBS.rank1(childPos);
+        const LoudsPos labelIndex = lbs().rank1(childPos);
         if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels.size())
         {
+            LOUDS_COUNT(siblings, 1);
+            LOUDS_TOUCH(labels.data() + labelIndex);
             if (labels[static_cast<size_t>(labelIndex)] == c)
                 return childPos;
         }
@@ -59,14 +59,14 @@ std::vector<std::u16string> LOUDSWithTermIdUtf16::commonPrefixSearch(const std::
     std::vector<char16_t> resultTemp;
     std::vector<std::u16string> result;
 
-    int n = 0;
+    LoudsPos n = 0;
     for (char16_t c : str)
     {
         n = traverse(n, c);
         if (n == -1)
             break;
 
-        const int index = LBS.rank1(n);
+        const LoudsPos index = lbs().rank1(n);
         if (index < 0 || static_cast<size_t>(index) >= labels.size())
             return result;
 
@@ -89,7 +89,7 @@ std::vector<std::u16string> LOUDSWithTermIdUtf16::commonPrefixSearch(const std::
     return result;
 }
 
-int32_t LOUDSWithTermIdUtf16::getTermId(int nodeIndex) const
+int32_t LOUDSWithTermIdUtf16::getTermId(LoudsPos nodeIndex) const
 {
     if (nodeIndex < 0)
         return -1;
@@ -100,8 +100,8 @@ int32_t LOUDSWithTermIdUtf16::getTermId(int nodeIndex) const
         return -1;
 
     // leaf の rank1(nodeIndex) - 1 が termIdsSave の index
-    const int leafRank = isLeaf.rank1(nodeIndex);
-    const int leafIndex = leafRank - 1;
+    const LoudsPos leafRank = leaf().rank1(nodeIndex);
+    const LoudsPos leafIndex = leafRank - 1;
     if (leafIndex < 0)
         return -1;
     if (static_cast<size_t>(leafIndex) >= termIdsSave.size())
@@ -110,22 +110,22 @@ int32_t LOUDSWithTermIdUtf16::getTermId(int nodeIndex) const
     return termIdsSave[static_cast<size_t>(leafIndex)];
 }
 
-int LOUDSWithTermIdUtf16::getNodeIndex(const std::u16string &s) const
+LoudsPos LOUDSWithTermIdUtf16::getNodeIndex(const std::u16string &s) const
 {
     return search(2, s, 0);
 }
 
-int LOUDSWithTermIdUtf16::getNodeId(const std::u16string &s) const
+LoudsPos LOUDSWithTermIdUtf16::getNodeId(const std::u16string &s) const
 {
-    const int idx = getNodeIndex(s);
+    const LoudsPos idx = getNodeIndex(s);
     if (idx < 0)
         return -1;
-    return LBS.rank0(idx);
+    return lbs().rank0(idx);
 }
 
-int LOUDSWithTermIdUtf16::search(int index, const std::u16string &chars, size_t wordOffset) const
+LoudsPos LOUDSWithTermIdUtf16::search(LoudsPos index, const std::u16string &chars, size_t wordOffset) const
 {
-    int index2 = index;
+    LoudsPos index2 = index;
     size_t wordOffset2 = wordOffset;
 
     if (chars.empty())
@@ -138,7 +138,7 @@ int LOUDSWithTermIdUtf16::search(int index, const std::u16string &chars, size_t
         if (wordOffset2 >= chars.size())
             return index2;
 
-        int charIndex = LBS.rank1(index2);
+        LoudsPos charIndex = lbs().rank1(index2);
         if (charIndex < 0 || static_cast<size_t>(charIndex) >= labels.size())
             return -1;
 
@@ -148,7 +148,7 @@ int LOUDSWithTermIdUtf16::search(int index, const std::u16string &chars, size_t
             {
                 return index2;
             }
-            const int nextIndex = indexOfLabel(charIndex);
+            const LoudsPos nextIndex = indexOfLabel(charIndex);
             if (nextIndex < 0)
                 return -1;
             return search(nextIndex, chars, wordOffset2 + 1);
@@ -161,23 +161,13 @@ int LOUDSWithTermIdUtf16::search(int index, const std::u16string &chars, size_t
     return -1;
 }
 
-int LOUDSWithTermIdUtf16::indexOfLabel(int label) const
+LoudsPos LOUDSWithTermIdUtf16::indexOfLabel(LoudsPos label) const
 {
-    int count = 0;
-    for (size_t i = 0; i < LBS.size(); ++i)
-    {
-        if (!LBS.get(i))
-        {
-            ++count;
-            if (count == label)
-            {
-                if (i + 1 >= LBS.size())
-                    return -1;
-                return static_cast<int>(i + 1);
-            }
-        }
-    }
-    return -1;
+    // label 番目（1-indexed）の 0 の次の位置（Kotlin: return i + 1）
+    const LoudsPos zero = lbs().select0(label);
+    if (zero < 0 || static_cast<size_t>(zero) + 1 >= LBS.size())
+        return -1;
+    return zero + 1;
 }
 
 bool LOUDSWithTermIdUtf16::equals(const LOUDSWithTermIdUtf16 &other) const
@@ -188,6 +178,21 @@ bool LOUDSWithTermIdUtf16::equals(const LOUDSWithTermIdUtf16 &other) const
            termIdsSave == other.termIdsSave;
 }
 
+MemoryUsage LOUDSWithTermIdUtf16::memoryUsage() const
+{
+    MemoryUsage u;
+    u += MemoryUsage::embedded(LBSTemp);
+    u += MemoryUsage::embedded(isLeafTemp);
+    u += MemoryUsage::embedded(LBS);
+    u += MemoryUsage::embedded(isLeaf);
+    u += MemoryUsage::embedded(lbsIndex_);
+    u += MemoryUsage::embedded(isLeafIndex_);
+    u.labels = MemoryUsage::used(labels);
+    u.termIds = MemoryUsage::used(termIdsSave);
+    u.overhead += sizeof(*this) + MemoryUsage::slack(labels) + MemoryUsage::slack(termIdsSave);
+    return u;
+}
+
 void LOUDSWithTermIdUtf16::write_u64(std::ostream &os, uint64_t v)
 {
     os.write(reinterpret_cast<const char *>(&v), sizeof(v));
@@ -253,7 +258,27 @@ BitVector LOUDSWithTermIdUtf16::readBitVector(std::istream &is)
     return bv;
 }
 
-void LOUDSWithTermIdUtf16::saveToFile(const std::string &path) const
+void LOUDSWithTermIdUtf16::saveToFile(const std::string &path, bool withDirectory) const
+{
+    writeFile(path, withDirectory, true);
+}
+
+void LOUDSWithTermIdUtf16::saveToImageFile(const std::string &path) const
+{
+    writeImageFile(path, true);
+}
+
+void LOUDSWithTermIdUtf16::saveLoudsToFile(const std::string &path, bool withDirectory) const
+{
+    writeFile(path, withDirectory, false);
+}
+
+void LOUDSWithTermIdUtf16::saveLoudsToImageFile(const std::string &path) const
+{
+    writeImageFile(path, false);
+}
+
+void LOUDSWithTermIdUtf16::writeFile(const std::string &path, bool withDirectory, bool withTermIds) const
 {
     std::ofstream ofs(path, std::ios::binary);
     if (!ofs)
@@ -271,11 +296,39 @@ void LOUDSWithTermIdUtf16::saveToFile(const std::string &path) const
     }
 
     // 3) termIdsSave
-    write_u64(ofs, static_cast<uint64_t>(termIdsSave.size()));
-    for (int32_t tid : termIdsSave)
+    if (withTermIds)
     {
-        write_i32(ofs, tid);
+        write_u64(ofs, static_cast<uint64_t>(termIdsSave.size()));
+        for (int32_t tid : termIdsSave)
+        {
+            write_i32(ofs, tid);
+        }
+    }
+
+    louds_trailer::Writer trailer;
+    if (withDirectory)
+    {
+        trailer.addDirectory(louds_image::SectionId::LbsWords, lbs());
+        trailer.addDirectory(louds_image::SectionId::LeafWords, leaf());
     }
+    trailer.addSiblingOrder(siblingOrder);
+    if (!trailer.empty())
+        trailer.writeTo(ofs);
+}
+
+void LOUDSWithTermIdUtf16::writeImageFile(const std::string &path, bool withTermIds) const
+{
+    const SuccinctBitVector &lbsSucc = lbs();
+    const SuccinctBitVector &leafSucc = leaf();
+
+    louds_image::Writer writer(withTermIds ? louds_image::Kind::LoudsWithTermId : louds_image::Kind::Louds, sizeof(char16_t));
+    writer.addBitVector(louds_image::SectionId::LbsWords, LBS, lbsSucc);
+    writer.addBitVector(louds_image::SectionId::LeafWords, isLeaf, leafSucc);
+    writer.add(louds_image::SectionId::Labels, std::span<const char16_t>(labels));
+    writer.addSiblingOrder(siblingOrder);
+    if (withTermIds)
+        writer.add(louds_image::SectionId::TermIds, std::span<const int32_t>(termIdsSave));
+    writer.writeTo(path);
 }
 
 LOUDSWithTermIdUtf16 LOUDSWithTermIdUtf16::loadFromFile(const std::string &path)
@@ -289,6 +342,9 @@ LOUDSWithTermIdUtf16 LOUDSWithTermIdUtf16::loadFromFile(const std::string &path)
     // 1) BitVectors
     l.LBS = readBitVector(ifs);
     l.isLeaf = readBitVector(ifs);
+    // 読み込んだビット列のディレクトリは末尾セクションから採るか、最初の検索で作る
+    l.lbsIndex_.reset();
+    l.isLeafIndex_.reset();
 
     // 2) labels
     uint64_t labelN = 0;
@@ -312,5 +368,12 @@ LOUDSWithTermIdUtf16 LOUDSWithTermIdUtf16::loadFromFile(const std::string &path)
         l.termIdsSave[i] = v;
     }
 
+    // 任意の末尾セクション（ディレクトリがあれば検索用にそのまま使う）
+    louds_trailer::Trailer trailer = louds_trailer::Trailer::read(ifs);
+    l.siblingOrder = trailer.siblingOrder();
+    if (trailer.has(louds_image::SectionId::LbsRank))
+        l.lbsIndex_.adopt(l.LBS, trailer.takeSuccinct(louds_image::SectionId::LbsWords, l.LBS));
+    if (trailer.has(louds_image::SectionId::LeafRank))
+        l.isLeafIndex_.adopt(l.isLeaf, trailer.takeSuccinct(louds_image::SectionId::LeafWords, l.isLeaf));
     return l;
 }
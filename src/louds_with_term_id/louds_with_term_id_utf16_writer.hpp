@@ -7,21 +7,29 @@
 #include <istream>
 #include <stdexcept>
 
+#include "common/louds_types.hpp"
+#include "common/memory_usage.hpp"
+#include "common/hot_path_counters.hpp"
 #include "common/bit_vector_utf16.hpp"
+#include "common/louds_image.hpp"
+#include "common/lazy_succinct_index.hpp"
 
 // 保存/生成用 LOUDSWithTermId（UTF-16 / char16_t）
 class LOUDSWithTermIdUtf16
 {
 public:
-    // builder 用（BFS で push して最後に BitVector 化）
-    std::vector<bool> LBSTemp;
-    std::vector<bool> isLeafTemp;
+    // Converter 用（BFS で語単位に追記して最後に BitVector 化）
+    BitVectorBuilder LBSTemp;
+    BitVectorBuilder isLeafTemp;
 
     // LOUDS 本体
     BitVector LBS;
     BitVector isLeaf;
     std::vector<char16_t> labels;
 
+    // 兄弟ラベルの並び順（Converter は CodeUnitAscending で出力する）。保存時に記録され、Reader の探索方法が変わる
+    louds_image::SiblingOrder siblingOrder{louds_image::SiblingOrder::Unordered};
+
     // leaf ノードに対応する termId 配列（leaf の出現順）
     std::vector<int32_t> termIdsSave;
 
@@ -33,23 +41,40 @@ public:
     std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
 
     // leaf nodeIndex に対して使う想定
-    int32_t getTermId(int nodeIndex) const;
-
-    int getNodeIndex(const std::u16string &s) const;
-    int getNodeId(const std::u16string &s) const;
-
-    void saveToFile(const std::string &path) const;
+    int32_t getTermId(LoudsPos nodeIndex) const;
+
+    LoudsPos getNodeIndex(const std::u16string &s) const;
+    LoudsPos getNodeId(const std::u16string &s) const;
+
+    // withDirectory: LBS / isLeaf の rank/select ディレクトリを末尾セクションとして追記する（Reader の構築を省ける）
+    void saveToFile(const std::string &path, bool withDirectory = false) const;
+    // mmap 用のイメージ形式（common/louds_image.hpp）で保存する。rank/select ディレクトリも含む
+    void saveToImageFile(const std::string &path) const;
+    // termId 列を除いた LOUDSUtf16 の形式で保存する（LOUDSUtf16::saveToFile / saveToImageFile と同じバイト列）。
+    // LBS / isLeaf / labels は共通なので、1 本の木・1 回の変換から両方の辞書を書ける
+    void saveLoudsToFile(const std::string &path, bool withDirectory = false) const;
+    void saveLoudsToImageFile(const std::string &path) const;
     static LOUDSWithTermIdUtf16 loadFromFile(const std::string &path);
 
     bool equals(const LOUDSWithTermIdUtf16 &other) const;
 
+    // 使っているメモリの内訳（変換中の *Temp と、検索で作った rank/select ディレクトリを含む）
+    MemoryUsage memoryUsage() const;
+
 private:
-    int firstChild(int pos) const;
-    int traverse(int pos, char16_t c) const;
+    // 検索用の rank/select ディレクトリ（最初の検索で作る。LBS / isLeaf を置き換えると作り直す）
+    LazySuccinctIndex lbsIndex_;
+    LazySuccinctIndex isLeafIndex_;
+
+    const SuccinctBitVector &lbs() const { return lbsIndex_.get(LBS); }
+    const SuccinctBitVector &leaf() const { return isLeafIndex_.get(isLeaf); }
+
+    LoudsPos firstChild(LoudsPos pos) const;
+    LoudsPos traverse(LoudsPos pos, char16_t c) const;
 
     // Kotlin: search / indexOfLabel 相当
-    int search(int index, const std::u16string &chars, size_t wordOffset) const;
-    int indexOfLabel(int label) const;
+    LoudsPos search(LoudsPos index, const std::u16string &chars, size_t wordOffset) const;
+    LoudsPos indexOfLabel(LoudsPos label) const;
 
     static void write_u64(std::ostream &os, uint64_t v);
     static void write_u16(std::ostream &os, uint16_t v);
@@ -62,6 +87,9 @@ private:
     static void write_u64_vec(std::ostream &os, const std::vector<uint64_t> &v);
     static std::vector<uint64_t> read_u64_vec(std::istream &is);
 
+    void writeFile(const std::string &path, bool withDirectory, bool withTermIds) const;
+    void writeImageFile(const std::string &path, bool withTermIds) const;
+
     void writeBitVector(std::ostream &os, const BitVector &bv) const;
     static BitVector readBitVector(std::istream &is);
 };
@@ -1,25 +1,19 @@
 #include "prefix_tree.hpp"
 
-PrefixTree::PrefixTree() : root(std::make_unique<PrefixNode>()), nextId(1) {}
+PrefixTree::PrefixTree() : root(nodes.create()), nextId(1) {}
 
-void PrefixTree::insert(const std::u32string& word) {
-    PrefixNode* cur = root.get();
+void PrefixTree::insert(std::u32string_view word) {
+    PrefixNode* cur = root;
     for (char32_t ch : word) {
-        if (auto* nxt = cur->getChild(ch)) {
-            cur = nxt;
-        } else {
-            int id = ++nextId;
-            auto node = std::make_unique<PrefixNode>();
-            node->c = ch;
-            node->id = id;
-
-            PrefixNode* raw = node.get();
-            cur->addChild(std::move(node));
-            cur = raw;
+        bool inserted = false;
+        PrefixNode* nxt = trie_arena::findOrInsertChild(*cur, ch, nodes, childArrays, inserted);
+        if (inserted) {
+            nxt->id = ++nextId;
         }
+        cur = nxt;
     }
     cur->isWord = true;
 }
 
-PrefixNode* PrefixTree::getRoot() { return root.get(); }
-const PrefixNode* PrefixTree::getRoot() const { return root.get(); }
+PrefixNode* PrefixTree::getRoot() { return root; }
+const PrefixNode* PrefixTree::getRoot() const { return root; }
@@ -1,46 +1,45 @@
 #pragma once
-#include <unordered_map>
-#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <atomic>
 #include <cstdint>
 
+#include "common/trie_arena.hpp"
+
 struct PrefixNode {
+    using Child = trie_arena::Child<char32_t, PrefixNode>;
+
     char32_t c{U' '};
     int id{-1};
     bool isWord{false};
 
-    std::unordered_map<char32_t, std::unique_ptr<PrefixNode>> children;
-
-    bool hasChild() const { return !children.empty(); }
-
-    PrefixNode* getChild(char32_t ch) {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-    const PrefixNode* getChild(char32_t ch) const {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-
-    void addChild(std::unique_ptr<PrefixNode> node) {
-        const char32_t ch = node->c;
-        if (children.find(ch) == children.end()) {
-            children.emplace(ch, std::move(node));
-        }
-    }
+    // 子はラベルの昇順。配列の実体は木の ChildArrayPool が持つ
+    uint8_t childClass{0};
+    uint32_t childCount{0};
+    Child* childArray{nullptr};
+
+    bool hasChild() const { return childCount != 0; }
+
+    std::span<const Child> children() const { return {childArray, childCount}; }
+
+    PrefixNode* getChild(char32_t ch) { return trie_arena::findChild(childArray, childCount, ch); }
+    const PrefixNode* getChild(char32_t ch) const { return trie_arena::findChild(childArray, childCount, ch); }
 };
 
 class PrefixTree {
 public:
     PrefixTree();
 
-    void insert(const std::u32string& word);
+    void insert(std::u32string_view word);
 
     PrefixNode* getRoot();
     const PrefixNode* getRoot() const;
 
 private:
-    std::unique_ptr<PrefixNode> root;
+    // ノードと子配列はまとめて確保し、木と一緒に解放する
+    trie_arena::NodePool<PrefixNode> nodes;
+    trie_arena::ChildArrayPool<PrefixNode::Child> childArrays;
+    PrefixNode* root;
     std::atomic<int> nextId;
 };
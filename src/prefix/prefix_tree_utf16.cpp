@@ -1,34 +1,26 @@
 #include "prefix/prefix_tree_utf16.hpp"
 
 PrefixTreeUtf16::PrefixTreeUtf16()
-    : root(std::make_unique<PrefixNodeUtf16>()),
+    : root(nodes.create()),
       nextId(1)
 {
 }
 
-void PrefixTreeUtf16::insert(const std::u16string &word)
+void PrefixTreeUtf16::insert(std::u16string_view word)
 {
-    PrefixNodeUtf16 *cur = root.get();
+    PrefixNodeUtf16 *cur = root;
     for (char16_t ch : word)
     {
-        if (auto *nxt = cur->getChild(ch))
+        bool inserted = false;
+        PrefixNodeUtf16 *nxt = trie_arena::findOrInsertChild(*cur, ch, nodes, childArrays, inserted);
+        if (inserted)
         {
-            cur = nxt;
-        }
-        else
-        {
-            int id = ++nextId;
-            auto node = std::make_unique<PrefixNodeUtf16>();
-            node->c = ch;
-            node->id = id;
-
-            PrefixNodeUtf16 *raw = node.get();
-            cur->addChild(std::move(node));
-            cur = raw;
+            nxt->id = ++nextId;
         }
+        cur = nxt;
     }
     cur->isWord = true;
 }
 
-PrefixNodeUtf16 *PrefixTreeUtf16::getRoot() { return root.get(); }
-const PrefixNodeUtf16 *PrefixTreeUtf16::getRoot() const { return root.get(); }
+PrefixNodeUtf16 *PrefixTreeUtf16::getRoot() { return root; }
+const PrefixNodeUtf16 *PrefixTreeUtf16::getRoot() const { return root; }
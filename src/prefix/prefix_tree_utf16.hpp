@@ -1,43 +1,33 @@
 #pragma once
-#include <unordered_map>
-#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <atomic>
 #include <cstdint>
 
+#include "common/trie_arena.hpp"
+
 // UTF-16 版は char32_t 版 (src/prefix/prefix_tree.*) と
 // 同名クラスにすると ODR/ABI 衝突でリンクが壊れるため、別名にしています。
-
 struct PrefixNodeUtf16
 {
+    using Child = trie_arena::Child<char16_t, PrefixNodeUtf16>;
+
     char16_t c{u' '};
     int id{-1};
     bool isWord{false};
 
-    std::unordered_map<char16_t, std::unique_ptr<PrefixNodeUtf16>> children;
-
-    bool hasChild() const { return !children.empty(); }
-
-    PrefixNodeUtf16 *getChild(char16_t ch)
-    {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-
-    const PrefixNodeUtf16 *getChild(char16_t ch) const
-    {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-
-    void addChild(std::unique_ptr<PrefixNodeUtf16> node)
-    {
-        const char16_t ch = node->c;
-        if (children.find(ch) == children.end())
-        {
-            children.emplace(ch, std::move(node));
-        }
-    }
+    // 子はラベルの昇順。配列の実体は木の ChildArrayPool が持つ
+    uint8_t childClass{0};
+    uint32_t childCount{0};
+    Child *childArray{nullptr};
+
+    bool hasChild() const { return childCount != 0; }
+
+    std::span<const Child> children() const { return {childArray, childCount}; }
+
+    PrefixNodeUtf16 *getChild(char16_t ch) { return trie_arena::findChild(childArray, childCount, ch); }
+    const PrefixNodeUtf16 *getChild(char16_t ch) const { return trie_arena::findChild(childArray, childCount, ch); }
 };
 
 class PrefixTreeUtf16
@@ -45,12 +35,15 @@ class PrefixTreeUtf16
 public:
     PrefixTreeUtf16();
 
-    void insert(const std::u16string &word);
+    void insert(std::u16string_view word);
 
     PrefixNodeUtf16 *getRoot();
     const PrefixNodeUtf16 *getRoot() const;
 
 private:
-    std::unique_ptr<PrefixNodeUtf16> root;
+    // ノードと子配列はまとめて確保し、木と一緒に解放する
+    trie_arena::NodePool<PrefixNodeUtf16> nodes;
+    trie_arena::ChildArrayPool<PrefixNodeUtf16::Child> childArrays;
+    PrefixNodeUtf16 *root;
     std::atomic<int> nextId;
 };
@@ -1,41 +1,33 @@
 #include "prefix_tree_with_term_id.hpp"
 
 PrefixTreeWithTermId::PrefixTreeWithTermId()
-    : root(std::make_unique<PrefixNodeWithTermId>()),
+    : root(nodes.create()),
       nextNodeId(1),
       nextTermId(1) {}
 
-void PrefixTreeWithTermId::insert(const std::u32string &word)
+void PrefixTreeWithTermId::insert(std::u32string_view word)
 {
-    PrefixNodeWithTermId *cur = root.get();
+    PrefixNodeWithTermId *cur = root;
 
     const int termId = nextTermId.fetch_add(1);
 
     for (char32_t ch : word)
     {
-        if (auto *nxt = cur->getChild(ch))
+        bool inserted = false;
+        PrefixNodeWithTermId *nxt = trie_arena::findOrInsertChild(*cur, ch, nodes, childArrays, inserted);
+        if (inserted)
         {
-            cur = nxt;
-        }
-        else
-        {
-            int id = nextNodeId.fetch_add(1) + 1;
-            auto node = std::make_unique<PrefixNodeWithTermId>();
-            node->c = ch;
-            node->id = id;
-            node->termId = termId;
-
-            PrefixNodeWithTermId *raw = node.get();
-            cur->addChild(std::move(node));
-            cur = raw;
+            nxt->id = nextNodeId.fetch_add(1) + 1;
+            nxt->termId = termId;
         }
+        cur = nxt;
     }
 
     cur->isWord = true;
 }
 
-PrefixNodeWithTermId *PrefixTreeWithTermId::getRoot() { return root.get(); }
-const PrefixNodeWithTermId *PrefixTreeWithTermId::getRoot() const { return root.get(); }
+PrefixNodeWithTermId *PrefixTreeWithTermId::getRoot() { return root; }
+const PrefixNodeWithTermId *PrefixTreeWithTermId::getRoot() const { return root; }
 
 int PrefixTreeWithTermId::getNodeSize() const
 {
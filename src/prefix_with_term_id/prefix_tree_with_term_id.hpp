@@ -1,40 +1,32 @@
 #pragma once
-#include <unordered_map>
-#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <atomic>
 #include <cstdint>
 
+#include "common/trie_arena.hpp"
+
 struct PrefixNodeWithTermId
 {
+    using Child = trie_arena::Child<char32_t, PrefixNodeWithTermId>;
+
     char32_t c{U' '};
     int id{-1};
     bool isWord{false};
     int termId{-1};
 
-    std::unordered_map<char32_t, std::unique_ptr<PrefixNodeWithTermId>> children;
-
-    bool hasChild() const { return !children.empty(); }
-
-    PrefixNodeWithTermId *getChild(char32_t ch)
-    {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-    const PrefixNodeWithTermId *getChild(char32_t ch) const
-    {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-
-    void addChild(std::unique_ptr<PrefixNodeWithTermId> node)
-    {
-        const char32_t ch = node->c;
-        if (children.find(ch) == children.end())
-        {
-            children.emplace(ch, std::move(node));
-        }
-    }
+    // 子はラベルの昇順。配列の実体は木の ChildArrayPool が持つ
+    uint8_t childClass{0};
+    uint32_t childCount{0};
+    Child *childArray{nullptr};
+
+    bool hasChild() const { return childCount != 0; }
+
+    std::span<const Child> children() const { return {childArray, childCount}; }
+
+    PrefixNodeWithTermId *getChild(char32_t ch) { return trie_arena::findChild(childArray, childCount, ch); }
+    const PrefixNodeWithTermId *getChild(char32_t ch) const { return trie_arena::findChild(childArray, childCount, ch); }
 };
 
 class PrefixTreeWithTermId
@@ -42,7 +34,7 @@ class PrefixTreeWithTermId
 public:
     PrefixTreeWithTermId();
 
-    void insert(const std::u32string &word);
+    void insert(std::u32string_view word);
 
     PrefixNodeWithTermId *getRoot();
     const PrefixNodeWithTermId *getRoot() const;
@@ -51,7 +43,10 @@ public:
     int getTermIdSize() const;
 
 private:
-    std::unique_ptr<PrefixNodeWithTermId> root;
+    // ノードと子配列はまとめて確保し、木と一緒に解放する
+    trie_arena::NodePool<PrefixNodeWithTermId> nodes;
+    trie_arena::ChildArrayPool<PrefixNodeWithTermId::Child> childArrays;
+    PrefixNodeWithTermId *root;
     std::atomic<int> nextNodeId;
     std::atomic<int> nextTermId;
 };
@@ -1,41 +1,32 @@
 #pragma once
-#include <unordered_map>
-#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <atomic>
 #include <cstdint>
 
+#include "common/trie_arena.hpp"
+
 struct PrefixNodeWithTermIdUtf16
 {
+    using Child = trie_arena::Child<char16_t, PrefixNodeWithTermIdUtf16>;
+
     char16_t c{u' '};
     int id{-1};
     bool isWord{false};
     int32_t termId{-1};
 
-    std::unordered_map<char16_t, std::unique_ptr<PrefixNodeWithTermIdUtf16>> children;
-
-    bool hasChild() const { return !children.empty(); }
-
-    PrefixNodeWithTermIdUtf16 *getChild(char16_t ch)
-    {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-
-    const PrefixNodeWithTermIdUtf16 *getChild(char16_t ch) const
-    {
-        auto it = children.find(ch);
-        return (it == children.end()) ? nullptr : it->second.get();
-    }
-
-    void addChild(std::unique_ptr<PrefixNodeWithTermIdUtf16> node)
-    {
-        const char16_t ch = node->c;
-        if (children.find(ch) == children.end())
-        {
-            children.emplace(ch, std::move(node));
-        }
-    }
+    // 子はラベルの昇順。配列の実体は木の ChildArrayPool が持つ
+    uint8_t childClass{0};
+    uint32_t childCount{0};
+    Child *childArray{nullptr};
+
+    bool hasChild() const { return childCount != 0; }
+
+    std::span<const Child> children() const { return {childArray, childCount}; }
+
+    PrefixNodeWithTermIdUtf16 *getChild(char16_t ch) { return trie_arena::findChild(childArray, childCount, ch); }
+    const PrefixNodeWithTermIdUtf16 *getChild(char16_t ch) const { return trie_arena::findChild(childArray, childCount, ch); }
 };
 
 class PrefixTreeWithTermIdUtf16
@@ -43,7 +34,7 @@ class PrefixTreeWithTermIdUtf16
 public:
     PrefixTreeWithTermIdUtf16();
 
-    void insert(const std::u16string &word);
+    void insert(std::u16string_view word);
 
     PrefixNodeWithTermIdUtf16 *getRoot();
     const PrefixNodeWithTermIdUtf16 *getRoot() const;
@@ -52,7 +43,10 @@ public:
     int getTermIdSize() const;
 
 private:
-    std::unique_ptr<PrefixNodeWithTermIdUtf16> root;
+    // ノードと子配列はまとめて確保し、木と一緒に解放する
+    trie_arena::NodePool<PrefixNodeWithTermIdUtf16> nodes;
+    trie_arena::ChildArrayPool<PrefixNodeWithTermIdUtf16::Child> childArrays;
+    PrefixNodeWithTermIdUtf16 *root;
     std::atomic<int> nextNodeId;
     std::atomic<int32_t> nextTermId;
 };
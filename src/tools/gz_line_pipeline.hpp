@@ -0,0 +1,325 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+#include <zlib.h>
+
+// jawiki_build 系の入力段: gzip 展開 → UTF-8 デコード → 挿入 をスレッドで重ねるパイプライン
+//
+// - 展開スレッド 1 本が gzread で batchBytes 程度ずつ読み、行の途中で切れた分は次のバッチへ持ち越す
+// - デコーダ decoderThreads 本がバッチ単位で UTF-8 → CharT に変換する（結果は連結した文字列 + 各語の終端）
+// - run を呼んだスレッドがバッチを入力順に受け取り、1 語ずつ sink に渡す（termId の振り方は直列版と同じ）
+// - バッチのバッファ（スロット）は固定数を使い回すので、行ごとに std::string を作らない
+// - 行の扱いは旧 gz_read_line と同じ（末尾の \n / \r を落とし、空行は読み飛ばす。デコードに失敗した行は語に数えない）
+template <class CharT>
+class GzLinePipeline
+{
+public:
+    // line を out に変換する（out は上書き）。不正な UTF-8 なら false
+    using Decoder = bool (*)(std::string_view line, std::basic_string<CharT> &out);
+
+    struct Options
+    {
+        // 0 なら hardware_concurrency - 2（展開スレッドと run のスレッドの分を引く）。最低 1
+        size_t decoderThreads = 0;
+        size_t batchBytes = size_t{4} << 20;
+        // 0 なら decoderThreads * 2 + 2
+        size_t slots = 0;
+        // 0 = 無制限。word_count がこの数に達したら残りを読まない
+        uint64_t limit = 0;
+    };
+
+    struct Stats
+    {
+        uint64_t wordCount{0};
+        uint64_t charCount{0};      // CharT の個数
+        uint64_t utf8Bytes{0};      // 空行を除いた行のバイト数（改行を除く）
+        double secondsInflate{0.0}; // 展開スレッドが gzread に使った時間
+        double secondsDecode{0.0};  // デコーダの処理時間の合計（スレッドをまたいだ和）
+        double secondsSink{0.0};    // sink（挿入）に使った時間
+        double secondsWall{0.0};    // run 全体の経過時間
+    };
+
+    GzLinePipeline(std::string path, Decoder decode, Options options)
+        : path_(std::move(path)), decode_(decode), options_(options)
+    {
+        if (options_.decoderThreads == 0)
+        {
+            const size_t hw = std::thread::hardware_concurrency();
+            options_.decoderThreads = (hw > 3) ? hw - 2 : 1;
+        }
+        if (options_.batchBytes == 0)
+            options_.batchBytes = 1;
+        if (options_.slots == 0)
+            options_.slots = options_.decoderThreads * 2 + 2;
+        slots_.resize(options_.slots);
+    }
+
+    size_t decoderThreads() const { return options_.decoderThreads; }
+
+    GzLinePipeline(const GzLinePipeline &) = delete;
+    GzLinePipeline &operator=(const GzLinePipeline &) = delete;
+
+    // 展開・デコードを別スレッドで回しながら、入力順に sink(std::basic_string_view<CharT>) を呼ぶ。
+    // どこかで例外が出たら全スレッドを止めてから投げ直す
+    template <class Sink>
+    Stats run(Sink &&sink)
+    {
+        const auto tBegin = std::chrono::steady_clock::now();
+        gzFile f = gzopen(path_.c_str(), "rb");
+        if (!f)
+            throw std::runtime_error("Failed to open gz: " + path_);
+        gzbuffer(f, 1u << 20);
+
+        Stats stats;
+        std::thread reader([&]
+                           { guarded([&]
+                                     { readLoop(f, stats.secondsInflate); }); });
+        std::vector<std::thread> decoders;
+        std::vector<double> decodeSeconds(options_.decoderThreads, 0.0);
+        for (size_t t = 0; t < options_.decoderThreads; ++t)
+        {
+            decoders.emplace_back([&, t]
+                                  { guarded([&]
+                                            { decodeLoop(decodeSeconds[t]); }); });
+        }
+
+        guarded([&]
+                { consumeLoop(sink, stats); });
+        stop();
+        reader.join();
+        for (std::thread &d : decoders)
+            d.join();
+        gzclose(f);
+
+        if (error_)
+            std::rethrow_exception(error_);
+        for (double s : decodeSeconds)
+            stats.secondsDecode += s;
+        stats.secondsWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - tBegin).count();
+        return stats;
+    }
+
+private:
+    enum class State
+    {
+        Free,
+        Raw,
+        Decoded,
+    };
+
+    struct Slot
+    {
+        State state{State::Free};
+        std::string raw;                   // 完全な行だけ（最後のバッチは改行で終わらないこともある）
+        std::basic_string<CharT> chars;    // デコード済みの語を連結したもの
+        std::vector<size_t> ends;          // chars 上の各語の終端
+        std::vector<uint64_t> bytes;       // 語ごとの UTF-8 バイト数（直前のデコード失敗行を含む）
+        uint64_t trailingBytes{0};         // 最後の語より後ろのデコード失敗行
+    };
+
+    static constexpr size_t kReadChunk = size_t{1} << 18;
+
+    std::string path_;
+    Decoder decode_;
+    Options options_;
+    std::vector<Slot> slots_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<size_t> work_;
+    uint64_t published_{0}; // 展開済みのバッチ数
+    bool readerDone_{false};
+    bool stop_{false};
+    std::exception_ptr error_;
+
+    template <class Fn>
+    void guarded(Fn &&fn)
+    {
+        try
+        {
+            fn();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+            stop_ = true;
+            cv_.notify_all();
+        }
+    }
+
+    void stop()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        cv_.notify_all();
+    }
+
+    void readLoop(gzFile f, double &seconds)
+    {
+        std::string carry;
+        for (uint64_t seq = 0;; ++seq)
+        {
+            Slot &slot = slots_[seq % slots_.size()];
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]
+                         { return stop_ || slot.state == State::Free; });
+                if (stop_)
+                    return;
+            }
+
+            // 持ち越し + batchBytes まで読む。改行が 1 つも無ければ（長い行）改行か EOF まで読み足す
+            slot.raw.swap(carry);
+            carry.clear();
+            bool eof = false;
+            size_t scanned = 0;
+            while (!eof && (slot.raw.size() < options_.batchBytes ||
+                            slot.raw.find('\n', scanned) == std::string::npos))
+            {
+                scanned = slot.raw.size();
+                slot.raw.resize(scanned + kReadChunk);
+                const auto t0 = std::chrono::steady_clock::now();
+                const int n = gzread(f, slot.raw.data() + scanned, static_cast<unsigned>(kReadChunk));
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                if (n < 0)
+                {
+                    int err = 0;
+                    throw std::runtime_error(std::string("gzread failed: ") + gzerror(f, &err));
+                }
+                slot.raw.resize(scanned + static_cast<size_t>(n));
+                eof = (n == 0);
+            }
+            if (!eof)
+            {
+                const size_t lastNewline = slot.raw.rfind('\n');
+                carry.assign(slot.raw, lastNewline + 1, std::string::npos);
+                slot.raw.resize(lastNewline + 1);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.state = State::Raw;
+            work_.push_back(seq % slots_.size());
+            published_ = seq + 1;
+            if (eof)
+                readerDone_ = true;
+            cv_.notify_all();
+            if (eof)
+                return;
+        }
+    }
+
+    void decodeLoop(double &seconds)
+    {
+        std::basic_string<CharT> scratch;
+        while (true)
+        {
+            size_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]
+                         { return stop_ || !work_.empty() || readerDone_; });
+                if (stop_ || (work_.empty() && readerDone_))
+                    return;
+                index = work_.front();
+                work_.pop_front();
+            }
+
+            const auto t0 = std::chrono::steady_clock::now();
+            decodeSlot(slots_[index], scratch);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            slots_[index].state = State::Decoded;
+            cv_.notify_all();
+        }
+    }
+
+    void decodeSlot(Slot &slot, std::basic_string<CharT> &scratch) const
+    {
+        slot.chars.clear();
+        slot.ends.clear();
+        slot.bytes.clear();
+        uint64_t pending = 0;
+
+        const std::string_view raw(slot.raw);
+        size_t begin = 0;
+        while (begin < raw.size())
+        {
+            size_t end = raw.find('\n', begin);
+            const size_t next = (end == std::string_view::npos) ? raw.size() : end + 1;
+            if (end == std::string_view::npos)
+                end = raw.size();
+            std::string_view line = raw.substr(begin, end - begin);
+            begin = next;
+
+            while (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.empty())
+                continue;
+
+            pending += line.size();
+            if (!decode_(line, scratch))
+                continue;
+            slot.chars.append(scratch);
+            slot.ends.push_back(slot.chars.size());
+            slot.bytes.push_back(pending);
+            pending = 0;
+        }
+        slot.trailingBytes = pending;
+    }
+
+    template <class Sink>
+    void consumeLoop(Sink &sink, Stats &stats)
+    {
+        for (uint64_t seq = 0;; ++seq)
+        {
+            Slot &slot = slots_[seq % slots_.size()];
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]
+                         { return stop_ || slot.state == State::Decoded || (readerDone_ && seq >= published_); });
+                if (stop_ || slot.state != State::Decoded)
+                    return;
+            }
+
+            const auto t0 = std::chrono::steady_clock::now();
+            auto limitReached = [&]
+            { return options_.limit != 0 && stats.wordCount >= options_.limit; };
+            size_t begin = 0;
+            for (size_t i = 0; i < slot.ends.size() && !limitReached(); ++i)
+            {
+                const size_t end = slot.ends[i];
+                stats.wordCount += 1;
+                stats.charCount += static_cast<uint64_t>(end - begin);
+                stats.utf8Bytes += slot.bytes[i];
+                sink(std::basic_string_view<CharT>(slot.chars.data() + begin, end - begin));
+                begin = end;
+            }
+            // 直列版は limit に達した直後の行を読まずに止まるので、その後ろの失敗行は数えない
+            const bool limited = limitReached();
+            if (!limited)
+                stats.utf8Bytes += slot.trailingBytes;
+            stats.secondsSink += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.state = State::Free;
+            cv_.notify_all();
+            if (limited)
+                return;
+        }
+    }
+};
@@ -2,142 +2,36 @@
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <chrono>
 #include <filesystem>
+#include <optional>
 
-#include <zlib.h>
-
-#include "../prefix/prefix_tree.hpp"
 #include "../prefix_with_term_id/prefix_tree_with_term_id.hpp"
 
-#include "../louds/converter.hpp"
 #include "../louds/louds.hpp"
 
 #include "../louds_with_term_id/converter_with_term_id.hpp"
 #include "../louds_with_term_id/louds_with_term_id.hpp"
 
-namespace fs = std::filesystem;
-
-// -----------------------------
-// UTF-8 -> UTF-32 (char32_t) decoder (strict, minimal, no ICU)
-// -----------------------------
-static bool utf8_to_u32(const std::string &s, std::u32string &out)
-{
-    out.clear();
-    out.reserve(s.size());
-
-    const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data());
-    size_t i = 0;
-    const size_t n = s.size();
-
-    while (i < n)
-    {
-        unsigned char c = p[i];
-
-        if (c <= 0x7F)
-        {
-            out.push_back(static_cast<char32_t>(c));
-            i += 1;
-            continue;
-        }
-
-        // Determine length
-        int len = 0;
-        char32_t cp = 0;
-
-        if ((c & 0xE0) == 0xC0)
-        {
-            len = 2;
-            cp = c & 0x1F;
-        }
-        else if ((c & 0xF0) == 0xE0)
-        {
-            len = 3;
-            cp = c & 0x0F;
-        }
-        else if ((c & 0xF8) == 0xF0)
-        {
-            len = 4;
-            cp = c & 0x07;
-        }
-        else
-        {
-            return false;
-        }
-
-        if (i + static_cast<size_t>(len) > n)
-            return false;
-
-        for (int k = 1; k < len; ++k)
-        {
-            unsigned char cc = p[i + static_cast<size_t>(k)];
-            if ((cc & 0xC0) != 0x80)
-                return false;
-            cp = (cp << 6) | (cc & 0x3F);
-        }
-
-        // Reject overlong encodings and invalid ranges
-        if (len == 2 && cp < 0x80)
-            return false;
-        if (len == 3 && cp < 0x800)
-            return false;
-        if (len == 4 && cp < 0x10000)
-            return false;
-
-        // Surrogates are invalid in UTF-8
-        if (cp >= 0xD800 && cp <= 0xDFFF)
-            return false;
-
-        // Max Unicode scalar value
-        if (cp > 0x10FFFF)
-            return false;
-
-        out.push_back(cp);
-        i += static_cast<size_t>(len);
-    }
-    return true;
-}
-
-// -----------------------------
-// gz line reader (handles long lines by accumulating chunks)
-// -----------------------------
-static bool gz_read_line(gzFile f, std::string &line)
-{
-    line.clear();
-    const int BUF = 1 << 15; // 32768
-    char buf[BUF];
-
-    while (true)
-    {
-        char *r = gzgets(f, buf, BUF);
-        if (!r)
-        {
-            // EOF or error
-            if (line.empty())
-                return false;
-            return true;
-        }
+#include "../louds/louds_reader.hpp"
+#include "../louds_with_term_id/louds_with_term_id_reader.hpp"
 
-        line.append(r);
+#include "../common/sorted_louds_builder.hpp"
+#include "../common/utf8.hpp"
+#include "../common/bit_ops.hpp"
+#include "../common/frequency_order.hpp"
 
-        // If newline found, we got a full line
-        if (!line.empty() && line.back() == '\n')
-        {
-            // trim \n and optional \r
-            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
-            {
-                line.pop_back();
-            }
-            return true;
-        }
+#include "gz_line_pipeline.hpp"
+#include "process_memory.hpp"
 
-        // else: buffer filled without newline, continue
-    }
-}
+namespace fs = std::filesystem;
 
 // -----------------------------
 // Simple CLI args
@@ -148,13 +42,19 @@ struct Args
     std::string out_dir = "out";
     std::string prefix = "jawiki_latest";
     uint64_t limit = 0; // 0 = no limit
+    bool with_directory = false; // .bin の末尾に rank/select ディレクトリを付ける
+    bool sorted_input = false;   // 入力が昇順（UTF-8 のバイト順）: PrefixTree を作らず SortedLoudsBuilder で直接書く
+    std::string spill_dir;       // --sorted-input の一時ファイルの置き場所（空なら既定の temp）
+    size_t decode_threads = 0;   // UTF-8 デコードのスレッド数（0 なら hardware_concurrency - 2、最低 1）
+    size_t convert_threads = 0;  // 変換のスレッド数（0 なら hardware_concurrency、1 なら直列の Converter）
+    std::string query_log;       // クエリログ（UTF-8、1 行 1 クエリ）。指定すると兄弟をアクセス数の降順に並べる
 };
 
 static void usage_and_exit(const char *prog)
 {
     std::cerr
         << "Usage:\n"
-        << "  " << prog << " --input <jawiki-*-all-titles-in-ns0.gz> --out-dir <dir> --prefix <name> [--limit N]\n";
+        << "  " << prog << " --input <jawiki-*-all-titles-in-ns0.gz> --out-dir <dir> --prefix <name> [--limit N] [--with-directory] [--sorted-input [--spill-dir <dir>]] [--decode-threads N] [--convert-threads N] [--query-log <file>]\n";
     std::exit(2);
 }
 
@@ -180,6 +80,18 @@ static Args parse_args(int argc, char **argv)
             a.out_dir = need("--out-dir");
         else if (k == "--prefix")
             a.prefix = need("--prefix");
+        else if (k == "--with-directory")
+            a.with_directory = true;
+        else if (k == "--sorted-input")
+            a.sorted_input = true;
+        else if (k == "--spill-dir")
+            a.spill_dir = need("--spill-dir");
+        else if (k == "--decode-threads")
+            a.decode_threads = static_cast<size_t>(std::stoull(need("--decode-threads")));
+        else if (k == "--convert-threads")
+            a.convert_threads = static_cast<size_t>(std::stoull(need("--convert-threads")));
+        else if (k == "--query-log")
+            a.query_log = need("--query-log");
         else if (k == "--limit")
         {
             std::string v = need("--limit");
@@ -193,9 +105,40 @@ static Args parse_args(int argc, char **argv)
     }
     if (a.input_gz.empty())
         usage_and_exit(argv[0]);
+    if (a.sorted_input && !a.query_log.empty())
+    {
+        std::cerr << "--query-log cannot be combined with --sorted-input (the sorted builder writes label order)\n";
+        usage_and_exit(argv[0]);
+    }
     return a;
 }
 
+// -----------------------------
+// Query log -> node weights (--query-log)
+// 1 行 1 クエリ。同じクエリが何度も出ればそのぶん重くなる。不正な UTF-8 の行は飛ばす
+// -----------------------------
+static NodeWeights<PrefixNodeWithTermId> load_query_weights(const std::string &path, const PrefixNodeWithTermId *root, uint64_t &queries)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open query log: " + path);
+
+    NodeWeights<PrefixNodeWithTermId> weights;
+    std::string line;
+    std::basic_string<char32_t> query;
+    queries = 0;
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || !utf8::toUtf32(line, query))
+            continue;
+        weights.addQuery(root, query);
+        ++queries;
+    }
+    return weights;
+}
+
 // -----------------------------
 // Bytes formatter (human readable)
 // -----------------------------
@@ -216,8 +159,41 @@ static std::string format_bytes(uint64_t bytes)
     return oss.str();
 }
 
+static const char *sibling_order_name(louds_image::SiblingOrder order)
+{
+    switch (order)
+    {
+    case louds_image::SiblingOrder::CodeUnitAscending:
+        return "code_unit_ascending";
+    case louds_image::SiblingOrder::CodePointAscending:
+        return "code_point_ascending";
+    case louds_image::SiblingOrder::FrequencyDescending:
+        return "frequency_descending";
+    default:
+        return "unordered";
+    }
+}
+
+// -----------------------------
+// Memory metrics
+// 段ごとのピーク RSS（段の始めに VmHWM を戻して測る）と、辞書のメモリの内訳
+// -----------------------------
+struct MemoryMetrics
+{
+    uint64_t peak_rss_build = 0;
+    uint64_t peak_rss_convert = 0;
+    uint64_t peak_rss_save_louds = 0;
+    uint64_t peak_rss_save_louds_termid = 0;
+    bool peak_rss_reset = true;
+    std::optional<MemoryUsage> louds_termid; // 変換した LOUDSWithTermId（--sorted-input では辞書を組み立てないので無し）
+    MemoryUsage reader_louds;        // 書いた .img を mmap した LOUDSReader
+    MemoryUsage reader_louds_termid; // 書いた .img を mmap した LOUDSWithTermIdReader
+};
+
 // -----------------------------
 // Metrics JSON writer (no external deps)
+// LOUDS / LOUDSWithTermId は 1 本の木・1 回の変換から作るので、build / convert は両方の合計
+// seconds_build は入力段全体の経過時間。inflate / decode / insert は各段の処理時間で、並行に動くので和は build を超えうる
 // -----------------------------
 static void write_metrics_json(
     const fs::path &path,
@@ -226,8 +202,17 @@ static void write_metrics_json(
     uint64_t input_gz_bytes,
     uint64_t input_utf8_bytes_total,
     double seconds_total,
-    double seconds_convert_louds,
-    double seconds_convert_louds_termid)
+    double seconds_build,
+    double seconds_inflate,
+    double seconds_decode,
+    double seconds_insert,
+    size_t decode_threads,
+    double seconds_convert,
+    size_t convert_threads,
+    louds_image::SiblingOrder sibling_order,
+    double seconds_save_louds,
+    double seconds_save_louds_termid,
+    const MemoryMetrics &memory)
 {
     std::ofstream ofs(path);
     if (!ofs)
@@ -241,8 +226,34 @@ static void write_metrics_json(
     ofs << "  \"input_gz_bytes\": " << input_gz_bytes << ",\n";
     ofs << "  \"input_utf8_bytes_total\": " << input_utf8_bytes_total << ",\n";
     ofs << "  \"seconds_total\": " << seconds_total << ",\n";
-    ofs << "  \"seconds_convert_louds\": " << seconds_convert_louds << ",\n";
-    ofs << "  \"seconds_convert_louds_with_term_id\": " << seconds_convert_louds_termid << "\n";
+    ofs << "  \"seconds_build\": " << seconds_build << ",\n";
+    ofs << "  \"seconds_inflate\": " << seconds_inflate << ",\n";
+    ofs << "  \"seconds_decode\": " << seconds_decode << ",\n";
+    ofs << "  \"seconds_insert\": " << seconds_insert << ",\n";
+    ofs << "  \"decode_threads\": " << decode_threads << ",\n";
+    ofs << "  \"utf8_kernel\": \"" << utf8::kernelName(utf8::activeKernel()) << "\",\n";
+    ofs << "  \"rank_select_kernel\": \"" << bit_ops::kernelName(bit_ops::activeKernel()) << "\",\n";
+    ofs << "  \"seconds_convert\": " << seconds_convert << ",\n";
+    ofs << "  \"convert_threads\": " << convert_threads << ",\n";
+    ofs << "  \"sibling_order\": \"" << sibling_order_name(sibling_order) << "\",\n";
+    ofs << "  \"seconds_save_louds\": " << seconds_save_louds << ",\n";
+    ofs << "  \"seconds_save_louds_with_term_id\": " << seconds_save_louds_termid << ",\n";
+    ofs << "  \"peak_rss_bytes\": {\"build\": " << memory.peak_rss_build
+        << ", \"convert\": " << memory.peak_rss_convert
+        << ", \"save_louds\": " << memory.peak_rss_save_louds
+        << ", \"save_louds_with_term_id\": " << memory.peak_rss_save_louds_termid << "},\n";
+    ofs << "  \"peak_rss_reset\": " << (memory.peak_rss_reset ? "true" : "false") << ",\n";
+    ofs << "  \"memory_usage\": {\n";
+    ofs << "    \"louds_with_term_id\": ";
+    if (memory.louds_termid)
+        process_memory::writeJson(ofs, *memory.louds_termid);
+    else
+        ofs << "null";
+    ofs << ",\n    \"louds_reader_image\": ";
+    process_memory::writeJson(ofs, memory.reader_louds);
+    ofs << ",\n    \"louds_with_term_id_reader_image\": ";
+    process_memory::writeJson(ofs, memory.reader_louds_termid);
+    ofs << "\n  }\n";
     ofs << "}\n";
 }
 
@@ -257,10 +268,17 @@ int main(int argc, char **argv)
         const fs::path out_dir(args.out_dir);
         const fs::path out_louds = out_dir / (args.prefix + ".louds.bin");
         const fs::path out_louds_termid = out_dir / (args.prefix + ".louds_termid.bin");
+        const fs::path out_louds_img = out_dir / (args.prefix + ".louds.img");
+        const fs::path out_louds_termid_img = out_dir / (args.prefix + ".louds_termid.img");
         const fs::path out_metrics = out_dir / "metrics.json";
 
         auto t_begin = std::chrono::steady_clock::now();
 
+        // 段ごとのピーク RSS（入力段 / 変換 / LOUDS の保存 / LOUDSWithTermId の保存）
+        MemoryMetrics memory;
+        process_memory::StagePeak stage;
+        stage.begin();
+
         // Input gzip file size (compressed size)
         uint64_t input_gz_bytes = 0;
         try
@@ -272,74 +290,121 @@ int main(int argc, char **argv)
             input_gz_bytes = 0;
         }
 
-        // 1) Read titles and build tries
-        PrefixTree trie;
-        PrefixTreeWithTermId trie_termid;
-
-        uint64_t word_count = 0;
-        uint64_t char_count = 0;
-
+        // 1) Read titles and build one trie (or feed the sorted builder)
+        //    LOUDS と LOUDSWithTermId は形が同じなので、termId 付きの木 1 本から両方を書く
+        // --sorted-input では木を作らない（SortedLoudsBuilder だけを使う）
+        std::optional<PrefixTreeWithTermId> trie;
+        if (!args.sorted_input)
+            trie.emplace();
+
+        SortedLoudsBuilder<char32_t>::Options sorted_options;
+        sorted_options.order = SortedLoudsBuilder<char32_t>::KeyOrder::CodePoint;
+        sorted_options.tempDir = args.spill_dir;
+        SortedLoudsBuilder<char32_t> sorted_builder(sorted_options);
+
+        // 展開・デコード・挿入を別スレッドで重ねる（挿入は入力順なので termId は直列版と同じ）
+        GzLinePipeline<char32_t>::Options pipeline_options;
+        pipeline_options.decoderThreads = args.decode_threads;
+        pipeline_options.limit = args.limit;
+        GzLinePipeline<char32_t> pipeline(args.input_gz, utf8::toUtf32, pipeline_options);
+
+        const auto ingest = pipeline.run([&](std::u32string_view word)
+                                         {
+                                             if (args.sorted_input)
+                                                 sorted_builder.add(word);
+                                             else
+                                                 trie->insert(word); });
+
+        const uint64_t word_count = ingest.wordCount;
+        const uint64_t char_count = ingest.charCount;
         // Total UTF-8 bytes read (approx. uncompressed bytes without newline)
-        uint64_t input_utf8_bytes_total = 0;
-
-        gzFile f = gzopen(args.input_gz.c_str(), "rb");
-        if (!f)
+        const uint64_t input_utf8_bytes_total = ingest.utf8Bytes;
+        memory.peak_rss_build = stage.end();
+        stage.begin();
+
+        auto t_built = std::chrono::steady_clock::now();
+        double seconds_build = std::chrono::duration<double>(t_built - t_begin).count();
+        double seconds_convert = 0.0;
+        size_t convert_threads = 0;
+        uint64_t query_log_queries = 0;
+        louds_image::SiblingOrder sibling_order = louds_image::SiblingOrder::Unordered;
+        double seconds_save_louds = 0.0;
+        double seconds_save_termid = 0.0;
+        if (args.sorted_input)
         {
-            std::cerr << "Failed to open gz: " << args.input_gz << "\n";
-            return 1;
+            // 2) Close the per-level buffers (no pointer trie)
+            sorted_builder.close();
+            sibling_order = sorted_builder.siblingOrder();
+            auto t1 = std::chrono::steady_clock::now();
+            seconds_convert = std::chrono::duration<double>(t1 - t_built).count();
+            memory.peak_rss_convert = stage.end();
+            stage.begin();
+
+            // 3) Stream .bin / directories / images straight from the spill files (never load the dictionary)
+            sorted_builder.writeLoudsFile(out_louds.string(), args.with_directory);
+            sorted_builder.writeLoudsImageFile(out_louds_img.string());
+            auto t2 = std::chrono::steady_clock::now();
+            seconds_save_louds = std::chrono::duration<double>(t2 - t1).count();
+            memory.peak_rss_save_louds = stage.end();
+            stage.begin();
+
+            sorted_builder.writeLoudsWithTermIdFile(out_louds_termid.string(), args.with_directory);
+            sorted_builder.writeLoudsWithTermIdImageFile(out_louds_termid_img.string());
+            auto t3 = std::chrono::steady_clock::now();
+            seconds_save_termid = std::chrono::duration<double>(t3 - t2).count();
+            memory.peak_rss_save_louds_termid = stage.end();
         }
-
-        std::string line;
-        std::u32string u32;
-        while (gz_read_line(f, line))
+        else
         {
-            if (args.limit != 0 && word_count >= args.limit)
-                break;
-            if (line.empty())
-                continue;
-
-            // Accumulate bytes (line already trimmed of \n/\r in gz_read_line)
-            input_utf8_bytes_total += static_cast<uint64_t>(line.size());
-            // If you want to estimate including newline, you can add:
-            // input_utf8_bytes_total += 1;
-
-            if (!utf8_to_u32(line, u32))
+            // 2) Convert once -> LOUDSWithTermId (LBS / isLeaf / labels are shared with LOUDS)
+            ConverterWithTermId conv;
+            LOUDSWithTermId louds_termid;
+            if (!args.query_log.empty())
             {
-                // If decoding fails, skip this line but keep moving
-                continue;
+                // 兄弟をクエリログのアクセス数の降順に並べる（直列の Converter。重みの集計も変換時間に含める）
+                const auto weights = load_query_weights(args.query_log, trie->getRoot(), query_log_queries);
+                louds_termid = conv.convertByFrequency(trie->getRoot(), weights);
+                convert_threads = 1;
             }
-
-            // Count
-            word_count += 1;
-            char_count += static_cast<uint64_t>(u32.size());
-
-            // Insert to both tries
-            trie.insert(u32);
-            trie_termid.insert(u32);
+            else
+            {
+                louds_termid = args.convert_threads == 1
+                                   ? conv.convert(trie->getRoot())
+                                   : conv.convertParallel(trie->getRoot(), args.convert_threads);
+                convert_threads = (args.convert_threads != 0) ? args.convert_threads
+                                                              : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            }
+            sibling_order = louds_termid.siblingOrder;
+            auto t1 = std::chrono::steady_clock::now();
+            seconds_convert = std::chrono::duration<double>(t1 - t_built).count();
+            memory.peak_rss_convert = stage.end();
+            stage.begin();
+
+            // 3) Save both dictionaries from the same columns
+            louds_termid.saveLoudsToFile(out_louds.string(), args.with_directory);
+            louds_termid.saveLoudsToImageFile(out_louds_img.string());
+            auto t2 = std::chrono::steady_clock::now();
+            seconds_save_louds = std::chrono::duration<double>(t2 - t1).count();
+            memory.peak_rss_save_louds = stage.end();
+            stage.begin();
+
+            louds_termid.saveToFile(out_louds_termid.string(), args.with_directory);
+            louds_termid.saveToImageFile(out_louds_termid_img.string());
+            auto t3 = std::chrono::steady_clock::now();
+            seconds_save_termid = std::chrono::duration<double>(t3 - t2).count();
+            memory.peak_rss_save_louds_termid = stage.end();
+            memory.louds_termid = louds_termid.memoryUsage();
         }
-        gzclose(f);
-
-        // 2) Convert -> LOUDS
-        Converter conv;
-        auto t1 = std::chrono::steady_clock::now();
-        LOUDS louds = conv.convert(trie.getRoot());
-        auto t2 = std::chrono::steady_clock::now();
-        double seconds_convert_louds = std::chrono::duration<double>(t2 - t1).count();
-
-        // 3) Convert -> LOUDSWithTermId
-        ConverterWithTermId conv_termid;
-        auto t3 = std::chrono::steady_clock::now();
-        LOUDSWithTermId louds_termid = conv_termid.convert(trie_termid.getRoot());
-        auto t4 = std::chrono::steady_clock::now();
-        double seconds_convert_termid = std::chrono::duration<double>(t4 - t3).count();
-
-        // 4) Save
-        louds.saveToFile(out_louds.string());
-        louds_termid.saveToFile(out_louds_termid.string());
 
         auto t_end = std::chrono::steady_clock::now();
         double seconds_total = std::chrono::duration<double>(t_end - t_begin).count();
 
+        // 4) Memory usage as the readers see it (mmap the images we just wrote; no copy, no rebuild)
+        //    total は .bin を loadFromFile したときのヒープとほぼ同じ
+        memory.reader_louds = LOUDSReader::mapFromImageFile(out_louds_img.string()).memoryUsage();
+        memory.reader_louds_termid = LOUDSWithTermIdReader::mapFromImageFile(out_louds_termid_img.string()).memoryUsage();
+        memory.peak_rss_reset = stage.resettable();
+
         // 5) Write metrics
         write_metrics_json(
             out_metrics,
@@ -348,8 +413,17 @@ int main(int argc, char **argv)
             input_gz_bytes,
             input_utf8_bytes_total,
             seconds_total,
-            seconds_convert_louds,
-            seconds_convert_termid);
+            seconds_build,
+            ingest.secondsInflate,
+            ingest.secondsDecode,
+            ingest.secondsSink,
+            pipeline.decoderThreads(),
+            seconds_convert,
+            convert_threads,
+            sibling_order,
+            seconds_save_louds,
+            seconds_save_termid,
+            memory);
 
         // Console summary (Actions log)
         std::cout << "input_gz_bytes=" << input_gz_bytes;
@@ -365,10 +439,26 @@ int main(int argc, char **argv)
         std::cout << "word_count=" << word_count << "\n";
         std::cout << "char_count=" << char_count << "\n";
         std::cout << "seconds_total=" << seconds_total << "\n";
-        std::cout << "seconds_convert_louds=" << seconds_convert_louds << "\n";
-        std::cout << "seconds_convert_louds_with_term_id=" << seconds_convert_termid << "\n";
+        std::cout << "seconds_build=" << seconds_build << "\n";
+        std::cout << "seconds_inflate=" << ingest.secondsInflate << "\n";
+        std::cout << "seconds_decode=" << ingest.secondsDecode << " (" << pipeline.decoderThreads() << " threads, utf8 kernel " << utf8::kernelName(utf8::activeKernel()) << ")\n";
+        std::cout << "seconds_insert=" << ingest.secondsSink << "\n";
+        std::cout << "seconds_convert=" << seconds_convert << " (" << convert_threads << " threads)\n";
+        std::cout << "sibling_order=" << sibling_order_name(sibling_order);
+        if (!args.query_log.empty())
+            std::cout << " (" << query_log_queries << " queries from " << args.query_log << ")";
+        std::cout << "\n";
+        std::cout << "seconds_save_louds=" << seconds_save_louds << "\n";
+        std::cout << "seconds_save_louds_with_term_id=" << seconds_save_termid << "\n";
+        std::cout << "peak_rss_bytes build=" << memory.peak_rss_build << " convert=" << memory.peak_rss_convert
+                  << " save_louds=" << memory.peak_rss_save_louds << " save_louds_with_term_id=" << memory.peak_rss_save_louds_termid
+                  << (memory.peak_rss_reset ? "" : " (not reset per stage)") << "\n";
+        std::cout << "memory_louds_reader=" << memory.reader_louds.total() << " (" << format_bytes(memory.reader_louds.total()) << ")\n";
+        std::cout << "memory_louds_with_term_id_reader=" << memory.reader_louds_termid.total() << " (" << format_bytes(memory.reader_louds_termid.total()) << ")\n";
         std::cout << "out_louds=" << out_louds.string() << "\n";
         std::cout << "out_louds_termid=" << out_louds_termid.string() << "\n";
+        std::cout << "out_louds_img=" << out_louds_img.string() << "\n";
+        std::cout << "out_louds_termid_img=" << out_louds_termid_img.string() << "\n";
         std::cout << "out_metrics=" << out_metrics.string() << "\n";
 
         return 0;
@@ -2,162 +2,37 @@
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <chrono>
 #include <filesystem>
-
-#include <zlib.h>
+#include <optional>
 
 // UTF-16版（あなたの実装に合わせてパス/名前は調整してください）
-#include "../prefix/prefix_tree_utf16.hpp"
 #include "../prefix_with_term_id/prefix_tree_with_term_id_utf16.hpp"
 
-#include "../louds/louds_converter_utf16.hpp"
 #include "../louds/louds_utf16_writer.hpp"
 
 #include "../louds_with_term_id/converter_with_term_id_utf16.hpp"
 #include "../louds_with_term_id/louds_with_term_id_utf16_writer.hpp"
 
-namespace fs = std::filesystem;
-
-// -----------------------------
-// UTF-8 -> UTF-16 (strict, minimal, no ICU)
-// - validates UTF-8
-// - rejects surrogates
-// - converts scalar values > 0xFFFF into surrogate pairs
-// -----------------------------
-static bool utf8_to_u16(const std::string &s, std::u16string &out)
-{
-    out.clear();
-    out.reserve(s.size()); // rough
-
-    const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data());
-    size_t i = 0;
-    const size_t n = s.size();
-
-    while (i < n)
-    {
-        unsigned char c = p[i];
-
-        // ASCII
-        if (c <= 0x7F)
-        {
-            out.push_back(static_cast<char16_t>(c));
-            i += 1;
-            continue;
-        }
-
-        // Determine length and initial bits
-        int len = 0;
-        char32_t cp = 0;
-
-        if ((c & 0xE0) == 0xC0)
-        {
-            len = 2;
-            cp = static_cast<char32_t>(c & 0x1F);
-        }
-        else if ((c & 0xF0) == 0xE0)
-        {
-            len = 3;
-            cp = static_cast<char32_t>(c & 0x0F);
-        }
-        else if ((c & 0xF8) == 0xF0)
-        {
-            len = 4;
-            cp = static_cast<char32_t>(c & 0x07);
-        }
-        else
-        {
-            return false;
-        }
-
-        if (i + static_cast<size_t>(len) > n)
-            return false;
-
-        for (int k = 1; k < len; ++k)
-        {
-            unsigned char cc = p[i + static_cast<size_t>(k)];
-            if ((cc & 0xC0) != 0x80)
-                return false;
-            cp = (cp << 6) | static_cast<char32_t>(cc & 0x3F);
-        }
-
-        // Reject overlong encodings
-        if (len == 2 && cp < 0x80)
-            return false;
-        if (len == 3 && cp < 0x800)
-            return false;
-        if (len == 4 && cp < 0x10000)
-            return false;
-
-        // Surrogates are invalid as scalar values
-        if (cp >= 0xD800 && cp <= 0xDFFF)
-            return false;
-
-        // Max Unicode scalar value
-        if (cp > 0x10FFFF)
-            return false;
-
-        // Encode to UTF-16
-        if (cp <= 0xFFFF)
-        {
-            out.push_back(static_cast<char16_t>(cp));
-        }
-        else
-        {
-            // surrogate pair
-            cp -= 0x10000;
-            char16_t hi = static_cast<char16_t>(0xD800 + ((cp >> 10) & 0x3FF));
-            char16_t lo = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
-            out.push_back(hi);
-            out.push_back(lo);
-        }
-
-        i += static_cast<size_t>(len);
-    }
-
-    return true;
-}
-
-// -----------------------------
-// gz line reader (handles long lines by accumulating chunks)
-// -----------------------------
-static bool gz_read_line(gzFile f, std::string &line)
-{
-    line.clear();
-    const int BUF = 1 << 15; // 32768
-    char buf[BUF];
-
-    while (true)
-    {
-        char *r = gzgets(f, buf, BUF);
-        if (!r)
-        {
-            // EOF or error
-            if (line.empty())
-                return false;
-            return true;
-        }
+#include "../louds/louds_utf16_reader.hpp"
+#include "../louds_with_term_id/louds_with_term_id_utf16_reader.hpp"
 
-        line.append(r);
+#include "../common/sorted_louds_builder.hpp"
+#include "../common/utf8.hpp"
+#include "../common/bit_ops.hpp"
+#include "../common/frequency_order.hpp"
 
-        // If newline found, we got a full line
-        if (!line.empty() && line.back() == '\n')
-        {
-            // trim \n and optional \r
-            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
-            {
-                line.pop_back();
-            }
-            return true;
-        }
+#include "gz_line_pipeline.hpp"
+#include "process_memory.hpp"
 
-        // else: buffer filled without newline, continue
-    }
-}
+namespace fs = std::filesystem;
 
 // -----------------------------
 // Simple CLI args
@@ -168,13 +43,19 @@ struct Args
     std::string out_dir = "out";
     std::string prefix = "jawiki_latest_utf16";
     uint64_t limit = 0; // 0 = no limit
+    bool with_directory = false; // .bin の末尾に rank/select ディレクトリを付ける
+    bool sorted_input = false;   // 入力が昇順（UTF-8 のバイト順）: PrefixTree を作らず SortedLoudsBuilder で直接書く
+    std::string spill_dir;       // --sorted-input の一時ファイルの置き場所（空なら既定の temp）
+    size_t decode_threads = 0;   // UTF-8 デコードのスレッド数（0 なら hardware_concurrency - 2、最低 1）
+    size_t convert_threads = 0;  // 変換のスレッド数（0 なら hardware_concurrency、1 なら直列の Converter）
+    std::string query_log;       // クエリログ（UTF-8、1 行 1 クエリ）。指定すると兄弟をアクセス数の降順に並べる
 };
 
 static void usage_and_exit(const char *prog)
 {
     std::cerr
         << "Usage:\n"
-        << "  " << prog << " --input <jawiki-*-all-titles-in-ns0.gz> --out-dir <dir> --prefix <name> [--limit N]\n";
+        << "  " << prog << " --input <jawiki-*-all-titles-in-ns0.gz> --out-dir <dir> --prefix <name> [--limit N] [--with-directory] [--sorted-input [--spill-dir <dir>]] [--decode-threads N] [--convert-threads N] [--query-log <file>]\n";
     std::exit(2);
 }
 
@@ -200,6 +81,18 @@ static Args parse_args(int argc, char **argv)
             a.out_dir = need("--out-dir");
         else if (k == "--prefix")
             a.prefix = need("--prefix");
+        else if (k == "--with-directory")
+            a.with_directory = true;
+        else if (k == "--sorted-input")
+            a.sorted_input = true;
+        else if (k == "--spill-dir")
+            a.spill_dir = need("--spill-dir");
+        else if (k == "--decode-threads")
+            a.decode_threads = static_cast<size_t>(std::stoull(need("--decode-threads")));
+        else if (k == "--convert-threads")
+            a.convert_threads = static_cast<size_t>(std::stoull(need("--convert-threads")));
+        else if (k == "--query-log")
+            a.query_log = need("--query-log");
         else if (k == "--limit")
         {
             std::string v = need("--limit");
@@ -213,9 +106,40 @@ static Args parse_args(int argc, char **argv)
     }
     if (a.input_gz.empty())
         usage_and_exit(argv[0]);
+    if (a.sorted_input && !a.query_log.empty())
+    {
+        std::cerr << "--query-log cannot be combined with --sorted-input (the sorted builder writes label order)\n";
+        usage_and_exit(argv[0]);
+    }
     return a;
 }
 
+// -----------------------------
+// Query log -> node weights (--query-log)
+// 1 行 1 クエリ。同じクエリが何度も出ればそのぶん重くなる。不正な UTF-8 の行は飛ばす
+// -----------------------------
+static NodeWeights<PrefixNodeWithTermIdUtf16> load_query_weights(const std::string &path, const PrefixNodeWithTermIdUtf16 *root, uint64_t &queries)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open query log: " + path);
+
+    NodeWeights<PrefixNodeWithTermIdUtf16> weights;
+    std::string line;
+    std::basic_string<char16_t> query;
+    queries = 0;
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || !utf8::toUtf16(line, query))
+            continue;
+        weights.addQuery(root, query);
+        ++queries;
+    }
+    return weights;
+}
+
 // -----------------------------
 // Bytes formatter (human readable)
 // -----------------------------
@@ -236,9 +160,41 @@ static std::string format_bytes(uint64_t bytes)
     return oss.str();
 }
 
+static const char *sibling_order_name(louds_image::SiblingOrder order)
+{
+    switch (order)
+    {
+    case louds_image::SiblingOrder::CodeUnitAscending:
+        return "code_unit_ascending";
+    case louds_image::SiblingOrder::CodePointAscending:
+        return "code_point_ascending";
+    case louds_image::SiblingOrder::FrequencyDescending:
+        return "frequency_descending";
+    default:
+        return "unordered";
+    }
+}
+
+// -----------------------------
+// Memory metrics
+// 段ごとのピーク RSS（段の始めに VmHWM を戻して測る）と、辞書のメモリの内訳
+// -----------------------------
+struct MemoryMetrics
+{
+    uint64_t peak_rss_build = 0;
+    uint64_t peak_rss_convert = 0;
+    uint64_t peak_rss_save_louds = 0;
+    uint64_t peak_rss_save_louds_termid = 0;
+    bool peak_rss_reset = true;
+    std::optional<MemoryUsage> louds_termid; // 変換した LOUDSWithTermIdUtf16（--sorted-input では辞書を組み立てないので無し）
+    MemoryUsage reader_louds;        // 書いた .img を mmap した LOUDSReaderUtf16
+    MemoryUsage reader_louds_termid; // 書いた .img を mmap した LOUDSWithTermIdUtf16Reader
+};
+
 // -----------------------------
 // Metrics JSON writer (no external deps)
 // 注意: char_count は UTF-16 の code unit 数（サロゲートペアは2）
+// LOUDS / LOUDSWithTermId は 1 本の木・1 回の変換から作るので、build / convert は両方の合計
 // -----------------------------
 static void write_metrics_json(
     const fs::path &path,
@@ -250,24 +206,27 @@ static void write_metrics_json(
     // Overall wall clock time of the whole program
     double seconds_total_all,
 
-    // Shared (IO + UTF-8 decode to UTF-16) time
-    double seconds_io_decode,
+    // Ingest stage (gzip inflate -> UTF-8 decode -> insert, pipelined)
+    // seconds_ingest is wall clock; the others are per-stage busy time and overlap
+    double seconds_ingest,
+    double seconds_inflate,
+    double seconds_decode, // summed over decoder threads
+    size_t decode_threads,
 
-    // PrefixTree build times (insert only, separated)
+    // PrefixTree build time (insert only; one trie for both outputs)
     double seconds_build_prefix_tree,
-    double seconds_build_prefix_tree_with_term_id,
 
-    // Convert times
-    double seconds_convert_louds,
-    double seconds_convert_louds_with_term_id,
+    // Convert time (one pass for both outputs)
+    double seconds_convert,
+    size_t convert_threads,
+    louds_image::SiblingOrder sibling_order,
 
     // Save times
     double seconds_save_louds,
     double seconds_save_louds_with_term_id,
 
-    // Totals per output
-    double seconds_total_louds,
-    double seconds_total_louds_with_term_id)
+    // Peak RSS per stage and memory usage of the dictionaries
+    const MemoryMetrics &memory)
 {
     std::ofstream ofs(path);
     if (!ofs)
@@ -282,19 +241,36 @@ static void write_metrics_json(
     ofs << "  \"input_utf8_bytes_total\": " << input_utf8_bytes_total << ",\n";
 
     ofs << "  \"seconds_total_all\": " << seconds_total_all << ",\n";
-    ofs << "  \"seconds_io_decode\": " << seconds_io_decode << ",\n";
+    ofs << "  \"seconds_ingest\": " << seconds_ingest << ",\n";
+    ofs << "  \"seconds_inflate\": " << seconds_inflate << ",\n";
+    ofs << "  \"seconds_decode\": " << seconds_decode << ",\n";
+    ofs << "  \"decode_threads\": " << decode_threads << ",\n";
+    ofs << "  \"utf8_kernel\": \"" << utf8::kernelName(utf8::activeKernel()) << "\",\n";
+    ofs << "  \"rank_select_kernel\": \"" << bit_ops::kernelName(bit_ops::activeKernel()) << "\",\n";
 
     ofs << "  \"seconds_build_prefix_tree\": " << seconds_build_prefix_tree << ",\n";
-    ofs << "  \"seconds_build_prefix_tree_with_term_id\": " << seconds_build_prefix_tree_with_term_id << ",\n";
-
-    ofs << "  \"seconds_convert_louds\": " << seconds_convert_louds << ",\n";
-    ofs << "  \"seconds_convert_louds_with_term_id\": " << seconds_convert_louds_with_term_id << ",\n";
+    ofs << "  \"seconds_convert\": " << seconds_convert << ",\n";
+    ofs << "  \"convert_threads\": " << convert_threads << ",\n";
+    ofs << "  \"sibling_order\": \"" << sibling_order_name(sibling_order) << "\",\n";
 
     ofs << "  \"seconds_save_louds\": " << seconds_save_louds << ",\n";
     ofs << "  \"seconds_save_louds_with_term_id\": " << seconds_save_louds_with_term_id << ",\n";
-
-    ofs << "  \"seconds_total_louds\": " << seconds_total_louds << ",\n";
-    ofs << "  \"seconds_total_louds_with_term_id\": " << seconds_total_louds_with_term_id << "\n";
+    ofs << "  \"peak_rss_bytes\": {\"build\": " << memory.peak_rss_build
+        << ", \"convert\": " << memory.peak_rss_convert
+        << ", \"save_louds\": " << memory.peak_rss_save_louds
+        << ", \"save_louds_with_term_id\": " << memory.peak_rss_save_louds_termid << "},\n";
+    ofs << "  \"peak_rss_reset\": " << (memory.peak_rss_reset ? "true" : "false") << ",\n";
+    ofs << "  \"memory_usage\": {\n";
+    ofs << "    \"louds_with_term_id\": ";
+    if (memory.louds_termid)
+        process_memory::writeJson(ofs, *memory.louds_termid);
+    else
+        ofs << "null";
+    ofs << ",\n    \"louds_reader_image\": ";
+    process_memory::writeJson(ofs, memory.reader_louds);
+    ofs << ",\n    \"louds_with_term_id_reader_image\": ";
+    process_memory::writeJson(ofs, memory.reader_louds_termid);
+    ofs << "\n  }\n";
     ofs << "}\n";
 }
 
@@ -309,10 +285,17 @@ int main(int argc, char **argv)
         const fs::path out_dir(args.out_dir);
         const fs::path out_louds = out_dir / (args.prefix + ".louds_utf16.bin");
         const fs::path out_louds_termid = out_dir / (args.prefix + ".louds_termid_utf16.bin");
+        const fs::path out_louds_img = out_dir / (args.prefix + ".louds_utf16.img");
+        const fs::path out_louds_termid_img = out_dir / (args.prefix + ".louds_termid_utf16.img");
         const fs::path out_metrics = out_dir / "metrics.json";
 
         auto t_begin = std::chrono::steady_clock::now();
 
+        // 段ごとのピーク RSS（入力段 / 変換 / LOUDS の保存 / LOUDSWithTermId の保存）
+        MemoryMetrics memory;
+        process_memory::StagePeak stage;
+        stage.begin();
+
         // Input gzip file size (compressed size)
         uint64_t input_gz_bytes = 0;
         try
@@ -324,129 +307,123 @@ int main(int argc, char **argv)
             input_gz_bytes = 0;
         }
 
-        // 1) Read titles and build tries (UTF-16)
-        PrefixTreeUtf16 trie;
-        PrefixTreeWithTermIdUtf16 trie_termid;
-
-        uint64_t word_count = 0;
-        uint64_t char_count = 0;
-
+        // 1) Read titles and build one trie (UTF-16)
+        //    LOUDS と LOUDSWithTermId は形が同じなので、termId 付きの木 1 本から両方を書く
+        // --sorted-input では木を作らない（SortedLoudsBuilder だけを使う）
+        std::optional<PrefixTreeWithTermIdUtf16> trie;
+        if (!args.sorted_input)
+            trie.emplace();
+
+        // --sorted-input: UTF-8 のバイト順 = code point 順。UTF-16 ではサロゲートの位置が code unit 順と違うので
+        // CodePointAscending として記録する
+        SortedLoudsBuilder<char16_t>::Options sorted_options;
+        sorted_options.order = SortedLoudsBuilder<char16_t>::KeyOrder::CodePoint;
+        sorted_options.tempDir = args.spill_dir;
+        SortedLoudsBuilder<char16_t> sorted_builder(sorted_options);
+
+        // 展開・デコード・挿入を別スレッドで重ねる（挿入は入力順なので termId は直列版と同じ）
+        GzLinePipeline<char16_t>::Options pipeline_options;
+        pipeline_options.decoderThreads = args.decode_threads;
+        pipeline_options.limit = args.limit;
+        GzLinePipeline<char16_t> pipeline(args.input_gz, utf8::toUtf16, pipeline_options);
+
+        // 1 回の add / insert で LOUDS / LOUDSWithTermId の両方の材料になる
+        const auto ingest = pipeline.run([&](std::u16string_view word)
+                                         {
+                                             if (args.sorted_input)
+                                                 sorted_builder.add(word);
+                                             else
+                                                 trie->insert(word); });
+
+        const uint64_t word_count = ingest.wordCount;
+        const uint64_t char_count = ingest.charCount; // UTF-16 code units
         // Total UTF-8 bytes read (approx. uncompressed bytes without newline)
-        uint64_t input_utf8_bytes_total = 0;
-
-        // Timers
-        double seconds_io_decode = 0.0;
-        double seconds_build_prefix_tree = 0.0;
-        double seconds_build_prefix_tree_with_term_id = 0.0;
-
-        gzFile f = gzopen(args.input_gz.c_str(), "rb");
-        if (!f)
+        const uint64_t input_utf8_bytes_total = ingest.utf8Bytes;
+        memory.peak_rss_build = stage.end();
+        stage.begin();
+
+        double seconds_convert = 0.0;
+        size_t convert_threads = 0;
+        uint64_t query_log_queries = 0;
+        louds_image::SiblingOrder sibling_order = louds_image::SiblingOrder::Unordered;
+        double seconds_save_louds = 0.0;
+        double seconds_save_termid = 0.0;
+        if (args.sorted_input)
         {
-            std::cerr << "Failed to open gz: " << args.input_gz << "\n";
-            return 1;
+            // 2) Close the per-level buffers (no pointer trie)
+            auto t1 = std::chrono::steady_clock::now();
+            sorted_builder.close();
+            sibling_order = sorted_builder.siblingOrder();
+            auto t2 = std::chrono::steady_clock::now();
+            seconds_convert = std::chrono::duration<double>(t2 - t1).count();
+            memory.peak_rss_convert = stage.end();
+            stage.begin();
+
+            // 3) Stream .bin / directories / images straight from the spill files (never load the dictionary)
+            sorted_builder.writeLoudsFile(out_louds.string(), args.with_directory);
+            sorted_builder.writeLoudsImageFile(out_louds_img.string());
+            auto t3 = std::chrono::steady_clock::now();
+            seconds_save_louds = std::chrono::duration<double>(t3 - t2).count();
+            memory.peak_rss_save_louds = stage.end();
+            stage.begin();
+
+            sorted_builder.writeLoudsWithTermIdFile(out_louds_termid.string(), args.with_directory);
+            sorted_builder.writeLoudsWithTermIdImageFile(out_louds_termid_img.string());
+            auto t4 = std::chrono::steady_clock::now();
+            seconds_save_termid = std::chrono::duration<double>(t4 - t3).count();
+            memory.peak_rss_save_louds_termid = stage.end();
         }
-
-        std::string line;
-        std::u16string u16;
-
-        while (true)
+        else
         {
-            auto t_io_begin = std::chrono::steady_clock::now();
-            bool ok = gz_read_line(f, line);
-            auto t_io_end = std::chrono::steady_clock::now();
-
-            if (!ok)
-            {
-                seconds_io_decode += std::chrono::duration<double>(t_io_end - t_io_begin).count();
-                break;
-            }
-
-            if (args.limit != 0 && word_count >= args.limit)
+            // 2) Convert once -> LOUDSWithTermId (UTF-16). LBS / isLeaf / labels are shared with LOUDS
+            ConverterWithTermIdUtf16 conv;
+            auto t1 = std::chrono::steady_clock::now();
+            LOUDSWithTermIdUtf16 louds_termid;
+            if (!args.query_log.empty())
             {
-                seconds_io_decode += std::chrono::duration<double>(t_io_end - t_io_begin).count();
-                break;
+                // 兄弟をクエリログのアクセス数の降順に並べる（直列の Converter。重みの集計も変換時間に含める）
+                const auto weights = load_query_weights(args.query_log, trie->getRoot(), query_log_queries);
+                louds_termid = conv.convertByFrequency(trie->getRoot(), weights);
+                convert_threads = 1;
             }
-
-            if (line.empty())
+            else
             {
-                seconds_io_decode += std::chrono::duration<double>(t_io_end - t_io_begin).count();
-                continue;
-            }
-
-            input_utf8_bytes_total += static_cast<uint64_t>(line.size());
-
-            // include decode time in io_decode bucket
-            bool decoded = utf8_to_u16(line, u16);
-            auto t_decode_end = std::chrono::steady_clock::now();
-            seconds_io_decode += std::chrono::duration<double>(t_decode_end - t_io_begin).count();
-
-            if (!decoded)
-            {
-                // If decoding fails, skip this line but keep moving
-                continue;
-            }
-
-            word_count += 1;
-            char_count += static_cast<uint64_t>(u16.size()); // UTF-16 code units
-
-            // measure inserts separately
-            {
-                auto t_ins1_begin = std::chrono::steady_clock::now();
-                trie.insert(u16);
-                auto t_ins1_end = std::chrono::steady_clock::now();
-                seconds_build_prefix_tree += std::chrono::duration<double>(t_ins1_end - t_ins1_begin).count();
-            }
-
-            {
-                auto t_ins2_begin = std::chrono::steady_clock::now();
-                trie_termid.insert(u16);
-                auto t_ins2_end = std::chrono::steady_clock::now();
-                seconds_build_prefix_tree_with_term_id += std::chrono::duration<double>(t_ins2_end - t_ins2_begin).count();
+                louds_termid = args.convert_threads == 1
+                                   ? conv.convert(trie->getRoot())
+                                   : conv.convertParallel(trie->getRoot(), args.convert_threads);
+                convert_threads = (args.convert_threads != 0) ? args.convert_threads
+                                                              : std::max<size_t>(std::thread::hardware_concurrency(), 1);
             }
+            sibling_order = louds_termid.siblingOrder;
+            auto t2 = std::chrono::steady_clock::now();
+            seconds_convert = std::chrono::duration<double>(t2 - t1).count();
+            memory.peak_rss_convert = stage.end();
+            stage.begin();
+
+            // 3) Save both dictionaries from the same columns (measure separately)
+            louds_termid.saveLoudsToFile(out_louds.string(), args.with_directory);
+            louds_termid.saveLoudsToImageFile(out_louds_img.string());
+            auto t3 = std::chrono::steady_clock::now();
+            seconds_save_louds = std::chrono::duration<double>(t3 - t2).count();
+            memory.peak_rss_save_louds = stage.end();
+            stage.begin();
+
+            louds_termid.saveToFile(out_louds_termid.string(), args.with_directory);
+            louds_termid.saveToImageFile(out_louds_termid_img.string());
+            auto t4 = std::chrono::steady_clock::now();
+            seconds_save_termid = std::chrono::duration<double>(t4 - t3).count();
+            memory.peak_rss_save_louds_termid = stage.end();
+            memory.louds_termid = louds_termid.memoryUsage();
         }
 
-        gzclose(f);
-
-        // 2) Convert -> LOUDS (UTF-16)
-        ConverterUtf16 conv;
-        auto t1 = std::chrono::steady_clock::now();
-        LOUDSUtf16 louds = conv.convert(trie.getRoot());
-        auto t2 = std::chrono::steady_clock::now();
-        double seconds_convert_louds = std::chrono::duration<double>(t2 - t1).count();
-
-        // 3) Convert -> LOUDSWithTermId (UTF-16)
-        ConverterWithTermIdUtf16 conv_termid;
-        auto t3 = std::chrono::steady_clock::now();
-        LOUDSWithTermIdUtf16 louds_termid = conv_termid.convert(trie_termid.getRoot());
-        auto t4 = std::chrono::steady_clock::now();
-        double seconds_convert_termid = std::chrono::duration<double>(t4 - t3).count();
-
-        // 4) Save (measure separately)
-        auto t_save1_begin = std::chrono::steady_clock::now();
-        louds.saveToFile(out_louds.string());
-        auto t_save1_end = std::chrono::steady_clock::now();
-        double seconds_save_louds = std::chrono::duration<double>(t_save1_end - t_save1_begin).count();
-
-        auto t_save2_begin = std::chrono::steady_clock::now();
-        louds_termid.saveToFile(out_louds_termid.string());
-        auto t_save2_end = std::chrono::steady_clock::now();
-        double seconds_save_termid = std::chrono::duration<double>(t_save2_end - t_save2_begin).count();
-
         auto t_end = std::chrono::steady_clock::now();
         double seconds_total_all = std::chrono::duration<double>(t_end - t_begin).count();
 
-        // Totals per output (requested)
-        double seconds_total_louds =
-            seconds_io_decode +
-            seconds_build_prefix_tree +
-            seconds_convert_louds +
-            seconds_save_louds;
-
-        double seconds_total_louds_with_term_id =
-            seconds_io_decode +
-            seconds_build_prefix_tree_with_term_id +
-            seconds_convert_termid +
-            seconds_save_termid;
+        // 4) Memory usage as the readers see it (mmap the images we just wrote; no copy, no rebuild)
+        //    total は .bin を loadFromFile したときのヒープとほぼ同じ
+        memory.reader_louds = LOUDSReaderUtf16::mapFromImageFile(out_louds_img.string()).memoryUsage();
+        memory.reader_louds_termid = LOUDSWithTermIdUtf16Reader::mapFromImageFile(out_louds_termid_img.string()).memoryUsage();
+        memory.peak_rss_reset = stage.resettable();
 
         // 5) Write metrics
         write_metrics_json(
@@ -457,19 +434,19 @@ int main(int argc, char **argv)
             input_utf8_bytes_total,
 
             seconds_total_all,
-            seconds_io_decode,
-
-            seconds_build_prefix_tree,
-            seconds_build_prefix_tree_with_term_id,
+            ingest.secondsWall,
+            ingest.secondsInflate,
+            ingest.secondsDecode,
+            pipeline.decoderThreads(),
 
-            seconds_convert_louds,
-            seconds_convert_termid,
+            ingest.secondsSink,
+            seconds_convert,
+            convert_threads,
+            sibling_order,
 
             seconds_save_louds,
             seconds_save_termid,
-
-            seconds_total_louds,
-            seconds_total_louds_with_term_id);
+            memory);
 
         // Console summary (Actions log)
         std::cout << "input_gz_bytes=" << input_gz_bytes;
@@ -485,23 +462,30 @@ int main(int argc, char **argv)
         std::cout << "word_count=" << word_count << "\n";
         std::cout << "char_count=" << char_count << " (UTF-16 code units)\n";
 
-        std::cout << "seconds_io_decode=" << seconds_io_decode << "\n";
-        std::cout << "seconds_build_prefix_tree=" << seconds_build_prefix_tree << "\n";
-        std::cout << "seconds_build_prefix_tree_with_term_id=" << seconds_build_prefix_tree_with_term_id << "\n";
-
-        std::cout << "seconds_convert_louds=" << seconds_convert_louds << "\n";
-        std::cout << "seconds_convert_louds_with_term_id=" << seconds_convert_termid << "\n";
+        std::cout << "seconds_ingest=" << ingest.secondsWall << "\n";
+        std::cout << "seconds_inflate=" << ingest.secondsInflate << "\n";
+        std::cout << "seconds_decode=" << ingest.secondsDecode << " (" << pipeline.decoderThreads() << " threads, utf8 kernel " << utf8::kernelName(utf8::activeKernel()) << ")\n";
+        std::cout << "seconds_build_prefix_tree=" << ingest.secondsSink << "\n";
+        std::cout << "seconds_convert=" << seconds_convert << " (" << convert_threads << " threads)\n";
+        std::cout << "sibling_order=" << sibling_order_name(sibling_order);
+        if (!args.query_log.empty())
+            std::cout << " (" << query_log_queries << " queries from " << args.query_log << ")";
+        std::cout << "\n";
 
         std::cout << "seconds_save_louds=" << seconds_save_louds << "\n";
         std::cout << "seconds_save_louds_with_term_id=" << seconds_save_termid << "\n";
-
-        std::cout << "seconds_total_louds=" << seconds_total_louds << "\n";
-        std::cout << "seconds_total_louds_with_term_id=" << seconds_total_louds_with_term_id << "\n";
+        std::cout << "peak_rss_bytes build=" << memory.peak_rss_build << " convert=" << memory.peak_rss_convert
+                  << " save_louds=" << memory.peak_rss_save_louds << " save_louds_with_term_id=" << memory.peak_rss_save_louds_termid
+                  << (memory.peak_rss_reset ? "" : " (not reset per stage)") << "\n";
+        std::cout << "memory_louds_reader=" << memory.reader_louds.total() << " (" << format_bytes(memory.reader_louds.total()) << ")\n";
+        std::cout << "memory_louds_with_term_id_reader=" << memory.reader_louds_termid.total() << " (" << format_bytes(memory.reader_louds_termid.total()) << ")\n";
 
         std::cout << "seconds_total_all=" << seconds_total_all << "\n";
 
         std::cout << "out_louds=" << out_louds.string() << "\n";
         std::cout << "out_louds_termid=" << out_louds_termid.string() << "\n";
+        std::cout << "out_louds_img=" << out_louds_img.string() << "\n";
+        std::cout << "out_louds_termid_img=" << out_louds_termid_img.string() << "\n";
         std::cout << "out_metrics=" << out_metrics.string() << "\n";
 
         return 0;
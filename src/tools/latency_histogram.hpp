@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+// レイテンシ（ns）の HDR 風ヒストグラム（louds_replay 系）
+//
+// - 0..255 はそのまま 1 ns 刻み、それより上は 2 のべきごとに 128 分割する（相対誤差 1/128 未満）
+// - 64bit の全範囲を 7424 個のカウンタで持つ（約 58 KiB）。スレッドごとに 1 つ持って最後に merge する
+// - percentile はその順位の値が入るバケットの上端を返す（max を超えない）
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : counts_(kBuckets, 0) {}
+
+    void record(uint64_t ns)
+    {
+        ++counts_[indexOf(ns)];
+        ++count_;
+        sum_ += ns;
+        min_ = std::min(min_, ns);
+        max_ = std::max(max_, ns);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < kBuckets; ++i)
+            counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ == 0 ? 0 : min_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+    // p は 0..100。記録が無ければ 0
+    uint64_t percentile(double p) const
+    {
+        if (count_ == 0)
+            return 0;
+        p = std::clamp(p, 0.0, 100.0);
+        // 小さい側から数えて rank 番目（1-indexed）の値
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+                return std::min(upperBoundOf(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static constexpr int kSubBits = 7;
+    static constexpr uint64_t kExact = uint64_t{1} << (kSubBits + 1); // 256
+    static constexpr size_t kBuckets = (64 - kSubBits - 1 + 1) * (size_t{1} << kSubBits) + (size_t{1} << kSubBits);
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_{0};
+    uint64_t sum_{0};
+    uint64_t min_{std::numeric_limits<uint64_t>::max()};
+    uint64_t max_{0};
+
+    // v の上位 8 bit（先頭の 1 を含む）と、それを取り出すシフト量でバケットを決める
+    static size_t indexOf(uint64_t v)
+    {
+        if (v < kExact)
+            return static_cast<size_t>(v);
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - kSubBits;
+        return (static_cast<size_t>(shift) << kSubBits) + static_cast<size_t>(v >> shift);
+    }
+
+    static uint64_t upperBoundOf(size_t index)
+    {
+        if (index < kExact)
+            return static_cast<uint64_t>(index);
+        const int shift = static_cast<int>(index >> kSubBits) - 1;
+        const uint64_t top = (index & ((size_t{1} << kSubBits) - 1)) + (uint64_t{1} << kSubBits);
+        if (shift + kSubBits + 1 >= 64 && top == (uint64_t{1} << (kSubBits + 1)) - 1)
+            return std::numeric_limits<uint64_t>::max();
+        return ((top + 1) << shift) - 1;
+    }
+};
@@ -0,0 +1,152 @@
+// src/tools/louds_replay.cpp
+//
+// Usage:
+//   louds_replay --dict <dict.louds.{bin,img}> [--term-id] [--log <queries.txt>|-]
+//                [--op common-prefix|exact|predictive|term-id] [--threads N] [--repeat R] [--limit K]
+//
+// Example:
+//   ./louds_replay --dict ../out/jawiki_latest.louds.img --log queries.txt --threads 8 --repeat 10
+//   cat queries.txt | ./louds_replay --dict ../out/jawiki_latest.louds_termid.bin --term-id --op term-id
+//
+// Notes:
+// - 辞書を 1 回だけ読み込み（.img は mmap）、クエリログ（UTF-8、1 行 1 クエリ。省略か "-" なら標準入力）を
+//   N スレッドで同じ Reader に流す。ログは repeat 周する。
+// - --term-id は辞書が LOUDSWithTermId（*.louds_termid.*）であることを示す。--op term-id にはこれが要る。
+// - 出力はスループット（qps）と、HDR 風ヒストグラムから求めたレイテンシ（min / mean / p50 / p90 / p99 / p99.9 / max, ns）。
+//   サーバの台数見積もりと、テールレイテンシの劣化検出に使う。
+// - -DLOUDS_HOT_PATH_COUNTERS=ON でビルドすると、1 件あたりの rank / select 回数・兄弟の比較数・段数・キャッシュライン数も出す。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <chrono>
+#include <stdexcept>
+
+#include "common/utf8.hpp"
+#include "louds/louds_reader.hpp"
+#include "louds_with_term_id/louds_with_term_id_reader.hpp"
+#include "query_replay.hpp"
+
+struct Args
+{
+    std::string dict;
+    std::string log;
+    bool term_id = false;
+    query_replay::Options options;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " --dict <dict.louds.{bin,img}> [--term-id] [--log <queries.txt>|-]\n"
+        << "      [--op common-prefix|exact|predictive|term-id] [--threads N] [--repeat R] [--limit K]\n";
+    std::exit(2);
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--dict")
+            a.dict = need("--dict");
+        else if (k == "--log")
+            a.log = need("--log");
+        else if (k == "--term-id")
+            a.term_id = true;
+        else if (k == "--op")
+        {
+            const std::string op = need("--op");
+            if (!query_replay::parseOp(op, a.options.op))
+            {
+                std::cerr << "Unknown --op: " << op << "\n";
+                usage_and_exit(argv[0]);
+            }
+        }
+        else if (k == "--threads")
+            a.options.threads = static_cast<size_t>(std::stoull(need("--threads")));
+        else if (k == "--repeat")
+            a.options.repeat = static_cast<uint64_t>(std::stoull(need("--repeat")));
+        else if (k == "--limit")
+            a.options.limit = static_cast<size_t>(std::stoull(need("--limit")));
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.dict.empty())
+    {
+        std::cerr << "--dict is required\n";
+        usage_and_exit(argv[0]);
+    }
+    if (a.options.repeat == 0)
+    {
+        std::cerr << "--repeat must be positive\n";
+        usage_and_exit(argv[0]);
+    }
+    if (a.options.op == query_replay::Op::TermId && !a.term_id)
+    {
+        std::cerr << "--op term-id needs a termId dictionary (--term-id)\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+static bool is_image(const std::string &path)
+{
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".img") == 0;
+}
+
+template <class Reader>
+static int run(const Args &args, const std::vector<std::u32string> &queries)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    const Reader reader = is_image(args.dict) ? Reader::mapFromImageFile(args.dict) : Reader::loadFromFile(args.dict);
+    const double seconds_load = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "seconds_load=" << seconds_load << "\n";
+    const MemoryUsage memory = reader.memoryUsage();
+    std::cout << "memory_bytes=" << memory.total() << " memory_heap_bytes=" << memory.heap() << "\n";
+
+    const query_replay::Report report = query_replay::replay(reader, queries, args.options);
+    query_replay::printReport(std::cout, report);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Args args = parse_args(argc, argv);
+
+        uint64_t invalid = 0;
+        const std::vector<std::u32string> queries = query_replay::readLog<char32_t>(args.log, utf8::toUtf32, invalid);
+        if (queries.empty())
+            throw std::runtime_error("query log has no valid queries");
+
+        std::cout << "dict=" << args.dict << "\n";
+        std::cout << "op=" << query_replay::opName(args.options.op) << "\n";
+        std::cout << "log_queries=" << queries.size() << " invalid_lines=" << invalid << "\n";
+
+        return args.term_id ? run<LOUDSWithTermIdReader>(args, queries) : run<LOUDSReader>(args, queries);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <ostream>
+
+#include <sys/resource.h>
+
+#include "common/memory_usage.hpp"
+
+// ツール用: プロセスの RSS と、段ごとのピーク RSS（jawiki_build 系の metrics.json）
+//
+// - 値は /proc/self/status の VmRSS / VmHWM（Linux）。読めなければ VmHWM は getrusage の ru_maxrss、VmRSS は 0
+// - resetPeak は /proc/self/clear_refs に 5 を書いて VmHWM を今の RSS に戻す（Linux 4.0 以降）。
+//   戻せない環境ではピークはプロセス開始からの値になるので、metrics.json には peak_rss_reset を一緒に書く
+namespace process_memory
+{
+    // /proc/self/status の "key:" の値（kB）を byte で返す。無ければ 0
+    inline uint64_t statusBytes(const char *key)
+    {
+        std::ifstream ifs("/proc/self/status");
+        std::string line;
+        const size_t n = std::strlen(key);
+        while (std::getline(ifs, line))
+        {
+            if (line.compare(0, n, key) == 0 && line.size() > n && line[n] == ':')
+                return static_cast<uint64_t>(std::stoull(line.substr(n + 1))) * 1024;
+        }
+        return 0;
+    }
+
+    inline uint64_t currentRss() { return statusBytes("VmRSS"); }
+
+    inline uint64_t peakRss()
+    {
+        if (const uint64_t hwm = statusBytes("VmHWM"))
+            return hwm;
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) != 0)
+            return 0;
+#if defined(__APPLE__)
+        return static_cast<uint64_t>(ru.ru_maxrss);
+#else
+        return static_cast<uint64_t>(ru.ru_maxrss) * 1024;
+#endif
+    }
+
+    inline bool resetPeak()
+    {
+        std::ofstream ofs("/proc/self/clear_refs");
+        if (!ofs)
+            return false;
+        ofs << "5";
+        ofs.flush();
+        return static_cast<bool>(ofs);
+    }
+
+    // 段ごとのピーク RSS: 段の始めに begin、終わりに end を呼ぶ
+    class StagePeak
+    {
+    public:
+        void begin() { resettable_ = resetPeak() && resettable_; }
+
+        uint64_t end() const { return peakRss(); }
+
+        // 1 度でも戻せなかったら false（そのときの値はプロセス開始からのピーク）
+        bool resettable() const { return resettable_; }
+
+    private:
+        bool resettable_ = true;
+    };
+
+    // {"bits": ..., ..., "total": ..., "heap": ...} を 1 行で書く
+    inline void writeJson(std::ostream &os, const MemoryUsage &u)
+    {
+        os << "{\"bits\": " << u.bits
+           << ", \"rank_directory\": " << u.rankDirectory
+           << ", \"select_samples\": " << u.selectSamples
+           << ", \"labels\": " << u.labels
+           << ", \"term_ids\": " << u.termIds
+           << ", \"scores\": " << u.scores
+           << ", \"overhead\": " << u.overhead
+           << ", \"mapped\": " << u.mapped
+           << ", \"total\": " << u.total()
+           << ", \"heap\": " << u.heap() << "}";
+    }
+}
@@ -0,0 +1,249 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+#include "common/louds_types.hpp"
+#include "common/hot_path_counters.hpp"
+#include "latency_histogram.hpp"
+
+// louds_replay 系の本体: 読み込んだ 1 つの Reader に対してクエリログを N スレッドで流し、スループットとレイテンシ分布を出す
+//
+// - クエリは先に全部デコードしておき、worker は共有のカウンタから kChunk 件ずつ取る（ログを repeat 周する）
+// - 1 件ごとに steady_clock で前後を測り、worker ごとのヒストグラムに入れて最後に merge する
+//   （時計の読み出し 2 回ぶん、数十 ns が各レイテンシに乗る）
+// - Reader の検索は const なので、全 worker が同じ Reader を共有する
+// - LOUDS_HOT_PATH_COUNTERS=ON のビルドでは、worker ごとの検索の内訳カウンタも足して 1 件あたりで出す
+namespace query_replay
+{
+    enum class Op
+    {
+        CommonPrefix, // commonPrefixSearch（見つかった接頭辞の数を hit に足す）
+        Exact,        // getNodeIndex（キーとして登録されていれば hit）
+        Predictive,   // predictiveCursor で最大 limit 件（取り出した件数を hit に足す）
+        TermId,       // getNodeIndex + getTermId（termId を持つ辞書のみ。termId >= 0 なら hit）
+    };
+
+    inline const char *opName(Op op)
+    {
+        switch (op)
+        {
+        case Op::CommonPrefix:
+            return "common-prefix";
+        case Op::Exact:
+            return "exact";
+        case Op::Predictive:
+            return "predictive";
+        case Op::TermId:
+            return "term-id";
+        }
+        return "unknown";
+    }
+
+    inline bool parseOp(std::string_view s, Op &op)
+    {
+        for (Op o : {Op::CommonPrefix, Op::Exact, Op::Predictive, Op::TermId})
+        {
+            if (s == opName(o))
+            {
+                op = o;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct Options
+    {
+        Op op = Op::CommonPrefix;
+        // 0 なら hardware_concurrency
+        size_t threads = 1;
+        uint64_t repeat = 1;
+        size_t limit = 10;
+    };
+
+    struct Report
+    {
+        uint64_t queries{0};
+        uint64_t hits{0};
+        size_t threads{0};
+        double seconds{0.0};
+        LatencyHistogram latency;
+        hot_path_counters::Counters counters;
+    };
+
+    // 1 行 1 クエリの UTF-8（path が空か "-" なら標準入力）。空行は飛ばし、デコードできない行は invalid に数える
+    template <class CharT>
+    std::vector<std::basic_string<CharT>> readLog(const std::string &path,
+                                                  bool (*decode)(std::string_view, std::basic_string<CharT> &),
+                                                  uint64_t &invalid)
+    {
+        std::ifstream file;
+        std::istream *in = &std::cin;
+        if (!path.empty() && path != "-")
+        {
+            file.open(path, std::ios::binary);
+            if (!file)
+                throw std::runtime_error("failed to open query log: " + path);
+            in = &file;
+        }
+
+        std::vector<std::basic_string<CharT>> out;
+        std::basic_string<CharT> q;
+        std::string line;
+        invalid = 0;
+        while (std::getline(*in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                continue;
+            if (decode(line, q))
+                out.push_back(q);
+            else
+                ++invalid;
+        }
+        return out;
+    }
+
+    template <class Reader, class String>
+    uint64_t runOne(const Reader &reader, const String &q, const Options &options)
+    {
+        using View = std::basic_string_view<typename String::value_type>;
+        switch (options.op)
+        {
+        case Op::CommonPrefix:
+        {
+            uint64_t hits = 0;
+            reader.commonPrefixSearch(View(q), [&](size_t, LoudsPos, auto...)
+                                      { ++hits; });
+            return hits;
+        }
+        case Op::Exact:
+            return reader.getNodeIndex(q) >= 0 ? 1 : 0;
+        case Op::Predictive:
+        {
+            auto cursor = reader.predictiveCursor(View(q));
+            uint64_t hits = 0;
+            if constexpr (requires { reader.getTermId(LoudsPos{0}); })
+            {
+                LoudsTermPrefixMatch m;
+                while (hits < options.limit && cursor.next(m))
+                    ++hits;
+            }
+            else
+            {
+                LoudsPrefixMatch m;
+                while (hits < options.limit && cursor.next(m))
+                    ++hits;
+            }
+            return hits;
+        }
+        case Op::TermId:
+            if constexpr (requires { reader.getTermId(LoudsPos{0}); })
+            {
+                const LoudsPos n = reader.getNodeIndex(q);
+                return (n >= 0 && reader.getTermId(n) >= 0) ? 1 : 0;
+            }
+            else
+            {
+                throw std::runtime_error("term-id needs a dictionary with termIds");
+            }
+        }
+        return 0;
+    }
+
+    template <class Reader, class String>
+    Report replay(const Reader &reader, const std::vector<String> &queries, const Options &options)
+    {
+        constexpr uint64_t kChunk = 64;
+
+        Report report;
+        const uint64_t total = static_cast<uint64_t>(queries.size()) * options.repeat;
+        size_t threads = options.threads;
+        if (threads == 0)
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        threads = static_cast<size_t>(std::max<uint64_t>(1, std::min<uint64_t>(threads, (total + kChunk - 1) / kChunk)));
+
+        std::atomic<uint64_t> next{0};
+        std::mutex mergeMutex;
+        std::exception_ptr error;
+        auto work = [&]
+        {
+            LatencyHistogram local;
+            uint64_t hits = 0;
+            hot_path_counters::reset();
+            try
+            {
+                for (uint64_t begin = next.fetch_add(kChunk); begin < total; begin = next.fetch_add(kChunk))
+                {
+                    const uint64_t end = std::min(begin + kChunk, total);
+                    for (uint64_t i = begin; i < end; ++i)
+                    {
+                        const String &q = queries[static_cast<size_t>(i % queries.size())];
+                        const auto t0 = std::chrono::steady_clock::now();
+                        hits += runOne(reader, q, options);
+                        const auto t1 = std::chrono::steady_clock::now();
+                        local.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+                    }
+                }
+            }
+            catch (...)
+            {
+                next.store(total);
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            report.latency.merge(local);
+            report.hits += hits;
+            report.counters += hot_path_counters::snapshot();
+        };
+
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t)
+            workers.emplace_back(work);
+        work();
+        for (std::thread &w : workers)
+            w.join();
+        const auto t1 = std::chrono::steady_clock::now();
+        if (error)
+            std::rethrow_exception(error);
+
+        report.queries = report.latency.count();
+        report.threads = threads;
+        report.seconds = std::chrono::duration<double>(t1 - t0).count();
+        return report;
+    }
+
+    // key=value で 1 行ずつ出す（jawiki_build 系の標準出力と同じ形）
+    inline void printReport(std::ostream &os, const Report &r)
+    {
+        os << "threads=" << r.threads << "\n";
+        os << "queries=" << r.queries << "\n";
+        os << "hits=" << r.hits << "\n";
+        os << "seconds=" << r.seconds << "\n";
+        os << "qps=" << (r.seconds > 0.0 ? static_cast<double>(r.queries) / r.seconds : 0.0) << "\n";
+        os << "latency_ns_min=" << r.latency.min() << "\n";
+        os << "latency_ns_mean=" << r.latency.mean() << "\n";
+        os << "latency_ns_p50=" << r.latency.percentile(50.0) << "\n";
+        os << "latency_ns_p90=" << r.latency.percentile(90.0) << "\n";
+        os << "latency_ns_p99=" << r.latency.percentile(99.0) << "\n";
+        os << "latency_ns_p99.9=" << r.latency.percentile(99.9) << "\n";
+        os << "latency_ns_max=" << r.latency.max() << "\n";
+        hot_path_counters::print(os, r.counters, r.queries);
+    }
+}
@@ -0,0 +1,342 @@
+// src/tools/synthetic_corpus.cpp
+//
+// Usage:
+//   synthetic_corpus --out <keys.txt[.gz]> [--keys N] [--seed S] [--sorted]
+//                    [--hit-queries <file>] [--miss-queries <file>] [--queries N]
+//                    [--min-length N] [--mean-length N] [--max-length N]
+//                    [--mix kanji:hiragana:katakana:ascii] [--kanji N] [--char-zipf S]
+//                    [--prefix-share F] [--stems N] [--stem-zipf S] [--query-zipf S]
+//
+// Example:
+//   ./synthetic_corpus --out ../data/synth_10M.gz --keys 10M --seed 1
+//       --hit-queries ../data/synth_10M.hit.txt --miss-queries ../data/synth_10M.miss.txt
+//   ./jawiki_build_utf16 --input ../data/synth_10M.gz --out-dir ../out/synth_10M --prefix synth_10M
+//
+// Notes:
+// - jawiki のダンプの代わりに、seed から再現できるキー集合（1 行 1 キー、UTF-8）を書く。
+//   出力先が .gz なら gzip（jawiki_build 系の --input にそのまま渡せる）、それ以外は平文。
+// - キーの作り方（文字種の混ざり方・Zipf・長さ・接頭辞の共有）は synthetic_corpus.hpp を参照。
+// - --keys は 1M / 10M / 100M のように k / M / G を付けられる。
+// - --sorted はキーを UTF-8 のバイト順に並べ、重複を除いて書く（jawiki_build 系の --sorted-input 用）。
+//   全キーをメモリに持つ。付けなければキーを 1 つずつ作って書くだけなので、メモリはほぼ使わない。
+// - --hit-queries / --miss-queries は、完全一致で必ず見つかる / 見つからないクエリを --queries 行ずつ書く
+//   （louds_replay 系の --log や jawiki_build 系の --query-log に渡せる）。
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "common/utf8.hpp"
+#include "synthetic_corpus.hpp"
+
+struct Args
+{
+    std::string out;
+    std::string hit_queries;
+    std::string miss_queries;
+    uint64_t queries = 100000;
+    bool sorted = false;
+    synthetic_corpus::Options options;
+};
+
+static void usage_and_exit(const char *prog)
+{
+    std::cerr
+        << "Usage:\n"
+        << "  " << prog << " --out <keys.txt[.gz]> [--keys N] [--seed S] [--sorted]\n"
+        << "      [--hit-queries <file>] [--miss-queries <file>] [--queries N]\n"
+        << "      [--min-length N] [--mean-length N] [--max-length N]\n"
+        << "      [--mix kanji:hiragana:katakana:ascii] [--kanji N] [--char-zipf S]\n"
+        << "      [--prefix-share F] [--stems N] [--stem-zipf S] [--query-zipf S]\n";
+    std::exit(2);
+}
+
+// 1000 / 10k / 1M / 100M / 1G
+static uint64_t parse_count(const std::string &s)
+{
+    size_t used = 0;
+    const uint64_t v = std::stoull(s, &used);
+    const std::string suffix = s.substr(used);
+    if (suffix.empty())
+        return v;
+    if (suffix == "k" || suffix == "K")
+        return v * 1000;
+    if (suffix == "m" || suffix == "M")
+        return v * 1000000;
+    if (suffix == "g" || suffix == "G")
+        return v * 1000000000;
+    throw std::runtime_error("bad count: " + s);
+}
+
+// "45:20:25:10"
+static void parse_mix(const std::string &s, synthetic_corpus::Options &o)
+{
+    uint32_t w[4] = {0, 0, 0, 0};
+    size_t begin = 0;
+    for (int k = 0; k < 4; ++k)
+    {
+        const size_t end = k < 3 ? s.find(':', begin) : s.size();
+        if (end == std::string::npos)
+            throw std::runtime_error("--mix needs 4 weights (kanji:hiragana:katakana:ascii): " + s);
+        w[k] = static_cast<uint32_t>(std::stoul(s.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    o.weightKanji = w[0];
+    o.weightHiragana = w[1];
+    o.weightKatakana = w[2];
+    o.weightAscii = w[3];
+}
+
+static Args parse_args(int argc, char **argv)
+{
+    Args a;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string k = argv[i];
+        auto need = [&](const char *opt) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << opt << "\n";
+                usage_and_exit(argv[0]);
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (k == "--out")
+            a.out = need("--out");
+        else if (k == "--keys")
+            a.options.keys = parse_count(need("--keys"));
+        else if (k == "--seed")
+            a.options.seed = static_cast<uint64_t>(std::stoull(need("--seed")));
+        else if (k == "--sorted")
+            a.sorted = true;
+        else if (k == "--hit-queries")
+            a.hit_queries = need("--hit-queries");
+        else if (k == "--miss-queries")
+            a.miss_queries = need("--miss-queries");
+        else if (k == "--queries")
+            a.queries = parse_count(need("--queries"));
+        else if (k == "--min-length")
+            a.options.minLength = static_cast<uint32_t>(std::stoul(need("--min-length")));
+        else if (k == "--mean-length")
+            a.options.meanLength = static_cast<uint32_t>(std::stoul(need("--mean-length")));
+        else if (k == "--max-length")
+            a.options.maxLength = static_cast<uint32_t>(std::stoul(need("--max-length")));
+        else if (k == "--mix")
+            parse_mix(need("--mix"), a.options);
+        else if (k == "--kanji")
+            a.options.kanjiCount = static_cast<uint32_t>(std::stoul(need("--kanji")));
+        else if (k == "--char-zipf")
+            a.options.charZipf = std::stod(need("--char-zipf"));
+        else if (k == "--prefix-share")
+            a.options.prefixShare = std::stod(need("--prefix-share"));
+        else if (k == "--stems")
+            a.options.stems = parse_count(need("--stems"));
+        else if (k == "--stem-zipf")
+            a.options.stemZipf = std::stod(need("--stem-zipf"));
+        else if (k == "--query-zipf")
+            a.options.queryZipf = std::stod(need("--query-zipf"));
+        else
+        {
+            std::cerr << "Unknown option: " << k << "\n";
+            usage_and_exit(argv[0]);
+        }
+    }
+    if (a.out.empty())
+    {
+        std::cerr << "--out is required\n";
+        usage_and_exit(argv[0]);
+    }
+    return a;
+}
+
+// 1 行ずつ書く（.gz なら gzip の速い圧縮レベル）
+class LineWriter
+{
+public:
+    explicit LineWriter(const std::string &path)
+    {
+        if (path.size() >= 3 && path.compare(path.size() - 3, 3, ".gz") == 0)
+        {
+            gz_ = gzopen(path.c_str(), "wb1");
+            if (!gz_)
+                throw std::runtime_error("failed to open for write: " + path);
+            gzbuffer(gz_, 1u << 20);
+        }
+        else
+        {
+            file_.open(path, std::ios::binary);
+            if (!file_)
+                throw std::runtime_error("failed to open for write: " + path);
+        }
+        buffer_.reserve(kFlushBytes + 4096);
+    }
+
+    ~LineWriter()
+    {
+        if (gz_)
+            gzclose(gz_);
+    }
+
+    LineWriter(const LineWriter &) = delete;
+    LineWriter &operator=(const LineWriter &) = delete;
+
+    void write(std::string_view line)
+    {
+        buffer_.append(line);
+        buffer_.push_back('\n');
+        bytes_ += line.size() + 1;
+        if (buffer_.size() >= kFlushBytes)
+            flush();
+    }
+
+    void close()
+    {
+        flush();
+        if (gz_)
+        {
+            const int rc = gzclose(gz_);
+            gz_ = nullptr;
+            if (rc != Z_OK)
+                throw std::runtime_error("gzclose failed");
+        }
+        else
+        {
+            file_.close();
+            if (!file_)
+                throw std::runtime_error("write failed");
+        }
+    }
+
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    static constexpr size_t kFlushBytes = size_t{1} << 20;
+
+    gzFile gz_ = nullptr;
+    std::ofstream file_;
+    std::string buffer_;
+    uint64_t bytes_{0};
+
+    void flush()
+    {
+        if (buffer_.empty())
+            return;
+        if (gz_)
+        {
+            if (gzwrite(gz_, buffer_.data(), static_cast<unsigned>(buffer_.size())) != static_cast<int>(buffer_.size()))
+                throw std::runtime_error("gzwrite failed");
+        }
+        else
+        {
+            file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            if (!file_)
+                throw std::runtime_error("write failed");
+        }
+        buffer_.clear();
+    }
+};
+
+template <class Make>
+static void write_queries(const std::string &path, uint64_t n, Make make)
+{
+    LineWriter out(path);
+    std::u32string q;
+    for (uint64_t j = 0; j < n; ++j)
+    {
+        make(j, q);
+        out.write(utf8::fromUtf32(q));
+    }
+    out.close();
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Args args = parse_args(argc, argv);
+        const synthetic_corpus::Generator gen(args.options);
+        const uint64_t n = gen.options().keys;
+
+        const auto t0 = std::chrono::steady_clock::now();
+        uint64_t chars = 0;
+        uint64_t written = 0;
+        uint64_t text_bytes = 0;
+        {
+            LineWriter out(args.out);
+            std::u32string key;
+            if (args.sorted)
+            {
+                std::vector<std::string> keys;
+                keys.reserve(static_cast<size_t>(n));
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    gen.key(i, key);
+                    keys.push_back(utf8::fromUtf32(key));
+                }
+                std::sort(keys.begin(), keys.end());
+                keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+                for (const std::string &k : keys)
+                    out.write(k);
+                written = keys.size();
+                for (const std::string &k : keys)
+                    chars += static_cast<uint64_t>(std::count_if(k.begin(), k.end(), [](char c)
+                                                                 { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }));
+            }
+            else
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    gen.key(i, key);
+                    chars += key.size();
+                    out.write(utf8::fromUtf32(key));
+                }
+                written = n;
+            }
+            out.close();
+            text_bytes = out.bytes();
+        }
+        const double seconds_keys = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        const auto t1 = std::chrono::steady_clock::now();
+        if (!args.hit_queries.empty())
+            write_queries(args.hit_queries, args.queries, [&](uint64_t j, std::u32string &q)
+                          { gen.hitQuery(j, q); });
+        if (!args.miss_queries.empty())
+            write_queries(args.miss_queries, args.queries, [&](uint64_t j, std::u32string &q)
+                          { gen.missQuery(j, q); });
+        const double seconds_queries = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+
+        std::cout << "out=" << args.out << "\n";
+        std::cout << "seed=" << gen.options().seed << "\n";
+        std::cout << "keys_generated=" << n << "\n";
+        std::cout << "sorted=" << (args.sorted ? 1 : 0) << "\n";
+        std::cout << "keys_written=" << written << "\n";
+        std::cout << "stems=" << gen.options().stems << "\n";
+        std::cout << "chars=" << chars << "\n";
+        std::cout << "text_bytes=" << text_bytes << "\n";
+        std::cout << "mean_length=" << (written ? static_cast<double>(chars) / static_cast<double>(written) : 0.0) << "\n";
+        std::cout << "seconds_keys=" << seconds_keys << "\n";
+        if (!args.hit_queries.empty() || !args.miss_queries.empty())
+        {
+            std::cout << "queries=" << args.queries << "\n";
+            std::cout << "seconds_queries=" << seconds_queries << "\n";
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "[FATAL] " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,376 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+// ベンチマーク用の合成コーパス（synthetic_corpus ツール）
+//
+// - jawiki のダンプ無しで、seed から再現できるキー集合と、それに合うヒット / ミスのクエリを作る
+// - キー i は (seed, i) だけから決まる（カウンタ方式）。全キーを持たずに任意の i を作り直せるので、
+//   ヒットクエリは「選んだ番号のキーを作り直す」だけで済み、1 億キーでもメモリを食わない
+// - 乱数は自前の splitmix64 で、std::*_distribution（実装ごとに結果が違う）は使わない。
+//   同じ seed と引数なら、IEEE 754 の libm のもとで同じ出力になる
+//
+// キーの形:
+// - 長さ（文字数）は minLength + 幾何分布（平均 meanLength）で、maxLength で打ち切る
+// - 文字は「文字種の連なり（run）」を重ねて作る。run ごとに漢字・ひらがな・カタカナ・ASCII を重みで選び、
+//   run の中の文字は文字種ごとの Zipf 分布（指数 charZipf）で引く
+// - prefixShare の割合のキーは、stems 個ある語幹のどれか（Zipf、指数 stemZipf）から始まる。
+//   割合と語幹の数で、接頭辞を共有するキーの密度を変えられる
+// - キーは重複しうる（ビルダー側では 1 つのキーにまとまる）
+//
+// クエリ:
+// - hitQuery: キーの番号を Zipf（指数 queryZipf）で選び、そのキーをそのまま返す（完全一致で必ず見つかる）
+// - missQuery: 同じように選んだキーの後半の 1 文字を、キーに現れないハングル音節に置き換える。
+//   完全一致では必ず見つからず、前半の接頭辞は実在のキーと共有する
+namespace synthetic_corpus
+{
+    __extension__ using Uint128 = unsigned __int128;
+
+    inline uint64_t mix64(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // splitmix64
+    class Rng
+    {
+    public:
+        explicit Rng(uint64_t seed) : state_(seed) {}
+
+        uint64_t next()
+        {
+            state_ += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state_;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // [0, n)
+        uint64_t below(uint64_t n)
+        {
+            return static_cast<uint64_t>((static_cast<Uint128>(next()) * n) >> 64);
+        }
+
+        // [0, 1)
+        double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    private:
+        uint64_t state_;
+    };
+
+    // [0, n) の Zipf 風の番号（連続近似の逆関数法）。s = 0 なら一様
+    inline uint64_t zipfIndex(double u, uint64_t n, double s)
+    {
+        if (n <= 1)
+            return 0;
+        const double dn = static_cast<double>(n);
+        double x;
+        if (std::fabs(s - 1.0) < 1e-9)
+        {
+            x = std::exp(u * std::log(dn + 1.0)) - 1.0;
+        }
+        else
+        {
+            const double a = 1.0 - s;
+            const double total = (std::pow(dn + 1.0, a) - 1.0) / a;
+            x = std::pow(1.0 + u * total * a, 1.0 / a) - 1.0;
+        }
+        if (!(x >= 0.0))
+            return 0;
+        return std::min(static_cast<uint64_t>(x), n - 1);
+    }
+
+    enum class Script
+    {
+        Kanji,
+        Hiragana,
+        Katakana,
+        Ascii,
+    };
+
+    struct Options
+    {
+        uint64_t seed = 1;
+        uint64_t keys = 1000000;
+
+        uint32_t minLength = 2;
+        uint32_t meanLength = 8;
+        uint32_t maxLength = 40;
+
+        // 文字種の重み（漢字・ひらがな・カタカナ・ASCII）
+        uint32_t weightKanji = 45;
+        uint32_t weightHiragana = 20;
+        uint32_t weightKatakana = 25;
+        uint32_t weightAscii = 10;
+        // 使う漢字の数（CJK 統合漢字 U+4E00..U+9FA5 から散らして選ぶ。最大 20902）
+        uint32_t kanjiCount = 3000;
+        double charZipf = 1.0;
+
+        double prefixShare = 0.5;
+        // 0 なら keys / 64（最低 1）
+        uint64_t stems = 0;
+        double stemZipf = 1.0;
+
+        double queryZipf = 1.0;
+    };
+
+    class Generator
+    {
+    public:
+        explicit Generator(const Options &options) : options_(options)
+        {
+            if (options_.keys == 0)
+                throw std::runtime_error("synthetic corpus: keys must be > 0");
+            if (options_.minLength == 0 || options_.minLength > options_.maxLength)
+                throw std::runtime_error("synthetic corpus: need 1 <= min length <= max length");
+            if (options_.meanLength < options_.minLength)
+                throw std::runtime_error("synthetic corpus: mean length must be >= min length");
+            if (options_.kanjiCount == 0 || options_.kanjiCount > kKanjiBlock)
+                throw std::runtime_error("synthetic corpus: kanji count must be in 1..20902");
+            if (options_.prefixShare < 0.0 || options_.prefixShare > 1.0)
+                throw std::runtime_error("synthetic corpus: prefix share must be in 0..1");
+            const uint64_t weightSum = uint64_t{options_.weightKanji} + options_.weightHiragana +
+                                       options_.weightKatakana + options_.weightAscii;
+            if (weightSum == 0)
+                throw std::runtime_error("synthetic corpus: all script weights are 0");
+            if (options_.stems == 0)
+                options_.stems = std::max<uint64_t>(options_.keys / 64, 1);
+
+            // 幾何分布: 1 文字ごとに確率 p で止まる（止まるまでの文字数の平均が meanLength - minLength）
+            const double p = 1.0 / (static_cast<double>(options_.meanLength - options_.minLength) + 1.0);
+            stopThreshold_ = p >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(p, 64));
+            shareThreshold_ = options_.prefixShare >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(options_.prefixShare, 64));
+
+            buildPool(Script::Kanji, options_.kanjiCount);
+            buildPool(Script::Hiragana, kHiraganaCount);
+            buildPool(Script::Katakana, kKatakanaCount);
+            buildPool(Script::Ascii, kAsciiCount);
+        }
+
+        const Options &options() const { return options_; }
+
+        // i 番目のキー（i < keys）
+        void key(uint64_t i, std::u32string &out) const
+        {
+            Rng rng(mix64(mix64(options_.seed ^ kKeyStream) + i));
+            out.clear();
+
+            uint32_t length = options_.minLength;
+            while (length < options_.maxLength && rng.next() >= stopThreshold_)
+                ++length;
+
+            if (shareThreshold_ != 0 && rng.next() < shareThreshold_)
+            {
+                stem(zipfIndex(rng.unit(), options_.stems, options_.stemZipf), out);
+                // 語幹のあとに最低 1 文字は付ける（語幹そのものだけのキーばかりにならないように）
+                length = std::max<uint32_t>(length, static_cast<uint32_t>(out.size()) + 1);
+                length = std::min(length, options_.maxLength);
+            }
+            appendRuns(rng, length, out);
+        }
+
+        // j 番目のヒットクエリ（キーのどれかと完全一致する）
+        void hitQuery(uint64_t j, std::u32string &out) const
+        {
+            Rng rng(mix64(mix64(options_.seed ^ kHitStream) + j));
+            key(pickKey(rng), out);
+        }
+
+        // j 番目のミスクエリ（どのキーとも完全一致しない）
+        void missQuery(uint64_t j, std::u32string &out) const
+        {
+            Rng rng(mix64(mix64(options_.seed ^ kMissStream) + j));
+            key(pickKey(rng), out);
+            const size_t half = out.size() / 2;
+            const size_t pos = half + static_cast<size_t>(rng.below(out.size() - half));
+            out[pos] = static_cast<char32_t>(kMissFirst + rng.below(kMissCount));
+        }
+
+        // キーに現れうる文字か（テスト用）
+        static bool isKeyChar(char32_t c)
+        {
+            return (c >= 0x4E00 && c < 0x4E00 + kKanjiBlock) ||
+                   (c >= 0x3041 && c < 0x3041 + kHiraganaCount) ||
+                   (c >= 0x30A1 && c < 0x30A1 + kKatakanaCount - 1) || c == 0x30FC ||
+                   (c >= U'0' && c <= U'9') || (c >= U'A' && c <= U'Z') || (c >= U'a' && c <= U'z');
+        }
+
+    private:
+        static constexpr uint32_t kKanjiBlock = 20902;   // U+4E00..U+9FA5
+        static constexpr uint32_t kHiraganaCount = 83;   // U+3041..U+3093
+        static constexpr uint32_t kKatakanaCount = 84;   // U+30A1..U+30F3 と長音符 U+30FC
+        static constexpr uint32_t kAsciiCount = 62;      // 0-9 A-Z a-z
+        static constexpr uint32_t kMissFirst = 0xAC00;   // ハングル音節（キーには現れない）
+        static constexpr uint32_t kMissCount = 11172;
+
+        static constexpr uint64_t kKeyStream = 0x6B65790000000000ull;
+        static constexpr uint64_t kStemStream = 0x7374656D00000000ull;
+        static constexpr uint64_t kHitStream = 0x6869740000000000ull;
+        static constexpr uint64_t kMissStream = 0x6D69737300000000ull;
+
+        struct Pool
+        {
+            // Zipf の累積分布（next() と比べる 64bit のしきい値）と、順位ごとの文字
+            std::vector<uint64_t> cdf;
+            std::vector<char32_t> chars;
+        };
+
+        Options options_;
+        uint64_t stopThreshold_{0};
+        uint64_t shareThreshold_{0};
+        Pool pools_[4];
+
+        // 文字種の字を頻度の高い順に count 個。先頭は実際の日本語でよく使う字（おおまかな順）で、
+        // 残りは符号位置の順（漢字はブロック全体に散らした順）に、まだ入っていない字を足す
+        static std::vector<char32_t> rankedChars(Script script, uint32_t count)
+        {
+            std::u32string_view frequent;
+            char32_t first = 0;
+            uint32_t span = 0;
+            uint32_t step = 1;
+            switch (script)
+            {
+            case Script::Kanji:
+                frequent = U"日本人大年中国一出会学生上子東京市時者月社場手分行新地事下自長高金前同内合小田方山理";
+                // 7919 と 20902 は互いに素なので、ブロック全体をくまなく散らして回る
+                first = 0x4E00;
+                span = kKanjiBlock;
+                step = 7919;
+                break;
+            case Script::Hiragana:
+                frequent = U"のにはをたがでてとしいかるなれもうらっりまこすくあおきけそよせちつどんえめわみ";
+                first = 0x3041;
+                span = kHiraganaCount;
+                break;
+            case Script::Katakana:
+                frequent = U"ーンスルトリクライアシタレドロカコマミテフッメジグサキブデナバニパオエプビ";
+                first = 0x30A1;
+                span = kKatakanaCount - 1;
+                break;
+            case Script::Ascii:
+                frequent = U"eaoitnsrhlcdumSCMATBPfgpbywkvDRLE0123456789";
+                break;
+            }
+
+            std::vector<char32_t> chars(frequent.begin(), frequent.end());
+            auto add = [&](char32_t c)
+            {
+                if (chars.size() < count && std::find(chars.begin(), chars.end(), c) == chars.end())
+                    chars.push_back(c);
+            };
+            if (script == Script::Ascii)
+            {
+                for (char32_t c = U'a'; c <= U'z'; ++c)
+                    add(c);
+                for (char32_t c = U'A'; c <= U'Z'; ++c)
+                    add(c);
+            }
+            else
+            {
+                for (uint32_t k = 0; k < span && chars.size() < count; ++k)
+                    add(static_cast<char32_t>(first + (uint64_t{k} * step + 3) % span));
+            }
+            chars.resize(std::min<size_t>(chars.size(), count));
+            return chars;
+        }
+
+        void buildPool(Script script, uint32_t count)
+        {
+            Pool &pool = pools_[static_cast<int>(script)];
+            std::vector<double> weights(count);
+            for (uint32_t r = 0; r < count; ++r)
+                weights[r] = 1.0 / std::pow(static_cast<double>(r) + 1.0, options_.charZipf);
+            const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+            double cum = 0.0;
+            pool.cdf.resize(count);
+            pool.chars = rankedChars(script, count);
+            for (uint32_t r = 0; r < count; ++r)
+            {
+                cum += weights[r];
+                const double f = cum / total;
+                pool.cdf[r] = (r + 1 == count || f >= 1.0) ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(f, 64));
+            }
+        }
+
+        char32_t drawChar(Rng &rng, Script script) const
+        {
+            const Pool &pool = pools_[static_cast<int>(script)];
+            const auto it = std::upper_bound(pool.cdf.begin(), pool.cdf.end(), rng.next());
+            return pool.chars[std::min(static_cast<size_t>(it - pool.cdf.begin()), pool.chars.size() - 1)];
+        }
+
+        Script drawScript(Rng &rng) const
+        {
+            uint64_t r = rng.below(uint64_t{options_.weightKanji} + options_.weightHiragana +
+                                   options_.weightKatakana + options_.weightAscii);
+            if (r < options_.weightKanji)
+                return Script::Kanji;
+            r -= options_.weightKanji;
+            if (r < options_.weightHiragana)
+                return Script::Hiragana;
+            r -= options_.weightHiragana;
+            if (r < options_.weightKatakana)
+                return Script::Katakana;
+            return Script::Ascii;
+        }
+
+        // 文字種ごとの run の長さ（漢字は短く、カタカナ語・英数字は長め）
+        static uint32_t runLength(Rng &rng, Script script)
+        {
+            switch (script)
+            {
+            case Script::Kanji:
+                return 1 + static_cast<uint32_t>(rng.below(3));
+            case Script::Hiragana:
+                return 1 + static_cast<uint32_t>(rng.below(4));
+            case Script::Katakana:
+                return 2 + static_cast<uint32_t>(rng.below(5));
+            case Script::Ascii:
+                return 1 + static_cast<uint32_t>(rng.below(6));
+            }
+            return 1;
+        }
+
+        void appendRuns(Rng &rng, uint32_t length, std::u32string &out) const
+        {
+            while (out.size() < length)
+            {
+                const Script script = drawScript(rng);
+                const uint32_t n = std::min<uint32_t>(runLength(rng, script), length - static_cast<uint32_t>(out.size()));
+                for (uint32_t k = 0; k < n; ++k)
+                    out.push_back(drawChar(rng, script));
+            }
+        }
+
+        // s 番目の語幹（1..max(meanLength / 2, 1) 文字で、maxLength - 1 を超えない）
+        void stem(uint64_t s, std::u32string &out) const
+        {
+            Rng rng(mix64(mix64(options_.seed ^ kStemStream) + s));
+            uint32_t length = 1 + static_cast<uint32_t>(rng.below(std::max<uint32_t>(options_.meanLength / 2, 1)));
+            length = std::min(length, std::max<uint32_t>(options_.maxLength - 1, 1));
+            appendRuns(rng, length, out);
+        }
+
+        // クエリが引くキーの番号。Zipf の順位を番号全体に散らす（頻繁なキーが番号の若い側に固まらないように）
+        uint64_t pickKey(Rng &rng) const
+        {
+            const uint64_t n = options_.keys;
+            const uint64_t rank = zipfIndex(rng.unit(), n, options_.queryZipf);
+            constexpr uint64_t kScatter = 2654435761ull; // 素数
+            if (std::gcd(kScatter, n) != 1)
+                return rank;
+            return static_cast<uint64_t>((static_cast<Uint128>(rank) * kScatter) % n);
+        }
+    };
+}
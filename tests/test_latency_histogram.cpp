@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "tools/latency_histogram.hpp"
+
+static void assert_true(bool cond, const std::string &msg)
+{
+    if (!cond)
+    {
+        std::cerr << "[FAIL] " << msg << "\n";
+        std::exit(1);
+    }
+}
+
+// 並べ替えた値の p パーセンタイル（percentile と同じ順位の決め方）
+static uint64_t exact_percentile(std::vector<uint64_t> sorted, double p)
+{
+    std::sort(sorted.begin(), sorted.end());
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, sorted.size());
+    return sorted[static_cast<size_t>(rank - 1)];
+}
+
+int main()
+{
+    // 空
+    {
+        LatencyHistogram h;
+        assert_true(h.count() == 0, "empty: count");
+        assert_true(h.percentile(50.0) == 0, "empty: percentile");
+        assert_true(h.min() == 0 && h.max() == 0, "empty: min/max");
+        assert_true(h.mean() == 0.0, "empty: mean");
+    }
+
+    // 256 未満はそのままの値
+    {
+        LatencyHistogram h;
+        for (uint64_t v = 0; v < 256; ++v)
+            h.record(v);
+        assert_true(h.count() == 256, "exact: count");
+        assert_true(h.min() == 0 && h.max() == 255, "exact: min/max");
+        assert_true(h.percentile(50.0) == 127, "exact: p50");
+        assert_true(h.percentile(100.0) == 255, "exact: p100");
+        assert_true(h.mean() == 127.5, "exact: mean");
+    }
+
+    // 広い範囲（対数一様）で、正しい値に対して上に 1/128 以内
+    {
+        std::mt19937_64 rng(1);
+        std::uniform_real_distribution<double> exp(0.0, 40.0);
+        std::vector<uint64_t> values;
+        LatencyHistogram h;
+        for (int i = 0; i < 200000; ++i)
+        {
+            const uint64_t v = static_cast<uint64_t>(std::pow(2.0, exp(rng)));
+            values.push_back(v);
+            h.record(v);
+        }
+        for (double p : {1.0, 50.0, 90.0, 99.0, 99.9, 100.0})
+        {
+            const uint64_t want = exact_percentile(values, p);
+            const uint64_t got = h.percentile(p);
+            const std::string tag = "log-uniform p" + std::to_string(p);
+            assert_true(got >= want, tag + ": not below the exact value");
+            assert_true(static_cast<double>(got - want) <= static_cast<double>(want) / 128.0, tag + ": within 1/128");
+        }
+        assert_true(h.max() == *std::max_element(values.begin(), values.end()), "log-uniform: max");
+        assert_true(h.percentile(100.0) == h.max(), "log-uniform: p100 == max");
+    }
+
+    // merge は同じ値を 1 つに入れた場合と同じ
+    {
+        std::mt19937_64 rng(2);
+        LatencyHistogram a, b, all;
+        for (int i = 0; i < 10000; ++i)
+        {
+            const uint64_t v = rng() % 5000000;
+            (i % 3 == 0 ? a : b).record(v);
+            all.record(v);
+        }
+        a.merge(b);
+        assert_true(a.count() == all.count(), "merge: count");
+        assert_true(a.min() == all.min() && a.max() == all.max(), "merge: min/max");
+        for (double p : {50.0, 90.0, 99.0, 99.9})
+            assert_true(a.percentile(p) == all.percentile(p), "merge: p" + std::to_string(p));
+    }
+
+    // 64bit の端
+    {
+        LatencyHistogram h;
+        h.record(std::numeric_limits<uint64_t>::max());
+        h.record(uint64_t{1} << 63);
+        assert_true(h.percentile(100.0) == std::numeric_limits<uint64_t>::max(), "u64 max");
+        assert_true(h.percentile(50.0) >= (uint64_t{1} << 63), "2^63");
+    }
+
+    std::cout << "[OK] LatencyHistogram tests passed\n";
+    return 0;
+}
@@ -2,10 +2,13 @@
 #include <cstdlib>
 #include <vector>
 #include <string>
+#include <fstream>
+#include <iterator>
 
 #include "prefix/prefix_tree.hpp"
 #include "louds/converter.hpp"
 #include "louds/louds.hpp"
+#include "common/sorted_louds_builder.hpp"
 
 static void assert_true(bool cond, const char *msg)
 {
@@ -118,6 +121,120 @@ int main()
                     "hiragana commonPrefixSearch after load should be {す,すみ,すみれ}");
     }
 
+    // =========================================================
+    // SortedLoudsBuilder: 昇順入力から Converter と同じ LOUDS（一時ファイルへの退避を含む）
+    // =========================================================
+    {
+        const std::vector<std::u32string> keys = {U"あ", U"あい", U"あいう", U"あお", U"か", U"かき", U"かきく", U"さ", U"さし"};
+
+        PrefixTree t;
+        for (const auto &k : keys)
+            t.insert(k);
+        Converter conv;
+        LOUDS expected = conv.convert(t.getRoot());
+
+        SortedLoudsBuilder<char32_t>::Options options;
+        options.spillRecords = 2; // 各深さのバッファをすぐ一時ファイルへ書き出させる
+        SortedLoudsBuilder<char32_t> builder(options);
+        for (const auto &k : keys)
+            builder.add(k);
+
+        const std::string path = "louds_sorted_builder_test.bin";
+        builder.writeLoudsFile(path);
+        LOUDS streamed = LOUDS::loadFromFile(path);
+        assert_true(streamed.equals(expected), "sorted builder: streamed .bin should equal Converter output");
+        assert_true(streamed.siblingOrder == louds_image::SiblingOrder::CodeUnitAscending,
+                    "sorted builder: sibling order should be recorded");
+
+        // ディレクトリ付き .bin と .img も一時ファイルから直接書き、Converter の出力と同じバイト列になる
+        auto readAll = [](const std::string &p)
+        {
+            std::ifstream ifs(p, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        };
+        expected.saveToFile("louds_sorted_builder_expected_dir.bin", true);
+        builder.writeLoudsFile("louds_sorted_builder_dir.bin", true);
+        assert_true(readAll("louds_sorted_builder_expected_dir.bin") == readAll("louds_sorted_builder_dir.bin"),
+                    "sorted builder: .bin with directory should match LOUDS::saveToFile(path, true)");
+        expected.saveToImageFile("louds_sorted_builder_expected.img");
+        builder.writeLoudsImageFile("louds_sorted_builder.img");
+        assert_true(readAll("louds_sorted_builder_expected.img") == readAll("louds_sorted_builder.img"),
+                    "sorted builder: image should match LOUDS::saveToImageFile");
+
+        auto result = builder.finish();
+        LOUDS built;
+        built.LBS = std::move(result.LBS);
+        built.isLeaf = std::move(result.isLeaf);
+        built.labels = std::move(result.labels);
+        assert_true(built.equals(expected), "sorted builder: finish() should equal Converter output");
+
+        auto r = built.commonPrefixSearch(U"かきくけ");
+        std::vector<std::u32string> prefixes = {U"か", U"かき", U"かきく"};
+        assert_true(u32_equals(r, prefixes), "sorted builder: commonPrefixSearch should work on the built LOUDS");
+
+        SortedLoudsBuilder<char32_t> unsorted;
+        unsorted.add(U"か");
+        bool threw = false;
+        try
+        {
+            unsorted.add(U"あ");
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "sorted builder: out-of-order key should throw");
+    }
+
+    // =========================================================
+    // convertListToBitVector: ビット列を作り直したら検索用ディレクトリを捨てる
+    // =========================================================
+    {
+        PrefixTree t;
+        for (const auto &k : {U"あ", U"あい", U"か"})
+            t.insert(k);
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+        louds.commonPrefixSearch(U"あい");
+        assert_true(louds.memoryUsage().rankDirectory > 0, "index: search should build the rank directory");
+        louds.convertListToBitVector();
+        assert_true(louds.memoryUsage().rankDirectory == 0, "index: convertListToBitVector should discard the directory");
+    }
+
+    // =========================================================
+    // 同じ大きさの BitVector を代入したら、検索用ディレクトリを作り直す（word 列の場所が変わらなくても）
+    // =========================================================
+    {
+        PrefixTree ta;
+        for (const auto &k : {U"あ", U"あい", U"か"})
+            ta.insert(k);
+        PrefixTree tb;
+        for (const auto &k : {U"あい", U"か"})
+            tb.insert(k);
+        Converter conv;
+        LOUDS a = conv.convert(ta.getRoot());
+        LOUDS b = conv.convert(tb.getRoot());
+        assert_true(a.LBS.size() == b.LBS.size() && a.isLeaf.size() == b.isLeaf.size(), "index: shapes should match");
+
+        const std::vector<std::u32string> before = {U"あ", U"あい"};
+        assert_true(u32_equals(a.commonPrefixSearch(U"あい"), before), "index: search before assignment");
+        a.saveToImageFile("louds_index_before.img"); // isLeaf のディレクトリも作らせる
+        a.LBS = b.LBS;
+        a.isLeaf = b.isLeaf;
+        const std::vector<std::u32string> after = {U"あい"};
+        assert_true(u32_equals(a.commonPrefixSearch(U"あい"), after), "index: search should see the assigned isLeaf");
+
+        auto readAll = [](const std::string &p)
+        {
+            std::ifstream ifs(p, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        };
+        a.saveToImageFile("louds_index_assigned.img");
+        b.saveToImageFile("louds_index_expected.img");
+        assert_true(readAll("louds_index_assigned.img") == readAll("louds_index_expected.img"),
+                    "index: image after assignment should carry the new directory");
+    }
+
     std::cout << "[OK] all LOUDS tests passed\n";
     return 0;
 }
@@ -2,12 +2,34 @@
 #include <cstdlib>
 #include <vector>
 #include <string>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <new>
+#include <cstddef>
+#include <memory>
 
 #include "prefix/prefix_tree.hpp"
 #include "louds/converter.hpp"
 #include "louds/louds.hpp"
 
 #include "louds/louds_reader.hpp"
+#include "common/louds_image.hpp"
+#include "common/mapped_file.hpp"
+
+// visitor 版 commonPrefixSearch がヒープ確保しないことを確かめるためのカウンタ
+static size_t g_allocations = 0;
+
+void *operator new(std::size_t n)
+{
+    ++g_allocations;
+    if (void *p = std::malloc(n == 0 ? 1 : n))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
 
 static void assert_true(bool cond, const char *msg)
 {
@@ -88,6 +110,336 @@ int main()
         assert_true(s == U"すみれ", "reader getLetter(nodeIndex_of_すみれ) should be U\"すみれ\"");
     }
 
+    // =========================================================
+    // 3) イメージ形式: saveToImageFile -> mapFromImageFile で旧形式と同じ結果
+    // =========================================================
+    {
+        PrefixTree t;
+        t.insert(U"す");
+        t.insert(U"すみ");
+        t.insert(U"すみれ");
+        t.insert(U"あい");
+        t.insert(U"あお");
+
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+
+        const std::string binPath = "louds_writer_image.bin";
+        const std::string imgPath = "louds_writer_image.img";
+        louds.saveToFile(binPath);
+        louds.saveToImageFile(imgPath);
+
+        LOUDSReader loaded = LOUDSReader::loadFromFile(binPath);
+        LOUDSReader mapped = LOUDSReader::mapFromImageFile(imgPath);
+
+        assert_true(loaded.getAllLabels().size() == mapped.getAllLabels().size(), "image labels size should match");
+        for (const std::u32string q : {U"すみれいろ", U"あお", U"あいす", U"か"})
+        {
+            assert_true(u32_equals(loaded.commonPrefixSearch(q), mapped.commonPrefixSearch(q)),
+                        "image commonPrefixSearch should match loadFromFile");
+            assert_true(loaded.getNodeIndex(q) == mapped.getNodeIndex(q), "image getNodeIndex should match loadFromFile");
+        }
+        const int idx = mapped.getNodeIndex(U"すみれ");
+        assert_true(idx >= 0 && mapped.getLetter(idx) == U"すみれ", "image getLetter should restore U\"すみれ\"");
+
+        // move しても mmap 上の参照は有効
+        LOUDSReader moved = std::move(mapped);
+        assert_true(moved.getNodeIndex(U"あお") == loaded.getNodeIndex(U"あお"), "moved image reader should still work");
+
+        // 旧形式のファイルや途中で切れたファイルは例外
+        bool threw = false;
+        try
+        {
+            LOUDSReader::mapFromImageFile(binPath);
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "mapFromImageFile should reject legacy .bin");
+
+        {
+            std::ifstream ifs(imgPath, std::ios::binary);
+            std::string bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            std::ofstream ofs("louds_writer_image_truncated.img", std::ios::binary);
+            ofs.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 8));
+        }
+        threw = false;
+        try
+        {
+            LOUDSReader::mapFromImageFile("louds_writer_image_truncated.img");
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "mapFromImageFile should reject truncated image");
+    }
+
+    // =========================================================
+    // 4) 旧形式 + 末尾ディレクトリ: Reader は保存済みディレクトリを使い、Writer の loadFromFile も読める
+    // =========================================================
+    {
+        PrefixTree t;
+        t.insert(U"す");
+        t.insert(U"すみ");
+        t.insert(U"すみれ");
+        t.insert(U"あお");
+
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+
+        const std::string plainPath = "louds_writer_plain.bin";
+        const std::string dirPath = "louds_writer_with_dir.bin";
+        louds.saveToFile(plainPath);
+        louds.saveToFile(dirPath, true);
+
+        LOUDSReader plain = LOUDSReader::loadFromFile(plainPath);
+        LOUDSReader withDir = LOUDSReader::loadFromFile(dirPath);
+        for (const std::u32string q : {U"すみれいろ", U"あお", U"か"})
+        {
+            assert_true(u32_equals(plain.commonPrefixSearch(q), withDir.commonPrefixSearch(q)),
+                        "directory trailer commonPrefixSearch should match rebuilt directory");
+            assert_true(plain.getNodeIndex(q) == withDir.getNodeIndex(q), "directory trailer getNodeIndex should match");
+        }
+        assert_true(withDir.getLetter(withDir.getNodeIndex(U"すみれ")) == U"すみれ", "directory trailer getLetter");
+
+        LOUDS reloaded = LOUDS::loadFromFile(dirPath);
+        assert_true(reloaded.equals(louds), "LOUDS::loadFromFile should ignore the directory trailer");
+
+        // セクションの長さが壊れた（ファイルの残りより長い）末尾セクションは、確保する前に例外
+        {
+            std::ifstream ifs(dirPath, std::ios::binary);
+            std::string bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            const size_t magicAt = bytes.rfind("LOUDSEXT");
+            assert_true(magicAt != std::string::npos, "directory trailer should start with its magic");
+            bytes.resize(magicAt + 8);
+            const uint64_t count = 1;
+            const uint32_t id = static_cast<uint32_t>(louds_image::SectionId::LbsRank);
+            const uint32_t elemBytes = sizeof(uint64_t);
+            const uint64_t huge = 1ULL << 40;
+            bytes.append(reinterpret_cast<const char *>(&count), sizeof(count));
+            bytes.append(reinterpret_cast<const char *>(&id), sizeof(id));
+            bytes.append(reinterpret_cast<const char *>(&elemBytes), sizeof(elemBytes));
+            bytes.append(reinterpret_cast<const char *>(&huge), sizeof(huge));
+            const std::string corruptPath = "louds_writer_corrupt_trailer.bin";
+            std::ofstream(corruptPath, std::ios::binary) << bytes;
+
+            bool rejected = false;
+            try
+            {
+                LOUDSReader::loadFromFile(corruptPath);
+            }
+            catch (const std::runtime_error &)
+            {
+                rejected = true;
+            }
+            assert_true(rejected, "oversized trailer section should be rejected without allocating it");
+        }
+
+        // 末尾に知らないデータがあるファイルは例外
+        {
+            std::ofstream ofs(plainPath, std::ios::binary | std::ios::app);
+            ofs << "garbage!";
+        }
+        bool threw = false;
+        try
+        {
+            LOUDSReader::loadFromFile(plainPath);
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "loadFromFile should reject unknown trailing data");
+    }
+
+    // =========================================================
+    // 5) 大きな fanout: 兄弟は昇順に並び、二分探索 / SIMD のどちらの経路でも引ける
+    // =========================================================
+    {
+        PrefixTree t;
+        std::vector<std::u32string> words;
+        for (char32_t c = 0x3041; c < 0x3041 + 80; ++c)
+        {
+            words.push_back(std::u32string(1, c));
+            // 2 文字目は fanout が小さい区間（SIMD の経路）
+            for (char32_t d = U'a'; d < U'a' + static_cast<char32_t>(c % 7); ++d)
+                words.push_back(std::u32string{c, d});
+        }
+        for (auto it = words.rbegin(); it != words.rend(); ++it)
+            t.insert(*it);
+
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+        assert_true(louds.siblingOrder == louds_image::SiblingOrder::CodeUnitAscending, "converter should emit sorted siblings");
+
+        // ルートの子（labels[2..81]）は昇順
+        for (size_t i = 3; i < 2 + 80; ++i)
+            assert_true(louds.labels[i - 1] < louds.labels[i], "root children should be in code unit order");
+
+        const std::string path = "louds_writer_fanout.bin";
+        louds.saveToFile(path);
+        LOUDSReader reader = LOUDSReader::loadFromFile(path);
+
+        for (const auto &w : words)
+        {
+            const int idx = reader.getNodeIndex(w);
+            assert_true(idx >= 0 && reader.getLetter(idx) == w, "fanout getNodeIndex/getLetter should round-trip");
+            const auto r = reader.commonPrefixSearch(w + U"z");
+            assert_true(!r.empty() && r.back() == w, "fanout commonPrefixSearch should end with the word");
+        }
+        assert_true(reader.getNodeIndex(U"\u3040") == -1, "fanout missing label before the span");
+        assert_true(reader.getNodeIndex(U"\u30ff") == -1, "fanout missing label after the span");
+        assert_true(reader.getNodeIndex(std::u32string{0x3042, U'z'}) == -1, "fanout missing second label");
+    }
+
+    // =========================================================
+    // 5b) louds_image::Writer: 並び順を足したあとで Writer を move しても、書く値は変わらない
+    // =========================================================
+    {
+        auto original = std::make_unique<louds_image::Writer>(louds_image::Kind::Louds, sizeof(char32_t));
+        original->addSiblingOrder(louds_image::SiblingOrder::CodePointAscending);
+        louds_image::Writer moved = std::move(*original);
+        original.reset();
+
+        const std::string path = "louds_image_writer_moved.img";
+        moved.writeTo(path);
+        const MappedFile file(path);
+        const louds_image::View view(file, louds_image::Kind::Louds, sizeof(char32_t));
+        assert_true(view.siblingOrder() == louds_image::SiblingOrder::CodePointAscending,
+                    "moved image writer should keep the sibling order");
+    }
+
+    // =========================================================
+    // 6) visitor / 固定長出力の commonPrefixSearch（ヒープ確保なし）
+    // =========================================================
+    {
+        PrefixTree t;
+        t.insert(U"す");
+        t.insert(U"すみ");
+        t.insert(U"すみれ");
+
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+        const std::string path = "louds_writer_visitor.bin";
+        louds.saveToFile(path);
+        LOUDSReader reader = LOUDSReader::loadFromFile(path);
+
+        const std::u32string query = U"すみれいろ";
+        size_t lengths[4] = {};
+        LoudsPos nodes[4] = {};
+        size_t hits = 0;
+
+        const size_t before = g_allocations;
+        reader.commonPrefixSearch(std::u32string_view(query), [&](size_t length, LoudsPos nodeIndex)
+                                  {
+                                      lengths[hits] = length;
+                                      nodes[hits] = nodeIndex;
+                                      ++hits; });
+        LoudsPrefixMatch out[2];
+        const size_t n = reader.commonPrefixSearch(std::u32string_view(query), std::span<LoudsPrefixMatch>(out));
+        assert_true(g_allocations == before, "visitor commonPrefixSearch should not allocate");
+
+        assert_true(hits == 3, "visitor should report 3 prefixes");
+        assert_true(lengths[0] == 1 && lengths[1] == 2 && lengths[2] == 3, "visitor prefix lengths should be 1,2,3");
+        assert_true(nodes[2] == reader.getNodeIndex(U"すみれ"), "visitor nodeIndex should match getNodeIndex");
+
+        assert_true(n == 2, "fixed-capacity output should stop when full");
+        assert_true(out[0].length == 1 && out[1].length == 2, "fixed-capacity output lengths should be 1,2");
+
+        // bool を返す visitor は false で打ち切る
+        hits = 0;
+        reader.commonPrefixSearch(std::u32string_view(query), [&](size_t, LoudsPos)
+                                  { return ++hits < 1; });
+        assert_true(hits == 1, "visitor returning false should stop the search");
+    }
+
+    // =========================================================
+    // 7) predictiveSearch / predictiveCursor（短い順・limit で打ち切り）
+    // =========================================================
+    {
+        PrefixTree t;
+        for (const std::u32string w : {U"a", U"ab", U"abc", U"abd", U"b", U"ba"})
+            t.insert(w);
+
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+        const std::string path = "louds_writer_predictive.bin";
+        louds.saveToFile(path);
+        LOUDSReader reader = LOUDSReader::loadFromFile(path);
+
+        std::vector<std::u32string> expected = {U"a", U"ab", U"abc", U"abd"};
+        assert_true(u32_equals(reader.predictiveSearch(U"a", 10), expected), "predictiveSearch('a') should be {a,ab,abc,abd}");
+
+        expected = {U"a", U"b", U"ab", U"ba", U"abc", U"abd"};
+        assert_true(u32_equals(reader.predictiveSearch(U"", 10), expected), "predictiveSearch('') should enumerate all keys breadth-first");
+
+        expected = {U"a", U"b", U"ab"};
+        assert_true(u32_equals(reader.predictiveSearch(U"", 3), expected), "predictiveSearch should stop at limit");
+
+        assert_true(reader.predictiveSearch(U"ab", 0).empty(), "predictiveSearch with limit 0 should be empty");
+        assert_true(reader.predictiveSearch(U"x", 10).empty(), "predictiveSearch with unknown prefix should be empty");
+
+        LOUDSReader::PredictiveCursor cursor = reader.predictiveCursor(U"ab");
+        LoudsPrefixMatch m;
+        assert_true(cursor.next(m) && m.length == 2 && m.nodeIndex == reader.getNodeIndex(U"ab"), "cursor first match should be 'ab'");
+        assert_true(cursor.next(m) && m.length == 3 && reader.getLetter(m.nodeIndex) == U"abc", "cursor second match should be 'abc'");
+        assert_true(cursor.next(m) && reader.getLetter(m.nodeIndex) == U"abd", "cursor third match should be 'abd'");
+        assert_true(!cursor.next(m) && !cursor.next(m), "cursor should stay exhausted");
+
+        LOUDSReader::PredictiveCursor none = reader.predictiveCursor(U"zz");
+        assert_true(!none.next(m), "cursor for unknown prefix should be empty");
+    }
+
+    // =========================================================
+    // 8) バッチ版（lockstep）は 1 件ずつの結果と一致する
+    // =========================================================
+    {
+        PrefixTree t;
+        for (const std::u32string w : {U"a", U"ab", U"abc", U"abd", U"b", U"ba", U"す", U"すみ", U"すみれ"})
+            t.insert(w);
+
+        Converter conv;
+        LOUDS louds = conv.convert(t.getRoot());
+        const std::string path = "louds_writer_batch.bin";
+        louds.saveToFile(path);
+        LOUDSReader reader = LOUDSReader::loadFromFile(path);
+
+        const std::vector<std::u32string> words = {U"abc", U"", U"x", U"すみれいろ", U"ab", U"abdz", U"b", U"すみ"};
+        std::vector<std::u32string_view> queries(words.begin(), words.end());
+
+        std::vector<LoudsPos> out(queries.size());
+        reader.getNodeIndexBatch(queries, out);
+        for (size_t i = 0; i < words.size(); ++i)
+            assert_true(out[i] == reader.getNodeIndex(words[i]), "getNodeIndexBatch should match getNodeIndex");
+
+        std::vector<std::vector<std::u32string>> hits(queries.size());
+        reader.commonPrefixSearchBatch(queries, [&](size_t query, size_t length, LoudsPos)
+                                       { hits[query].push_back(words[query].substr(0, length)); });
+        for (size_t i = 0; i < words.size(); ++i)
+            assert_true(u32_equals(hits[i], reader.commonPrefixSearch(words[i])),
+                        "commonPrefixSearchBatch should match commonPrefixSearch");
+
+        // bool を返す visitor はそのクエリだけを打ち切る
+        std::vector<size_t> counts(queries.size(), 0);
+        reader.commonPrefixSearchBatch(queries, [&](size_t query, size_t, LoudsPos)
+                                       { return ++counts[query] < 1; });
+        assert_true(counts[0] == 1 && counts[3] == 1, "commonPrefixSearchBatch should stop a query on false");
+
+        bool threw = false;
+        try
+        {
+            std::vector<LoudsPos> small(1);
+            reader.getNodeIndexBatch(queries, small);
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "getNodeIndexBatch should reject mismatched output size");
+    }
+
     std::cout << "[OK] LOUDSReader tests passed\n";
     return 0;
 }
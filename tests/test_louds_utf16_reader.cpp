@@ -86,6 +86,81 @@ int main()
         assert_true(s == u"すみれ", "reader getLetter(nodeIndex_of_すみれ) should be u\"すみれ\"");
     }
 
+    // 3) イメージ形式: saveToImageFile -> mapFromImageFile
+    {
+        PrefixTreeUtf16 t;
+        t.insert(u"す");
+        t.insert(u"すみ");
+        t.insert(u"すみれ");
+
+        ConverterUtf16 conv;
+        LOUDSUtf16 louds = conv.convert(t.getRoot());
+
+        const std::string path = "louds_writer_hira_utf16.img";
+        louds.saveToImageFile(path);
+
+        LOUDSReaderUtf16 reader = LOUDSReaderUtf16::mapFromImageFile(path);
+
+        auto r = reader.commonPrefixSearch(u"すみれいろ");
+        std::vector<std::u16string> expected = {u"す", u"すみ", u"すみれ"};
+        assert_true(u16_equals(r, expected),
+                    "image reader hiragana commonPrefixSearch should be {す,すみ,すみれ}");
+
+        const int idx = reader.getNodeIndex(u"すみれ");
+        assert_true(idx >= 0 && reader.getLetter(idx) == u"すみれ",
+                    "image reader getLetter(nodeIndex_of_すみれ) should be u\"すみれ\"");
+    }
+
+    // 4) 大きな fanout（兄弟は昇順。二分探索 / SIMD の両方の経路）
+    {
+        PrefixTreeUtf16 t;
+        std::vector<std::u16string> words;
+        for (char16_t c = 0x30A1; c < 0x30A1 + 70; ++c)
+        {
+            words.push_back(std::u16string(1, c));
+            for (char16_t d = u'a'; d < u'a' + static_cast<char16_t>(c % 11); ++d)
+                words.push_back(std::u16string{c, d});
+        }
+        for (auto it = words.rbegin(); it != words.rend(); ++it)
+            t.insert(*it);
+
+        ConverterUtf16 conv;
+        LOUDSUtf16 louds = conv.convert(t.getRoot());
+
+        const std::string path = "louds_writer_fanout_utf16.img";
+        louds.saveToImageFile(path);
+        LOUDSReaderUtf16 reader = LOUDSReaderUtf16::mapFromImageFile(path);
+
+        for (const auto &w : words)
+        {
+            const int idx = reader.getNodeIndex(w);
+            assert_true(idx >= 0 && reader.getLetter(idx) == w, "fanout getNodeIndex/getLetter should round-trip");
+        }
+        assert_true(reader.getNodeIndex(u"\u30A0") == -1, "fanout missing label before the span");
+        assert_true(reader.getNodeIndex(std::u16string{0x30A2, u'z'}) == -1, "fanout missing second label");
+    }
+
+    // =========================================================
+    // predictiveSearch（UTF-16）
+    // =========================================================
+    {
+        PrefixTreeUtf16 t;
+        t.insert(u"す");
+        t.insert(u"すみ");
+        t.insert(u"すみれ");
+        t.insert(u"すし");
+
+        ConverterUtf16 conv;
+        LOUDSUtf16 louds = conv.convert(t.getRoot());
+        const std::string path = "louds_utf16_predictive.bin";
+        louds.saveToFile(path);
+        LOUDSReaderUtf16 reader = LOUDSReaderUtf16::loadFromFile(path);
+
+        std::vector<std::u16string> expected = {u"す", u"すし", u"すみ"};
+        assert_true(u16_equals(reader.predictiveSearch(u"す", 3), expected),
+                    "utf16 predictiveSearch('す', 3) should be {す,すし,すみ}");
+    }
+
     std::cout << "[OK] LOUDS UTF-16 reader tests passed\n";
     return 0;
 }
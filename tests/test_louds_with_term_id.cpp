@@ -2,10 +2,18 @@
 #include <cstdlib>
 #include <vector>
 #include <string>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <algorithm>
 
+#include "prefix/prefix_tree.hpp"
 #include "prefix_with_term_id/prefix_tree_with_term_id.hpp"
+#include "louds/converter.hpp"
+#include "louds/louds.hpp"
 #include "louds_with_term_id/converter_with_term_id.hpp"
 #include "louds_with_term_id/louds_with_term_id.hpp"
+#include "common/sorted_louds_builder.hpp"
 
 static void assert_true(bool cond, const char *msg)
 {
@@ -158,6 +166,310 @@ int main()
         assert_true(loaded.getTermId(idx_sumire) == 3, "termId: loaded termId for 'すみれ' should be 3");
     }
 
+    // =========================================================
+    // 4) score 列: 部分木の最大 score + バイナリ round-trip
+    // =========================================================
+    {
+        PrefixTreeWithTermId st;
+        st.insert(U"す");     // termId 1
+        st.insert(U"すみ");   // termId 2
+        st.insert(U"すみれ"); // termId 3
+        st.insert(U"あお");   // termId 4
+
+        const std::vector<uint32_t> scores = {0, 5, 1, 9, 3};
+        ConverterWithTermId sconv;
+        LOUDSWithTermId slouds = sconv.convert(st.getRoot(), scores);
+
+        assert_true(slouds.maxScores.size() == slouds.labels.size(), "score: maxScores should be parallel to labels");
+        assert_true(slouds.termScores.size() == slouds.termIdsSave.size(), "score: termScores should be parallel to termIdsSave");
+        assert_true(slouds.maxScores[1] == 9, "score: root max should be 9");
+        for (size_t i = 0; i < slouds.termIdsSave.size(); ++i)
+            assert_true(slouds.termScores[i] == scores[static_cast<size_t>(slouds.termIdsSave[i])], "score: termScores should follow termIdsSave");
+
+        const std::string path = "louds_with_term_id_scores_test.bin";
+        slouds.saveToFile(path);
+        LOUDSWithTermId loaded = LOUDSWithTermId::loadFromFile(path);
+        assert_true(loaded.equals(slouds), "score: binary round-trip should preserve score columns");
+
+        LOUDSWithTermId plain = sconv.convert(st.getRoot());
+        assert_true(plain.maxScores.empty() && plain.termScores.empty(), "score: convert without scores should leave columns empty");
+    }
+
+    // =========================================================
+    // 5) SortedLoudsBuilder: termId（重複・空キーも番号を消費）が PrefixTreeWithTermId と一致
+    // =========================================================
+    {
+        const std::vector<std::u32string> keys = {U"", U"す", U"すみ", U"すみ", U"すみれ", U"すもも", U"た", U"たぬき"};
+
+        PrefixTreeWithTermId t;
+        for (const auto &k : keys)
+            t.insert(k);
+        ConverterWithTermId conv;
+        LOUDSWithTermId expected = conv.convert(t.getRoot());
+
+        SortedLoudsBuilder<char32_t>::Options options;
+        options.spillRecords = 3;
+        SortedLoudsBuilder<char32_t> builder(options);
+        for (const auto &k : keys)
+            builder.add(k);
+
+        const std::string path = "louds_with_term_id_sorted_builder_test.bin";
+        builder.writeLoudsWithTermIdFile(path);
+        LOUDSWithTermId streamed = LOUDSWithTermId::loadFromFile(path);
+        assert_true(streamed.equals(expected), "sorted builder: streamed termId .bin should equal ConverterWithTermId output");
+
+        auto result = builder.finish();
+        LOUDSWithTermId built;
+        built.LBS = std::move(result.LBS);
+        built.isLeaf = std::move(result.isLeaf);
+        built.labels = std::move(result.labels);
+        built.termIdsSave = std::move(result.termIdsSave);
+        assert_true(built.equals(expected), "sorted builder: finish() should equal ConverterWithTermId output");
+        assert_true(built.getTermId(built.getNodeIndex(U"すみれ")) == 5, "sorted builder: termId of 'すみれ' should be 5");
+    }
+
+    // =========================================================
+    // 5b) SortedLoudsBuilder: ディレクトリ付き .bin と .img を一時ファイルから直接書く
+    //     （select サンプルが複数ブロックにまたがる大きさで、Converter の出力とバイト単位で一致）
+    // =========================================================
+    {
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<int> len(1, 6);
+        std::uniform_int_distribution<int> ch(0, 11);
+        std::vector<std::u32string> keys;
+        for (int i = 0; i < 3000; ++i)
+        {
+            std::u32string k;
+            const int n = len(rng);
+            for (int j = 0; j < n; ++j)
+                k.push_back(static_cast<char32_t>(U'あ' + ch(rng)));
+            keys.push_back(k);
+        }
+        std::sort(keys.begin(), keys.end());
+
+        PrefixTreeWithTermId t;
+        for (const auto &k : keys)
+            t.insert(k);
+        ConverterWithTermId conv;
+        LOUDSWithTermId expected = conv.convert(t.getRoot());
+
+        SortedLoudsBuilder<char32_t>::Options options;
+        options.spillRecords = 64;
+        SortedLoudsBuilder<char32_t> builder(options);
+        for (const auto &k : keys)
+            builder.add(k);
+
+        auto readAll = [](const std::string &path)
+        {
+            std::ifstream ifs(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        };
+        expected.saveToFile("louds_with_term_id_sorted_expected_dir.bin", true);
+        builder.writeLoudsWithTermIdFile("louds_with_term_id_sorted_dir.bin", true);
+        assert_true(readAll("louds_with_term_id_sorted_expected_dir.bin") == readAll("louds_with_term_id_sorted_dir.bin"),
+                    "sorted builder: .bin with directory should match LOUDSWithTermId::saveToFile(path, true)");
+        expected.saveToImageFile("louds_with_term_id_sorted_expected.img");
+        builder.writeLoudsWithTermIdImageFile("louds_with_term_id_sorted.img");
+        assert_true(readAll("louds_with_term_id_sorted_expected.img") == readAll("louds_with_term_id_sorted.img"),
+                    "sorted builder: image should match LOUDSWithTermId::saveToImageFile");
+    }
+
+    // =========================================================
+    // 6) saveLoudsToFile / saveLoudsToImageFile: termId 無しの LOUDS と同じバイト列
+    // =========================================================
+    {
+        const std::vector<std::u32string> keys = {U"すみれ", U"す", U"あお", U"すもも", U"あ"};
+        PrefixTree plainTree;
+        PrefixTreeWithTermId termTree;
+        for (const auto &k : keys)
+        {
+            plainTree.insert(k);
+            termTree.insert(k);
+        }
+        Converter plainConv;
+        LOUDS plain = plainConv.convert(plainTree.getRoot());
+        ConverterWithTermId termConv;
+        LOUDSWithTermId withTermId = termConv.convert(termTree.getRoot());
+
+        auto readAll = [](const std::string &path)
+        {
+            std::ifstream ifs(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        };
+
+        plain.saveToFile("louds_plain_expected.bin", true);
+        withTermId.saveLoudsToFile("louds_plain_shared.bin", true);
+        assert_true(readAll("louds_plain_expected.bin") == readAll("louds_plain_shared.bin"),
+                    "saveLoudsToFile should write the same bytes as LOUDS::saveToFile");
+
+        plain.saveToImageFile("louds_plain_expected.img");
+        withTermId.saveLoudsToImageFile("louds_plain_shared.img");
+        assert_true(readAll("louds_plain_expected.img") == readAll("louds_plain_shared.img"),
+                    "saveLoudsToImageFile should write the same bytes as LOUDS::saveToImageFile");
+    }
+
+    // =========================================================
+    // 7) convertParallel: スレッド数によらず convert と同じ列（LOUDS / termId / score）
+    // =========================================================
+    {
+        std::mt19937 rng(2024);
+        std::uniform_int_distribution<int> len(0, 7);
+        std::uniform_int_distribution<int> ch(0, 11);
+        std::vector<std::u32string> keys;
+        for (int i = 0; i < 3000; ++i)
+        {
+            std::u32string k(static_cast<size_t>(len(rng)), U'\0');
+            for (char32_t &c : k)
+                c = static_cast<char32_t>(U'あ' + ch(rng));
+            keys.push_back(k);
+        }
+
+        PrefixTree plainTree;
+        PrefixTreeWithTermId termTree;
+        for (const auto &k : keys)
+        {
+            plainTree.insert(k);
+            termTree.insert(k);
+        }
+        std::vector<uint32_t> scores(keys.size() + 1);
+        for (uint32_t &v : scores)
+            v = static_cast<uint32_t>(rng() % 1000);
+
+        Converter plainConv;
+        ConverterWithTermId termConv;
+        const LOUDS plainSerial = plainConv.convert(plainTree.getRoot());
+        const LOUDSWithTermId termSerial = termConv.convert(termTree.getRoot());
+        const LOUDSWithTermId scoredSerial = termConv.convert(termTree.getRoot(), scores);
+        for (size_t threads : {size_t{0}, size_t{1}, size_t{2}, size_t{3}, size_t{16}})
+        {
+            assert_true(plainConv.convertParallel(plainTree.getRoot(), threads).equals(plainSerial),
+                        "convertParallel: LOUDS should match convert");
+            const LOUDSWithTermId term = termConv.convertParallel(termTree.getRoot(), threads);
+            assert_true(term.equals(termSerial), "convertParallel: LOUDSWithTermId should match convert");
+            assert_true(term.siblingOrder == termSerial.siblingOrder, "convertParallel: sibling order should match convert");
+            assert_true(termConv.convertParallel(termTree.getRoot(), scores, threads).equals(scoredSerial),
+                        "convertParallel: score columns should match convert");
+        }
+
+        // 空の木 / 根の子が 1 つだけ
+        PrefixTreeWithTermId empty;
+        assert_true(termConv.convertParallel(empty.getRoot(), 4).equals(termConv.convert(empty.getRoot())),
+                    "convertParallel: empty tree should match convert");
+        PrefixTreeWithTermId single;
+        single.insert(U"すみれ");
+        single.insert(U"すもも");
+        assert_true(termConv.convertParallel(single.getRoot(), 4).equals(termConv.convert(single.getRoot())),
+                    "convertParallel: single shard should match convert");
+    }
+
+    // =========================================================
+    // 8) convertByFrequency: 兄弟が重みの降順。中身（prefix / termId / score）は convert と同じで、並び順は保存される
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"すし");   // termId=1
+        t.insert(U"すみ");   // termId=2
+        t.insert(U"すみれ"); // termId=3
+        t.insert(U"すもも"); // termId=4
+        t.insert(U"あお");   // termId=5
+        t.insert(U"か");     // termId=6
+
+        // 語の重み: すもも > すし > その他。部分木の合計なので根の子は す(9+1+2+40) > か(5) > あ(3)
+        const std::vector<uint32_t> weights = {0, 9, 1, 2, 40, 3, 5};
+        const auto nodeWeights = NodeWeights<PrefixNodeWithTermId>::fromTermWeights(t.getRoot(), weights);
+        assert_true(nodeWeights.weightOf(t.getRoot()->getChild(U'す')) == 52, "fromTermWeights: subtree sum");
+
+        ConverterWithTermId conv;
+        const LOUDSWithTermId byLabel = conv.convert(t.getRoot());
+        const LOUDSWithTermId byFreq = conv.convertByFrequency(t.getRoot(), nodeWeights);
+        assert_true(byFreq.siblingOrder == louds_image::SiblingOrder::FrequencyDescending, "convertByFrequency: sibling order");
+        // labels[2..4] は根の子
+        assert_true(byFreq.labels[2] == U'す' && byFreq.labels[3] == U'か' && byFreq.labels[4] == U'あ',
+                    "convertByFrequency: root children by weight");
+        assert_true(byFreq.labels.size() == byLabel.labels.size(), "convertByFrequency: same node count");
+
+        const std::vector<std::u32string> keys = {U"すし", U"すみれ", U"すもも", U"あお", U"か", U"すみ", U"すみれいろ", U"さ"};
+        for (const auto &k : keys)
+        {
+            assert_true(u32_equals(byFreq.commonPrefixSearch(k), byLabel.commonPrefixSearch(k)),
+                        "convertByFrequency: commonPrefixSearch should match convert");
+            const LoudsPos a = byFreq.getNodeIndex(k);
+            const LoudsPos b = byLabel.getNodeIndex(k);
+            assert_true((a < 0) == (b < 0), "convertByFrequency: same keys");
+            if (a >= 0)
+                assert_true(byFreq.getTermId(a) == byLabel.getTermId(b), "convertByFrequency: same termId");
+        }
+
+        // score 列も並べ替えに追従する（ルートの最大値は同じ）
+        const std::vector<uint32_t> scores = {0, 5, 2, 1, 9, 7, 3};
+        const LOUDSWithTermId scored = conv.convertByFrequency(t.getRoot(), nodeWeights, scores);
+        assert_true(scored.maxScores.size() == scored.labels.size() && scored.maxScores[1] == 9,
+                    "convertByFrequency: max subtree score at root");
+        assert_true(scored.maxScores[2] == 9 && scored.maxScores[3] == 3 && scored.maxScores[4] == 7,
+                    "convertByFrequency: max subtree score follows the new order");
+
+        // .bin round-trip で並び順が残る
+        const std::string path = "louds_term_frequency.bin";
+        byFreq.saveToFile(path, true);
+        const LOUDSWithTermId loaded = LOUDSWithTermId::loadFromFile(path);
+        assert_true(loaded.equals(byFreq), "convertByFrequency: round-trip");
+        assert_true(loaded.siblingOrder == louds_image::SiblingOrder::FrequencyDescending, "convertByFrequency: order survives round-trip");
+
+        // 重みが空ならラベル順と同じ列（並び順の記録だけ違う）
+        const LOUDSWithTermId unweighted = conv.convertByFrequency(t.getRoot(), NodeWeights<PrefixNodeWithTermId>{});
+        assert_true(unweighted.equals(byLabel), "convertByFrequency: empty weights keep label order");
+
+        // クエリログ: たどれたノードに +1（外れたクエリも外れるまで数える）
+        PrefixTree plain;
+        for (const auto &k : keys)
+            plain.insert(k);
+        NodeWeights<PrefixNode> queryWeights;
+        for (const char32_t *q : {U"あお", U"あお", U"あおい", U"か"})
+            queryWeights.addQuery(plain.getRoot(), q);
+        assert_true(queryWeights.weightOf(plain.getRoot()->getChild(U'あ')) == 3, "addQuery: counts partial matches");
+        const LOUDS plainFreq = Converter().convertByFrequency(plain.getRoot(), queryWeights);
+        assert_true(plainFreq.labels[2] == U'あ' && plainFreq.labels[3] == U'か', "addQuery: hot child first");
+        assert_true(u32_equals(plainFreq.commonPrefixSearch(U"すみれいろ"), {U"すみ", U"すみれ", U"すみれいろ"}),
+                    "LOUDS convertByFrequency: commonPrefixSearch");
+    }
+
+    // =========================================================
+    // 9) Writer の検索用ディレクトリ: コピー・move・ビット列の置き換え・ディレクトリ付き読み込みでも結果が正しい
+    // =========================================================
+    {
+        PrefixTreeWithTermId a;
+        a.insert(U"すし");
+        a.insert(U"すみれ");
+        PrefixTreeWithTermId b;
+        b.insert(U"あお");
+        b.insert(U"あおい");
+
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(a.getRoot());
+        assert_true(louds.getNodeIndex(U"すみれ") >= 0, "index: first query builds the directory");
+
+        const LOUDSWithTermId copy = louds;
+        assert_true(copy.getTermId(copy.getNodeIndex(U"すみれ")) == 2, "index: copy answers with its own bits");
+        const LOUDSWithTermId moved = std::move(louds);
+        assert_true(moved.getTermId(moved.getNodeIndex(U"すし")) == 1, "index: move keeps the directory usable");
+
+        // LBS / isLeaf / labels を別の辞書に差し替えると次の検索で作り直す
+        LOUDSWithTermId swapped = copy;
+        const LOUDSWithTermId other = conv.convert(b.getRoot());
+        swapped.LBS = other.LBS;
+        swapped.isLeaf = other.isLeaf;
+        swapped.labels = other.labels;
+        swapped.termIdsSave = other.termIdsSave;
+        assert_true(swapped.getNodeIndex(U"すし") < 0, "index: replaced bits drop old keys");
+        assert_true(u32_equals(swapped.commonPrefixSearch(U"あおいろ"), {U"あお", U"あおい"}), "index: replaced bits find new keys");
+
+        // ディレクトリ付きの .bin はそれを使う（結果は同じ）
+        copy.saveToFile("louds_term_index.bin", true);
+        const LOUDSWithTermId loaded = LOUDSWithTermId::loadFromFile("louds_term_index.bin");
+        assert_true(loaded.getTermId(loaded.getNodeIndex(U"すみれ")) == 2, "index: adopted directory from .bin");
+        assert_true(u32_equals(loaded.commonPrefixSearch(U"すしや"), {U"すし"}), "index: adopted directory commonPrefixSearch");
+    }
+
     std::cout << "[OK] all LOUDSWithTermId tests passed\n";
     return 0;
 }
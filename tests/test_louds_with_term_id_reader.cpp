@@ -2,6 +2,10 @@
 #include <cstdlib>
 #include <vector>
 #include <string>
+#include <stdexcept>
+#include <random>
+#include <utility>
+#include <algorithm>
 
 #include "prefix_with_term_id/prefix_tree_with_term_id.hpp"
 #include "louds_with_term_id/converter_with_term_id.hpp"
@@ -101,6 +105,295 @@ int main()
         assert_true(reader.getTermId(idx_sumire) == 3, "term reader termId('すみれ') should be 3");
     }
 
+    // =========================================================
+    // 3) イメージ形式: mapFromImageFile でも prefix と termId が一致
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"す");     // termId=1
+        t.insert(U"すみ");   // termId=2
+        t.insert(U"すみれ"); // termId=3
+        t.insert(U"あお");   // termId=4
+
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(t.getRoot());
+
+        const std::string path = "louds_term_writer_image.img";
+        louds.saveToImageFile(path);
+
+        LOUDSWithTermIdReader reader = LOUDSWithTermIdReader::mapFromImageFile(path);
+
+        auto r = reader.commonPrefixSearch(U"すみれいろ");
+        std::vector<std::u32string> expected = {U"す", U"すみ", U"すみれ"};
+        assert_true(u32_equals(r, expected), "term image reader commonPrefixSearch should be {す,すみ,すみれ}");
+
+        assert_true(reader.getTermId(reader.getNodeIndex(U"すみ")) == 2, "term image reader termId('すみ') should be 2");
+        assert_true(reader.getTermId(reader.getNodeIndex(U"あお")) == 4, "term image reader termId('あお') should be 4");
+        assert_true(reader.getLetter(reader.getNodeIndex(U"すみれ")) == U"すみれ", "term image reader getLetter should restore すみれ");
+    }
+
+    // =========================================================
+    // 4) 旧形式 + 末尾ディレクトリ（LBS / isLeaf 両方）
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"a");   // termId=1
+        t.insert(U"ab");  // termId=2
+        t.insert(U"abc"); // termId=3
+        t.insert(U"b");   // termId=4
+
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(t.getRoot());
+
+        const std::string path = "louds_term_writer_with_dir.bin";
+        louds.saveToFile(path, true);
+
+        LOUDSWithTermIdReader reader = LOUDSWithTermIdReader::loadFromFile(path);
+
+        auto r = reader.commonPrefixSearch(U"abcd");
+        std::vector<std::u32string> expected = {U"a", U"ab", U"abc"};
+        assert_true(u32_equals(r, expected), "term reader with directory commonPrefixSearch should be {a,ab,abc}");
+        assert_true(reader.getTermId(reader.getNodeIndex(U"abc")) == 3, "term reader with directory termId('abc') should be 3");
+        assert_true(reader.getTermId(reader.getNodeIndex(U"b")) == 4, "term reader with directory termId('b') should be 4");
+    }
+
+    // =========================================================
+    // 5) visitor / 固定長出力の commonPrefixSearch は termId も返す
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"す");     // termId=1
+        t.insert(U"すみ");   // termId=2
+        t.insert(U"すみれ"); // termId=3
+
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(t.getRoot());
+
+        const std::string path = "louds_term_writer_visitor.bin";
+        louds.saveToFile(path);
+        LOUDSWithTermIdReader reader = LOUDSWithTermIdReader::loadFromFile(path);
+
+        std::vector<LoudsTermPrefixMatch> seen;
+        reader.commonPrefixSearch(std::u32string_view(U"すみれいろ"), [&](size_t length, LoudsPos nodeIndex, int32_t termId)
+                                  { seen.push_back({length, nodeIndex, termId}); });
+        assert_true(seen.size() == 3, "term visitor should report 3 prefixes");
+        assert_true(seen[0].length == 1 && seen[0].termId == 1, "term visitor first match should be (1, termId=1)");
+        assert_true(seen[2].length == 3 && seen[2].termId == 3, "term visitor last match should be (3, termId=3)");
+        assert_true(seen[1].nodeIndex == reader.getNodeIndex(U"すみ"), "term visitor nodeIndex should match getNodeIndex");
+
+        LoudsTermPrefixMatch out[1];
+        const size_t n = reader.commonPrefixSearch(std::u32string_view(U"すみれいろ"), std::span<LoudsTermPrefixMatch>(out));
+        assert_true(n == 1 && out[0].termId == 1, "term fixed-capacity output should keep the shortest match");
+    }
+
+    // =========================================================
+    // 6) predictiveSearch / predictiveCursor は termId も返す
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"す");     // termId=1
+        t.insert(U"すみ");   // termId=2
+        t.insert(U"すみれ"); // termId=3
+        t.insert(U"あお");   // termId=4
+
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(t.getRoot());
+        const std::string path = "louds_term_writer_predictive.bin";
+        louds.saveToFile(path);
+        LOUDSWithTermIdReader reader = LOUDSWithTermIdReader::loadFromFile(path);
+
+        std::vector<std::u32string> expected = {U"すみ", U"すみれ"};
+        assert_true(u32_equals(reader.predictiveSearch(U"すみ", 10), expected), "term predictiveSearch('すみ') should be {すみ,すみれ}");
+
+        LOUDSWithTermIdReader::PredictiveCursor cursor = reader.predictiveCursor(U"す");
+        LoudsTermPrefixMatch m;
+        assert_true(cursor.next(m) && m.length == 1 && m.termId == 1, "term cursor first match should be (1, termId=1)");
+        assert_true(cursor.next(m) && m.length == 2 && m.termId == 2, "term cursor second match should be (2, termId=2)");
+        assert_true(cursor.next(m) && m.length == 3 && m.termId == 3, "term cursor third match should be (3, termId=3)");
+        assert_true(!cursor.next(m), "term cursor should be exhausted");
+    }
+
+    // =========================================================
+    // 7) predictiveTopK: score 降順の上位 k 件（.bin / .img）
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"す");     // termId=1
+        t.insert(U"すみ");   // termId=2
+        t.insert(U"すみれ"); // termId=3
+        t.insert(U"すし");   // termId=4
+        t.insert(U"あお");   // termId=5
+
+        const std::vector<uint32_t> scores = {0, 5, 1, 9, 7, 3};
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(t.getRoot(), scores);
+
+        const std::string binPath = "louds_term_writer_scores.bin";
+        const std::string imgPath = "louds_term_writer_scores.img";
+        louds.saveToFile(binPath);
+        louds.saveToImageFile(imgPath);
+
+        const LOUDSWithTermIdReader loaded = LOUDSWithTermIdReader::loadFromFile(binPath);
+        const LOUDSWithTermIdReader mapped = LOUDSWithTermIdReader::mapFromImageFile(imgPath);
+        for (const LOUDSWithTermIdReader *reader : {&loaded, &mapped})
+        {
+            assert_true(reader->hasScores(), "scored reader should have scores");
+
+            const auto top = reader->predictiveTopK(U"す", 3);
+            assert_true(top.size() == 3, "predictiveTopK('す', 3) should return 3 matches");
+            assert_true(top[0].termId == 3 && top[0].score == 9 && top[0].length == 3, "top1 should be すみれ (9)");
+            assert_true(top[1].termId == 4 && top[1].score == 7, "top2 should be すし (7)");
+            assert_true(top[2].termId == 1 && top[2].score == 5, "top3 should be す (5)");
+            assert_true(reader->getLetter(top[1].nodeIndex) == U"すし", "top2 nodeIndex should restore すし");
+
+            const auto all = reader->predictiveTopK(U"", 10);
+            assert_true(all.size() == 5, "predictiveTopK('') should return every key");
+            for (size_t i = 1; i < all.size(); ++i)
+                assert_true(all[i - 1].score >= all[i].score, "predictiveTopK should be in score order");
+
+            assert_true(reader->predictiveTopK(U"か", 3).empty(), "predictiveTopK with unknown prefix should be empty");
+        }
+
+        const LOUDSWithTermIdReader plain = LOUDSWithTermIdReader::loadFromFile("louds_term_writer_predictive.bin");
+        assert_true(!plain.hasScores(), "reader without score columns should report no scores");
+        bool threw = false;
+        try
+        {
+            plain.predictiveTopK(U"す", 1);
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "predictiveTopK without scores should throw");
+    }
+
+    // 7b) predictiveTopK の同点: 先に見つかった長い語より、未展開の部分木にある同じ score の短い語を先に返す
+    {
+        PrefixTreeWithTermId t;
+        t.insert(U"ああ");   // termId=1, score 5
+        t.insert(U"あああ"); // termId=2, score 9
+        t.insert(U"い");     // termId=3, score 5
+        const std::vector<uint32_t> scores = {0, 5, 9, 5};
+        ConverterWithTermId conv;
+        LOUDSWithTermId louds = conv.convert(t.getRoot(), scores);
+        louds.saveToImageFile("louds_term_writer_scores_tie.img");
+        const LOUDSWithTermIdReader reader = LOUDSWithTermIdReader::mapFromImageFile("louds_term_writer_scores_tie.img");
+
+        const auto top = reader.predictiveTopK(U"", 3);
+        assert_true(top.size() == 3, "tie: predictiveTopK should return 3 matches");
+        assert_true(top[0].termId == 2, "tie: top1 should be あああ (9)");
+        assert_true(top[1].termId == 3 && top[1].length == 1, "tie: い (5) should come before the longer ああ (5)");
+        assert_true(top[2].termId == 1 && top[2].length == 2, "tie: top3 should be ああ (5)");
+    }
+
+    // =========================================================
+    // 8) FrequencyDescending: ラベル順の辞書と同じ検索結果（.bin / .img。predictive は集合で比較）
+    // =========================================================
+    {
+        std::mt19937 rng(99);
+        std::uniform_int_distribution<int> len(1, 6);
+        std::uniform_int_distribution<int> ch(0, 40); // 根の子が 32 を超える（ラベル順は二分探索になる）
+        PrefixTreeWithTermId t;
+        std::vector<std::u32string> keys;
+        for (int i = 0; i < 2000; ++i)
+        {
+            std::u32string k(static_cast<size_t>(len(rng)), U'\0');
+            for (char32_t &c : k)
+                c = static_cast<char32_t>(U'ぁ' + ch(rng));
+            t.insert(k);
+            keys.push_back(k);
+        }
+        std::vector<uint32_t> weights(keys.size() + 1);
+        std::vector<uint32_t> scores(keys.size() + 1);
+        for (size_t i = 0; i < weights.size(); ++i)
+        {
+            weights[i] = static_cast<uint32_t>(rng() % 1000 < 50 ? rng() % 100000 : rng() % 10);
+            scores[i] = static_cast<uint32_t>(rng() % 500);
+        }
+
+        ConverterWithTermId conv;
+        conv.convert(t.getRoot(), scores).saveToImageFile("louds_term_label_order.img");
+        const auto nodeWeights = NodeWeights<PrefixNodeWithTermId>::fromTermWeights(t.getRoot(), weights);
+        const LOUDSWithTermId byFreq = conv.convertByFrequency(t.getRoot(), nodeWeights, scores);
+        byFreq.saveToFile("louds_term_frequency_order.bin");
+        byFreq.saveToImageFile("louds_term_frequency_order.img");
+
+        const LOUDSWithTermIdReader base = LOUDSWithTermIdReader::mapFromImageFile("louds_term_label_order.img");
+        const LOUDSWithTermIdReader loaded = LOUDSWithTermIdReader::loadFromFile("louds_term_frequency_order.bin");
+        const LOUDSWithTermIdReader mapped = LOUDSWithTermIdReader::mapFromImageFile("louds_term_frequency_order.img");
+        assert_true(base.siblingOrder() == louds_image::SiblingOrder::CodeUnitAscending, "label order dictionary");
+
+        auto matches = [](const LOUDSWithTermIdReader &r, const std::u32string &q)
+        {
+            std::vector<std::pair<size_t, int32_t>> out;
+            r.commonPrefixSearch(std::u32string_view(q), [&](size_t length, LoudsPos, int32_t termId)
+                                 { out.emplace_back(length, termId); });
+            return out;
+        };
+        auto predictive = [](const LOUDSWithTermIdReader &r, const std::u32string &q)
+        {
+            std::vector<int32_t> out;
+            auto cursor = r.predictiveCursor(q);
+            LoudsTermPrefixMatch m;
+            while (cursor.next(m))
+                out.push_back(m.termId);
+            std::sort(out.begin(), out.end());
+            return out;
+        };
+
+        for (const LOUDSWithTermIdReader *reader : {&loaded, &mapped})
+        {
+            assert_true(reader->siblingOrder() == louds_image::SiblingOrder::FrequencyDescending,
+                        "frequency order should be recorded in .bin / .img");
+            for (size_t i = 0; i < keys.size(); i += 7)
+            {
+                std::u32string q = keys[i] + keys[(i + 1) % keys.size()];
+                assert_true(matches(*reader, q) == matches(base, q), "frequency order: commonPrefixSearch should match");
+                const LoudsPos a = reader->getNodeIndex(keys[i]);
+                assert_true(a >= 0 && reader->getLetter(a) == keys[i], "frequency order: getNodeIndex / getLetter");
+                assert_true(reader->getTermId(a) == base.getTermId(base.getNodeIndex(keys[i])), "frequency order: termId");
+                const std::u32string prefix = keys[i].substr(0, 1);
+                assert_true(predictive(*reader, prefix) == predictive(base, prefix), "frequency order: predictive set");
+                const auto top = reader->predictiveTopK(prefix, 5);
+                const auto want = base.predictiveTopK(prefix, 5);
+                assert_true(top.size() == want.size(), "frequency order: predictiveTopK size");
+                for (size_t j = 0; j < top.size(); ++j)
+                    assert_true(top[j].score == want[j].score, "frequency order: predictiveTopK scores");
+            }
+        }
+    }
+
+    // =========================================================
+    // 9) memoryUsage: .bin と .img で内訳が同じ、.img はデータ部分が mapped
+    // =========================================================
+    {
+        PrefixTreeWithTermId t;
+        for (int i = 0; i < 500; ++i)
+            t.insert(std::u32string(1, static_cast<char32_t>(U'あ' + i % 40)) + static_cast<char32_t>(U'a' + i % 26) +
+                     static_cast<char32_t>(U'0' + i % 10));
+        ConverterWithTermId conv;
+        const LOUDSWithTermId louds = conv.convert(t.getRoot());
+        louds.saveToFile("louds_term_memory.bin");
+        louds.saveToImageFile("louds_term_memory.img");
+
+        const MemoryUsage writer = louds.memoryUsage();
+        assert_true(writer.labels == louds.labels.size() * sizeof(char32_t), "memoryUsage: writer labels");
+        assert_true(writer.termIds == louds.termIdsSave.size() * sizeof(int32_t), "memoryUsage: writer termIds");
+        assert_true(writer.bits >= (louds.LBS.words().size() + louds.isLeaf.words().size()) * sizeof(uint64_t), "memoryUsage: writer bits");
+
+        const LOUDSWithTermIdReader loaded = LOUDSWithTermIdReader::loadFromFile("louds_term_memory.bin");
+        const LOUDSWithTermIdReader mapped = LOUDSWithTermIdReader::mapFromImageFile("louds_term_memory.img");
+        const MemoryUsage a = loaded.memoryUsage();
+        const MemoryUsage b = mapped.memoryUsage();
+        assert_true(a.bits == b.bits && a.labels == b.labels && a.termIds == b.termIds, "memoryUsage: same columns");
+        assert_true(a.rankDirectory == b.rankDirectory && a.selectSamples == b.selectSamples, "memoryUsage: same directories");
+        assert_true(a.rankDirectory > 0 && a.selectSamples > 0, "memoryUsage: directories counted");
+        assert_true(a.labels == louds.labels.size() * sizeof(char32_t), "memoryUsage: reader labels");
+        assert_true(a.mapped == 0 && a.heap() == a.total(), "memoryUsage: .bin is on the heap");
+        assert_true(b.mapped == b.total() - b.overhead && b.heap() == b.overhead, "memoryUsage: .img data is mapped");
+    }
+
     std::cout << "[OK] LOUDSWithTermIdReader tests passed\n";
     return 0;
 }
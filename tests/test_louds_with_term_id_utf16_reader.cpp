@@ -7,6 +7,7 @@
 #include "louds_with_term_id/converter_with_term_id_utf16.hpp"
 #include "louds_with_term_id/louds_with_term_id_utf16_writer.hpp"
 #include "louds_with_term_id/louds_with_term_id_utf16_reader.hpp"
+#include "common/sorted_louds_builder.hpp"
 
 static void assert_true(bool cond, const char *msg)
 {
@@ -65,6 +66,72 @@ int main()
         assert_true(reader.getTermId(idx_abc) == 3, "reader termId of 'abc' should be 3");
     }
 
+    // イメージ形式（mmap）でも同じ結果
+    {
+        PrefixTreeWithTermIdUtf16 t;
+        t.insert(u"a");   // 1
+        t.insert(u"ab");  // 2
+        t.insert(u"abc"); // 3
+
+        ConverterWithTermIdUtf16 conv;
+        LOUDSWithTermIdUtf16 louds = conv.convert(t.getRoot());
+
+        const std::string path = "louds_with_term_id_utf16_reader.img";
+        louds.saveToImageFile(path);
+
+        LOUDSWithTermIdUtf16Reader reader = LOUDSWithTermIdUtf16Reader::mapFromImageFile(path);
+
+        auto r = reader.commonPrefixSearch(u"abcd");
+        std::vector<std::u16string> expected = {u"a", u"ab", u"abc"};
+        assert_true(u16_equals(r, expected), "image reader commonPrefixSearch should be {a,ab,abc}");
+
+        const int idx_abc = reader.getNodeIndex(u"abc");
+        assert_true(reader.getLetter(idx_abc) == u"abc", "image reader getLetter(nodeIndex_of_abc) should be u\"abc\"");
+        assert_true(reader.getTermId(idx_abc) == 3, "image reader termId of 'abc' should be 3");
+    }
+
+    // SortedLoudsBuilder（code point 順）: サロゲートが U+E000..U+FFFF より後ろに並ぶ兄弟でも二分探索で引ける
+    {
+        // UTF-8 のバイト順に並んだキー。兄弟が kBinarySearchMinFanout 以上になるよう ASCII を足す
+        std::vector<std::u16string> keys;
+        for (char16_t c = u'A'; c < u'A' + 40; ++c)
+            keys.push_back(std::u16string(1, c));
+        keys.push_back(u"\uFF21");       // U+FF21
+        keys.push_back(u"\uFF21\u3042"); // U+FF21 U+3042
+        keys.push_back(u"\U0001F600");   // サロゲートペア（U+FF21 より後ろ）
+
+        SortedLoudsBuilder<char16_t>::Options options;
+        options.order = SortedLoudsBuilder<char16_t>::KeyOrder::CodePoint;
+        SortedLoudsBuilder<char16_t> builder(options);
+        for (const auto &k : keys)
+            builder.add(k);
+
+        const std::string path = "louds_with_term_id_utf16_sorted_builder.bin";
+        builder.writeLoudsWithTermIdFile(path);
+        LOUDSWithTermIdUtf16Reader reader = LOUDSWithTermIdUtf16Reader::loadFromFile(path);
+
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            const int idx = reader.getNodeIndex(keys[i]);
+            assert_true(idx >= 0, "sorted builder: every key should be found");
+            assert_true(reader.getTermId(idx) == static_cast<int32_t>(i + 1), "sorted builder: termId should follow add order");
+        }
+        assert_true(reader.getNodeIndex(u"\uFF22") < 0, "sorted builder: missing key should not be found");
+
+        SortedLoudsBuilder<char16_t> unitOrder;
+        unitOrder.add(u"\uFF21");
+        bool threw = false;
+        try
+        {
+            unitOrder.add(u"\U0001F600"); // code unit 順では D83D < FF21
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "sorted builder: code unit order should reject surrogates after U+FF21");
+    }
+
     std::cout << "[OK] LOUDSWithTermId UTF-16 reader tests passed\n";
     return 0;
 }
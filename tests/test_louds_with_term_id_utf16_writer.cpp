@@ -2,8 +2,14 @@
 #include <cstdlib>
 #include <vector>
 #include <string>
+#include <fstream>
+#include <iterator>
+#include <random>
 
+#include "prefix/prefix_tree_utf16.hpp"
 #include "prefix_with_term_id/prefix_tree_with_term_id_utf16.hpp"
+#include "louds/louds_converter_utf16.hpp"
+#include "louds/louds_utf16_writer.hpp"
 #include "louds_with_term_id/converter_with_term_id_utf16.hpp"
 #include "louds_with_term_id/louds_with_term_id_utf16_writer.hpp"
 
@@ -86,6 +92,114 @@ int main()
         assert_true(louds.getTermId(idx) == 3, "termId of 'すみれ' should be 3");
     }
 
+    // saveLoudsToFile: termId 無しの LOUDSUtf16 と同じバイト列
+    {
+        const std::vector<std::u16string> keys = {u"すみれ", u"す", u"あお", u"すもも", u"あ"};
+        PrefixTreeUtf16 plainTree;
+        PrefixTreeWithTermIdUtf16 termTree;
+        for (const auto &k : keys)
+        {
+            plainTree.insert(k);
+            termTree.insert(k);
+        }
+        ConverterUtf16 plainConv;
+        LOUDSUtf16 plain = plainConv.convert(plainTree.getRoot());
+        ConverterWithTermIdUtf16 termConv;
+        LOUDSWithTermIdUtf16 withTermId = termConv.convert(termTree.getRoot());
+
+        auto readAll = [](const std::string &path)
+        {
+            std::ifstream ifs(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        };
+
+        plain.saveToFile("louds_utf16_plain_expected.bin", true);
+        withTermId.saveLoudsToFile("louds_utf16_plain_shared.bin", true);
+        assert_true(readAll("louds_utf16_plain_expected.bin") == readAll("louds_utf16_plain_shared.bin"),
+                    "saveLoudsToFile should write the same bytes as LOUDSUtf16::saveToFile");
+        LOUDSUtf16 loaded = LOUDSUtf16::loadFromFile("louds_utf16_plain_shared.bin");
+        assert_true(loaded.equals(plain), "saveLoudsToFile output should load as LOUDSUtf16");
+    }
+
+    // convertParallel: スレッド数によらず convert と同じ（サロゲートペアを含むキーも混ぜる）
+    {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> len(1, 6);
+        std::uniform_int_distribution<int> ch(0, 9);
+        PrefixTreeUtf16 plainTree;
+        PrefixTreeWithTermIdUtf16 termTree;
+        for (int i = 0; i < 2000; ++i)
+        {
+            std::u16string k;
+            for (int j = len(rng); j > 0; --j)
+            {
+                const int c = ch(rng);
+                if (c == 0)
+                    k += u"\U0001F600";
+                else
+                    k.push_back(static_cast<char16_t>(u'あ' + c));
+            }
+            plainTree.insert(k);
+            termTree.insert(k);
+        }
+
+        ConverterUtf16 plainConv;
+        ConverterWithTermIdUtf16 termConv;
+        const LOUDSUtf16 plainSerial = plainConv.convert(plainTree.getRoot());
+        const LOUDSWithTermIdUtf16 termSerial = termConv.convert(termTree.getRoot());
+        for (size_t threads : {size_t{0}, size_t{1}, size_t{2}, size_t{5}})
+        {
+            assert_true(plainConv.convertParallel(plainTree.getRoot(), threads).equals(plainSerial),
+                        "convertParallel: LOUDSUtf16 should match convert");
+            assert_true(termConv.convertParallel(termTree.getRoot(), threads).equals(termSerial),
+                        "convertParallel: LOUDSWithTermIdUtf16 should match convert");
+        }
+    }
+
+    // convertByFrequency: 兄弟がクエリのアクセス数の降順。検索結果と termId は convert と同じで、並び順は保存される
+    {
+        PrefixTreeUtf16 plainTree;
+        PrefixTreeWithTermIdUtf16 termTree;
+        const std::vector<std::u16string> keys = {u"すし", u"すみれ", u"すもも", u"あお", u"\U0001F600ね", u"か"};
+        for (const auto &k : keys)
+        {
+            plainTree.insert(k);
+            termTree.insert(k);
+        }
+        NodeWeights<PrefixNodeUtf16> plainWeights;
+        NodeWeights<PrefixNodeWithTermIdUtf16> termWeights;
+        for (const char16_t *q : {u"\U0001F600ね", u"\U0001F600", u"すも", u"か"})
+        {
+            plainWeights.addQuery(plainTree.getRoot(), q);
+            termWeights.addQuery(termTree.getRoot(), q);
+        }
+
+        ConverterWithTermIdUtf16 termConv;
+        const LOUDSWithTermIdUtf16 byLabel = termConv.convert(termTree.getRoot());
+        const LOUDSWithTermIdUtf16 byFreq = termConv.convertByFrequency(termTree.getRoot(), termWeights);
+        // 根の子: 上位サロゲート(2) > か(1) = す(1)（同じ重みは code unit 昇順）> あ(0)
+        assert_true(byFreq.labels[2] == static_cast<char16_t>(0xD83D) && byFreq.labels[3] == u'か' &&
+                        byFreq.labels[4] == u'す' && byFreq.labels[5] == u'あ',
+                    "convertByFrequency (UTF-16): root children by access count");
+        for (const auto &k : keys)
+        {
+            assert_true(u16_equals(byFreq.commonPrefixSearch(k), byLabel.commonPrefixSearch(k)),
+                        "convertByFrequency (UTF-16): commonPrefixSearch should match convert");
+            assert_true(byFreq.getTermId(byFreq.getNodeIndex(k)) == byLabel.getTermId(byLabel.getNodeIndex(k)),
+                        "convertByFrequency (UTF-16): termId should match convert");
+        }
+
+        const std::string path = "louds_termid_utf16_frequency.bin";
+        byFreq.saveToFile(path);
+        const LOUDSWithTermIdUtf16 loaded = LOUDSWithTermIdUtf16::loadFromFile(path);
+        assert_true(loaded.equals(byFreq) && loaded.siblingOrder == louds_image::SiblingOrder::FrequencyDescending,
+                    "convertByFrequency (UTF-16): order survives round-trip");
+
+        const LOUDSUtf16 plainFreq = ConverterUtf16().convertByFrequency(plainTree.getRoot(), plainWeights);
+        assert_true(plainFreq.labels == byFreq.labels && plainFreq.siblingOrder == byFreq.siblingOrder,
+                    "convertByFrequency (UTF-16): LOUDSUtf16 has the same layout");
+    }
+
     std::cout << "[OK] LOUDSWithTermId UTF-16 writer tests passed\n";
     return 0;
 }
@@ -0,0 +1,391 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <random>
+#include <span>
+#include <algorithm>
+
+#include "common/bit_vector.hpp"
+#include "common/succinct_bit_vector.hpp"
+#include "common/bit_ops.hpp"
+#include "common/hot_path_counters.hpp"
+
+static void assert_true(bool cond, const std::string &msg)
+{
+    if (!cond)
+    {
+        std::cerr << "[FAIL] " << msg << "\n";
+        std::exit(1);
+    }
+}
+
+// 素朴な数え上げを正解として SuccinctBitVector と突き合わせる
+static void check_against_naive(size_t nbits, double density, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution coin(density);
+
+    BitVector bv;
+    for (size_t i = 0; i < nbits; ++i)
+        bv.push_back(coin(rng));
+
+    SuccinctBitVector sbv(bv);
+    const std::string tag = "n=" + std::to_string(nbits) + " density=" + std::to_string(density);
+
+    assert_true(sbv.size() == static_cast<int>(nbits), tag + ": size");
+
+    // 素朴に 1 / 0 の位置を列挙しておく（BitVector::select は O(n) なので使わない）
+    std::vector<int> onePos, zeroPos;
+    int ones = 0;
+    for (size_t i = 0; i < nbits; ++i)
+    {
+        if (bv.get(i))
+        {
+            ++ones;
+            onePos.push_back(static_cast<int>(i));
+        }
+        else
+        {
+            zeroPos.push_back(static_cast<int>(i));
+        }
+        const int idx = static_cast<int>(i);
+        assert_true(sbv.rank1(idx) == ones, tag + ": rank1 at " + std::to_string(i));
+        assert_true(sbv.rank0(idx) == idx + 1 - ones, tag + ": rank0 at " + std::to_string(i));
+    }
+    assert_true(sbv.totalOnes() == ones, tag + ": totalOnes");
+
+    const int zeros = static_cast<int>(nbits) - ones;
+    for (int k = 1; k <= ones; ++k)
+        assert_true(sbv.select1(k) == onePos[static_cast<size_t>(k - 1)], tag + ": select1(" + std::to_string(k) + ")");
+    for (int k = 1; k <= zeros; ++k)
+        assert_true(sbv.select0(k) == zeroPos[static_cast<size_t>(k - 1)], tag + ": select0(" + std::to_string(k) + ")");
+
+    // 範囲外
+    assert_true(sbv.rank1(-1) == 0, tag + ": rank1(-1)");
+    assert_true(sbv.rank1(static_cast<int>(nbits) + 10) == ones, tag + ": rank1 past end");
+    assert_true(sbv.select1(0) == -1, tag + ": select1(0)");
+    assert_true(sbv.select1(ones + 1) == -1, tag + ": select1 past end");
+    assert_true(sbv.select0(zeros + 1) == -1, tag + ": select0 past end");
+}
+
+// word 内 select（broadword 版）を 1bit ずつの走査と突き合わせる
+static void check_select64(uint64_t x)
+{
+    int k = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+        if ((x >> i) & 1ULL)
+        {
+            ++k;
+            assert_true(bit_ops::select64Broadword(x, k) == i, "select64Broadword");
+            assert_true(bit_ops::select64(x, k) == i, "select64");
+        }
+    }
+}
+
+static const bit_ops::Kernel kAllKernels[] = {bit_ops::Kernel::Portable, bit_ops::Kernel::Popcnt,
+                                               bit_ops::Kernel::Bmi2, bit_ops::Kernel::Avx512};
+
+// CPU が対応しているカーネルだけ返す
+static std::vector<bit_ops::Kernel> supported_kernels()
+{
+    const bit_ops::Kernel original = bit_ops::activeKernel();
+    std::vector<bit_ops::Kernel> out;
+    for (bit_ops::Kernel k : kAllKernels)
+    {
+        if (bit_ops::setKernel(k))
+            out.push_back(k);
+    }
+    bit_ops::setKernel(original);
+    return out;
+}
+
+// 複数 word の popcount・ディレクトリ・BitVector の rank/select をカーネルごとに突き合わせる
+static void check_kernel(bit_ops::Kernel kernel, const std::vector<uint64_t> &expectedRankDir, const BitVector &bv)
+{
+    const std::string tag = std::string("kernel ") + bit_ops::kernelName(kernel);
+    assert_true(bit_ops::setKernel(kernel), tag + ": setKernel");
+    assert_true(bit_ops::activeKernel() == kernel, tag + ": activeKernel");
+
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> words(37);
+    for (uint64_t &w : words)
+        w = rng() & rng();
+    uint64_t naive = 0;
+    for (size_t n = 0; n <= words.size(); ++n)
+    {
+        assert_true(bit_ops::popcountWords(words.data(), n) == naive, tag + ": popcountWords n=" + std::to_string(n));
+        if (n < words.size())
+            naive += static_cast<uint64_t>(__builtin_popcountll(words[n]));
+    }
+
+    for (int i = 0; i < 200; ++i)
+        check_select64(rng() & rng());
+
+    const SuccinctBitVector sbv(bv);
+    const std::span<const uint64_t> dir = sbv.rankDirectory();
+    assert_true(std::equal(dir.begin(), dir.end(), expectedRankDir.begin(), expectedRankDir.end()), tag + ": rank directory");
+
+    // BitVector の rank / select（word 単位の走査）を SuccinctBitVector と比べる
+    const int n = static_cast<int>(bv.size());
+    for (int i = 0; i < n; i += 37)
+        assert_true(bv.rank1(i) == sbv.rank1(i), tag + ": BitVector::rank1");
+    for (int k = 1; k <= sbv.totalOnes(); k += 29)
+        assert_true(bv.select1(k) == sbv.select1(k), tag + ": BitVector::select1");
+    for (int k = 1; k <= n - sbv.totalOnes(); k += 31)
+        assert_true(bv.select0(k) == sbv.select0(k), tag + ": BitVector::select0");
+    assert_true(bv.select0(n - sbv.totalOnes() + 1) == -1, tag + ": BitVector::select0 past end");
+    assert_true(bv.select1(sbv.totalOnes() + 1) == -1, tag + ": BitVector::select1 past end");
+
+    check_against_naive(4096 + 7, 0.5, 900 + static_cast<uint32_t>(kernel));
+}
+
+// BitVectorBuilder の各操作を BitVector::push_back と突き合わせる
+static void check_builder(uint32_t seed)
+{
+    std::mt19937_64 rng(seed);
+    BitVectorBuilder builder;
+    BitVector expected;
+    builder.reserve(1000);
+    for (int op = 0; op < 400; ++op)
+    {
+        switch (rng() % 4)
+        {
+        case 0:
+        {
+            const bool b = (rng() & 1) != 0;
+            builder.push_back(b);
+            expected.push_back(b);
+            break;
+        }
+        case 1:
+        {
+            const uint64_t w = rng();
+            const unsigned count = static_cast<unsigned>(rng() % 65);
+            builder.appendWord(w, count);
+            for (unsigned i = 0; i < count; ++i)
+                expected.push_back((w >> i) & 1ULL);
+            break;
+        }
+        case 2:
+        {
+            const bool b = (rng() & 1) != 0;
+            const size_t count = static_cast<size_t>(rng() % 150);
+            builder.appendRun(b, count);
+            for (size_t i = 0; i < count; ++i)
+                expected.push_back(b);
+            break;
+        }
+        default:
+        {
+            BitVectorBuilder other;
+            const size_t count = static_cast<size_t>(rng() % 200);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const bool b = (rng() % 3) == 0;
+                other.push_back(b);
+                expected.push_back(b);
+            }
+            builder.append(other);
+            break;
+        }
+        }
+        assert_true(builder.size() == expected.size(), "builder: size");
+    }
+    const BitVector built = builder.build();
+    assert_true(built.equals(expected), "builder: words should match push_back");
+    assert_true(builder.size() == 0, "builder: build() should leave the builder empty");
+}
+
+int main()
+{
+    {
+        std::mt19937_64 rng(42);
+        check_select64(~0ULL);
+        check_select64(1ULL);
+        check_select64(1ULL << 63);
+        for (int i = 0; i < 1000; ++i)
+            check_select64(rng() & rng());
+    }
+
+    // 空
+    {
+        BitVector bv;
+        SuccinctBitVector sbv(bv);
+        assert_true(sbv.rank1(0) == 0, "empty: rank1");
+        assert_true(sbv.select1(1) == -1, "empty: select1");
+        assert_true(sbv.select0(1) == -1, "empty: select0");
+    }
+
+    // ブロック境界（64 / 512 bit）前後と、疎・密・全 0・全 1
+    const size_t sizes[] = {1, 63, 64, 65, 511, 512, 513, 4096 + 7, 300000};
+    const double densities[] = {0.0, 0.02, 0.5, 0.98, 1.0};
+    uint32_t seed = 1;
+    for (size_t n : sizes)
+    {
+        for (double d : densities)
+        {
+            check_against_naive(n, d, seed++);
+        }
+    }
+
+    for (uint32_t s = 1; s <= 50; ++s)
+        check_builder(s);
+
+    // カーネルごと（CPU が対応しているものだけ）。ディレクトリはポータブル版と同じになること
+    {
+        const bit_ops::Kernel original = bit_ops::activeKernel();
+        std::mt19937 rng(3);
+        std::bernoulli_distribution coin(0.3);
+        BitVector bv;
+        for (size_t i = 0; i < 64 * 8 * 20 + 100; ++i)
+            bv.push_back(coin(rng));
+
+        bit_ops::setKernel(bit_ops::Kernel::Portable);
+        const SuccinctBitVector reference(bv);
+        const std::vector<uint64_t> expectedRankDir(reference.rankDirectory().begin(), reference.rankDirectory().end());
+
+        for (bit_ops::Kernel k : supported_kernels())
+            check_kernel(k, expectedRankDir, bv);
+        bit_ops::setKernel(original);
+    }
+
+    // 前計算済みディレクトリ: 開くときはサンプルの中身を見ず、validate で検出する。壊れたサンプルでも範囲外は読まない
+    {
+        BitVector bv;
+        for (size_t i = 0; i < 512 * 16; ++i)
+            bv.push_back(i % 5 == 0);
+        const SuccinctBitVector ref(bv);
+        std::vector<uint64_t> dir(ref.rankDirectory().begin(), ref.rankDirectory().end());
+        std::vector<uint32_t> s1(ref.select1Samples().begin(), ref.select1Samples().end());
+        std::vector<uint32_t> s0(ref.select0Samples().begin(), ref.select0Samples().end());
+
+        const SuccinctBitVector good(bv, dir, s1, s0);
+        good.validate();
+        assert_true(good.select1(3) == ref.select1(3), "adopted directory: select1");
+
+        s0.back() = 1000000;
+        const SuccinctBitVector bad(bv, dir, s1, s0);
+        bool threw = false;
+        try
+        {
+            bad.validate();
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert_true(threw, "validate: corrupted select samples");
+        (void)bad.select0(static_cast<LoudsPos>(bv.size()) - bad.totalOnes());
+
+        // 壊れた rank ディレクトリ（累積値・9 bit の相対値）: validate が検出し、select は範囲外を読まず -1 か範囲内を返す
+        const auto corrupted = [&](size_t index, uint64_t value)
+        {
+            std::vector<uint64_t> d = dir;
+            d[index] = value;
+            const SuccinctBitVector c(bv, d, std::vector<uint32_t>(ref.select1Samples().begin(), ref.select1Samples().end()),
+                                      std::vector<uint32_t>(ref.select0Samples().begin(), ref.select0Samples().end()));
+            bool caught = false;
+            try
+            {
+                c.validate();
+            }
+            catch (const std::runtime_error &)
+            {
+                caught = true;
+            }
+            assert_true(caught, "validate: corrupted rank directory");
+            const LoudsPos n = static_cast<LoudsPos>(bv.size());
+            for (LoudsPos i = 1; i <= c.totalOnes(); ++i)
+            {
+                const LoudsPos p1 = c.select1(i);
+                assert_true(p1 >= -1 && p1 < n, "corrupted rank directory: select1 stays in range");
+            }
+            for (LoudsPos i = 1; i <= n - c.totalOnes(); ++i)
+            {
+                const LoudsPos p0 = c.select0(i);
+                assert_true(p0 >= -1 && p0 < n, "corrupted rank directory: select0 stays in range");
+            }
+        };
+        corrupted(2 * 5, dir[2 * 5] + 700);     // 累積値が次のブロックを越える
+        corrupted(2 * 3, 0);                    // 累積値が戻る（local が 512 を超える）
+        corrupted(2 * 7 + 1, ~0ULL);            // 相対値が全部 511
+        corrupted(2 * 15 + 1, 0);               // 末尾ブロックの相対値が全部 0: k が 7 まで進む
+    }
+
+    // 端数のある末尾ブロック（2 word）の相対値が壊れていても、select は末尾 word より後ろを読まない
+    {
+        BitVector grown;
+        for (size_t i = 0; i < 512 * 4 + 70; ++i)
+            grown.push_back(i % 3 == 0);
+        BitVector bv; // word 列をちょうどの大きさで持たせる（sanitizer で末尾より後ろの読み出しを検出できる）
+        bv.assign_from_words(grown.size(), std::vector<uint64_t>(grown.words().begin(), grown.words().end()));
+        const SuccinctBitVector ref(bv);
+        std::vector<uint64_t> dir(ref.rankDirectory().begin(), ref.rankDirectory().end());
+        dir.back() = 0;
+        const SuccinctBitVector c(bv, dir, std::vector<uint32_t>(ref.select1Samples().begin(), ref.select1Samples().end()),
+                                  std::vector<uint32_t>(ref.select0Samples().begin(), ref.select0Samples().end()));
+        const LoudsPos n = static_cast<LoudsPos>(bv.size());
+        for (LoudsPos i = 1; i <= c.totalOnes(); ++i)
+        {
+            const LoudsPos p1 = c.select1(i);
+            assert_true(p1 >= -1 && p1 < n, "corrupted tail block: select1 stays in range");
+        }
+        for (LoudsPos i = 1; i <= n - c.totalOnes(); ++i)
+        {
+            const LoudsPos p0 = c.select0(i);
+            assert_true(p0 >= -1 && p0 < n, "corrupted tail block: select0 stays in range");
+        }
+    }
+
+    // memoryUsage: ディレクトリは 2 word / 512 bit、select ヒントは 512 個ごとに 1 つ（ビット列は SuccinctBitVector に含めない）
+    {
+        BitVector bv;
+        for (size_t i = 0; i < 512 * 10 + 3; ++i)
+            bv.push_back(i % 3 == 0);
+        const MemoryUsage bits = bv.memoryUsage();
+        assert_true(bits.bits == bv.words().size() * sizeof(uint64_t), "memoryUsage: BitVector bits");
+        assert_true(bits.overhead >= sizeof(BitVector), "memoryUsage: BitVector overhead");
+
+        const SuccinctBitVector sbv(bv);
+        const MemoryUsage dir = sbv.memoryUsage();
+        assert_true(dir.bits == 0, "memoryUsage: SuccinctBitVector does not own the bits");
+        assert_true(dir.rankDirectory == 11 * 2 * sizeof(uint64_t), "memoryUsage: rank directory");
+        const uint64_t ones = static_cast<uint64_t>(sbv.totalOnes());
+        const uint64_t zeros = bv.size() - ones;
+        assert_true(dir.selectSamples == ((ones + 511) / 512 + (zeros + 511) / 512) * sizeof(uint32_t), "memoryUsage: select samples");
+        assert_true(dir.mapped == 0 && dir.heap() == dir.total(), "memoryUsage: nothing mapped");
+    }
+
+    // 検索の内訳カウンタ: 有効なビルドでは呼び出し回数を数え、無効なビルドでは常に 0
+    {
+        BitVector bv;
+        for (size_t i = 0; i < 4096; ++i)
+            bv.push_back(i % 2 == 0);
+        const SuccinctBitVector sbv(bv);
+
+        hot_path_counters::reset();
+        (void)sbv.rank1(100);
+        (void)sbv.rank0(3000);
+        (void)sbv.select1(7);
+        (void)sbv.select0(1000);
+        (void)sbv.select0(0); // 範囲外は数えない
+        const hot_path_counters::Counters c = hot_path_counters::snapshot();
+        if (hot_path_counters::kEnabled)
+        {
+            assert_true(c.rank == 2 && c.select == 2, "hot_path_counters: rank / select calls");
+            assert_true(c.cacheLines >= 4, "hot_path_counters: cache lines");
+        }
+        else
+        {
+            assert_true(c.rank == 0 && c.select == 0 && c.cacheLines == 0, "hot_path_counters: compiled out");
+        }
+        hot_path_counters::reset();
+        assert_true(hot_path_counters::snapshot().rank == 0, "hot_path_counters: reset");
+    }
+
+    std::cout << "[OK] SuccinctBitVector tests passed\n";
+    return 0;
+}
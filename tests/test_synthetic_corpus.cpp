@@ -0,0 +1,130 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <algorithm>
+
+#include "tools/synthetic_corpus.hpp"
+
+static void assert_true(bool cond, const std::string &msg)
+{
+    if (!cond)
+    {
+        std::cerr << "[FAIL] " << msg << "\n";
+        std::exit(1);
+    }
+}
+
+using synthetic_corpus::Generator;
+using synthetic_corpus::Options;
+
+int main()
+{
+    Options options;
+    options.keys = 20000;
+    options.seed = 7;
+    const Generator gen(options);
+
+    // 同じ seed なら同じキー（作り直しても、別の Generator でも）、seed が違えば別のキー
+    {
+        const Generator again(options);
+        Options other = options;
+        other.seed = 8;
+        const Generator different(other);
+        std::u32string a, b, c;
+        size_t same = 0;
+        for (uint64_t i = 0; i < 1000; ++i)
+        {
+            gen.key(i, a);
+            again.key(i, b);
+            assert_true(a == b, "deterministic key " + std::to_string(i));
+            gen.key(i, b);
+            assert_true(a == b, "key is a function of i " + std::to_string(i));
+            different.key(i, c);
+            same += (a == c);
+        }
+        assert_true(same < 50, "different seed gives different keys");
+    }
+
+    // 長さの範囲と文字種、平均の長さ
+    std::unordered_set<std::u32string> keys;
+    {
+        std::u32string k;
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < options.keys; ++i)
+        {
+            gen.key(i, k);
+            assert_true(k.size() >= options.minLength && k.size() <= options.maxLength, "length in range");
+            assert_true(std::all_of(k.begin(), k.end(), Generator::isKeyChar), "key chars");
+            total += k.size();
+            keys.insert(k);
+        }
+        const double mean = static_cast<double>(total) / static_cast<double>(options.keys);
+        assert_true(mean > options.meanLength * 0.8 && mean < options.meanLength * 1.5, "mean length near --mean-length");
+        assert_true(keys.size() > options.keys * 9 / 10, "few duplicates");
+    }
+
+    // ヒットクエリは必ずキー、ミスクエリは必ずキーでない
+    {
+        std::u32string q;
+        for (uint64_t j = 0; j < 5000; ++j)
+        {
+            gen.hitQuery(j, q);
+            assert_true(keys.count(q) == 1, "hit query is a key");
+            gen.missQuery(j, q);
+            assert_true(keys.count(q) == 0, "miss query is not a key");
+            assert_true(!std::all_of(q.begin(), q.end(), Generator::isKeyChar), "miss query has a non-key char");
+        }
+    }
+
+    // 語幹 1 つ・共有率 1 なら全キーが同じ語幹から始まる
+    {
+        Options o = options;
+        o.keys = 2000;
+        o.prefixShare = 1.0;
+        o.stems = 1;
+        const Generator shared(o);
+        std::u32string first, k;
+        shared.key(0, first);
+        for (uint64_t i = 1; i < o.keys; ++i)
+        {
+            shared.key(i, k);
+            assert_true(!k.empty() && k[0] == first[0], "shared stem");
+        }
+    }
+
+    // 文字種の重み: ひらがなだけ
+    {
+        Options o = options;
+        o.keys = 1000;
+        o.prefixShare = 0.0;
+        o.weightKanji = o.weightKatakana = o.weightAscii = 0;
+        const Generator hira(o);
+        std::u32string k;
+        for (uint64_t i = 0; i < o.keys; ++i)
+        {
+            hira.key(i, k);
+            assert_true(std::all_of(k.begin(), k.end(), [](char32_t c)
+                                    { return c >= 0x3041 && c <= 0x3093; }),
+                        "hiragana only");
+        }
+    }
+
+    // zipfIndex は範囲内、s = 0 は一様に近い
+    {
+        synthetic_corpus::Rng rng(1);
+        uint64_t low = 0;
+        for (int i = 0; i < 10000; ++i)
+        {
+            const uint64_t z = synthetic_corpus::zipfIndex(rng.unit(), 100, 1.0);
+            assert_true(z < 100, "zipf in range");
+            low += (z < 10);
+            assert_true(synthetic_corpus::zipfIndex(rng.unit(), 100, 0.0) < 100, "uniform in range");
+        }
+        assert_true(low > 4000, "zipf favours small ranks");
+    }
+
+    std::cout << "[OK] synthetic corpus tests passed\n";
+    return 0;
+}
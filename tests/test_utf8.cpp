@@ -0,0 +1,220 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <random>
+
+#include "common/utf8.hpp"
+
+static void assert_true(bool cond, const std::string &msg)
+{
+    if (!cond)
+    {
+        std::cerr << "[FAIL] " << msg << "\n";
+        std::exit(1);
+    }
+}
+
+static const utf8::Kernel kAllKernels[] = {utf8::Kernel::Scalar, utf8::Kernel::Sse2, utf8::Kernel::Avx2};
+
+// CPU が対応しているカーネルだけ返す
+static std::vector<utf8::Kernel> supported_kernels()
+{
+    const utf8::Kernel original = utf8::activeKernel();
+    std::vector<utf8::Kernel> out;
+    for (utf8::Kernel k : kAllKernels)
+    {
+        if (utf8::setKernel(k))
+            out.push_back(k);
+    }
+    utf8::setKernel(original);
+    return out;
+}
+
+// ASCII / 2 byte / 3 byte / 4 byte の連続を混ぜた code point 列（SIMD の各経路と境界を通す）
+static std::u32string random_code_points(std::mt19937 &rng, size_t runs)
+{
+    std::uniform_int_distribution<int> kindDist(0, 3);
+    std::uniform_int_distribution<int> runDist(1, 40);
+    std::u32string s;
+    for (size_t r = 0; r < runs; ++r)
+    {
+        const int kind = kindDist(rng);
+        const int len = runDist(rng);
+        for (int i = 0; i < len; ++i)
+        {
+            char32_t cp = 0;
+            switch (kind)
+            {
+            case 0:
+                cp = std::uniform_int_distribution<char32_t>(0x01, 0x7F)(rng);
+                break;
+            case 1:
+                cp = std::uniform_int_distribution<char32_t>(0x80, 0x7FF)(rng);
+                break;
+            case 2:
+                do
+                {
+                    cp = std::uniform_int_distribution<char32_t>(0x800, 0xFFFF)(rng);
+                } while (cp >= 0xD800 && cp <= 0xDFFF);
+                break;
+            default:
+                cp = std::uniform_int_distribution<char32_t>(0x10000, 0x10FFFF)(rng);
+                break;
+            }
+            s.push_back(cp);
+        }
+    }
+    return s;
+}
+
+static std::u16string to_u16_naive(const std::u32string &s)
+{
+    std::u16string out;
+    for (char32_t cp : s)
+    {
+        if (cp >= 0x10000)
+        {
+            const char32_t v = cp - 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (v >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (v & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(static_cast<char16_t>(cp));
+        }
+    }
+    return out;
+}
+
+static std::string repeat(const std::string &unit, size_t n)
+{
+    std::string s;
+    for (size_t i = 0; i < n; ++i)
+        s += unit;
+    return s;
+}
+
+int main()
+{
+    const std::vector<utf8::Kernel> kernels = supported_kernels();
+    assert_true(!kernels.empty() && kernels.front() == utf8::Kernel::Scalar, "scalar kernel is always available");
+
+    // 1) 正しい列: すべてのカーネルで code point 列に戻り、UTF-8 にも戻る
+    {
+        std::mt19937 rng(12345);
+        for (int iter = 0; iter < 300; ++iter)
+        {
+            const std::u32string cps = random_code_points(rng, static_cast<size_t>(iter % 12));
+            const std::string bytes = utf8::fromUtf32(cps);
+            const std::u16string units = to_u16_naive(cps);
+            for (utf8::Kernel k : kernels)
+            {
+                utf8::setKernel(k);
+                const std::string tag = std::string(utf8::kernelName(k)) + " iter=" + std::to_string(iter);
+                std::u32string out32 = U"stale";
+                std::u16string out16 = u"stale";
+                assert_true(utf8::toUtf32(bytes, out32), tag + ": toUtf32 ok");
+                assert_true(out32 == cps, tag + ": toUtf32 value");
+                assert_true(utf8::toUtf16(bytes, out16), tag + ": toUtf16 ok");
+                assert_true(out16 == units, tag + ": toUtf16 value");
+                assert_true(utf8::fromUtf16(out16) == bytes, tag + ": fromUtf16 round trip");
+            }
+        }
+    }
+
+    // 2) 不正な列: SIMD の窓の中・境界・末尾のどこにあっても false
+    {
+        const std::string ascii = repeat("a", 40);
+        const std::string two = repeat("\xC3\xA9", 40);       // é
+        const std::string three = repeat("\xE3\x81\x82", 40); // あ
+        const std::string bad[] = {
+            "\xC0\x80",         // overlong (2 byte)
+            "\xC1\xBF",         // overlong (2 byte)
+            "\xE0\x80\x80",     // overlong (3 byte)
+            "\xE0\x9F\xBF",     // overlong (3 byte)
+            "\xED\xA0\x80",     // high surrogate
+            "\xED\xBF\xBF",     // low surrogate
+            "\xF0\x8F\xBF\xBF", // overlong (4 byte)
+            "\xF4\x90\x80\x80", // > U+10FFFF
+            "\x80",             // 単独の継続 byte
+            "\xFF",
+            "\xE3\x81",         // 途中で切れた 3 byte 列（後ろに別の文字が続く）
+            "\xC3",
+        };
+        const std::string contexts[] = {ascii, two, three};
+        for (utf8::Kernel k : kernels)
+        {
+            utf8::setKernel(k);
+            for (size_t b = 0; b < std::size(bad); ++b)
+            {
+                for (const std::string &ctx : contexts)
+                {
+                    for (size_t at : {size_t{0}, size_t{6}, size_t{12}, size_t{30}, ctx.size()})
+                    {
+                        const std::string s = ctx.substr(0, at) + bad[b] + ctx.substr(at);
+                        const std::string tag = std::string(utf8::kernelName(k)) + " bad=" + std::to_string(b) + " at=" + std::to_string(at);
+                        std::u32string out32;
+                        std::u16string out16;
+                        assert_true(!utf8::toUtf32(s, out32), tag + ": toUtf32 rejects");
+                        assert_true(!utf8::toUtf16(s, out16), tag + ": toUtf16 rejects");
+                    }
+                }
+            }
+            // 末尾で切れた列
+            std::u32string out32;
+            assert_true(!utf8::toUtf32(three.substr(0, three.size() - 1), out32), std::string(utf8::kernelName(k)) + ": truncated tail");
+        }
+    }
+
+    // 3) 1 byte を壊した列: すべてのカーネルがスカラーと同じ結果（成否と値）
+    {
+        std::mt19937 rng(777);
+        for (int iter = 0; iter < 2000; ++iter)
+        {
+            std::string bytes = utf8::fromUtf32(random_code_points(rng, 6));
+            if (bytes.empty())
+                continue;
+            bytes[std::uniform_int_distribution<size_t>(0, bytes.size() - 1)(rng)] =
+                static_cast<char>(std::uniform_int_distribution<int>(0, 255)(rng));
+
+            utf8::setKernel(utf8::Kernel::Scalar);
+            std::u32string want32;
+            std::u16string want16;
+            const bool ok32 = utf8::toUtf32(bytes, want32);
+            const bool ok16 = utf8::toUtf16(bytes, want16);
+            assert_true(ok32 == ok16, "scalar: toUtf32 / toUtf16 agree");
+            for (utf8::Kernel k : kernels)
+            {
+                utf8::setKernel(k);
+                const std::string tag = std::string(utf8::kernelName(k)) + " mutated iter=" + std::to_string(iter);
+                std::u32string got32;
+                std::u16string got16;
+                assert_true(utf8::toUtf32(bytes, got32) == ok32, tag + ": toUtf32 ok");
+                assert_true(utf8::toUtf16(bytes, got16) == ok16, tag + ": toUtf16 ok");
+                if (ok32)
+                {
+                    assert_true(got32 == want32, tag + ": toUtf32 value");
+                    assert_true(got16 == want16, tag + ": toUtf16 value");
+                }
+            }
+        }
+    }
+
+    // 4) エンコーダ: 対になっていないサロゲートと範囲外は '?'
+    {
+        assert_true(utf8::fromUtf16(std::u16string{u'a', 0xD800}) == "a?", "fromUtf16: trailing high surrogate");
+        assert_true(utf8::fromUtf16(std::u16string{0xD800, u'b'}) == "?b", "fromUtf16: unpaired high surrogate");
+        assert_true(utf8::fromUtf16(std::u16string{0xDC00, u'b'}) == "?b", "fromUtf16: stray low surrogate");
+        assert_true(utf8::fromUtf32(std::u32string{0xD800, 0x110000, U'x'}) == "??x", "fromUtf32: surrogate / out of range");
+        assert_true(utf8::fromUtf32(U"東京\U0001F600") == "\xE6\x9D\xB1\xE4\xBA\xAC\xF0\x9F\x98\x80", "fromUtf32: value");
+    }
+
+    utf8::setKernel(kernels.back());
+    std::cout << "[OK] utf8 tests passed (kernels:";
+    for (utf8::Kernel k : kernels)
+        std::cout << " " << utf8::kernelName(k);
+    std::cout << ")\n";
+    return 0;
+}